@@ -0,0 +1,131 @@
+/*
+ * benchmark_dense.cpp
+ * Compares per-channel and dense reading of FFT bins for large channel counts
+ *
+ * Copyright (C) 2024 charlie-foxtrot
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <vector>
+
+#include "dense_bins.h"
+#include "squelch.h"
+
+using namespace std;
+
+// 8.33 kHz channels across 2.4 MHz need bins narrower than the channel spacing
+static const size_t fft_size = 2048;
+static const int sample_rate = 2400000;
+static const int batch = 1000;    // wave samples per demodulator batch, one FFT each
+static const int batches = 200;  // 25 seconds of audio at 8 kHz
+
+// stand-in for channel_t - per-channel buffers far apart in memory, as in the real struct
+struct bench_channel {
+    float wavein[batch];
+    float waveout[batch];
+    float iq_in[2 * batch];
+    Squelch squelch;
+};
+
+static double elapsed(chrono::steady_clock::time_point start) {
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+static void run(int channel_count) {
+    vector<float> fft(2 * fft_size);
+    for (size_t k = 0; k < fft.size(); k++) {
+        fft[k] = (float)rand() / RAND_MAX * 0.01f;  // quiet band
+    }
+
+    // channels at 8.33 kHz spacing, in configuration order (not sorted by frequency)
+    vector<size_t> bins(channel_count);
+    for (int i = 0; i < channel_count; i++) {
+        int freq = -sample_rate * 9 / 20 + ((i * 7919) % channel_count) * 25000 / 3;
+        bins[i] = (size_t)((freq + sample_rate) / ((double)sample_rate / fft_size)) % fft_size;
+    }
+    vector<bench_channel> scattered(channel_count), dense(channel_count);
+    DenseBinReader reader(bins.data(), channel_count);
+
+    // per-channel reads followed by the per-sample loop of a closed AM channel
+    double t_scattered_read = 0.0, t_dense_read = 0.0;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for (int b = 0; b < batches; b++) {
+        chrono::steady_clock::time_point read_start = chrono::steady_clock::now();
+        for (int j = 0; j < batch; j++) {
+            for (int i = 0; i < channel_count; i++) {
+                const float* bin = fft.data() + 2 * bins[i];
+                scattered[i].wavein[j] = sqrtf(bin[0] * bin[0] + bin[1] * bin[1]);
+            }
+        }
+        t_scattered_read += elapsed(read_start);
+        for (int i = 0; i < channel_count; i++) {
+            bench_channel& ch = scattered[i];
+            for (int j = 0; j < batch; j++) {
+                ch.squelch.process_raw_sample(ch.wavein[j]);
+                if (ch.squelch.should_filter_sample() || ch.squelch.first_open_sample() || ch.squelch.last_open_sample() || ch.squelch.should_process_audio() || ch.squelch.is_open()) {
+                    ch.waveout[j] = ch.wavein[j];
+                } else {
+                    ch.waveout[j] = 0;
+                }
+            }
+        }
+    }
+    double t_scattered = elapsed(start);
+
+    // dense reads followed by the idle fast path
+    start = chrono::steady_clock::now();
+    for (int b = 0; b < batches; b++) {
+        chrono::steady_clock::time_point read_start = chrono::steady_clock::now();
+        for (int j = 0; j < batch; j++) {
+            reader.read(fft.data(), bins.data());
+            for (int i = 0; i < channel_count; i++) {
+                dense[i].wavein[j] = reader.level(i);
+            }
+        }
+        t_dense_read += elapsed(read_start);
+        for (int i = 0; i < channel_count; i++) {
+            bench_channel& ch = dense[i];
+            float level_max = 0.0f;
+            for (int j = 0; j < batch; j++) {
+                level_max = max(level_max, ch.wavein[j]);
+            }
+            if (ch.squelch.is_idle() && level_max < ch.squelch.squelch_level()) {
+                ch.squelch.process_idle_samples(ch.wavein, batch);
+                memset(ch.waveout, 0, sizeof(ch.waveout));
+            }
+        }
+    }
+    double t_dense = elapsed(start);
+
+    const double audio_seconds = (double)batches * batch / 8000.0;
+    printf("%4d channels  %8.2f%% %8.2f%%  %8.2f%% %8.2f%%  %6.2fx\n", channel_count, 100.0 * t_scattered_read / audio_seconds, 100.0 * t_scattered / audio_seconds,
+           100.0 * t_dense_read / audio_seconds, 100.0 * t_dense / audio_seconds, t_scattered / t_dense);
+}
+
+int main(void) {
+    printf("FFT size %zu, %d Hz sample rate, %d batches of %d samples, CPU time in %% of one core\n", fft_size, sample_rate, batches, batch);
+    printf("                per-channel           dense\n");
+    printf("                 bins    total     bins    total  speedup\n");
+    run(100);
+    run(200);
+    run(300);
+    return 0;
+}
@@ -0,0 +1,129 @@
+/*
+ * capacity.cpp
+ * Cost model of a configuration, see print_capacity_plan()
+ *
+ * Copyright (C) 2024 charlie-foxtrot
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "capacity.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+using namespace std;
+
+double benchmark_call(const function<void(void)>& fn, double min_time) {
+    fn();  // warm up caches
+
+    size_t calls = 0;
+    chrono::duration<double> elapsed(0);
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    while (calls == 0 || elapsed.count() < min_time) {
+        fn();
+        calls++;
+        elapsed = chrono::steady_clock::now() - start;
+    }
+    return elapsed.count() / calls;
+}
+
+void CapacityPlan::add(const string& thread, const string& device, const string& item, double load) {
+    if (find(threads_.begin(), threads_.end(), thread) == threads_.end()) {
+        threads_.push_back(thread);
+    }
+    if (!device.empty() && find(devices_.begin(), devices_.end(), device) == devices_.end()) {
+        devices_.push_back(device);
+    }
+    items_.push_back({thread, device, item, load});
+}
+
+double CapacityPlan::thread_load(const string& thread) const {
+    double load = 0.0;
+    for (size_t i = 0; i < items_.size(); i++) {
+        if (items_[i].thread == thread) {
+            load += items_[i].load;
+        }
+    }
+    return load;
+}
+
+double CapacityPlan::device_load(const string& device) const {
+    double load = 0.0;
+    for (size_t i = 0; i < items_.size(); i++) {
+        if (items_[i].device == device) {
+            load += items_[i].load;
+        }
+    }
+    return load;
+}
+
+double CapacityPlan::total_load(void) const {
+    double load = 0.0;
+    for (size_t i = 0; i < items_.size(); i++) {
+        load += items_[i].load;
+    }
+    return load;
+}
+
+vector<string> CapacityPlan::warnings(double thread_limit, unsigned cpus) const {
+    vector<string> ret;
+    char buf[256];
+    for (size_t t = 0; t < threads_.size(); t++) {
+        const double load = thread_load(threads_[t]);
+        if (load > thread_limit) {
+            snprintf(buf, sizeof(buf), "%s thread needs %.0f%% of a CPU, more than %.0f%%", threads_[t].c_str(), load * 100.0, thread_limit * 100.0);
+            ret.push_back(buf);
+        }
+    }
+    if (total_load() > thread_limit * cpus) {
+        snprintf(buf, sizeof(buf), "all threads together need %.0f%% of a CPU, more than %.0f%% of %u CPUs", total_load() * 100.0, thread_limit * 100.0, cpus);
+        ret.push_back(buf);
+    }
+    return ret;
+}
+
+string CapacityPlan::format(double thread_limit, unsigned cpus) const {
+    string out;
+    char buf[256];
+    snprintf(buf, sizeof(buf), "%-40s %8s\n", "Thread / work", "CPU %");
+    out += buf;
+    for (size_t t = 0; t < threads_.size(); t++) {
+        snprintf(buf, sizeof(buf), "%-40s %8.1f\n", threads_[t].c_str(), thread_load(threads_[t]) * 100.0);
+        out += buf;
+        for (size_t i = 0; i < items_.size(); i++) {
+            if (items_[i].thread == threads_[t]) {
+                snprintf(buf, sizeof(buf), "  %-38s %8.1f\n", items_[i].name.c_str(), items_[i].load * 100.0);
+                out += buf;
+            }
+        }
+    }
+    if (!devices_.empty()) {
+        snprintf(buf, sizeof(buf), "\n%-40s %8s\n", "Device", "CPU %");
+        out += buf;
+        for (size_t d = 0; d < devices_.size(); d++) {
+            snprintf(buf, sizeof(buf), "%-40s %8.1f\n", devices_[d].c_str(), device_load(devices_[d]) * 100.0);
+            out += buf;
+        }
+    }
+    snprintf(buf, sizeof(buf), "\n%-40s %8.1f (%u CPUs available)\n", "Total", total_load() * 100.0, cpus);
+    out += buf;
+
+    vector<string> w = warnings(thread_limit, cpus);
+    for (size_t i = 0; i < w.size(); i++) {
+        out += "WARNING: " + w[i] + "\n";
+    }
+    return out;
+}
@@ -0,0 +1,64 @@
+/*
+ * capacity.h
+ * Cost model of a configuration, see print_capacity_plan()
+ *
+ * Copyright (C) 2024 charlie-foxtrot
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CAPACITY_H
+#define _CAPACITY_H
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#define CAPACITY_THREAD_LIMIT 0.8  // load of one thread above which it may not keep up with bursts
+
+// Seconds taken by one call of fn, averaged over calls for at least min_time seconds
+double benchmark_call(const std::function<void(void)>& fn, double min_time);
+
+/*
+ * Predicted load of the threads, as the fraction of one CPU each item of
+ * work keeps busy. Items can be attributed to a device (or a mixer) to sum
+ * up the load of each device across threads.
+ */
+class CapacityPlan {
+   public:
+    void add(const std::string& thread, const std::string& device, const std::string& item, double load);
+
+    double thread_load(const std::string& thread) const;
+    double device_load(const std::string& device) const;
+    double total_load(void) const;
+
+    // Threads above thread_limit, and the total above thread_limit for each of the cpus
+    std::vector<std::string> warnings(double thread_limit, unsigned cpus) const;
+
+    // Table of the threads with their items, the devices and the warnings
+    std::string format(double thread_limit, unsigned cpus) const;
+
+   private:
+    struct item_t {
+        std::string thread;
+        std::string device;
+        std::string name;
+        double load;
+    };
+    std::vector<item_t> items_;
+    std::vector<std::string> threads_;  // in the order they were added
+    std::vector<std::string> devices_;
+};
+
+#endif /* _CAPACITY_H */
@@ -0,0 +1,76 @@
+/*
+ * carrier_discovery.cpp
+ * Detection of persistent carriers in the averaged spectrum
+ *
+ * Copyright (C) 2024 charlie-foxtrot
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "carrier_discovery.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+using namespace std;
+
+vector<int> find_carriers(const vector<float>& levels, int centerfreq, int sample_rate, float threshold, double raster, int half_span, int dc_guard) {
+    vector<int> carriers;
+    if (levels.empty()) {
+        return carriers;
+    }
+
+    // most of the band is empty, so the median is a good estimate of the noise floor
+    vector<float> sorted(levels);
+    nth_element(sorted.begin(), sorted.begin() + sorted.size() / 2, sorted.end());
+    const float noise_floor = sorted[sorted.size() / 2];
+
+    const double bin_width = (double)sample_rate / levels.size();
+    for (size_t b = 0; b < levels.size(); b++) {
+        if (levels[b] < noise_floor + threshold) {
+            continue;
+        }
+        double freq = centerfreq - sample_rate / 2.0 + (b + 0.5) * bin_width;
+        if (raster > 0) {
+            freq = round(freq / raster) * raster;
+        }
+        const int offset = abs((int)round(freq) - centerfreq);
+        if (offset > half_span || offset < dc_guard) {
+            continue;
+        }
+        // a strong carrier spills over neighbouring bins which snap to the same frequency
+        if (carriers.empty() || carriers.back() != (int)round(freq)) {
+            carriers.push_back((int)round(freq));
+        }
+    }
+    return carriers;
+}
+
+CarrierTracker::CarrierTracker(int hold_frames) : hold_frames_(hold_frames) {}
+
+vector<int> CarrierTracker::update(const vector<int>& carriers) {
+    map<int, int> seen;
+    vector<int> confirmed;
+    for (size_t i = 0; i < carriers.size(); i++) {
+        map<int, int>::const_iterator it = seen_.find(carriers[i]);
+        int frames = (it == seen_.end() ? 1 : it->second + 1);
+        seen[carriers[i]] = frames;
+        if (frames >= hold_frames_) {
+            confirmed.push_back(carriers[i]);
+        }
+    }
+    seen_.swap(seen);
+    return confirmed;
+}
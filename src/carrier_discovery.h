@@ -0,0 +1,52 @@
+/*
+ * carrier_discovery.h
+ *
+ * Copyright (C) 2024 charlie-foxtrot
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CARRIER_DISCOVERY_H
+#define _CARRIER_DISCOVERY_H
+
+#include <map>
+#include <vector>
+
+/*
+ * Find carriers in an averaged spectrum frame (dBFS, lowest frequency first,
+ * covering centerfreq +/- sample_rate / 2). A bin holds a carrier when it is
+ * at least threshold dB above the median of the frame. Carrier frequencies are
+ * snapped to the channel raster (no snapping if raster is 0) and have to be
+ * between dc_guard and half_span Hz away from the center frequency.
+ */
+std::vector<int> find_carriers(const std::vector<float>& levels, int centerfreq, int sample_rate, float threshold, double raster, int half_span, int dc_guard);
+
+/*
+ * Keeps track of how long each carrier has been present. A carrier is
+ * confirmed once it shows up in hold_frames consecutive frames, and forgotten
+ * as soon as a frame doesn't have it.
+ */
+class CarrierTracker {
+   public:
+    CarrierTracker(int hold_frames);
+
+    // feed carriers of the next frame, returns the confirmed ones
+    std::vector<int> update(const std::vector<int>& carriers);
+
+   private:
+    int hold_frames_;
+    std::map<int, int> seen_;  // frequency -> consecutive frames
+};
+
+#endif /* _CARRIER_DISCOVERY_H */
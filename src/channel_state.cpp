@@ -0,0 +1,100 @@
+/*
+ * channel_state.cpp
+ * Saving what the channels have learned for a warm start
+ *
+ * Copyright (C) 2024 charlie-foxtrot
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "channel_state.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>  // strerror()
+#include <syslog.h>  // LOG_* levels
+#include <string>
+
+#include "logging.h"  // log()
+
+using namespace std;
+
+#define STATE_FILE_MAGIC "rtl_airband-state"
+#define STATE_FILE_VERSION 1
+
+bool channel_state_write(const char* path, size_t fft_size, const vector<channel_state_t>& states) {
+    const string temp_path = string(path) + ".tmp";
+    FILE* f = fopen(temp_path.c_str(), "w");
+    if (f == NULL) {
+        log(LOG_WARNING, "Cannot write state file %s (%s)\n", temp_path.c_str(), strerror(errno));
+        return false;
+    }
+    fprintf(f, "%s %d %zu\n", STATE_FILE_MAGIC, STATE_FILE_VERSION, fft_size);
+    for (size_t i = 0; i < states.size(); i++) {
+        const channel_state_t& s = states[i];
+        fprintf(f, "%d %d %.9g %.9g %.9g %.9g\n", s.device, s.frequency, s.squelch.noise_floor, s.squelch.signal, s.squelch.filtered_signal, s.agc_level);
+    }
+    bool ok = (fflush(f) == 0 && !ferror(f));
+    ok = (fclose(f) == 0) && ok;
+    if (!ok || rename(temp_path.c_str(), path) != 0) {
+        log(LOG_WARNING, "Cannot write state file %s (%s)\n", path, strerror(errno));
+        remove(temp_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool channel_state_read(const char* path, size_t fft_size, vector<channel_state_t>& states) {
+    states.clear();
+    FILE* f = fopen(path, "r");
+    if (f == NULL) {
+        if (errno != ENOENT) {
+            log(LOG_WARNING, "Cannot read state file %s (%s)\n", path, strerror(errno));
+        }
+        return false;
+    }
+    char magic[32];
+    int version;
+    size_t saved_fft_size;
+    if (fscanf(f, "%31s %d %zu", magic, &version, &saved_fft_size) != 3 || strcmp(magic, STATE_FILE_MAGIC) != 0 || version != STATE_FILE_VERSION) {
+        log(LOG_WARNING, "%s is not a state file, ignoring it\n", path);
+        fclose(f);
+        return false;
+    }
+    if (saved_fft_size != fft_size) {
+        log(LOG_NOTICE, "State file %s was saved with another fft_size, starting from scratch\n", path);
+        fclose(f);
+        return false;
+    }
+    channel_state_t s;
+    while (fscanf(f, "%d %d %g %g %g %g", &s.device, &s.frequency, &s.squelch.noise_floor, &s.squelch.signal, &s.squelch.filtered_signal, &s.agc_level) == 6) {
+        states.push_back(s);
+    }
+    if (!feof(f)) {
+        log(LOG_WARNING, "State file %s is damaged, starting from scratch\n", path);
+        states.clear();
+    }
+    fclose(f);
+    return !states.empty();
+}
+
+const channel_state_t* ChannelStateMatcher::take(int device, int frequency) {
+    for (size_t i = 0; i < states_.size(); i++) {
+        if (!used_[i] && states_[i].device == device && states_[i].frequency == frequency) {
+            used_[i] = true;
+            return &states_[i];
+        }
+    }
+    return NULL;
+}
@@ -0,0 +1,64 @@
+/*
+ * channel_state.h
+ * Saving what the channels have learned for a warm start
+ *
+ * Copyright (C) 2024 charlie-foxtrot
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CHANNEL_STATE_H
+#define _CHANNEL_STATE_H
+
+#include <cstddef>  // size_t
+#include <vector>
+
+#include "squelch.h"  // SquelchLevels
+
+// DSP state of one frequency of a channel
+struct channel_state_t {
+    int device;
+    int frequency;  // Hz, a state is only restored to the same frequency of the same device
+    SquelchLevels squelch;
+    float agc_level;  // freq_t::agcavgfast
+};
+
+/*
+ * The state file is a line of text per frequency. It's replaced atomically,
+ * so a reader never sees it half written. Levels depend on the FFT size, so
+ * states are only valid for the fft_size they were saved with.
+ */
+bool channel_state_write(const char* path, size_t fft_size, const std::vector<channel_state_t>& states);
+
+// Returns false if the file can't be read or was written for another fft_size
+bool channel_state_read(const char* path, size_t fft_size, std::vector<channel_state_t>& states);
+
+/*
+ * Hands out the saved states in the order they were written. A frequency
+ * may be used by several channels of a device, their states are matched up
+ * in the same order.
+ */
+class ChannelStateMatcher {
+   public:
+    explicit ChannelStateMatcher(const std::vector<channel_state_t>& states) : states_(states), used_(states.size(), false) {}
+
+    // NULL if there is no saved state left for the frequency
+    const channel_state_t* take(int device, int frequency);
+
+   private:
+    const std::vector<channel_state_t>& states_;
+    std::vector<bool> used_;
+};
+
+#endif /* _CHANNEL_STATE_H */
@@ -21,13 +21,19 @@
 #include <assert.h>
 #include <stdint.h>  // uint32_t
 #include <syslog.h>
+#include <algorithm>  // find
 #include <cmath>
 #include <cstdlib>
 #include <cstring>
 #include <iostream>
 #include <libconfig.h++>
-#include "input-common.h"  // input_t
+#include "carrier_discovery.h"
+#include "dense_bins.h"
+#include "input-common.h"   // input_t
+#include "input-subband.h"  // subband_frontend_new(), subband_input_new()
 #include "rtl_airband.h"
+#include "scan_planner.h"
+#include "thread_sched.h"
 
 using namespace std;
 
@@ -75,20 +81,20 @@ static int parse_outputs(libconfig::Setting& outs, channel_t* channel, int i, in
                         idata->tls_mode = SHOUT_TLS_DISABLED;
                     } else {
                         if (parsing_mixers) {
-                            cerr << "Configuration error: mixers.[" << i << "] outputs.[" << o << "]: ";
+                            config_errors() << "Configuration error: mixers.[" << i << "] outputs.[" << o << "]: ";
                         } else {
-                            cerr << "Configuration error: devices.[" << i << "] channels.[" << j << "] outputs.[" << o << "]: ";
+                            config_errors() << "Configuration error: devices.[" << i << "] channels.[" << j << "] outputs.[" << o << "]: ";
                         }
-                        cerr << "invalid value for tls; must be one of: auto, auto_no_plain, transport, upgrade, disabled\n";
+                        config_errors() << "invalid value for tls; must be one of: auto, auto_no_plain, transport, upgrade, disabled\n";
                         error();
                     }
                 } else {
                     if (parsing_mixers) {
-                        cerr << "Configuration error: mixers.[" << i << "] outputs.[" << o << "]: ";
+                        config_errors() << "Configuration error: mixers.[" << i << "] outputs.[" << o << "]: ";
                     } else {
-                        cerr << "Configuration error: devices.[" << i << "] channels.[" << j << "] outputs.[" << o << "]: ";
+                        config_errors() << "Configuration error: devices.[" << i << "] channels.[" << j << "] outputs.[" << o << "]: ";
                     }
-                    cerr << "tls value must be a string\n";
+                    config_errors() << "tls value must be a string\n";
                     error();
                 }
             } else {
@@ -106,21 +112,36 @@ static int parse_outputs(libconfig::Setting& outs, channel_t* channel, int i, in
             fdata->type = O_FILE;
             if (!outs[o].exists("directory") || !outs[o].exists("filename_template")) {
                 if (parsing_mixers) {
-                    cerr << "Configuration error: mixers.[" << i << "] outputs.[" << o << "]: ";
+                    config_errors() << "Configuration error: mixers.[" << i << "] outputs.[" << o << "]: ";
                 } else {
-                    cerr << "Configuration error: devices.[" << i << "] channels.[" << j << "] outputs.[" << o << "]: ";
+                    config_errors() << "Configuration error: devices.[" << i << "] channels.[" << j << "] outputs.[" << o << "]: ";
                 }
-                cerr << "both directory and filename_template required for file\n";
+                config_errors() << "both directory and filename_template required for file\n";
                 error();
             }
             if (outs[o]["directory"].getType() != libconfig::Setting::TypeString || outs[o]["filename_template"].getType() != libconfig::Setting::TypeString) {
-                cerr << "Configuration error: devices.[" << i << "] channels.[" << j << "] outputs.[" << o << "]: both directory and filename_template must be strings\n";
+                config_errors() << "Configuration error: devices.[" << i << "] channels.[" << j << "] outputs.[" << o << "]: both directory and filename_template must be strings\n";
                 error();
             }
             fdata->basedir = static_cast<const char*>(outs[o]["directory"]);
             fdata->basename = static_cast<const char*>(outs[o]["filename_template"]);
             fdata->dated_subdirectories = outs[o].exists("dated_subdirectories") ? (bool)(outs[o]["dated_subdirectories"]) : false;
-            fdata->suffix = ".mp3";
+            const char* format = outs[o].exists("format") ? (const char*)outs[o]["format"] : "mp3";
+            if (!strcmp(format, "mp3")) {
+                fdata->suffix = ".mp3";
+            } else if (!strcmp(format, "wav") || !strcmp(format, "ima_adpcm")) {
+                fdata->suffix = ".wav";
+                fdata->wav = true;
+                fdata->wav_type = strcmp(format, "wav") ? WAV_IMA_ADPCM : WAV_PCM16;
+            } else {
+                if (parsing_mixers) {
+                    config_errors() << "Configuration error: mixers.[" << i << "] outputs.[" << o << "]: ";
+                } else {
+                    config_errors() << "Configuration error: devices.[" << i << "] channels.[" << j << "] outputs.[" << o << "]: ";
+                }
+                config_errors() << "format must be one of \"mp3\", \"wav\" or \"ima_adpcm\"\n";
+                error();
+            }
 
             fdata->continuous = outs[o].exists("continuous") ? (bool)(outs[o]["continuous"]) : false;
             fdata->append = (!outs[o].exists("append")) || (bool)(outs[o]["append"]);
@@ -128,7 +149,7 @@ static int parse_outputs(libconfig::Setting& outs, channel_t* channel, int i, in
             fdata->include_freq = outs[o].exists("include_freq") ? (bool)(outs[o]["include_freq"]) : false;
             if (outs[o].exists("upload_url")) {
                 if (outs[o]["upload_url"].getType() != libconfig::Setting::TypeString) {
-                    cerr << "Configuration error: devices[" << i << "] channels[" << j << "] outputs[" << o << "]: upload_url must be a string\n";
+                    config_errors() << "Configuration error: devices[" << i << "] channels[" << j << "] outputs[" << o << "]: upload_url must be a string\n";
                     error();
                 }
                 fdata->upload_url = static_cast<const char*>(outs[o]["upload_url"]);
@@ -138,12 +159,12 @@ static int parse_outputs(libconfig::Setting& outs, channel_t* channel, int i, in
             fdata->delete_after_upload = outs[o].exists("delete_after_upload") ? (bool)(outs[o]["delete_after_upload"]) : false;
             fdata->upload_retry_interval = outs[o].exists("upload_retry_interval") ? (int)(outs[o]["upload_retry_interval"]) : 60;
             if (fdata->upload_retry_interval <= 0) {
-                cerr << "Configuration error: devices[" << i << "] channels[" << j << "] outputs[" << o << "]: upload_retry_interval must be positive\n";
+                config_errors() << "Configuration error: devices[" << i << "] channels[" << j << "] outputs[" << o << "]: upload_retry_interval must be positive\n";
                 error();
             }
             fdata->upload_pending_on_start = outs[o].exists("upload_pending_on_start") ? (bool)(outs[o]["upload_pending_on_start"]) : false;
             if (outs[o].exists("upload_url") && fdata->upload_url.empty()) {
-                cerr << "Configuration error: devices[" << i << "] channels[" << j << "] outputs[" << o << "]: upload_url may not be empty\n";
+                config_errors() << "Configuration error: devices[" << i << "] channels[" << j << "] outputs[" << o << "]: upload_url may not be empty\n";
                 error();
             }
             if (!fdata->upload_url.empty()) {
@@ -151,22 +172,22 @@ static int parse_outputs(libconfig::Setting& outs, channel_t* channel, int i, in
                     fdata->upload_retry_interval, fdata->upload_pending_on_start);
             }
 
-            channel->outputs[oo].has_mp3_output = true;
+            channel->outputs[oo].has_mp3_output = !fdata->wav;
 
             if (fdata->split_on_transmission) {
                 if (parsing_mixers) {
-                    cerr << "Configuration error: mixers.[" << i << "] outputs.[" << o << "]: split_on_transmission is not allowed for mixers\n";
+                    config_errors() << "Configuration error: mixers.[" << i << "] outputs.[" << o << "]: split_on_transmission is not allowed for mixers\n";
                     error();
                 }
                 if (fdata->continuous) {
-                    cerr << "Configuration error: devices.[" << i << "] channels.[" << j << "] outputs.[" << o << "]: can't have both continuous and split_on_transmission\n";
+                    config_errors() << "Configuration error: devices.[" << i << "] channels.[" << j << "] outputs.[" << o << "]: can't have both continuous and split_on_transmission\n";
                     error();
                 }
             }
 
         } else if (!strncmp(outs[o]["type"], "rawfile", 7)) {
             if (parsing_mixers) {  // rawfile outputs not allowed for mixers
-                cerr << "Configuration error: mixers.[" << i << "] outputs[" << o << "]: rawfile output is not allowed for mixers\n";
+                config_errors() << "Configuration error: mixers.[" << i << "] outputs[" << o << "]: rawfile output is not allowed for mixers\n";
                 error();
             }
             // Allocate with constructor: file_data contains std::string members
@@ -176,12 +197,12 @@ static int parse_outputs(libconfig::Setting& outs, channel_t* channel, int i, in
 
             fdata->type = O_RAWFILE;
             if (!outs[o].exists("directory") || !outs[o].exists("filename_template")) {
-                cerr << "Configuration error: devices.[" << i << "] channels.[" << j << "] outputs.[" << o << "]: both directory and filename_template required for file\n";
+                config_errors() << "Configuration error: devices.[" << i << "] channels.[" << j << "] outputs.[" << o << "]: both directory and filename_template required for file\n";
                 error();
             }
 
             if (outs[o]["directory"].getType() != libconfig::Setting::TypeString || outs[o]["filename_template"].getType() != libconfig::Setting::TypeString) {
-                cerr << "Configuration error: devices.[" << i << "] channels.[" << j << "] outputs.[" << o << "]: both directory and filename_template must be strings\n";
+                config_errors() << "Configuration error: devices.[" << i << "] channels.[" << j << "] outputs.[" << o << "]: both directory and filename_template must be strings\n";
                 error();
             }
             fdata->basedir = static_cast<const char*>(outs[o]["directory"]);
@@ -196,12 +217,30 @@ static int parse_outputs(libconfig::Setting& outs, channel_t* channel, int i, in
             channel->needs_raw_iq = channel->has_iq_outputs = 1;
 
             if (fdata->continuous && fdata->split_on_transmission) {
-                cerr << "Configuration error: devices.[" << i << "] channels.[" << j << "] outputs.[" << o << "]: can't have both continuous and split_on_transmission\n";
+                config_errors() << "Configuration error: devices.[" << i << "] channels.[" << j << "] outputs.[" << o << "]: can't have both continuous and split_on_transmission\n";
                 error();
             }
+            if (outs[o].exists("pre_trigger")) {
+                // seconds of I/Q before the squelch opens, written ahead of every transmission
+                libconfig::Setting& setting = outs[o]["pre_trigger"];
+                double pre_trigger = (setting.getType() == libconfig::Setting::TypeFloat) ? (double)setting : (int)setting;
+                if (pre_trigger < 0.0 || pre_trigger > MAX_PRE_TRIGGER) {
+                    config_errors() << "Configuration error: devices.[" << i << "] channels.[" << j << "] outputs.[" << o << "]: pre_trigger must be between 0 and " << MAX_PRE_TRIGGER << " seconds\n";
+                    error();
+                }
+                if (pre_trigger > 0.0 && fdata->continuous) {
+                    config_errors() << "Configuration error: devices.[" << i << "] channels.[" << j << "] outputs.[" << o << "]: pre_trigger is useless with continuous\n";
+                    error();
+                }
+                fdata->pre_trigger_samples = (size_t)(pre_trigger * WAVE_RATE);
+            }
+            if (fdata->pre_trigger_samples > 0) {
+                fdata->pre_trigger = new IqHistory(fdata->pre_trigger_samples);
+                channel->has_pre_trigger = 1;
+            }
         } else if (!strncmp(outs[o]["type"], "mixer", 5)) {
             if (parsing_mixers) {  // mixer outputs not allowed for mixers
-                cerr << "Configuration error: mixers.[" << i << "] outputs.[" << o << "]: mixer output is not allowed for mixers\n";
+                config_errors() << "Configuration error: mixers.[" << i << "] outputs.[" << o << "]: mixer output is not allowed for mixers\n";
                 error();
             }
             channel->outputs[oo].data = XCALLOC(1, sizeof(struct mixer_data));
@@ -209,20 +248,20 @@ static int parse_outputs(libconfig::Setting& outs, channel_t* channel, int i, in
             mixer_data* mdata = (mixer_data*)(channel->outputs[oo].data);
             const char* name = (const char*)outs[o]["name"];
             if ((mdata->mixer = getmixerbyname(name)) == NULL) {
-                cerr << "Configuration error: devices.[" << i << "] channels.[" << j << "] outputs.[" << o << "]: unknown mixer \"" << name << "\"\n";
+                config_errors() << "Configuration error: devices.[" << i << "] channels.[" << j << "] outputs.[" << o << "]: unknown mixer \"" << name << "\"\n";
                 error();
             }
             float ampfactor = outs[o].exists("ampfactor") ? (float)outs[o]["ampfactor"] : 1.0f;
             float balance = outs[o].exists("balance") ? (float)outs[o]["balance"] : 0.0f;
             if (balance < -1.0f || balance > 1.0f) {
-                cerr << "Configuration error: devices.[" << i << "] channels.[" << j << "] outputs.[" << o << "]: balance out of allowed range <-1.0;1.0>\n";
+                config_errors() << "Configuration error: devices.[" << i << "] channels.[" << j << "] outputs.[" << o << "]: balance out of allowed range <-1.0;1.0>\n";
                 error();
             }
             if ((mdata->input = mixer_connect_input(mdata->mixer, ampfactor, balance)) < 0) {
-                cerr << "Configuration error: devices.[" << i << "] channels.[" << j << "] outputs.[" << o
-                     << "]: "
-                        "could not connect to mixer "
-                     << name << ": " << mixer_get_error() << "\n";
+                config_errors() << "Configuration error: devices.[" << i << "] channels.[" << j << "] outputs.[" << o
+                                << "]: "
+                                   "could not connect to mixer "
+                                << name << ": " << mixer_get_error() << "\n";
                 error();
             }
             debug_print("dev[%d].chan[%d].out[%d] connected to mixer %s as input %d (ampfactor=%.1f balance=%.1f)\n", i, j, o, name, mdata->input, ampfactor, balance);
@@ -238,11 +277,11 @@ static int parse_outputs(libconfig::Setting& outs, channel_t* channel, int i, in
                 sdata->dest_address = strdup(outs[o]["dest_address"]);
             } else {
                 if (parsing_mixers) {
-                    cerr << "Configuration error: mixers.[" << i << "] outputs.[" << o << "]: ";
+                    config_errors() << "Configuration error: mixers.[" << i << "] outputs.[" << o << "]: ";
                 } else {
-                    cerr << "Configuration error: devices.[" << i << "] channels.[" << j << "] outputs.[" << o << "]: ";
+                    config_errors() << "Configuration error: devices.[" << i << "] channels.[" << j << "] outputs.[" << o << "]: ";
                 }
-                cerr << "missing dest_address\n";
+                config_errors() << "missing dest_address\n";
                 error();
             }
 
@@ -256,13 +295,39 @@ static int parse_outputs(libconfig::Setting& outs, channel_t* channel, int i, in
                 }
             } else {
                 if (parsing_mixers) {
-                    cerr << "Configuration error: mixers.[" << i << "] outputs.[" << o << "]: ";
+                    config_errors() << "Configuration error: mixers.[" << i << "] outputs.[" << o << "]: ";
                 } else {
-                    cerr << "Configuration error: devices.[" << i << "] channels.[" << j << "] outputs.[" << o << "]: ";
+                    config_errors() << "Configuration error: devices.[" << i << "] channels.[" << j << "] outputs.[" << o << "]: ";
                 }
-                cerr << "missing dest_port\n";
+                config_errors() << "missing dest_port\n";
                 error();
             }
+        } else if (!strcmp(outs[o]["type"], "http")) {
+            channel->outputs[oo].data = XCALLOC(1, sizeof(struct http_data));
+            channel->outputs[oo].type = O_HTTP;
+
+            http_data* hdata = (http_data*)channel->outputs[oo].data;
+            const char* problem = NULL;
+            if (http_server == NULL) {
+                problem = "http outputs require the http_server section";
+            } else if (!outs[o].exists("mountpoint")) {
+                problem = "missing mountpoint";
+            } else {
+                hdata->mountpoint = strdup(outs[o]["mountpoint"]);
+                if (hdata->mountpoint[0] != '/' || strcmp(hdata->mountpoint, "/") == 0) {
+                    problem = "mountpoint must start with / and name a stream";
+                }
+            }
+            if (problem != NULL) {
+                if (parsing_mixers) {
+                    config_errors() << "Configuration error: mixers.[" << i << "] outputs.[" << o << "]: ";
+                } else {
+                    config_errors() << "Configuration error: devices.[" << i << "] channels.[" << j << "] outputs.[" << o << "]: ";
+                }
+                config_errors() << problem << "\n";
+                error();
+            }
+            channel->outputs[oo].has_mp3_output = true;
 #ifdef WITH_PULSEAUDIO
         } else if (!strncmp(outs[o]["type"], "pulse", 5)) {
             channel->outputs[oo].data = XCALLOC(1, sizeof(struct pulse_data));
@@ -271,14 +336,14 @@ static int parse_outputs(libconfig::Setting& outs, channel_t* channel, int i, in
             pulse_data* pdata = (pulse_data*)(channel->outputs[oo].data);
             pdata->continuous = outs[o].exists("continuous") ? (bool)(outs[o]["continuous"]) : false;
             pdata->server = outs[o].exists("server") ? strdup(outs[o]["server"]) : NULL;
-            pdata->name = outs[o].exists("name") ? strdup(outs[o]["name"]) : "rtl_airband";
+            pdata->name = outs[o].exists("name") ? strdup(outs[o]["name"]) : strdup("rtl_airband");
             pdata->sink = outs[o].exists("sink") ? strdup(outs[o]["sink"]) : NULL;
 
             if (outs[o].exists("stream_name")) {
                 pdata->stream_name = strdup(outs[o]["stream_name"]);
             } else {
                 if (parsing_mixers) {
-                    cerr << "Configuration error: mixers.[" << i << "] outputs.[" << o << "]: PulseAudio outputs of mixers must have stream_name defined\n";
+                    config_errors() << "Configuration error: mixers.[" << i << "] outputs.[" << o << "]: PulseAudio outputs of mixers must have stream_name defined\n";
                     error();
                 }
                 char buf[1024];
@@ -288,13 +353,38 @@ static int parse_outputs(libconfig::Setting& outs, channel_t* channel, int i, in
 #endif /* WITH_PULSEAUDIO */
         } else {
             if (parsing_mixers) {
-                cerr << "Configuration error: mixers.[" << i << "] outputs.[" << o << "]: ";
+                config_errors() << "Configuration error: mixers.[" << i << "] outputs.[" << o << "]: ";
             } else {
-                cerr << "Configuration error: devices.[" << i << "] channels.[" << j << "] outputs.[" << o << "]: ";
+                config_errors() << "Configuration error: devices.[" << i << "] channels.[" << j << "] outputs.[" << o << "]: ";
             }
-            cerr << "unknown output type\n";
+            config_errors() << "unknown output type\n";
             error();
         }
+        const output_sink_t* sink = output_sink(channel->outputs[oo].type);
+        channel->outputs[oo].exec = sink->exec;
+        channel->outputs[oo].sink = NULL;
+        if (outs[o].exists("exec")) {
+            const char* exec = outs[o]["exec"];
+            if (!strcmp(exec, "inline")) {
+                channel->outputs[oo].exec = SINK_INLINE;
+            } else if (!strcmp(exec, "pool") && sink->queueable) {
+                channel->outputs[oo].exec = SINK_POOL;
+            } else if (!strcmp(exec, "thread") && sink->queueable) {
+                channel->outputs[oo].exec = SINK_THREAD;
+            } else {
+                if (parsing_mixers) {
+                    config_errors() << "Configuration error: mixers.[" << i << "] outputs.[" << o << "]: ";
+                } else {
+                    config_errors() << "Configuration error: devices.[" << i << "] channels.[" << j << "] outputs.[" << o << "]: ";
+                }
+                if (sink->queueable) {
+                    config_errors() << "exec must be one of inline, pool or thread\n";
+                } else {
+                    config_errors() << sink->name << " outputs can only run inline\n";
+                }
+                error();
+            }
+        }
         channel->outputs[oo].enabled = true;
         channel->outputs[oo].active = false;
         oo++;
@@ -304,7 +394,7 @@ static int parse_outputs(libconfig::Setting& outs, channel_t* channel, int i, in
 
 static struct freq_t* mk_freqlist(int n) {
     if (n < 1) {
-        cerr << "mk_freqlist: invalid list length " << n << "\n";
+        config_errors() << "mk_freqlist: invalid list length " << n << "\n";
         error();
     }
     struct freq_t* fl = (struct freq_t*)XCALLOC(n, sizeof(struct freq_t));
@@ -316,12 +406,15 @@ static struct freq_t* mk_freqlist(int n) {
         fl[i].squelch = Squelch();
         fl[i].active_counter = 0;
         fl[i].modulation = MOD_AM;
+        fl[i].priority = 0;
+        fl[i].revisit_interval = 1000;
     }
     return fl;
 }
 
+static const float soft_bw_threshold = 0.9f;
+
 static void warn_if_freq_not_in_range(int devidx, int chanidx, int freq, int centerfreq, int sample_rate) {
-    static const float soft_bw_threshold = 0.9f;
     float bw_limit = (float)sample_rate / 2.f * soft_bw_threshold;
     if ((float)abs(freq - centerfreq) >= bw_limit) {
         log(LOG_WARNING, "Warning: dev[%d].channel[%d]: frequency %.3f MHz is outside of SDR operating bandwidth (%.3f-%.3f MHz)\n", devidx, chanidx, (double)freq / 1e6,
@@ -343,527 +436,864 @@ static int parse_anynum2int(libconfig::Setting& f) {
     return ret;
 }
 
-static int parse_channels(libconfig::Setting& chans, device_t* dev, int i) {
-    int jj = 0;
-    for (int j = 0; j < chans.getLength(); j++) {
-        if (chans[j].exists("disable") && (bool)chans[j]["disable"] == true) {
-            continue;
-        }
-        channel_t* channel = dev->channels + jj;
-        for (int k = 0; k < AGC_EXTRA; k++) {
-            channel->wavein[k] = 20;
-            channel->waveout[k] = 0.5;
-        }
-        channel->axcindicate = NO_SIGNAL;
-        channel->mode = MM_MONO;
-        channel->freq_count = 1;
-        channel->freq_idx = 0;
-        channel->highpass = chans[j].exists("highpass") ? (int)chans[j]["highpass"] : 100;
-        channel->lowpass = chans[j].exists("lowpass") ? (int)chans[j]["lowpass"] : 2500;
+/*
+ * Parse one channel section into dev->channels[jj]. Discovery slots are parsed
+ * from the channel template of the discovery section, they get their frequency
+ * when a carrier is found.
+ */
+static void parse_channel(libconfig::Setting& chan, device_t* dev, int i, int j, int jj, bool slot) {
+    channel_t* channel = dev->channels + jj;
+    for (int k = 0; k < AGC_EXTRA; k++) {
+        channel->wavein[k] = 20;
+        channel->waveout[k] = 0.5;
+    }
+    channel->axcindicate = NO_SIGNAL;
+    channel->mode = MM_MONO;
+    channel->freq_count = 1;
+    channel->freq_idx = 0;
+    channel->highpass = chan.exists("highpass") ? (int)chan["highpass"] : 100;
+    channel->lowpass = chan.exists("lowpass") ? (int)chan["lowpass"] : 2500;
 #ifdef NFM
-        channel->pr = 0;
-        channel->pj = 0;
-        channel->prev_waveout = 0.5;
-        channel->alpha = dev->alpha;
+    channel->pr = 0;
+    channel->pj = 0;
+    channel->prev_waveout = 0.5;
+    channel->alpha = dev->alpha;
 #endif /* NFM */
 
-        // Make sure lowpass / highpass aren't flipped.
-        // If lowpass is enabled (greater than zero) it must be larger than highpass
-        if (channel->lowpass > 0 && channel->lowpass < channel->highpass) {
-            cerr << "Configuration error: devices.[" << i << "] channels.[" << j << "]: lowpass (" << channel->lowpass << ") must be greater than or equal to highpass (" << channel->highpass << ")\n";
-            error();
-        }
+    // Make sure lowpass / highpass aren't flipped.
+    // If lowpass is enabled (greater than zero) it must be larger than highpass
+    if (channel->lowpass > 0 && channel->lowpass < channel->highpass) {
+        config_errors() << "Configuration error: devices.[" << i << "] channels.[" << j << "]: lowpass (" << channel->lowpass << ") must be greater than or equal to highpass (" << channel->highpass << ")\n";
+        error();
+    }
 
-        modulations channel_modulation = MOD_AM;
-        if (chans[j].exists("modulation")) {
+    modulations channel_modulation = MOD_AM;
+    if (chan.exists("modulation")) {
 #ifdef NFM
-            if (strncmp(chans[j]["modulation"], "nfm", 3) == 0) {
-                channel_modulation = MOD_NFM;
-            } else
+        if (strncmp(chan["modulation"], "nfm", 3) == 0) {
+            channel_modulation = MOD_NFM;
+        } else
 #endif /* NFM */
-                if (strncmp(chans[j]["modulation"], "am", 2) != 0) {
-                    cerr << "Configuration error: devices.[" << i << "] channels.[" << j << "]: unknown modulation\n";
-                    error();
-                }
-        }
-        channel->afc = chans[j].exists("afc") ? (unsigned char)(unsigned int)chans[j]["afc"] : 0;
-        if (dev->mode == R_MULTICHANNEL) {
-            channel->freqlist = mk_freqlist(1);
-            channel->freqlist[0].frequency = parse_anynum2int(chans[j]["freq"]);
-            warn_if_freq_not_in_range(i, j, channel->freqlist[0].frequency, dev->input->centerfreq, dev->input->sample_rate);
-            if (chans[j].exists("label")) {
-                channel->freqlist[0].label = strdup(chans[j]["label"]);
-            }
-            channel->freqlist[0].modulation = channel_modulation;
-        } else { /* R_SCAN */
-            channel->freq_count = chans[j]["freqs"].getLength();
-            if (channel->freq_count < 1) {
-                cerr << "Configuration error: devices.[" << i << "] channels.[" << j << "]: freqs should be a list with at least one element\n";
-                error();
-            }
-            channel->freqlist = mk_freqlist(channel->freq_count);
-            if (chans[j].exists("labels") && chans[j]["labels"].getLength() < channel->freq_count) {
-                cerr << "Configuration error: devices.[" << i << "] channels.[" << j << "]: labels should be a list with at least " << channel->freq_count << " elements\n";
+            if (strncmp(chan["modulation"], "am", 2) != 0) {
+                config_errors() << "Configuration error: devices.[" << i << "] channels.[" << j << "]: unknown modulation\n";
                 error();
             }
-            if (chans[j].exists("squelch_threshold") && libconfig::Setting::TypeList == chans[j]["squelch_threshold"].getType() && chans[j]["squelch_threshold"].getLength() < channel->freq_count) {
-                cerr << "Configuration error: devices.[" << i << "] channels.[" << j << "]: squelch_threshold should be an int or a list of ints with at least " << channel->freq_count
-                     << " elements\n";
-                error();
-            }
-            if (chans[j].exists("squelch_snr_threshold") && libconfig::Setting::TypeList == chans[j]["squelch_snr_threshold"].getType() &&
-                chans[j]["squelch_snr_threshold"].getLength() < channel->freq_count) {
-                cerr << "Configuration error: devices.[" << i << "] channels.[" << j
-                     << "]: squelch_snr_threshold should be an int, a float or a list of "
-                        "ints or floats with at least "
-                     << channel->freq_count << " elements\n";
-                error();
-            }
-            if (chans[j].exists("notch") && libconfig::Setting::TypeList == chans[j]["notch"].getType() && chans[j]["notch"].getLength() < channel->freq_count) {
-                cerr << "Configuration error: devices.[" << i << "] channels.[" << j << "]: notch should be an float or a list of floats with at least " << channel->freq_count << " elements\n";
-                error();
-            }
-            if (chans[j].exists("notch_q") && libconfig::Setting::TypeList == chans[j]["notch_q"].getType() && chans[j]["notch_q"].getLength() < channel->freq_count) {
-                cerr << "Configuration error: devices.[" << i << "] channels.[" << j << "]: notch_q should be a float or a list of floats with at least " << channel->freq_count << " elements\n";
-                error();
+    }
+    channel->afc = chan.exists("afc") ? (unsigned char)(unsigned int)chan["afc"] : 0;
+    channel->low_priority = chan.exists("low_priority") && (bool)chan["low_priority"];
+    channel->scan_force = -1;
+    // scanning devices may also have fixed frequency channels, these use "freq" instead of "freqs"
+    if (dev->mode == R_MULTICHANNEL || !chan.exists("freqs")) {
+        channel->freqlist = mk_freqlist(1);
+        channel->freqlist[0].frequency = slot ? 0 : parse_anynum2int(chan["freq"]);
+        if (dev->mode == R_MULTICHANNEL && !slot) {
+            warn_if_freq_not_in_range(i, j, channel->freqlist[0].frequency, dev->input->centerfreq, dev->input->sample_rate);
+        }
+        if (chan.exists("label")) {
+            channel->freqlist[0].label = strdup(chan["label"]);
+        }
+        channel->freqlist[0].modulation = channel_modulation;
+    } else { /* R_SCAN */
+        channel->freq_count = chan["freqs"].getLength();
+        if (channel->freq_count < 1) {
+            config_errors() << "Configuration error: devices.[" << i << "] channels.[" << j << "]: freqs should be a list with at least one element\n";
+            error();
+        }
+        channel->freqlist = mk_freqlist(channel->freq_count);
+        if (chan.exists("labels") && chan["labels"].getLength() < channel->freq_count) {
+            config_errors() << "Configuration error: devices.[" << i << "] channels.[" << j << "]: labels should be a list with at least " << channel->freq_count << " elements\n";
+            error();
+        }
+        if (chan.exists("squelch_threshold") && libconfig::Setting::TypeList == chan["squelch_threshold"].getType() && chan["squelch_threshold"].getLength() < channel->freq_count) {
+            config_errors() << "Configuration error: devices.[" << i << "] channels.[" << j << "]: squelch_threshold should be an int or a list of ints with at least " << channel->freq_count
+                            << " elements\n";
+            error();
+        }
+        if (chan.exists("squelch_snr_threshold") && libconfig::Setting::TypeList == chan["squelch_snr_threshold"].getType() &&
+            chan["squelch_snr_threshold"].getLength() < channel->freq_count) {
+            config_errors() << "Configuration error: devices.[" << i << "] channels.[" << j
+                            << "]: squelch_snr_threshold should be an int, a float or a list of "
+                               "ints or floats with at least "
+                            << channel->freq_count << " elements\n";
+            error();
+        }
+        if (chan.exists("notch") && libconfig::Setting::TypeList == chan["notch"].getType() && chan["notch"].getLength() < channel->freq_count) {
+            config_errors() << "Configuration error: devices.[" << i << "] channels.[" << j << "]: notch should be an float or a list of floats with at least " << channel->freq_count << " elements\n";
+            error();
+        }
+        if (chan.exists("notch_q") && libconfig::Setting::TypeList == chan["notch_q"].getType() && chan["notch_q"].getLength() < channel->freq_count) {
+            config_errors() << "Configuration error: devices.[" << i << "] channels.[" << j << "]: notch_q should be a float or a list of floats with at least " << channel->freq_count << " elements\n";
+            error();
+        }
+        if (chan.exists("ctcss") && libconfig::Setting::TypeList == chan["ctcss"].getType() && chan["ctcss"].getLength() < channel->freq_count) {
+            config_errors() << "Configuration error: devices.[" << i << "] channels.[" << j << "]: ctcss should be an float or a list of floats with at least " << channel->freq_count << " elements\n";
+            error();
+        }
+        if (chan.exists("priorities") && chan["priorities"].getLength() < channel->freq_count) {
+            config_errors() << "Configuration error: devices.[" << i << "] channels.[" << j << "]: priorities should be a list with at least " << channel->freq_count << " elements\n";
+            error();
+        }
+        if (chan.exists("revisit_interval") && libconfig::Setting::TypeList == chan["revisit_interval"].getType() && chan["revisit_interval"].getLength() < channel->freq_count) {
+            config_errors() << "Configuration error: devices.[" << i << "] channels.[" << j << "]: revisit_interval should be an int or a list of ints with at least " << channel->freq_count
+                            << " elements\n";
+            error();
+        }
+        if (chan.exists("modulation") && chan.exists("modulations")) {
+            config_errors() << "Configuration error: devices.[" << i << "] channels.[" << j << "]: can't set both modulation and modulations\n";
+            error();
+        }
+        if (chan.exists("modulations") && chan["modulations"].getLength() < channel->freq_count) {
+            config_errors() << "Configuration error: devices.[" << i << "] channels.[" << j << "]: modulations should be a list with at least " << channel->freq_count << " elements\n";
+            error();
+        }
+
+        for (int f = 0; f < channel->freq_count; f++) {
+            channel->freqlist[f].frequency = parse_anynum2int((chan["freqs"][f]));
+            if (chan.exists("labels")) {
+                channel->freqlist[f].label = strdup(chan["labels"][f]);
             }
-            if (chans[j].exists("ctcss") && libconfig::Setting::TypeList == chans[j]["ctcss"].getType() && chans[j]["ctcss"].getLength() < channel->freq_count) {
-                cerr << "Configuration error: devices.[" << i << "] channels.[" << j << "]: ctcss should be an float or a list of floats with at least " << channel->freq_count << " elements\n";
-                error();
+            if (chan.exists("priorities")) {
+                channel->freqlist[f].priority = (int)chan["priorities"][f];
             }
-            if (chans[j].exists("modulation") && chans[j].exists("modulations")) {
-                cerr << "Configuration error: devices.[" << i << "] channels.[" << j << "]: can't set both modulation and modulations\n";
-                error();
+            if (chan.exists("revisit_interval")) {
+                if (libconfig::Setting::TypeList == chan["revisit_interval"].getType()) {
+                    channel->freqlist[f].revisit_interval = (int)chan["revisit_interval"][f];
+                } else {
+                    channel->freqlist[f].revisit_interval = (int)chan["revisit_interval"];
+                }
             }
-            if (chans[j].exists("modulations") && chans[j]["modulations"].getLength() < channel->freq_count) {
-                cerr << "Configuration error: devices.[" << i << "] channels.[" << j << "]: modulations should be a list with at least " << channel->freq_count << " elements\n";
+            if (channel->freqlist[f].priority < 0 || channel->freqlist[f].revisit_interval < 0) {
+                config_errors() << "Configuration error: devices.[" << i << "] channels.[" << j << "]: priorities and revisit_interval must not be negative\n";
                 error();
             }
-
-            for (int f = 0; f < channel->freq_count; f++) {
-                channel->freqlist[f].frequency = parse_anynum2int((chans[j]["freqs"][f]));
-                if (chans[j].exists("labels")) {
-                    channel->freqlist[f].label = strdup(chans[j]["labels"][f]);
-                }
-                if (chans[j].exists("modulations")) {
+            if (chan.exists("modulations")) {
 #ifdef NFM
-                    if (strncmp(chans[j]["modulations"][f], "nfm", 3) == 0) {
-                        channel->freqlist[f].modulation = MOD_NFM;
-                    } else
+                if (strncmp(chan["modulations"][f], "nfm", 3) == 0) {
+                    channel->freqlist[f].modulation = MOD_NFM;
+                } else
 #endif /* NFM */
-                        if (strncmp(chans[j]["modulations"][f], "am", 2) == 0) {
-                            channel->freqlist[f].modulation = MOD_AM;
-                        } else {
-                            cerr << "Configuration error: devices.[" << i << "] channels.[" << j << "] modulations.[" << f << "]: unknown modulation\n";
-                            error();
-                        }
-                } else {
-                    channel->freqlist[f].modulation = channel_modulation;
-                }
-            }
-            // Set initial frequency for scanning
-            // We tune 20 FFT bins higher to avoid DC spike
-            dev->input->centerfreq = channel->freqlist[0].frequency + 20 * (double)(dev->input->sample_rate / fft_size);
-        }
-        if (chans[j].exists("squelch")) {
-            cerr << "Warning: 'squelch' no longer supported and will be ignored, use 'squelch_threshold' or 'squelch_snr_threshold' instead\n";
-        }
-        if (chans[j].exists("squelch_threshold") && chans[j].exists("squelch_snr_threshold")) {
-            cerr << "Warning: Both 'squelch_threshold' and 'squelch_snr_threshold' are set and may conflict\n";
-        }
-        if (chans[j].exists("squelch_threshold")) {
-            // Value is dBFS, zero disables manual threshold (ie use auto squelch), negative is valid, positive is invalid
-            if (libconfig::Setting::TypeList == chans[j]["squelch_threshold"].getType()) {
-                // New-style array of per-frequency squelch settings
-                for (int f = 0; f < channel->freq_count; f++) {
-                    int threshold_dBFS = (int)chans[j]["squelch_threshold"][f];
-                    if (threshold_dBFS > 0) {
-                        cerr << "Configuration error: devices.[" << i << "] channels.[" << j << "]: squelch_threshold must be less than or equal to 0\n";
-                        error();
-                    } else if (threshold_dBFS == 0) {
-                        channel->freqlist[f].squelch.set_squelch_level_threshold(0);
+                    if (strncmp(chan["modulations"][f], "am", 2) == 0) {
+                        channel->freqlist[f].modulation = MOD_AM;
                     } else {
-                        channel->freqlist[f].squelch.set_squelch_level_threshold(dBFS_to_level(threshold_dBFS));
+                        config_errors() << "Configuration error: devices.[" << i << "] channels.[" << j << "] modulations.[" << f << "]: unknown modulation\n";
+                        error();
                     }
-                }
-            } else if (libconfig::Setting::TypeInt == chans[j]["squelch_threshold"].getType()) {
-                // Legacy (single squelch for all frequencies)
-                int threshold_dBFS = (int)chans[j]["squelch_threshold"];
-                float level;
+            } else {
+                channel->freqlist[f].modulation = channel_modulation;
+            }
+        }
+    }
+    if (chan.exists("squelch")) {
+        config_errors() << "Warning: 'squelch' no longer supported and will be ignored, use 'squelch_threshold' or 'squelch_snr_threshold' instead\n";
+    }
+    if (chan.exists("squelch_threshold") && chan.exists("squelch_snr_threshold")) {
+        config_errors() << "Warning: Both 'squelch_threshold' and 'squelch_snr_threshold' are set and may conflict\n";
+    }
+    if (chan.exists("squelch_threshold")) {
+        // Value is dBFS, zero disables manual threshold (ie use auto squelch), negative is valid, positive is invalid
+        if (libconfig::Setting::TypeList == chan["squelch_threshold"].getType()) {
+            // New-style array of per-frequency squelch settings
+            for (int f = 0; f < channel->freq_count; f++) {
+                int threshold_dBFS = (int)chan["squelch_threshold"][f];
                 if (threshold_dBFS > 0) {
-                    cerr << "Configuration error: devices.[" << i << "] channels.[" << j << "]: squelch_threshold must be less than or equal to 0\n";
+                    config_errors() << "Configuration error: devices.[" << i << "] channels.[" << j << "]: squelch_threshold must be less than or equal to 0\n";
                     error();
                 } else if (threshold_dBFS == 0) {
-                    level = 0;
+                    channel->freqlist[f].squelch.set_squelch_level_threshold(0);
                 } else {
-                    level = dBFS_to_level(threshold_dBFS);
+                    channel->freqlist[f].squelch.set_squelch_level_threshold(dBFS_to_level(threshold_dBFS));
                 }
-
-                for (int f = 0; f < channel->freq_count; f++) {
-                    channel->freqlist[f].squelch.set_squelch_level_threshold(level);
-                }
-            } else {
-                cerr << "Invalid value for squelch_threshold (should be int or list - use parentheses)\n";
+            }
+        } else if (libconfig::Setting::TypeInt == chan["squelch_threshold"].getType()) {
+            // Legacy (single squelch for all frequencies)
+            int threshold_dBFS = (int)chan["squelch_threshold"];
+            float level;
+            if (threshold_dBFS > 0) {
+                config_errors() << "Configuration error: devices.[" << i << "] channels.[" << j << "]: squelch_threshold must be less than or equal to 0\n";
                 error();
+            } else if (threshold_dBFS == 0) {
+                level = 0;
+            } else {
+                level = dBFS_to_level(threshold_dBFS);
             }
-        }
-        if (chans[j].exists("squelch_snr_threshold")) {
-            // Value is SNR in dB, zero disables squelch (ie always open), -1 uses default value, positive is valid, other negative values are invalid
-            if (libconfig::Setting::TypeList == chans[j]["squelch_snr_threshold"].getType()) {
-                // New-style array of per-frequency squelch settings
-                for (int f = 0; f < channel->freq_count; f++) {
-                    float snr = 0.f;
-                    if (libconfig::Setting::TypeFloat == chans[j]["squelch_snr_threshold"][f].getType()) {
-                        snr = (float)chans[j]["squelch_snr_threshold"][f];
-                    } else if (libconfig::Setting::TypeInt == chans[j]["squelch_snr_threshold"][f].getType()) {
-                        snr = (int)chans[j]["squelch_snr_threshold"][f];
-                    } else {
-                        cerr << "Configuration error: devices.[" << i << "] channels.[" << j << "]: squelch_snr_threshold list must be of int or float\n";
-                        error();
-                    }
 
-                    if (snr == -1.0) {
-                        continue;  // "disable" for this channel in list
-                    } else if (snr < 0) {
-                        cerr << "Configuration error: devices.[" << i << "] channels.[" << j << "]: squelch_snr_threshold must be greater than or equal to 0\n";
-                        error();
-                    } else {
-                        channel->freqlist[f].squelch.set_squelch_snr_threshold(snr);
-                    }
+            for (int f = 0; f < channel->freq_count; f++) {
+                channel->freqlist[f].squelch.set_squelch_level_threshold(level);
+            }
+        } else {
+            config_errors() << "Invalid value for squelch_threshold (should be int or list - use parentheses)\n";
+            error();
+        }
+    }
+    if (chan.exists("squelch_snr_threshold")) {
+        // Value is SNR in dB, zero disables squelch (ie always open), -1 uses default value, positive is valid, other negative values are invalid
+        if (libconfig::Setting::TypeList == chan["squelch_snr_threshold"].getType()) {
+            // New-style array of per-frequency squelch settings
+            for (int f = 0; f < channel->freq_count; f++) {
+                float snr = 0.f;
+                if (libconfig::Setting::TypeFloat == chan["squelch_snr_threshold"][f].getType()) {
+                    snr = (float)chan["squelch_snr_threshold"][f];
+                } else if (libconfig::Setting::TypeInt == chan["squelch_snr_threshold"][f].getType()) {
+                    snr = (int)chan["squelch_snr_threshold"][f];
+                } else {
+                    config_errors() << "Configuration error: devices.[" << i << "] channels.[" << j << "]: squelch_snr_threshold list must be of int or float\n";
+                    error();
                 }
-            } else if (libconfig::Setting::TypeFloat == chans[j]["squelch_snr_threshold"].getType() || libconfig::Setting::TypeInt == chans[j]["squelch_snr_threshold"].getType()) {
-                // Legacy (single squelch for all frequencies)
-                float snr = (libconfig::Setting::TypeFloat == chans[j]["squelch_snr_threshold"].getType()) ? (float)chans[j]["squelch_snr_threshold"] : (int)chans[j]["squelch_snr_threshold"];
 
                 if (snr == -1.0) {
-                    continue;  // "disable" so use the default without error message
+                    continue;  // "disable" for this channel in list
                 } else if (snr < 0) {
-                    cerr << "Configuration error: devices.[" << i << "] channels.[" << j << "]: squelch_snr_threshold must be greater than or equal to 0\n";
+                    config_errors() << "Configuration error: devices.[" << i << "] channels.[" << j << "]: squelch_snr_threshold must be greater than or equal to 0\n";
                     error();
+                } else {
+                    channel->freqlist[f].squelch.set_squelch_snr_threshold(snr);
                 }
+            }
+        } else if (libconfig::Setting::TypeFloat == chan["squelch_snr_threshold"].getType() || libconfig::Setting::TypeInt == chan["squelch_snr_threshold"].getType()) {
+            // Legacy (single squelch for all frequencies)
+            float snr = (libconfig::Setting::TypeFloat == chan["squelch_snr_threshold"].getType()) ? (float)chan["squelch_snr_threshold"] : (int)chan["squelch_snr_threshold"];
 
+            if (snr == -1.0) {
+                // "disable" so use the default without error message
+            } else if (snr < 0) {
+                config_errors() << "Configuration error: devices.[" << i << "] channels.[" << j << "]: squelch_snr_threshold must be greater than or equal to 0\n";
+                error();
+            } else {
                 for (int f = 0; f < channel->freq_count; f++) {
                     channel->freqlist[f].squelch.set_squelch_snr_threshold(snr);
                 }
-            } else {
-                cerr << "Invalid value for squelch_snr_threshold (should be float, int, or list of int/float - use parentheses)\n";
-                error();
             }
+        } else {
+            config_errors() << "Invalid value for squelch_snr_threshold (should be float, int, or list of int/float - use parentheses)\n";
+            error();
         }
-        if (chans[j].exists("notch")) {
-            static const float default_q = 10.0;
-
-            if (chans[j].exists("notch_q") && chans[j]["notch"].getType() != chans[j]["notch_q"].getType()) {
-                cerr << "Configuration error: devices.[" << i << "] channels.[" << j << "]: notch_q (if set) must be the same type as notch - "
-                     << "float or a list of floats with at least " << channel->freq_count << " elements\n";
-                error();
-            }
-            if (libconfig::Setting::TypeList == chans[j]["notch"].getType()) {
-                for (int f = 0; f < channel->freq_count; f++) {
-                    float freq = (float)chans[j]["notch"][f];
-                    float q = chans[j].exists("notch_q") ? (float)chans[j]["notch_q"][f] : default_q;
+    }
+    if (chan.exists("notch")) {
+        static const float default_q = 10.0;
 
-                    if (q == 0.0) {
-                        q = default_q;
-                    } else if (q <= 0.0) {
-                        cerr << "Configuration error: devices.[" << i << "] channels.[" << j << "] freq.[" << f << "]: invalid value for notch_q: " << q << " (must be greater than 0.0)\n";
-                        error();
-                    }
+        if (chan.exists("notch_q") && chan["notch"].getType() != chan["notch_q"].getType()) {
+            config_errors() << "Configuration error: devices.[" << i << "] channels.[" << j << "]: notch_q (if set) must be the same type as notch - "
+                            << "float or a list of floats with at least " << channel->freq_count << " elements\n";
+            error();
+        }
+        if (libconfig::Setting::TypeList == chan["notch"].getType()) {
+            for (int f = 0; f < channel->freq_count; f++) {
+                float freq = (float)chan["notch"][f];
+                float q = chan.exists("notch_q") ? (float)chan["notch_q"][f] : default_q;
 
-                    if (freq == 0) {
-                        continue;  // "disable" for this channel in list
-                    } else if (freq < 0) {
-                        cerr << "devices.[" << i << "] channels.[" << j << "] freq.[" << f << "]: invalid value for notch: " << freq << ", ignoring\n";
-                    } else {
-                        channel->freqlist[f].notch_filter = NotchFilter(freq, WAVE_RATE, q);
-                    }
-                }
-            } else if (libconfig::Setting::TypeFloat == chans[j]["notch"].getType()) {
-                float freq = (float)chans[j]["notch"];
-                float q = chans[j].exists("notch_q") ? (float)chans[j]["notch_q"] : default_q;
-                if (q <= 0.0) {
-                    cerr << "Configuration error: devices.[" << i << "] channels.[" << j << "]: invalid value for notch_q: " << q << " (must be greater than 0.0)\n";
+                if (q == 0.0) {
+                    q = default_q;
+                } else if (q <= 0.0) {
+                    config_errors() << "Configuration error: devices.[" << i << "] channels.[" << j << "] freq.[" << f << "]: invalid value for notch_q: " << q << " (must be greater than 0.0)\n";
                     error();
                 }
-                for (int f = 0; f < channel->freq_count; f++) {
-                    if (freq == 0) {
-                        continue;  // "disable" is default so ignore without error message
-                    } else if (freq < 0) {
-                        cerr << "devices.[" << i << "] channels.[" << j << "]: notch value '" << freq << "' invalid, ignoring\n";
-                    } else {
-                        channel->freqlist[f].notch_filter = NotchFilter(freq, WAVE_RATE, q);
-                    }
+
+                if (freq == 0) {
+                    continue;  // "disable" for this channel in list
+                } else if (freq < 0) {
+                    config_errors() << "devices.[" << i << "] channels.[" << j << "] freq.[" << f << "]: invalid value for notch: " << freq << ", ignoring\n";
+                } else {
+                    channel->freqlist[f].notch_filter = NotchFilter(freq, WAVE_RATE, q);
                 }
-            } else {
-                cerr << "Configuration error: devices.[" << i << "] channels.[" << j << "]: notch should be an float or a list of floats with at least " << channel->freq_count << " elements\n";
+            }
+        } else if (libconfig::Setting::TypeFloat == chan["notch"].getType()) {
+            float freq = (float)chan["notch"];
+            float q = chan.exists("notch_q") ? (float)chan["notch_q"] : default_q;
+            if (q <= 0.0) {
+                config_errors() << "Configuration error: devices.[" << i << "] channels.[" << j << "]: invalid value for notch_q: " << q << " (must be greater than 0.0)\n";
                 error();
             }
+            for (int f = 0; f < channel->freq_count; f++) {
+                if (freq == 0) {
+                    continue;  // "disable" is default so ignore without error message
+                } else if (freq < 0) {
+                    config_errors() << "devices.[" << i << "] channels.[" << j << "]: notch value '" << freq << "' invalid, ignoring\n";
+                } else {
+                    channel->freqlist[f].notch_filter = NotchFilter(freq, WAVE_RATE, q);
+                }
+            }
+        } else {
+            config_errors() << "Configuration error: devices.[" << i << "] channels.[" << j << "]: notch should be an float or a list of floats with at least " << channel->freq_count << " elements\n";
+            error();
         }
-        if (chans[j].exists("ctcss")) {
-            if (libconfig::Setting::TypeList == chans[j]["ctcss"].getType()) {
-                for (int f = 0; f < channel->freq_count; f++) {
-                    float freq = (float)chans[j]["ctcss"][f];
+    }
+    if (chan.exists("ctcss")) {
+        if (libconfig::Setting::TypeList == chan["ctcss"].getType()) {
+            for (int f = 0; f < channel->freq_count; f++) {
+                float freq = (float)chan["ctcss"][f];
 
-                    if (freq == 0) {
-                        continue;  // "disable" for this channel in list
-                    } else if (freq < 0) {
-                        cerr << "devices.[" << i << "] channels.[" << j << "] freq.[" << f << "]: invalid value for ctcss: " << freq << ", ignoring\n";
-                    } else {
-                        channel->freqlist[f].squelch.set_ctcss_freq(freq, WAVE_RATE);
-                    }
+                if (freq == 0) {
+                    continue;  // "disable" for this channel in list
+                } else if (freq < 0) {
+                    config_errors() << "devices.[" << i << "] channels.[" << j << "] freq.[" << f << "]: invalid value for ctcss: " << freq << ", ignoring\n";
+                } else {
+                    channel->freqlist[f].squelch.set_ctcss_freq(freq, WAVE_RATE);
                 }
-            } else if (libconfig::Setting::TypeFloat == chans[j]["ctcss"].getType()) {
-                float freq = (float)chans[j]["ctcss"];
-                for (int f = 0; f < channel->freq_count; f++) {
-                    if (freq <= 0) {
-                        cerr << "devices.[" << i << "] channels.[" << j << "]: ctcss value '" << freq << "' invalid, ignoring\n";
-                    } else {
-                        channel->freqlist[f].squelch.set_ctcss_freq(freq, WAVE_RATE);
-                    }
+            }
+        } else if (libconfig::Setting::TypeFloat == chan["ctcss"].getType()) {
+            float freq = (float)chan["ctcss"];
+            for (int f = 0; f < channel->freq_count; f++) {
+                if (freq <= 0) {
+                    config_errors() << "devices.[" << i << "] channels.[" << j << "]: ctcss value '" << freq << "' invalid, ignoring\n";
+                } else {
+                    channel->freqlist[f].squelch.set_ctcss_freq(freq, WAVE_RATE);
                 }
-            } else {
-                cerr << "Configuration error: devices.[" << i << "] channels.[" << j << "]: ctcss should be an float or a list of floats with at least " << channel->freq_count << " elements\n";
-                error();
             }
+        } else {
+            config_errors() << "Configuration error: devices.[" << i << "] channels.[" << j << "]: ctcss should be an float or a list of floats with at least " << channel->freq_count << " elements\n";
+            error();
         }
-        if (chans[j].exists("bandwidth")) {
-            channel->needs_raw_iq = 1;
+    }
+    if (chan.exists("bandwidth")) {
+        channel->needs_raw_iq = 1;
 
-            if (libconfig::Setting::TypeList == chans[j]["bandwidth"].getType()) {
-                for (int f = 0; f < channel->freq_count; f++) {
-                    int bandwidth = parse_anynum2int(chans[j]["bandwidth"][f]);
+        if (libconfig::Setting::TypeList == chan["bandwidth"].getType()) {
+            for (int f = 0; f < channel->freq_count; f++) {
+                int bandwidth = parse_anynum2int(chan["bandwidth"][f]);
 
-                    if (bandwidth == 0) {
-                        continue;  // "disable" for this channel in list
-                    } else if (bandwidth < 0) {
-                        cerr << "devices.[" << i << "] channels.[" << j << "] freq.[" << f << "]: bandwidth value '" << bandwidth << "' invalid, ignoring\n";
-                    } else {
-                        channel->freqlist[f].lowpass_filter = LowpassFilter((float)bandwidth / 2, WAVE_RATE);
-                    }
-                }
-            } else {
-                int bandwidth = parse_anynum2int(chans[j]["bandwidth"]);
                 if (bandwidth == 0) {
-                    continue;  // "disable" is default so ignore without error message
+                    continue;  // "disable" for this channel in list
                 } else if (bandwidth < 0) {
-                    cerr << "devices.[" << i << "] channels.[" << j << "]: bandwidth value '" << bandwidth << "' invalid, ignoring\n";
+                    config_errors() << "devices.[" << i << "] channels.[" << j << "] freq.[" << f << "]: bandwidth value '" << bandwidth << "' invalid, ignoring\n";
                 } else {
-                    for (int f = 0; f < channel->freq_count; f++) {
-                        channel->freqlist[f].lowpass_filter = LowpassFilter((float)bandwidth / 2, WAVE_RATE);
-                    }
+                    channel->freqlist[f].lowpass_filter = LowpassFilter((float)bandwidth / 2, WAVE_RATE);
                 }
             }
-        }
-        if (chans[j].exists("ampfactor")) {
-            if (libconfig::Setting::TypeList == chans[j]["ampfactor"].getType()) {
+        } else {
+            int bandwidth = parse_anynum2int(chan["bandwidth"]);
+            if (bandwidth == 0) {
+                // "disable" is default so ignore without error message
+            } else if (bandwidth < 0) {
+                config_errors() << "devices.[" << i << "] channels.[" << j << "]: bandwidth value '" << bandwidth << "' invalid, ignoring\n";
+            } else {
                 for (int f = 0; f < channel->freq_count; f++) {
-                    float ampfactor = (float)chans[j]["ampfactor"][f];
-
-                    if (ampfactor < 0) {
-                        cerr << "devices.[" << i << "] channels.[" << j << "] freq.[" << f << "]: ampfactor '" << ampfactor << "' must not be negative\n";
-                        error();
-                    }
-
-                    channel->freqlist[f].ampfactor = ampfactor;
+                    channel->freqlist[f].lowpass_filter = LowpassFilter((float)bandwidth / 2, WAVE_RATE);
                 }
-            } else {
-                float ampfactor = (float)chans[j]["ampfactor"];
+            }
+        }
+    }
+    if (chan.exists("ampfactor")) {
+        if (libconfig::Setting::TypeList == chan["ampfactor"].getType()) {
+            for (int f = 0; f < channel->freq_count; f++) {
+                float ampfactor = (float)chan["ampfactor"][f];
 
                 if (ampfactor < 0) {
-                    cerr << "devices.[" << i << "] channels.[" << j << "]: ampfactor '" << ampfactor << "' must not be negative\n";
+                    config_errors() << "devices.[" << i << "] channels.[" << j << "] freq.[" << f << "]: ampfactor '" << ampfactor << "' must not be negative\n";
                     error();
                 }
 
-                for (int f = 0; f < channel->freq_count; f++) {
-                    channel->freqlist[f].ampfactor = ampfactor;
-                }
+                channel->freqlist[f].ampfactor = ampfactor;
+            }
+        } else {
+            float ampfactor = (float)chan["ampfactor"];
+
+            if (ampfactor < 0) {
+                config_errors() << "devices.[" << i << "] channels.[" << j << "]: ampfactor '" << ampfactor << "' must not be negative\n";
+                error();
+            }
+
+            for (int f = 0; f < channel->freq_count; f++) {
+                channel->freqlist[f].ampfactor = ampfactor;
             }
         }
+    }
 
 #ifdef NFM
-        if (chans[j].exists("tau")) {
-            channel->alpha = ((int)chans[j]["tau"] == 0 ? 0.0f : exp(-1.0f / (WAVE_RATE * 1e-6 * (int)chans[j]["tau"])));
-        }
+    if (chan.exists("tau")) {
+        channel->alpha = ((int)chan["tau"] == 0 ? 0.0f : exp(-1.0f / (WAVE_RATE * 1e-6 * (int)chan["tau"])));
+    }
 #endif /* NFM */
-        libconfig::Setting& outputs = chans[j]["outputs"];
-        channel->output_count = outputs.getLength();
-        if (channel->output_count < 1) {
-            cerr << "Configuration error: devices.[" << i << "] channels.[" << j << "]: no outputs defined\n";
-            error();
-        }
-        channel->outputs = (output_t*)XCALLOC(channel->output_count, sizeof(struct output_t));
-        int outputs_enabled = parse_outputs(outputs, channel, i, j, false);
-        if (outputs_enabled < 1) {
-            cerr << "Configuration error: devices.[" << i << "] channels.[" << j << "]: no outputs defined\n";
-            error();
-        }
-        channel->outputs = (output_t*)XREALLOC(channel->outputs, outputs_enabled * sizeof(struct output_t));
-        channel->output_count = outputs_enabled;
+    libconfig::Setting& outputs = chan["outputs"];
+    channel->output_count = outputs.getLength();
+    if (channel->output_count < 1) {
+        config_errors() << "Configuration error: devices.[" << i << "] channels.[" << j << "]: no outputs defined\n";
+        error();
+    }
+    channel->outputs = (output_t*)XCALLOC(channel->output_count, sizeof(struct output_t));
+    int outputs_enabled = parse_outputs(outputs, channel, i, j, false);
+    if (outputs_enabled < 1) {
+        config_errors() << "Configuration error: devices.[" << i << "] channels.[" << j << "]: no outputs defined\n";
+        error();
+    }
+    channel->outputs = (output_t*)XREALLOC(channel->outputs, outputs_enabled * sizeof(struct output_t));
+    channel->output_count = outputs_enabled;
 
-        dev->base_bins[jj] = dev->bins[jj] =
-            (size_t)ceil((channel->freqlist[0].frequency + dev->input->sample_rate - dev->input->centerfreq) / (double)(dev->input->sample_rate / fft_size) - 1.0) % fft_size;
-        debug_print("bins[%d]: %zu\n", jj, dev->bins[jj]);
+    dev->base_bins[jj] = dev->bins[jj] = freq_to_bin(channel->freqlist[0].frequency, dev->input->centerfreq, dev->input->sample_rate);
+    debug_print("bins[%d]: %zu\n", jj, dev->bins[jj]);
 
 #ifdef NFM
-        for (int f = 0; f < channel->freq_count; f++) {
-            if (channel->freqlist[f].modulation == MOD_NFM) {
-                channel->needs_raw_iq = 1;
-                break;
-            }
+    for (int f = 0; f < channel->freq_count; f++) {
+        if (channel->freqlist[f].modulation == MOD_NFM) {
+            channel->needs_raw_iq = 1;
+            break;
         }
+    }
 #endif /* NFM */
 
-        if (channel->needs_raw_iq) {
-            // Downmixing is done only for NFM and raw IQ outputs. It's not critical to have some residual
-            // freq offset in AM, as it doesn't affect sound quality significantly.
-            double dm_dphi = (double)(channel->freqlist[0].frequency - dev->input->centerfreq);  // downmix freq in Hz
-
-            // In general, sample_rate is not required to be an integer multiple of WAVE_RATE.
-            // However the FFT window may only slide by an integer number of input samples. A non-zero rounding error
-            // introduces additional phase rotation which we have to compensate in order to shift the channel of interest
-            // to the center of the spectrum of the output I/Q stream. This is important for correct NFM demodulation.
-            // The error value (in Hz):
-            // - has an absolute value 0..WAVE_RATE/2
-            // - is linear with the error introduced by rounding the value of sample_rate/WAVE_RATE to the nearest integer
-            //   (range of -0.5..0.5)
-            // - is linear with the distance between center frequency and the channel frequency, normalized to 0..1
-            double decimation_factor = ((double)dev->input->sample_rate / (double)WAVE_RATE);
-            double dm_dphi_correction = (double)WAVE_RATE / 2.0;
-            dm_dphi_correction *= (decimation_factor - round(decimation_factor));
-            dm_dphi_correction *= (double)(channel->freqlist[0].frequency - dev->input->centerfreq) / ((double)dev->input->sample_rate / 2.0);
-
-            debug_print("dev[%d].chan[%d]: dm_dphi: %f Hz dm_dphi_correction: %f Hz\n", i, jj, dm_dphi, dm_dphi_correction);
-            dm_dphi -= dm_dphi_correction;
-            debug_print("dev[%d].chan[%d]: dm_dphi_corrected: %f Hz\n", i, jj, dm_dphi);
-            // Normalize
-            dm_dphi /= (double)WAVE_RATE;
-            // Unalias it, to prevent overflow of int during cast
-            dm_dphi -= trunc(dm_dphi);
-            debug_print("dev[%d].chan[%d]: dm_dphi_normalized=%f\n", i, jj, dm_dphi);
-            // Translate this to uint32_t range 0x00000000-0x00ffffff
-            dm_dphi *= 256.0 * 65536.0;
-            // Cast it to signed int first, because casting negative float to uint is not portable
-            channel->dm_dphi = (uint32_t)((int)dm_dphi);
-            debug_print("dev[%d].chan[%d]: dm_dphi_scaled=%f cast=0x%x\n", i, jj, dm_dphi, channel->dm_dphi);
-            channel->dm_phi = 0.f;
-        }
+    if (channel->needs_raw_iq) {
+        channel->dm_dphi = downmix_dphi(channel->freqlist[0].frequency, dev->input->centerfreq, dev->input->sample_rate);
+        debug_print("dev[%d].chan[%d]: dm_dphi=0x%x\n", i, jj, channel->dm_dphi);
+        channel->dm_phi = 0.f;
+    }
 
 #ifdef DEBUG_SQUELCH
-        // Setup squelch debug file, if enabled
-        char tmp_filepath[1024];
-        for (int f = 0; f < channel->freq_count; f++) {
-            snprintf(tmp_filepath, sizeof(tmp_filepath), "./squelch_debug-%d-%d.dat", j, f);
-            channel->freqlist[f].squelch.set_debug_file(tmp_filepath);
-        }
+    // Setup squelch debug file, if enabled
+    char tmp_filepath[1024];
+    for (int f = 0; f < channel->freq_count; f++) {
+        snprintf(tmp_filepath, sizeof(tmp_filepath), "./squelch_debug-%d-%d.dat", j, f);
+        channel->freqlist[f].squelch.set_debug_file(tmp_filepath);
+    }
 #endif /* DEBUG_SQUELCH */
+}
 
+static int parse_channels(libconfig::Setting& chans, device_t* dev, int i) {
+    int jj = 0;
+    for (int j = 0; j < chans.getLength(); j++) {
+        if (chans[j].exists("disable") && (bool)chans[j]["disable"] == true) {
+            continue;
+        }
+        parse_channel(chans[j], dev, i, j, jj, false);
         jj++;
     }
     return jj;
 }
 
-int parse_devices(libconfig::Setting& devs) {
-    int devcnt = 0;
-    for (int i = 0; i < devs.getLength(); i++) {
-        if (devs[i].exists("disable") && (bool)devs[i]["disable"] == true)
-            continue;
-        device_t* dev = devices + devcnt;
-        if (devs[i].exists("type")) {
-            dev->input = input_new(devs[i]["type"]);
-            if (dev->input == NULL) {
-                cerr << "Configuration error: devices.[" << i << "]: unsupported device type\n";
-                error();
-            }
+// Split the scan list into windows fitting in the device bandwidth and set up one demodulator (lane) per window member
+static void setup_wideband_scan(device_t* dev, int i) {
+    channel_t* channel = dev->channels;  // wideband scanning allows one channel only
+    std::vector<int> freqs;
+    for (int f = 0; f < channel->freq_count; f++) {
+        freqs.push_back(channel->freqlist[f].frequency);
+    }
+    std::vector<ScanWindow> windows = plan_scan_windows(freqs, scan_half_span(dev->input->sample_rate), scan_dc_guard(dev->input->sample_rate));
+
+    channel->scan_window_count = windows.size();
+    channel->scan_windows = (scan_window_t*)XCALLOC(windows.size(), sizeof(scan_window_t));
+    channel->lane_count = 0;
+    for (size_t w = 0; w < windows.size(); w++) {
+        scan_window_t* window = channel->scan_windows + w;
+        window->centerfreq = windows[w].centerfreq;
+        window->freq_count = windows[w].members.size();
+        window->freqs = (int*)XCALLOC(window->freq_count, sizeof(int));
+        for (int k = 0; k < window->freq_count; k++) {
+            window->freqs[k] = windows[w].members[k];
+        }
+        if (window->freq_count > channel->lane_count) {
+            channel->lane_count = window->freq_count;
+        }
+        debug_print("dev[%d]: scan window %zu: centerfreq=%d freqs=%d\n", i, w, window->centerfreq, window->freq_count);
+    }
+
+    channel->lanes = (channel_t*)XCALLOC(channel->lane_count, sizeof(channel_t));
+    channel->lane_bins = (size_t*)XCALLOC(channel->lane_count, sizeof(size_t));
+    channel->lane_base_bins = (size_t*)XCALLOC(channel->lane_count, sizeof(size_t));
+    for (int k = 0; k < channel->lane_count; k++) {
+        channel_t* lane = channel->lanes + k;
+        lane->freqlist = channel->freqlist;
+        lane->freq_count = channel->freq_count;
+        lane->needs_raw_iq = channel->needs_raw_iq;
+        lane->has_iq_outputs = channel->has_iq_outputs;
+        lane->has_pre_trigger = channel->has_pre_trigger;
+        lane->afc = channel->afc;
+        lane->mode = channel->mode;
+#ifdef NFM
+        lane->alpha = channel->alpha;
+#endif /* NFM */
+    }
+    channel->lanes_used = channel->lane_selected = 0;
+    dev->input->centerfreq = channel->scan_windows[0].centerfreq;
+    log(LOG_INFO, "Device %d: wideband scanning %d frequencies in %d window(s)\n", i, channel->freq_count, channel->scan_window_count);
+}
+
+static spectrum_t* parse_spectrum(libconfig::Setting& spec, int i) {
+    spectrum_t* spectrum = (spectrum_t*)XCALLOC(1, sizeof(spectrum_t));
+    if (!spec.exists("type")) {
+        config_errors() << "Configuration error: devices.[" << i << "] spectrum: mandatory parameter missing: type\n";
+        error();
+    }
+    if (!strcmp(spec["type"], "file")) {
+        spectrum->sink = SPECTRUM_FILE;
+    } else if (!strcmp(spec["type"], "udp")) {
+        spectrum->sink = SPECTRUM_UDP;
+    } else if (!strcmp(spec["type"], "unix")) {
+        spectrum->sink = SPECTRUM_UNIX;
+    } else {
+        config_errors() << "Configuration error: devices.[" << i << "] spectrum: invalid type (must be one of: \"file\", \"udp\", \"unix\")\n";
+        error();
+    }
+    if (spectrum->sink == SPECTRUM_UDP) {
+        if (!spec.exists("dest_address") || !spec.exists("dest_port")) {
+            config_errors() << "Configuration error: devices.[" << i << "] spectrum: dest_address and dest_port are required for udp\n";
+            error();
+        }
+        spectrum->dest_address = strdup(spec["dest_address"]);
+        if (spec["dest_port"].getType() == libconfig::Setting::TypeInt) {
+            char buffer[12];
+            sprintf(buffer, "%d", (int)spec["dest_port"]);
+            spectrum->dest_port = strdup(buffer);
         } else {
-#ifdef WITH_RTLSDR
-            cerr << "Warning: devices.[" << i << "]: assuming device type \"rtlsdr\", please set \"type\" in the device section.\n";
-            dev->input = input_new("rtlsdr");
-#else
-            cerr << "Configuration error: devices.[" << i << "]: mandatory parameter missing: type\n";
+            spectrum->dest_port = strdup(spec["dest_port"]);
+        }
+    } else {
+        if (!spec.exists("path")) {
+            config_errors() << "Configuration error: devices.[" << i << "] spectrum: mandatory parameter missing: path\n";
             error();
-#endif /* WITH_RTLSDR */
         }
-        assert(dev->input != NULL);
-        if (devs[i].exists("sample_rate")) {
-            int sample_rate = parse_anynum2int(devs[i]["sample_rate"]);
-            if (sample_rate < WAVE_RATE) {
-                cerr << "Configuration error: devices.[" << i << "]: sample_rate must be greater than " << WAVE_RATE << "\n";
-                error();
-            }
-            dev->input->sample_rate = sample_rate;
+        spectrum->path = strdup(spec["path"]);
+    }
+
+    spectrum->bin_count = spec.exists("bins") ? (int)spec["bins"] : 256;
+    if (spectrum->bin_count < 1 || spectrum->bin_count > (int)fft_size || fft_size % spectrum->bin_count != 0) {
+        config_errors() << "Configuration error: devices.[" << i << "] spectrum: bins must be a power of two not greater than fft_size (" << fft_size << ")\n";
+        error();
+    }
+    double rate = 1.0;  // frames per second
+    if (spec.exists("rate")) {
+        rate = (libconfig::Setting::TypeFloat == spec["rate"].getType()) ? (double)spec["rate"] : (int)spec["rate"];
+    }
+    spectrum->averaging = spec.exists("averaging") ? (int)spec["averaging"] : 50;
+    if (rate <= 0.0 || spectrum->averaging < 1 || rate * spectrum->averaging > WAVE_RATE) {
+        config_errors() << "Configuration error: devices.[" << i << "] spectrum: rate and averaging must be positive, and rate * averaging must not exceed " << WAVE_RATE << "\n";
+        error();
+    }
+    // one FFT is computed per output wave sample, spread the averaged ones evenly over the frame interval
+    spectrum->stride = (int)(WAVE_RATE / (rate * spectrum->averaging));
+    return spectrum;
+}
+
+// Set up discovery slots at the end of the channel list, all of them parked until a carrier is found
+static void setup_discovery(libconfig::Setting& disc, device_t* dev, int i, int channel_count, int slot_count) {
+    if (dev->mode != R_MULTICHANNEL) {
+        config_errors() << "Configuration error: devices.[" << i << "]: discovery requires multichannel mode\n";
+        error();
+    }
+    if (!disc.exists("channel")) {
+        config_errors() << "Configuration error: devices.[" << i << "] discovery: mandatory parameter missing: channel\n";
+        error();
+    }
+    discovery_t* discovery = (discovery_t*)XCALLOC(1, sizeof(discovery_t));
+    discovery->threshold = 10.0f;
+    if (disc.exists("threshold")) {
+        discovery->threshold = (libconfig::Setting::TypeFloat == disc["threshold"].getType()) ? (float)disc["threshold"] : (int)disc["threshold"];
+    }
+    discovery->raster = 25000.0;
+    if (disc.exists("raster")) {
+        discovery->raster = (libconfig::Setting::TypeFloat == disc["raster"].getType()) ? (double)disc["raster"] : (int)disc["raster"];
+    }
+    int hold_time = disc.exists("hold_time") ? (int)disc["hold_time"] : 3;
+    discovery->idle_timeout = disc.exists("idle_timeout") ? (int)disc["idle_timeout"] : 60;
+    if (discovery->threshold <= 0.0f || discovery->raster < 0.0 || hold_time < 1 || discovery->idle_timeout < 1) {
+        config_errors() << "Configuration error: devices.[" << i << "] discovery: threshold, hold_time and idle_timeout must be positive, raster must not be negative\n";
+        error();
+    }
+
+    // discovery works on the averaged spectrum, compute it at full resolution if it isn't published
+    if (dev->spectrum == NULL) {
+        dev->spectrum = (spectrum_t*)XCALLOC(1, sizeof(spectrum_t));
+        dev->spectrum->sink = SPECTRUM_NONE;
+        dev->spectrum->bin_count = fft_size;
+        dev->spectrum->averaging = 50;
+        dev->spectrum->stride = WAVE_RATE / dev->spectrum->averaging;
+    }
+    const double frame_rate = (double)WAVE_RATE / (dev->spectrum->stride * dev->spectrum->averaging);
+    discovery->tracker = new CarrierTracker((int)ceil(hold_time * frame_rate));
+
+    discovery->first_slot = channel_count;
+    discovery->slot_count = slot_count;
+    discovery->active_counters = (size_t*)XCALLOC(slot_count, sizeof(size_t));
+    discovery->last_activity = (struct timeval*)XCALLOC(slot_count, sizeof(struct timeval));
+    for (int k = 0; k < slot_count; k++) {
+        parse_channel(disc["channel"], dev, i, channel_count + k, channel_count + k, true);
+        dev->channels[channel_count + k].scan_state = SCAN_PARKED;
+    }
+    dev->discovery = discovery;
+}
+
+/*
+ * Pick the initial center frequency of a scanning device. It has to cover all
+ * fixed frequency channels and should cover the first frequency of each scan
+ * channel. Scan channels which don't fit are parked until the controller finds
+ * a time slice for them.
+ */
+static void setup_scan_center(device_t* dev, int i, int channel_count) {
+    const int half_span = scan_half_span(dev->input->sample_rate);
+    const int dc_guard = scan_dc_guard(dev->input->sample_rate);
+    std::vector<int> fixed, wanted;
+    std::vector<bool> accepted;
+    int centerfreq;
+
+    for (int j = 0; j < channel_count; j++) {
+        channel_t* channel = dev->channels + j;
+        if (channel->freq_count == 1) {
+            fixed.push_back(channel->freqlist[0].frequency);
         }
-        if (devs[i].exists("mode")) {
-            if (!strncmp(devs[i]["mode"], "multichannel", 12)) {
-                dev->mode = R_MULTICHANNEL;
-            } else if (!strncmp(devs[i]["mode"], "scan", 4)) {
-                dev->mode = R_SCAN;
-            } else {
-                cerr << "Configuration error: devices.[" << i << "]: invalid mode (must be one of: \"scan\", \"multichannel\")\n";
+    }
+    if (!plan_centerfreq(fixed, wanted, 0, half_span, dc_guard, &centerfreq, &accepted)) {
+        config_errors() << "Configuration error: devices.[" << i << "]: fixed frequency channels do not fit in the device bandwidth\n";
+        error();
+    }
+    // every scan frequency has to be reachable without dropping any of the fixed channels
+    for (int j = 0; j < channel_count; j++) {
+        channel_t* channel = dev->channels + j;
+        for (int f = 0; channel->freq_count > 1 && f < channel->freq_count; f++) {
+            std::vector<int> pinned(fixed);
+            pinned.push_back(channel->freqlist[f].frequency);
+            if (!plan_centerfreq(pinned, wanted, 0, half_span, dc_guard, &centerfreq, &accepted)) {
+                config_errors() << "Configuration error: devices.[" << i << "] channels.[" << j << "]: frequency " << channel->freqlist[f].frequency
+                                << " does not fit in the device bandwidth together with the fixed frequency channels\n";
                 error();
             }
-        } else {
-            dev->mode = R_MULTICHANNEL;
         }
-        if (dev->mode == R_MULTICHANNEL) {
-            dev->input->centerfreq = parse_anynum2int(devs[i]["centerfreq"]);
-        }  // centerfreq for R_SCAN will be set by parse_channels() after frequency list has been read
-#ifdef NFM
-        if (devs[i].exists("tau")) {
-            dev->alpha = ((int)devs[i]["tau"] == 0 ? 0.0f : exp(-1.0f / (WAVE_RATE * 1e-6 * (int)devs[i]["tau"])));
+        if (channel->freq_count > 1) {
+            wanted.push_back(channel->freqlist[0].frequency);
+        }
+    }
+
+    plan_centerfreq(fixed, wanted, 0, half_span, dc_guard, &centerfreq, &accepted);
+    dev->input->centerfreq = centerfreq;
+    for (int j = 0, w = 0; j < channel_count; j++) {
+        channel_t* channel = dev->channels + j;
+        if (channel->freq_count > 1 && !accepted[w++]) {
+            channel->scan_state = SCAN_PARKED;
+        }
+        channel->scan_next_freq = 0;
+        dev->base_bins[j] = dev->bins[j] = freq_to_bin(channel->freqlist[0].frequency, centerfreq, dev->input->sample_rate);
+        if (channel->needs_raw_iq) {
+            channel->dm_dphi = downmix_dphi(channel->freqlist[0].frequency, centerfreq, dev->input->sample_rate);
+        }
+    }
+    debug_print("dev[%d]: initial scan centerfreq=%d\n", i, centerfreq);
+}
+
+static input_t* parse_input_type(libconfig::Setting& devcfg, int i) {
+    input_t* input = NULL;
+    if (devcfg.exists("type")) {
+        input = input_new(devcfg["type"]);
+        if (input == NULL) {
+            config_errors() << "Configuration error: devices.[" << i << "]: unsupported device type\n";
+            error();
+        }
+    } else {
+#ifdef WITH_RTLSDR
+        config_errors() << "Warning: devices.[" << i << "]: assuming device type \"rtlsdr\", please set \"type\" in the device section.\n";
+        input = input_new("rtlsdr");
+#else
+        config_errors() << "Configuration error: devices.[" << i << "]: mandatory parameter missing: type\n";
+        error();
+#endif /* WITH_RTLSDR */
+    }
+    assert(input != NULL);
+    return input;
+}
+
+// Allocate the input buffer, at least min_size bytes
+static void alloc_input_buffer(input_t* input, size_t min_size) {
+    // For the input buffer size use a base value and round it up to the nearest multiple
+    // of fft_batch blocks of input samples.
+    // ceil is required here because sample rate is not guaranteed to be an integer multiple of WAVE_RATE.
+    size_t fft_batch_len = fft_batch * (2 * input->bytes_per_sample * (size_t)ceil((double)input->sample_rate / (double)WAVE_RATE));
+    input->buf_size = min_size;
+    if (input->buf_size % fft_batch_len != 0)
+        input->buf_size += fft_batch_len - input->buf_size % fft_batch_len;
+    debug_print("input->buf_size: %zu\n", input->buf_size);
+    input->buffer = (unsigned char*)XCALLOC(sizeof(unsigned char), input->buf_size + 2 * input->bytes_per_sample * fft_size);
+    input->bufs = input->bufe = 0;
+    input->overflow_count = 0;
+}
+
+/*
+ * A device with subbands is a wideband SDR which is not demodulated itself.
+ * Each sub-band becomes a separate multichannel device with its own input,
+ * fed from the wideband input, and gets its own channelizer.
+ */
+static subband_frontend_t* parse_frontend(libconfig::Setting& devcfg, int i) {
+    if (devcfg.exists("mode") && strncmp(devcfg["mode"], "multichannel", 12) != 0) {
+        config_errors() << "Configuration error: devices.[" << i << "]: subbands require multichannel mode\n";
+        error();
+    }
+    if (devcfg.exists("channels")) {
+        config_errors() << "Configuration error: devices.[" << i << "]: channels of a device with subbands have to be configured in the subbands\n";
+        error();
+    }
+    libconfig::Setting& subbands = devcfg["subbands"];
+    if (subbands.getLength() < 1) {
+        config_errors() << "Configuration error: devices.[" << i << "]: no subbands configured\n";
+        error();
+    }
+    input_t* wideband = parse_input_type(devcfg, i);
+    if (devcfg.exists("sample_rate")) {
+        wideband->sample_rate = parse_anynum2int(devcfg["sample_rate"]);
+    }
+    wideband->centerfreq = parse_anynum2int(devcfg["centerfreq"]);
+    input_parse_config(wideband, devcfg);
+    assert(wideband->sfmt != SFMT_UNDEF);
+    assert(wideband->fullscale > 0);
+    assert(wideband->bytes_per_sample > 0);
+    assert(wideband->sample_rate > WAVE_RATE);
+
+    // the sub-bands take the samples in 10 ms blocks, keep a quarter of a second to absorb scheduling delays
+    alloc_input_buffer(wideband, max((size_t)MIN_BUF_SIZE, (size_t)wideband->sample_rate / 4 * 2 * wideband->bytes_per_sample));
+    return subband_frontend_new(wideband, subbands.getLength());
+}
+
+// Parse everything of a device except its input type
+static void parse_device(libconfig::Setting& devcfg, device_t* dev, int i) {
+    if (devcfg.exists("sample_rate")) {
+        int sample_rate = parse_anynum2int(devcfg["sample_rate"]);
+        if (sample_rate < WAVE_RATE) {
+            config_errors() << "Configuration error: devices.[" << i << "]: sample_rate must be greater than " << WAVE_RATE << "\n";
+            error();
+        }
+        dev->input->sample_rate = sample_rate;
+    }
+    if (devcfg.exists("mode")) {
+        if (!strncmp(devcfg["mode"], "multichannel", 12)) {
+            dev->mode = R_MULTICHANNEL;
+        } else if (!strncmp(devcfg["mode"], "scan", 4)) {
+            dev->mode = R_SCAN;
         } else {
-            dev->alpha = alpha;
+            config_errors() << "Configuration error: devices.[" << i << "]: invalid mode (must be one of: \"scan\", \"multichannel\")\n";
+            error();
         }
+    } else {
+        dev->mode = R_MULTICHANNEL;
+    }
+    if (dev->mode == R_MULTICHANNEL) {
+        dev->input->centerfreq = parse_anynum2int(devcfg["centerfreq"]);
+    }  // centerfreq for R_SCAN will be set by parse_channels() after frequency list has been read
+#ifdef NFM
+    if (devcfg.exists("tau")) {
+        dev->alpha = ((int)devcfg["tau"] == 0 ? 0.0f : exp(-1.0f / (WAVE_RATE * 1e-6 * (int)devcfg["tau"])));
+    } else {
+        dev->alpha = alpha;
+    }
 #endif /* NFM */
 
-        // Parse hardware-dependent configuration parameters
-        if (input_parse_config(dev->input, devs[i]) < 0) {
-            // FIXME: get and display error string from input_parse_config
-            // Right now it exits the program on failure.
-        }
-        // Some basic sanity checks for crucial parameters which have to be set
-        // (or can be modified) by the input driver
-        assert(dev->input->sfmt != SFMT_UNDEF);
-        assert(dev->input->fullscale > 0);
-        assert(dev->input->bytes_per_sample > 0);
-        assert(dev->input->sample_rate > WAVE_RATE);
-
-        // For the input buffer size use a base value and round it up to the nearest multiple
-        // of FFT_BATCH blocks of input samples.
-        // ceil is required here because sample rate is not guaranteed to be an integer multiple of WAVE_RATE.
-        size_t fft_batch_len = FFT_BATCH * (2 * dev->input->bytes_per_sample * (size_t)ceil((double)dev->input->sample_rate / (double)WAVE_RATE));
-        dev->input->buf_size = MIN_BUF_SIZE;
-        if (dev->input->buf_size % fft_batch_len != 0)
-            dev->input->buf_size += fft_batch_len - dev->input->buf_size % fft_batch_len;
-        debug_print("dev->input->buf_size: %zu\n", dev->input->buf_size);
-        dev->input->buffer = (unsigned char*)XCALLOC(sizeof(unsigned char), dev->input->buf_size + 2 * dev->input->bytes_per_sample * fft_size);
-        dev->input->bufs = dev->input->bufe = 0;
-        dev->input->overflow_count = 0;
-        dev->output_overrun_count = 0;
-        dev->waveend = dev->waveavail = dev->row = dev->tq_head = dev->tq_tail = 0;
-        dev->last_frequency = -1;
-
-        libconfig::Setting& chans = devs[i]["channels"];
-        if (chans.getLength() < 1) {
-            cerr << "Configuration error: devices.[" << i << "]: no channels configured\n";
-            error();
-        }
-        dev->channels = (channel_t*)XCALLOC(chans.getLength(), sizeof(channel_t));
-        dev->bins = (size_t*)XCALLOC(chans.getLength(), sizeof(size_t));
-        dev->base_bins = (size_t*)XCALLOC(chans.getLength(), sizeof(size_t));
-        dev->channel_count = 0;
-        int channel_count = parse_channels(chans, dev, i);
-        if (channel_count < 1) {
-            cerr << "Configuration error: devices.[" << i << "]: no channels enabled\n";
-            error();
-        }
-        if (dev->mode == R_SCAN && channel_count > 1) {
-            cerr << "Configuration error: devices.[" << i << "]: only one channel is allowed in scan mode\n";
-            error();
-        }
-        dev->channels = (channel_t*)XREALLOC(dev->channels, channel_count * sizeof(channel_t));
-        dev->bins = (size_t*)XREALLOC(dev->bins, channel_count * sizeof(size_t));
-        dev->base_bins = (size_t*)XREALLOC(dev->base_bins, channel_count * sizeof(size_t));
-        dev->channel_count = channel_count;
+    // Parse hardware-dependent configuration parameters
+    if (input_parse_config(dev->input, devcfg) < 0) {
+        // FIXME: get and display error string from input_parse_config
+        // Right now it exits the program on failure.
+    }
+    // Some basic sanity checks for crucial parameters which have to be set
+    // (or can be modified) by the input driver
+    assert(dev->input->sfmt != SFMT_UNDEF);
+    assert(dev->input->fullscale > 0);
+    assert(dev->input->bytes_per_sample > 0);
+    assert(dev->input->sample_rate > WAVE_RATE);
+
+    alloc_input_buffer(dev->input, MIN_BUF_SIZE);
+    dev->output_overrun_count = 0;
+    dev->waveend = dev->waveavail = dev->tq_head = dev->tq_tail = 0;
+    dev->last_frequency = -1;
+
+    // scan timing, all in milliseconds
+    int scan_settle_time = devcfg.exists("scan_settle_time") ? (int)devcfg["scan_settle_time"] : 40;
+    int scan_probe_time = devcfg.exists("scan_probe_time") ? (int)devcfg["scan_probe_time"] : 30;
+    dev->scan_hang_time = devcfg.exists("scan_hang_time") ? (int)devcfg["scan_hang_time"] : 2000;
+    if (scan_settle_time < 0 || scan_probe_time <= 0 || dev->scan_hang_time < 0) {
+        config_errors() << "Configuration error: devices.[" << i << "]: scan_settle_time and scan_hang_time must not be negative, scan_probe_time must be positive\n";
+        error();
+    }
+    dev->scan_settle_samples = (int)((double)dev->input->sample_rate * scan_settle_time / 1000.0);
+    dev->scan_probe_len = scan_probe_time * WAVE_RATE / 1000;
+
+    dev->spectrum = devcfg.exists("spectrum") ? parse_spectrum(devcfg["spectrum"], i) : NULL;
+
+    libconfig::Setting& chans = devcfg["channels"];
+    if (chans.getLength() < 1) {
+        config_errors() << "Configuration error: devices.[" << i << "]: no channels configured\n";
+        error();
+    }
+    int slot_count = 0;
+    if (devcfg.exists("discovery")) {
+        slot_count = devcfg["discovery"].exists("max_channels") ? (int)devcfg["discovery"]["max_channels"] : 8;
+        if (slot_count < 1) {
+            config_errors() << "Configuration error: devices.[" << i << "] discovery: max_channels must be positive\n";
+            error();
+        }
+    }
+    dev->channels = (channel_t*)XCALLOC(chans.getLength() + slot_count, sizeof(channel_t));
+    dev->bins = (size_t*)XCALLOC(chans.getLength() + slot_count, sizeof(size_t));
+    dev->base_bins = (size_t*)XCALLOC(chans.getLength() + slot_count, sizeof(size_t));
+    dev->channel_count = 0;
+    int channel_count = parse_channels(chans, dev, i);
+    if (channel_count < 1) {
+        config_errors() << "Configuration error: devices.[" << i << "]: no channels enabled\n";
+        error();
+    }
+    if (slot_count > 0) {
+        setup_discovery(devcfg["discovery"], dev, i, channel_count, slot_count);
+        channel_count += slot_count;
+    }
+    if (devcfg.exists("wideband_scan") && (bool)devcfg["wideband_scan"] == true) {
+        if (dev->mode != R_SCAN) {
+            config_errors() << "Configuration error: devices.[" << i << "]: wideband_scan requires scan mode\n";
+            error();
+        }
+        if (channel_count > 1) {
+            config_errors() << "Configuration error: devices.[" << i << "]: only one channel is allowed with wideband_scan\n";
+            error();
+        }
+        setup_wideband_scan(dev, i);
+    } else if (dev->mode == R_SCAN) {
+        setup_scan_center(dev, i, channel_count);
+    }
+    dev->channels = (channel_t*)XREALLOC(dev->channels, channel_count * sizeof(channel_t));
+    dev->bins = (size_t*)XREALLOC(dev->bins, channel_count * sizeof(size_t));
+    dev->base_bins = (size_t*)XREALLOC(dev->base_bins, channel_count * sizeof(size_t));
+    dev->channel_count = channel_count;
+    if (devcfg.exists("dense") && (bool)devcfg["dense"] == true) {
+        if (dev->mode != R_MULTICHANNEL) {
+            config_errors() << "Configuration error: devices.[" << i << "]: dense mode requires multichannel mode\n";
+            error();
+        }
+        dev->dense = new DenseBinReader(dev->base_bins, channel_count);
+    }
+}
+
+// Number of devices parse_devices() may fill in, every sub-band of a wideband device is a device of its own
+int count_devices(libconfig::Setting& devs) {
+    int count = devs.getLength();
+    for (int i = 0; i < devs.getLength(); i++) {
+        if (devs[i].exists("subbands") && devs[i]["subbands"].getLength() > 1) {
+            count += devs[i]["subbands"].getLength() - 1;
+        }
+    }
+    return count;
+}
+
+// Failed inputs are reopened unless configured otherwise, a file input which has hit its end is done
+static bool parse_restart(libconfig::Setting& devcfg) {
+    if (devcfg.exists("restart")) {
+        return (bool)devcfg["restart"];
+    }
+    return !devcfg.exists("type") || strcmp(devcfg["type"], "file") != 0;
+}
+
+int parse_devices(libconfig::Setting& devs) {
+    int devcnt = 0;
+    for (int i = 0; i < devs.getLength(); i++) {
+        if (devs[i].exists("disable") && (bool)devs[i]["disable"] == true)
+            continue;
+        if (devs[i].exists("subbands")) {
+            subband_frontend_t* frontend = parse_frontend(devs[i], i);
+            for (int k = 0; k < frontend->subband_count; k++) {
+                device_t* dev = devices + devcnt;
+                dev->input = subband_input_new(frontend, k);
+                parse_device(devs[i]["subbands"][k], dev, i);
+                dev->restart = parse_restart(devs[i]);
+                if (dev->mode != R_MULTICHANNEL) {
+                    config_errors() << "Configuration error: devices.[" << i << "] subbands.[" << k << "]: sub-bands require multichannel mode\n";
+                    error();
+                }
+                devcnt++;
+            }
+            continue;
+        }
+        device_t* dev = devices + devcnt;
+        dev->input = parse_input_type(devs[i], i);
+        parse_device(devs[i], dev, i);
+        dev->restart = parse_restart(devs[i]);
         devcnt++;
     }
     return devcnt;
@@ -876,7 +1306,7 @@ int parse_mixers(libconfig::Setting& mx) {
         if (mx[i].exists("disable") && (bool)mx[i]["disable"] == true)
             continue;
         if ((name = mx[i].getName()) == NULL) {
-            cerr << "Configuration error: mixers.[" << i << "]: undefined mixer name\n";
+            config_errors() << "Configuration error: mixers.[" << i << "]: undefined mixer name\n";
             error();
         }
         debug_print("mm=%d name=%s\n", mm, name);
@@ -897,20 +1327,20 @@ int parse_mixers(libconfig::Setting& mx) {
         // Make sure lowpass / highpass aren't flipped.
         // If lowpass is enabled (greater than zero) it must be larger than highpass
         if (channel->lowpass > 0 && channel->lowpass < channel->highpass) {
-            cerr << "Configuration error: mixers.[" << i << "]: lowpass (" << channel->lowpass << ") must be greater than or equal to highpass (" << channel->highpass << ")\n";
+            config_errors() << "Configuration error: mixers.[" << i << "]: lowpass (" << channel->lowpass << ") must be greater than or equal to highpass (" << channel->highpass << ")\n";
             error();
         }
 
         libconfig::Setting& outputs = mx[i]["outputs"];
         channel->output_count = outputs.getLength();
         if (channel->output_count < 1) {
-            cerr << "Configuration error: mixers.[" << i << "]: no outputs defined\n";
+            config_errors() << "Configuration error: mixers.[" << i << "]: no outputs defined\n";
             error();
         }
         channel->outputs = (output_t*)XCALLOC(channel->output_count, sizeof(struct output_t));
         int outputs_enabled = parse_outputs(outputs, channel, i, 0, true);
         if (outputs_enabled < 1) {
-            cerr << "Configuration error: mixers.[" << i << "]: no outputs defined\n";
+            config_errors() << "Configuration error: mixers.[" << i << "]: no outputs defined\n";
             error();
         }
         channel->outputs = (output_t*)XREALLOC(channel->outputs, outputs_enabled * sizeof(struct output_t));
@@ -921,3 +1351,131 @@ int parse_mixers(libconfig::Setting& mx) {
 }
 
 // vim: ts=4
+
+void parse_threads(libconfig::Setting& threads) {
+    for (int k = 0; k < threads.getLength(); k++) {
+        const char* name = threads[k].getName();
+        int cls = 0;
+        while (cls < THREAD_CLASS_COUNT && strcmp(thread_class_name(cls), name) != 0) {
+            cls++;
+        }
+        if (cls == THREAD_CLASS_COUNT) {
+            config_errors() << "Configuration error: threads." << name << ": unknown thread class (must be one of:";
+            for (cls = 0; cls < THREAD_CLASS_COUNT; cls++) {
+                config_errors() << " \"" << thread_class_name(cls) << "\"";
+            }
+            config_errors() << ")\n";
+            error();
+        }
+        libconfig::Setting& cfg = threads[k];
+        thread_sched_t& sched = thread_sched[cls];
+        if (cfg.exists("cpus")) {
+            if (!thread_affinity_supported()) {
+                config_errors() << "Configuration error: threads." << name << ".cpus: CPU affinity is not supported on this platform\n";
+                error();
+            }
+            if (!parse_cpu_list(cfg["cpus"], sched.cpus) || sched.cpus.empty()) {
+                config_errors() << "Configuration error: threads." << name << ".cpus: invalid CPU list, expected something like \"0-3,6\"\n";
+                error();
+            }
+        }
+        sched.rt_priority = cfg.exists("realtime_priority") ? (int)cfg["realtime_priority"] : 0;
+        if (sched.rt_priority < 0 || sched.rt_priority > 99) {
+            config_errors() << "Configuration error: threads." << name << ".realtime_priority must be between 1 and 99\n";
+            error();
+        }
+        sched.nice = cfg.exists("nice") ? (int)cfg["nice"] : 0;
+        if (sched.nice < -20 || sched.nice > 19) {
+            config_errors() << "Configuration error: threads." << name << ".nice must be between -20 and 19\n";
+            error();
+        }
+        if (sched.rt_priority > 0 && sched.nice != 0) {
+            config_errors() << "Configuration error: threads." << name << ": realtime_priority and nice can't be used together\n";
+            error();
+        }
+    }
+}
+
+Governor* parse_governor(libconfig::Setting& cfg) {
+    std::vector<int> order;
+    if (cfg.exists("shed")) {
+        libconfig::Setting& shed = cfg["shed"];
+        for (int k = 0; k < shed.getLength(); k++) {
+            const char* name = shed[k];
+            int action = 0;
+            while (action < SHED_ACTION_COUNT && strcmp(shed_action_name(action), name) != 0) {
+                action++;
+            }
+            if (action == SHED_ACTION_COUNT) {
+                config_errors() << "Configuration error: governor.shed: unknown action \"" << name << "\" (must be one of:";
+                for (action = 0; action < SHED_ACTION_COUNT; action++) {
+                    config_errors() << " \"" << shed_action_name(action) << "\"";
+                }
+                config_errors() << ")\n";
+                error();
+            }
+            if (std::find(order.begin(), order.end(), action) != order.end()) {
+                config_errors() << "Configuration error: governor.shed: \"" << name << "\" is listed twice\n";
+                error();
+            }
+            order.push_back(action);
+        }
+    } else {
+        for (int action = 0; action < SHED_ACTION_COUNT; action++) {
+            order.push_back(action);
+        }
+    }
+    float high_water = cfg.exists("high_water") ? (float)cfg["high_water"] : 0.5f;
+    float low_water = cfg.exists("low_water") ? (float)cfg["low_water"] : 0.2f;
+    if (low_water <= 0.0f || low_water >= high_water || high_water >= 1.0f) {
+        config_errors() << "Configuration error: governor: 0 < low_water < high_water < 1 is required\n";
+        error();
+    }
+    return new Governor(order, high_water, low_water, GOVERNOR_SHED_INTERVAL, GOVERNOR_RESTORE_DELAY);
+}
+
+event_stream_t* parse_event_stream(libconfig::Setting& cfg) {
+    event_stream_t* stream = (event_stream_t*)XCALLOC(1, sizeof(event_stream_t));
+    stream->socket_path = cfg.exists("socket") ? strdup(cfg["socket"]) : NULL;
+    if (cfg.exists("udp_address") != cfg.exists("udp_port")) {
+        config_errors() << "Configuration error: event_stream: udp_address and udp_port go together\n";
+        error();
+    }
+    if (cfg.exists("udp_address")) {
+        stream->udp_address = strdup(cfg["udp_address"]);
+        if (cfg["udp_port"].getType() == libconfig::Setting::TypeInt) {
+            char buffer[12];
+            snprintf(buffer, sizeof(buffer), "%d", (int)cfg["udp_port"]);
+            stream->udp_port = strdup(buffer);
+        } else {
+            stream->udp_port = strdup(cfg["udp_port"]);
+        }
+    }
+    if (stream->socket_path == NULL && stream->udp_address == NULL) {
+        config_errors() << "Configuration error: event_stream: socket or udp_address and udp_port are required\n";
+        error();
+    }
+    event_queue = new TxEventQueue(EVENT_QUEUE_LEN);
+    return stream;
+}
+
+http_server_t* parse_http_server(libconfig::Setting& cfg) {
+    http_server_t* server = (http_server_t*)XCALLOC(1, sizeof(http_server_t));
+    server->address = cfg.exists("address") ? strdup(cfg["address"]) : NULL;
+    server->port = cfg.exists("port") ? (int)cfg["port"] : 8000;
+    server->burst_size = cfg.exists("burst_size") ? (int)cfg["burst_size"] : 16384;
+    server->max_listeners = cfg.exists("max_listeners") ? (int)cfg["max_listeners"] : 100;
+    if (server->port <= 0 || server->port > 65535) {
+        config_errors() << "Configuration error: http_server.port must be between 1 and 65535\n";
+        error();
+    }
+    if (server->burst_size < 0 || server->burst_size > 65536) {
+        config_errors() << "Configuration error: http_server.burst_size must be between 0 and 65536\n";
+        error();
+    }
+    if (server->max_listeners <= 0) {
+        config_errors() << "Configuration error: http_server.max_listeners must be positive\n";
+        error();
+    }
+    return server;
+}
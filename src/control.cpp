@@ -0,0 +1,321 @@
+/*
+ * control.cpp
+ * Local control socket for querying and adjusting a running instance
+ *
+ * Copyright (C) 2024 charlie-foxtrot
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <errno.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>  // sockaddr_un
+#include <unistd.h>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "rtl_airband.h"
+
+using namespace std;
+
+/*
+ * Line protocol: one command per line, answered with zero or more lines of
+ * data and a final "OK" or "ERROR <reason>" line. Devices, channels and
+ * outputs are numbered from 0 in the order of the configuration, as in the
+ * statistics file. Commands reading state run under the configuration read
+ * lock, the ones changing it under the write lock, so they never see a
+ * configuration reload half done.
+ */
+
+#define CONTROL_MAX_CLIENTS 8
+#define CONTROL_LINE_MAX 256  // longer lines close the connection
+#define CONTROL_POLL_MS 100
+
+static const char* const control_help =
+    "levels\n"
+    "mute <device> <channel>\n"
+    "unmute <device> <channel>\n"
+    "mute_output <device> <channel> <output>\n"
+    "unmute_output <device> <channel> <output>\n"
+    "tune <device> <channel> <MHz>\n"
+    "resume <device> <channel>\n"
+    "squelch <device> <channel> <dBFS, 0 for auto>\n"
+    "squelch_snr <device> <channel> <dB>\n";
+
+static string control_error(const char* reason) {
+    return string("ERROR ") + reason + "\n";
+}
+
+static channel_t* control_channel(istringstream& args, string* err) {
+    int d, c;
+    if (!(args >> d >> c)) {
+        *err = control_error("device and channel expected");
+        return NULL;
+    }
+    if (d < 0 || d >= device_count || c < 0 || c >= devices[d].channel_count) {
+        *err = control_error("no such channel");
+        return NULL;
+    }
+    return devices[d].channels + c;
+}
+
+static string control_levels(void) {
+    ConfigReadLock config_read_lock;
+    string out;
+    char buf[256];
+    for (int i = 0; i < device_count; i++) {
+        device_t* dev = devices + i;
+        for (int j = 0; j < dev->channel_count; j++) {
+            channel_t* channel = dev->channels + j;
+            int muted_outputs = 0;
+            for (int k = 0; k < channel->output_count; k++) {
+                muted_outputs += channel->outputs[k].muted;
+            }
+            snprintf(buf, sizeof(buf), "device=%d channel=%d freq=%.4f signal=%.1f noise=%.1f squelch=%s muted=%d outputs=%d muted_outputs=%d hold=%d\n", i, j, channel->tui.frequency / 1000000.0,
+                     level_to_dBFS(channel->tui.signal_level), level_to_dBFS(channel->tui.noise_level), channel->axcindicate != NO_SIGNAL ? "open" : "closed", channel->muted, channel->output_count,
+                     muted_outputs, channel->scan_hold);
+            out += buf;
+        }
+    }
+    return out + "OK\n";
+}
+
+static string control_mute(istringstream& args, bool mute) {
+    string err;
+    config_write_lock();
+    channel_t* channel = control_channel(args, &err);
+    if (channel != NULL) {
+        channel->muted = mute;
+    }
+    pthread_rwlock_unlock(&config_lock);
+    return channel != NULL ? "OK\n" : err;
+}
+
+static string control_mute_output(istringstream& args, bool mute) {
+    string err;
+    int k = 0;
+    config_write_lock();
+    channel_t* channel = control_channel(args, &err);
+    if (channel != NULL && !(args >> k && k >= 0 && k < channel->output_count)) {
+        err = control_error("no such output");
+        channel = NULL;
+    }
+    if (channel != NULL) {
+        channel->outputs[k].muted = mute;
+    }
+    pthread_rwlock_unlock(&config_lock);
+    return channel != NULL ? "OK\n" : err;
+}
+
+// Jump to a frequency of a scan channel and stay there until resumed, see controller_thread()
+static string control_tune(istringstream& args) {
+    string err;
+    double mhz = 0.0;
+    config_write_lock();
+    channel_t* channel = control_channel(args, &err);
+    if (channel != NULL && channel->freq_count < 2) {
+        err = control_error("not a scan channel");
+        channel = NULL;
+    } else if (channel != NULL && !(args >> mhz)) {
+        err = control_error("frequency expected");
+        channel = NULL;
+    }
+    if (channel != NULL) {
+        const int freq = (int)lround(mhz * 1000000.0);
+        int f;
+        for (f = 0; f < channel->freq_count && channel->freqlist[f].frequency != freq; f++)
+            ;
+        if (f < channel->freq_count) {
+            channel->scan_force = f;
+            channel->scan_hold = true;
+        } else {
+            err = control_error("frequency not scanned by the channel");
+            channel = NULL;
+        }
+    }
+    pthread_rwlock_unlock(&config_lock);
+    return channel != NULL ? "OK\n" : err;
+}
+
+static string control_resume(istringstream& args) {
+    string err;
+    config_write_lock();
+    channel_t* channel = control_channel(args, &err);
+    if (channel != NULL) {
+        channel->scan_force = -1;
+        channel->scan_hold = false;
+    }
+    pthread_rwlock_unlock(&config_lock);
+    return channel != NULL ? "OK\n" : err;
+}
+
+static string control_squelch(istringstream& args, bool snr) {
+    string err;
+    float db = 0.0f;
+    config_write_lock();
+    channel_t* channel = control_channel(args, &err);
+    if (channel != NULL && !(args >> db)) {
+        err = control_error("threshold expected");
+        channel = NULL;
+    } else if (channel != NULL && !snr && db > 0.0f) {
+        err = control_error("squelch threshold must be less than or equal to 0");
+        channel = NULL;
+    }
+    if (channel != NULL) {
+        // lanes of a wideband scan channel share its frequency list
+        for (int f = 0; f < channel->freq_count; f++) {
+            Squelch& squelch = channel->freqlist[f].squelch;
+            if (snr) {
+                squelch.set_squelch_snr_threshold(db);
+            } else {
+                squelch.set_squelch_level_threshold(db == 0.0f ? 0.0f : dBFS_to_level(db));
+            }
+        }
+    }
+    pthread_rwlock_unlock(&config_lock);
+    return channel != NULL ? "OK\n" : err;
+}
+
+static string control_execute(const string& line) {
+    istringstream args(line);
+    string cmd;
+    if (!(args >> cmd)) {
+        return "";
+    }
+    string reply;
+    if (cmd == "help") {
+        reply = string(control_help) + "OK\n";
+    } else if (cmd == "levels") {
+        reply = control_levels();
+    } else if (cmd == "mute" || cmd == "unmute") {
+        reply = control_mute(args, cmd == "mute");
+    } else if (cmd == "mute_output" || cmd == "unmute_output") {
+        reply = control_mute_output(args, cmd == "mute_output");
+    } else if (cmd == "tune") {
+        reply = control_tune(args);
+    } else if (cmd == "resume") {
+        reply = control_resume(args);
+    } else if (cmd == "squelch" || cmd == "squelch_snr") {
+        reply = control_squelch(args, cmd == "squelch_snr");
+    } else {
+        reply = control_error("unknown command, try help");
+    }
+    if (cmd != "help" && cmd != "levels" && reply == "OK\n") {
+        log(LOG_INFO, "Control socket: %s\n", line.c_str());
+    }
+    return reply;
+}
+
+static int control_listen(const char* path) {
+    struct sockaddr_un addr;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        log(LOG_ERR, "Control socket path %s is too long\n", path);
+        return -1;
+    }
+    // a stale socket of a previous run is in the way, anything else is left alone
+    struct stat st;
+    if (lstat(path, &st) == 0 && S_ISSOCK(st.st_mode)) {
+        unlink(path);
+    }
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        log(LOG_ERR, "Cannot create control socket: %s\n", strerror(errno));
+        return -1;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(fd, CONTROL_MAX_CLIENTS) < 0) {
+        log(LOG_ERR, "Cannot listen on control socket %s: %s\n", path, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    log(LOG_INFO, "Listening for control commands on %s\n", path);
+    return fd;
+}
+
+// Runs the complete lines received so far, returns false if the client is gone
+static bool control_serve(int fd, string& pending) {
+    char buf[CONTROL_LINE_MAX];
+    ssize_t len = recv(fd, buf, sizeof(buf), MSG_DONTWAIT);
+    if (len <= 0) {
+        return len < 0 && (errno == EAGAIN || errno == EINTR);
+    }
+    pending.append(buf, len);
+    size_t eol;
+    while ((eol = pending.find('\n')) != string::npos) {
+        string line = pending.substr(0, eol);
+        pending.erase(0, eol + 1);
+        if (!line.empty() && line[line.size() - 1] == '\r') {
+            line.erase(line.size() - 1);
+        }
+        string reply = control_execute(line);
+        // a client which doesn't read its replies is dropped rather than waited for
+        if (!reply.empty() && send(fd, reply.data(), reply.size(), MSG_DONTWAIT | MSG_NOSIGNAL) != (ssize_t)reply.size()) {
+            return false;
+        }
+    }
+    return pending.size() < CONTROL_LINE_MAX;
+}
+
+void* control_thread(void* params) {
+    const char* path = (const char*)params;
+    int listen_fd = control_listen(path);
+    if (listen_fd < 0) {
+        return NULL;
+    }
+    vector<struct pollfd> fds(1);
+    vector<string> pending(1);
+    fds[0].fd = listen_fd;
+    fds[0].events = POLLIN;
+    while (!do_exit) {
+        if (poll(fds.data(), fds.size(), CONTROL_POLL_MS) <= 0) {
+            continue;
+        }
+        for (size_t i = fds.size() - 1; i > 0; i--) {
+            if (fds[i].revents != 0 && !control_serve(fds[i].fd, pending[i])) {
+                close(fds[i].fd);
+                fds.erase(fds.begin() + i);
+                pending.erase(pending.begin() + i);
+            }
+        }
+        if (fds[0].revents & POLLIN) {
+            int fd = accept(listen_fd, NULL, NULL);
+            if (fd < 0) {
+                continue;
+            }
+            if (fds.size() > CONTROL_MAX_CLIENTS) {
+                close(fd);
+                continue;
+            }
+            struct pollfd client;
+            client.fd = fd;
+            client.events = POLLIN;
+            client.revents = 0;
+            fds.push_back(client);
+            pending.push_back("");
+        }
+    }
+    for (size_t i = 0; i < fds.size(); i++) {
+        close(fds[i].fd);
+    }
+    unlink(path);
+    return NULL;
+}
@@ -67,7 +67,7 @@ class ToneDetectorSet {
 
 class CTCSS {
    public:
-    CTCSS(void) : enabled_(false), found_count_(0), not_found_count_(0) {}
+    CTCSS(void) : enabled_(false), ctcss_freq_(0.0f), found_count_(0), not_found_count_(0) {}
     CTCSS(const float& ctcss_freq, const float& sample_rate, int window_size);
     void process_audio_sample(const float& sample);
     void reset(void);
@@ -76,6 +76,7 @@ class CTCSS {
     const size_t& not_found_count(void) const { return not_found_count_; }
 
     bool is_enabled(void) const { return enabled_; }
+    const float& freq(void) const { return ctcss_freq_; }
     bool enough_samples(void) const { return enough_samples_; }
     bool has_tone(void) const { return !enabled_ || has_tone_; }
 
@@ -0,0 +1,141 @@
+/*
+ * decimator.cpp
+ * Decimating filters for splitting a wideband input into sub-bands
+ *
+ * Copyright (C) 2024 charlie-foxtrot
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "decimator.h"
+
+#include <cmath>
+#include <cstring>
+
+using namespace std;
+
+#define HALFBAND_LEN 47  // taps, 4 * n - 1
+#define CIC_INPUT_SCALE 8388608.0f  // 2^23, fixed point scale of the CIC input
+
+HalfbandDecimator::HalfbandDecimator(void) : history_(4 * HALFBAND_LEN, 0.0f), len_(HALFBAND_LEN), pos_(0), odd_(false) {
+    // Blackman windowed sinc with the cutoff at a quarter of the input rate, every other tap is zero
+    const int half = HALFBAND_LEN / 2;
+    double sum = 0.5;
+    for (int d = 1; d <= half; d += 2) {
+        double x = M_PI * d / 2.0;
+        double n = (double)(half + d) / (HALFBAND_LEN - 1);
+        double window = 0.42 - 0.5 * cos(2.0 * M_PI * n) + 0.08 * cos(4.0 * M_PI * n);
+        taps_.push_back((float)(0.5 * sin(x) / x * window));
+        sum += 2.0 * taps_.back();
+    }
+    for (size_t k = 0; k < taps_.size(); k++) {
+        taps_[k] = (float)(taps_[k] / sum);
+    }
+    center_ = (float)(0.5 / sum);
+}
+
+size_t HalfbandDecimator::process(const float* in, size_t count, float* out) {
+    const size_t half = len_ / 2;
+    size_t produced = 0;
+    for (size_t i = 0; i < count; i++) {
+        // every sample is stored twice, so the last len_ samples are always contiguous
+        history_[2 * pos_] = history_[2 * (pos_ + len_)] = in[2 * i];
+        history_[2 * pos_ + 1] = history_[2 * (pos_ + len_) + 1] = in[2 * i + 1];
+        pos_ = (pos_ + 1) % len_;
+        odd_ = !odd_;
+        if (odd_) {
+            continue;
+        }
+        const float* h = &history_[2 * pos_];  // oldest sample first
+        float re = center_ * h[2 * half];
+        float im = center_ * h[2 * half + 1];
+        for (size_t k = 0; k < taps_.size(); k++) {
+            const size_t d = 2 * k + 1;
+            re += taps_[k] * (h[2 * (half - d)] + h[2 * (half + d)]);
+            im += taps_[k] * (h[2 * (half - d) + 1] + h[2 * (half + d) + 1]);
+        }
+        out[2 * produced] = re;
+        out[2 * produced + 1] = im;
+        produced++;
+    }
+    return produced;
+}
+
+CicDecimator::CicDecimator(int rate, int order) : rate_(rate), order_(order), phase_(0), integrators_(2 * order, 0), combs_(2 * order, 0) {
+    gain_ = 1.0f / (CIC_INPUT_SCALE * powf((float)rate, (float)order));
+}
+
+size_t CicDecimator::process(const float* in, size_t count, float* out) {
+    size_t produced = 0;
+    for (size_t i = 0; i < count; i++) {
+        for (int c = 0; c < 2; c++) {
+            uint64_t* integrator = &integrators_[c * order_];
+            integrator[0] += (uint64_t)(int64_t)(in[2 * i + c] * CIC_INPUT_SCALE);
+            for (int s = 1; s < order_; s++) {
+                integrator[s] += integrator[s - 1];
+            }
+        }
+        if (++phase_ < rate_) {
+            continue;
+        }
+        phase_ = 0;
+        for (int c = 0; c < 2; c++) {
+            uint64_t value = integrators_[c * order_ + order_ - 1];
+            uint64_t* comb = &combs_[c * order_];
+            for (int s = 0; s < order_; s++) {
+                uint64_t previous = comb[s];
+                comb[s] = value;
+                value -= previous;
+            }
+            out[2 * produced + c] = (float)(int64_t)value * gain_;
+        }
+        produced++;
+    }
+    return produced;
+}
+
+SubbandDecimator::SubbandDecimator(double offset, double sample_rate, int decimation) : rot_re_(1.0), rot_im_(0.0), has_cic_(decimation > 4), cic_(decimation > 4 ? decimation / 4 : 1) {
+    step_re_ = cos(-2.0 * M_PI * offset / sample_rate);
+    step_im_ = sin(-2.0 * M_PI * offset / sample_rate);
+    halfbands_.resize(decimation >= 4 ? 2 : 1);
+}
+
+size_t SubbandDecimator::process(const float* in, size_t count, float* out) {
+    if (work_.size() < 2 * count) {
+        work_.resize(2 * count);
+    }
+    float* w = work_.data();
+    for (size_t i = 0; i < count; i++) {
+        w[2 * i] = (float)(in[2 * i] * rot_re_ - in[2 * i + 1] * rot_im_);
+        w[2 * i + 1] = (float)(in[2 * i] * rot_im_ + in[2 * i + 1] * rot_re_);
+        double re = rot_re_ * step_re_ - rot_im_ * step_im_;
+        rot_im_ = rot_re_ * step_im_ + rot_im_ * step_re_;
+        rot_re_ = re;
+    }
+    // keep the mixer on the unit circle
+    double norm = sqrt(rot_re_ * rot_re_ + rot_im_ * rot_im_);
+    rot_re_ /= norm;
+    rot_im_ /= norm;
+
+    // every stage produces fewer samples than it reads, so they can all work in place
+    size_t n = count;
+    if (has_cic_) {
+        n = cic_.process(w, n, w);
+    }
+    for (size_t k = 0; k < halfbands_.size(); k++) {
+        n = halfbands_[k].process(w, n, w);
+    }
+    memcpy(out, w, 2 * n * sizeof(float));
+    return n;
+}
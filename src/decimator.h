@@ -0,0 +1,81 @@
+/*
+ * decimator.h
+ *
+ * Copyright (C) 2024 charlie-foxtrot
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _DECIMATOR_H
+#define _DECIMATOR_H
+
+#include <cstddef>  // size_t
+#include <cstdint>
+#include <vector>
+
+// All decimators work on interleaved I/Q float samples and keep their state between calls.
+
+// Decimation by 2 with a half-band FIR filter, passes the lower 40% of the output band
+class HalfbandDecimator {
+   public:
+    HalfbandDecimator(void);
+    // returns the number of output samples
+    size_t process(const float* in, size_t count, float* out);
+
+   private:
+    std::vector<float> taps_;     // non-zero taps of one half, from the center outwards
+    float center_;
+    std::vector<float> history_;  // last input samples, twice the filter length
+    size_t len_;                  // filter length
+    size_t pos_;                  // write position in history_
+    bool odd_;                    // next input sample is dropped
+};
+
+// Cascaded integrator-comb decimator, cheap coarse decimation by any factor
+class CicDecimator {
+   public:
+    CicDecimator(int rate, int order = 4);
+    size_t process(const float* in, size_t count, float* out);
+
+   private:
+    int rate_;
+    int order_;
+    int phase_;  // input samples since the last output sample
+    float gain_;
+    // integer arithmetic, wrapping around is harmless as long as the output fits
+    std::vector<uint64_t> integrators_;  // I and Q interleaved
+    std::vector<uint64_t> combs_;
+};
+
+/*
+ * Shifts the band around offset Hz down to zero and decimates it by a power
+ * of two: a CIC stage takes care of everything except the last factor of 4,
+ * which is done by two half-band stages. The result is usable up to 80% of
+ * the output bandwidth.
+ */
+class SubbandDecimator {
+   public:
+    SubbandDecimator(double offset, double sample_rate, int decimation);
+    size_t process(const float* in, size_t count, float* out);
+
+   private:
+    double step_re_, step_im_;  // phase rotation per input sample
+    double rot_re_, rot_im_;    // current phase of the mixer
+    bool has_cic_;              // false when decimating by 4 or less
+    CicDecimator cic_;
+    std::vector<HalfbandDecimator> halfbands_;
+    std::vector<float> work_;
+};
+
+#endif /* _DECIMATOR_H */
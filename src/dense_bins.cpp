@@ -0,0 +1,72 @@
+/*
+ * dense_bins.cpp
+ * Gathering of FFT bins for devices with many channels
+ *
+ * Copyright (C) 2024 charlie-foxtrot
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "dense_bins.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+DenseBinReader::DenseBinReader(const size_t* bins, int channel_count)
+    : order_(channel_count), pos_(channel_count), is_active_(channel_count, true), active_changed_(true), re_(channel_count), im_(channel_count), mag_(channel_count) {
+    for (int i = 0; i < channel_count; i++) {
+        order_[i] = i;
+    }
+    stable_sort(order_.begin(), order_.end(), [bins](int a, int b) { return bins[a] < bins[b]; });
+    for (int k = 0; k < channel_count; k++) {
+        pos_[order_[k]] = k;
+    }
+}
+
+void DenseBinReader::set_active(int channel, bool active) {
+    const int k = pos_[channel];
+    if (is_active_[k] == active) {
+        return;
+    }
+    is_active_[k] = active;
+    active_changed_ = true;
+    re_[k] = im_[k] = 0.0f;
+}
+
+void DenseBinReader::read(const float* fft, const size_t* bins) {
+    if (active_changed_) {
+        active_.clear();
+        for (size_t k = 0; k < order_.size(); k++) {
+            if (is_active_[k]) {
+                active_.push_back(k);
+            }
+        }
+        active_changed_ = false;
+    }
+    const int count = order_.size();
+    float* re = re_.data();
+    float* im = im_.data();
+    float* mag = mag_.data();
+    for (size_t n = 0; n < active_.size(); n++) {
+        const int k = active_[n];
+        const float* bin = fft + 2 * bins[order_[k]];
+        re[k] = bin[0];
+        im[k] = bin[1];
+    }
+    for (int k = 0; k < count; k++) {
+        mag[k] = sqrtf(re[k] * re[k] + im[k] * im[k]);
+    }
+}
@@ -0,0 +1,58 @@
+/*
+ * dense_bins.h
+ *
+ * Copyright (C) 2024 charlie-foxtrot
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _DENSE_BINS_H
+#define _DENSE_BINS_H
+
+#include <cstddef>  // size_t
+#include <vector>
+
+/*
+ * Reads the FFT bins of many channels at once. Channels are visited in
+ * ascending bin order, so the FFT output is walked front to back, and I/Q
+ * values are gathered into contiguous arrays before the magnitudes are
+ * computed in one vectorizable pass. This only changes the order of the
+ * reads: squelch, AGC and demodulation still run channel by channel.
+ */
+class DenseBinReader {
+   public:
+    // bins[i] is the FFT bin of channel i, it only sets the visiting order
+    DenseBinReader(const size_t* bins, int channel_count);
+
+    // fft holds interleaved re/im values, bins[i] is the current bin of channel i (it may have been moved by AFC)
+    void read(const float* fft, const size_t* bins);
+
+    // Channels which aren't demodulated (shed or muted) are not read, they read as silence
+    void set_active(int channel, bool active);
+    bool active(int channel) const { return is_active_[pos_[channel]]; }
+
+    float level(int channel) const { return mag_[pos_[channel]]; }
+    float re(int channel) const { return re_[pos_[channel]]; }
+    float im(int channel) const { return im_[pos_[channel]]; }
+
+   private:
+    std::vector<int> order_;  // channel index at each position
+    std::vector<int> pos_;    // position of each channel
+    std::vector<int> active_;  // positions which are read
+    std::vector<bool> is_active_;
+    bool active_changed_;
+    std::vector<float> re_, im_, mag_;
+};
+
+#endif /* _DENSE_BINS_H */
@@ -0,0 +1,158 @@
+/*
+ * event_stream.cpp
+ * Sends transmission events to a unix socket and / or over UDP
+ *
+ * Copyright (C) 2024 charlie-foxtrot
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <errno.h>
+#include <netdb.h>  // getaddrinfo()
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>  // sockaddr_un
+#include <unistd.h>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "rtl_airband.h"
+
+using namespace std;
+
+/*
+ * The output threads queue an event whenever the squelch of a channel opens
+ * or closes (see track_transmission()), this thread formats them as lines of
+ * JSON and sends them out. Neither side waits for the other: events which
+ * don't fit into the queue are dropped and counted in the stats file, and
+ * socket clients which don't keep up are disconnected.
+ */
+
+#define EVENT_MAX_CLIENTS 16
+#define EVENT_POLL_MS 100
+
+event_stream_t* event_stream = NULL;
+TxEventQueue* event_queue = NULL;
+
+static int event_listen(const char* path) {
+    struct sockaddr_un addr;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        log(LOG_ERR, "Event socket path %s is too long\n", path);
+        return -1;
+    }
+    struct stat st;
+    if (lstat(path, &st) == 0 && S_ISSOCK(st.st_mode)) {
+        unlink(path);
+    }
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        log(LOG_ERR, "Cannot create event socket: %s\n", strerror(errno));
+        return -1;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(fd, EVENT_MAX_CLIENTS) < 0) {
+        log(LOG_ERR, "Cannot listen on event socket %s: %s\n", path, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    log(LOG_INFO, "Sending transmission events to clients of %s\n", path);
+    return fd;
+}
+
+static int event_udp_socket(struct sockaddr_storage* dest, socklen_t* dest_len) {
+    struct addrinfo hints, *result;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
+    int ret = getaddrinfo(event_stream->udp_address, event_stream->udp_port, &hints, &result);
+    if (ret != 0) {
+        log(LOG_ERR, "Event stream: cannot resolve %s:%s: %s\n", event_stream->udp_address, event_stream->udp_port, gai_strerror(ret));
+        return -1;
+    }
+    int fd = socket(result->ai_family, result->ai_socktype, result->ai_protocol);
+    if (fd < 0) {
+        log(LOG_ERR, "Event stream: cannot create UDP socket: %s\n", strerror(errno));
+    } else {
+        memcpy(dest, result->ai_addr, result->ai_addrlen);
+        *dest_len = result->ai_addrlen;
+        log(LOG_INFO, "Sending transmission events to %s:%s\n", event_stream->udp_address, event_stream->udp_port);
+    }
+    freeaddrinfo(result);
+    return fd;
+}
+
+void* event_stream_thread(void*) {
+    int listen_fd = -1, udp_fd = -1;
+    struct sockaddr_storage dest;
+    socklen_t dest_len = 0;
+    if (event_stream->socket_path != NULL) {
+        listen_fd = event_listen(event_stream->socket_path);
+    }
+    if (event_stream->udp_address != NULL) {
+        udp_fd = event_udp_socket(&dest, &dest_len);
+    }
+
+    vector<int> clients;
+    tx_event_t event;
+    bool done = false;
+    while (!done) {
+        done = do_exit;  // one more round after do_exit sends what is still queued
+        struct pollfd pfd;
+        pfd.fd = listen_fd;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        if (listen_fd >= 0) {
+            poll(&pfd, 1, EVENT_POLL_MS);
+        } else {
+            usleep(EVENT_POLL_MS * 1000);
+        }
+        if (pfd.revents & POLLIN) {
+            int fd = accept(listen_fd, NULL, NULL);
+            if (fd >= 0 && clients.size() < EVENT_MAX_CLIENTS) {
+                clients.push_back(fd);
+            } else if (fd >= 0) {
+                close(fd);
+            }
+        }
+
+        while (event_queue->pop(&event)) {
+            string line = tx_event_json(event) + "\n";
+            if (udp_fd >= 0) {
+                sendto(udp_fd, line.data(), line.size(), 0, (struct sockaddr*)&dest, dest_len);
+            }
+            for (size_t i = clients.size(); i > 0; i--) {
+                if (send(clients[i - 1], line.data(), line.size(), MSG_DONTWAIT | MSG_NOSIGNAL) != (ssize_t)line.size()) {
+                    close(clients[i - 1]);
+                    clients.erase(clients.begin() + (i - 1));
+                }
+            }
+        }
+    }
+
+    for (size_t i = 0; i < clients.size(); i++) {
+        close(clients[i]);
+    }
+    if (listen_fd >= 0) {
+        close(listen_fd);
+        unlink(event_stream->socket_path);
+    }
+    if (udp_fd >= 0) {
+        close(udp_fd);
+    }
+    return NULL;
+}
@@ -0,0 +1,160 @@
+/*
+ * events.cpp
+ * Transmission start and end events for downstream consumers
+ *
+ * Copyright (C) 2024 charlie-foxtrot
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>  // intptr_t
+#include <algorithm>  // max()
+#include <cstdio>
+#include <cstring>  // memcpy()
+
+#include "events.h"
+
+using namespace std;
+
+static void json_string(string& out, const char* s) {
+    out += '"';
+    for (; *s != '\0'; s++) {
+        const unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += (char)c;
+        } else if (c < 0x20) {
+            char buf[8];
+            snprintf(buf, sizeof(buf), "\\u%04x", c);
+            out += buf;
+        } else {
+            out += (char)c;
+        }
+    }
+    out += '"';
+}
+
+static void json_time(string& out, const char* name, const struct timeval& tv) {
+    char buf[64];
+    snprintf(buf, sizeof(buf), ",\"%s\":%ld.%03ld", name, (long)tv.tv_sec, (long)tv.tv_usec / 1000);
+    out += buf;
+}
+
+string tx_event_json(const tx_event_t& event) {
+    char buf[128];
+    string out;
+    snprintf(buf, sizeof(buf), "{\"event\":\"%s\",\"device\":%d,\"channel\":%d,\"freq\":%d,\"label\":", event.type == TX_START ? "start" : "end", event.device, event.channel, event.frequency);
+    out += buf;
+    if (event.label[0] != '\0') {
+        json_string(out, event.label);
+    } else {
+        out += "null";
+    }
+    json_time(out, "start", event.start);
+    if (event.type == TX_END) {
+        json_time(out, "end", event.end);
+        const double duration = (event.end.tv_sec - event.start.tv_sec) + (event.end.tv_usec - event.start.tv_usec) / 1000000.0;
+        snprintf(buf, sizeof(buf), ",\"duration\":%.3f,\"peak_dbfs\":%.1f,\"avg_dbfs\":%.1f", duration, event.peak_dbfs, event.avg_dbfs);
+        out += buf;
+    }
+    if (event.ctcss > 0.0f) {
+        snprintf(buf, sizeof(buf), ",\"ctcss\":%.1f", event.ctcss);
+        out += buf;
+    } else {
+        out += ",\"ctcss\":null";
+    }
+    out += ",\"path\":";
+    if (event.path[0] != '\0') {
+        json_string(out, event.path);
+    } else {
+        out += "null";
+    }
+    out += '}';
+    return out;
+}
+
+bool TxTracker::update(bool open, float level_dbfs, const struct timeval& now, tx_event_t* event) {
+    if (open && !open_) {
+        open_ = true;
+        start_ = now;
+        peak_dbfs_ = level_dbfs;
+        sum_dbfs_ = level_dbfs;
+        batches_ = 1;
+        frequency_ = event->frequency;
+        memcpy(label_, event->label, sizeof(label_));
+        ctcss_ = event->ctcss;
+        event->type = TX_START;
+        event->start = now;
+        return true;
+    }
+    if (open) {
+        peak_dbfs_ = max(peak_dbfs_, level_dbfs);
+        sum_dbfs_ += level_dbfs;
+        batches_++;
+        return false;
+    }
+    if (open_) {
+        open_ = false;
+        event->type = TX_END;
+        event->frequency = frequency_;
+        memcpy(event->label, label_, sizeof(label_));
+        event->ctcss = ctcss_;
+        event->start = start_;
+        event->end = now;
+        event->peak_dbfs = peak_dbfs_;
+        event->avg_dbfs = (float)(sum_dbfs_ / batches_);
+        return true;
+    }
+    return false;
+}
+
+TxEventQueue::TxEventQueue(size_t capacity) : slots_(capacity), mask_(capacity - 1), enqueue_pos_(0), dequeue_pos_(0), dropped_(0) {
+    for (size_t i = 0; i < capacity; i++) {
+        slots_[i].seq.store(i, memory_order_relaxed);
+    }
+}
+
+// Each slot's sequence number tells whose turn it is, as in the log queue
+bool TxEventQueue::push(const tx_event_t& event) {
+    size_t pos = enqueue_pos_.load(memory_order_relaxed);
+    slot_t* slot;
+    for (;;) {
+        slot = &slots_[pos & mask_];
+        const intptr_t diff = (intptr_t)slot->seq.load(memory_order_acquire) - (intptr_t)pos;
+        if (diff == 0) {
+            if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            dropped_++;
+            return false;
+        } else {
+            pos = enqueue_pos_.load(memory_order_relaxed);
+        }
+    }
+    slot->event = event;
+    slot->seq.store(pos + 1, memory_order_release);
+    return true;
+}
+
+bool TxEventQueue::pop(tx_event_t* event) {
+    slot_t* slot = &slots_[dequeue_pos_ & mask_];
+    if (slot->seq.load(memory_order_acquire) != dequeue_pos_ + 1) {
+        return false;
+    }
+    *event = slot->event;
+    slot->seq.store(dequeue_pos_ + mask_ + 1, memory_order_release);
+    dequeue_pos_++;
+    return true;
+}
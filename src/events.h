@@ -0,0 +1,99 @@
+/*
+ * events.h
+ * Transmission start and end events for downstream consumers
+ *
+ * Copyright (C) 2024 charlie-foxtrot
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _EVENTS_H
+#define _EVENTS_H
+
+#include <sys/time.h>  // timeval
+#include <atomic>
+#include <cstddef>  // size_t
+#include <string>
+#include <vector>
+
+#define TX_LABEL_LEN 64
+#define TX_PATH_LEN 256
+
+enum tx_event_type { TX_START, TX_END };
+
+struct tx_event_t {
+    tx_event_type type;
+    int device;
+    int channel;
+    int frequency;  // Hz
+    char label[TX_LABEL_LEN];
+    struct timeval start;
+    struct timeval end;  // the fields below are only set for TX_END
+    float peak_dbfs;
+    float avg_dbfs;
+    float ctcss;              // Hz, 0 if the channel has no CTCSS squelch
+    char path[TX_PATH_LEN];  // the recording being written, empty if none
+};
+
+// One line of JSON, without the newline
+std::string tx_event_json(const tx_event_t& event);
+
+// Follows the squelch of a channel from batch to batch
+class TxTracker {
+   public:
+    TxTracker(void) : open_(false), frequency_(0), ctcss_(0.0f), peak_dbfs_(0.0f), sum_dbfs_(0.0), batches_(0) { label_[0] = '\0'; }
+
+    // Feeds the state of one batch, fills in the type, times and levels of *event and returns true when a transmission starts or ends.
+    // *event comes with the frequency, label and tone of the batch; those of a TX_START are kept and reported again with its TX_END,
+    // even if the channel has moved on to another frequency in the meantime.
+    bool update(bool open, float level_dbfs, const struct timeval& now, tx_event_t* event);
+
+   private:
+    bool open_;
+    int frequency_;
+    char label_[TX_LABEL_LEN];
+    float ctcss_;
+    struct timeval start_;
+    float peak_dbfs_;
+    double sum_dbfs_;
+    size_t batches_;
+};
+
+/*
+ * Bounded queue handing events from any number of threads to one reader
+ * without locks, so that the threads producing them never wait. An event
+ * which doesn't fit is dropped and counted.
+ */
+class TxEventQueue {
+   public:
+    explicit TxEventQueue(size_t capacity);  // power of two
+
+    bool push(const tx_event_t& event);
+    bool pop(tx_event_t* event);  // false if empty, one reader only
+    size_t dropped(void) const { return dropped_; }
+
+   private:
+    struct slot_t {
+        std::atomic<size_t> seq;
+        tx_event_t event;
+    };
+
+    std::vector<slot_t> slots_;
+    size_t mask_;
+    std::atomic<size_t> enqueue_pos_;
+    size_t dequeue_pos_;
+    std::atomic<size_t> dropped_;
+};
+
+#endif /* _EVENTS_H */
@@ -0,0 +1,258 @@
+/*
+ * fft_engine.cpp
+ * FFT backends and the startup benchmark choosing between them
+ *
+ * Copyright (C) 2024 charlie-foxtrot
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include "fft_engine.h"
+
+#ifdef WITH_BCM_VC
+#include "hello_fft/gpu_fft.h"
+#include "hello_fft/mailbox.h"
+#else
+#include <fftw3.h>
+#endif /* WITH_BCM_VC */
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+
+#include "logging.h"  // log()
+
+using namespace std;
+
+#define BENCHMARK_TIME 0.05  // seconds per candidate
+
+#ifdef WITH_BCM_VC
+// Broadcom VideoCore IV GPU
+class GpuFftEngine : public FftEngine {
+   public:
+    GpuFftEngine(size_t size_log, size_t batch) : FftEngine((size_t)1 << size_log, batch), mb_(mbox_open()), fft_(NULL) {
+        int ret = gpu_fft_prepare(mb_, size_log, GPU_FFT_FWD, batch, &fft_);
+        switch (ret) {
+            case 0:
+                break;
+            case -1:
+                log(LOG_CRIT, "Unable to enable V3D. Please check your firmware is up to date.\n");
+                break;
+            case -2:
+                log(LOG_CRIT, "log2_N=%zu not supported. Try between 8 and 17.\n", size_log);
+                break;
+            case -3:
+                log(LOG_CRIT, "Out of memory. Try a smaller batch or increase GPU memory.\n");
+                break;
+        }
+        if (ret != 0) {
+            fft_ = NULL;
+            return;
+        }
+        in_ = (float*)fft_->in;
+        out_ = (float*)fft_->out;
+        in_stride_ = out_stride_ = 2 * fft_->step;
+    }
+    ~GpuFftEngine(void) {
+        if (fft_ != NULL) {
+            log(LOG_INFO, "Freeing GPU memory\n");
+            gpu_fft_release(fft_);
+        }
+        mbox_close(mb_);
+    }
+    bool ready(void) const { return fft_ != NULL; }
+    const char* name(void) const { return "gpu"; }
+    void execute(void) { gpu_fft_execute(fft_); }
+
+   private:
+    int mb_;
+    struct GPU_FFT* fft_;
+};
+#else
+class FftwEngine : public FftEngine {
+   public:
+    FftwEngine(size_t size_log, size_t batch) : FftEngine((size_t)1 << size_log, batch) {
+        const int n = (int)size_;
+        fftwf_complex* in = fftwf_alloc_complex(size_ * batch);
+        fftwf_complex* out = fftwf_alloc_complex(size_ * batch);
+        plan_ = fftwf_plan_many_dft(1, &n, (int)batch, in, NULL, 1, n, out, NULL, 1, n, FFTW_FORWARD, FFTW_MEASURE);
+        in_ = (float*)in;
+        out_ = (float*)out;
+    }
+    ~FftwEngine(void) {
+        fftwf_destroy_plan(plan_);
+        fftwf_free(in_);
+        fftwf_free(out_);
+    }
+    bool ready(void) const { return plan_ != NULL; }
+    const char* name(void) const { return "fftw"; }
+    void execute(void) { fftwf_execute(plan_); }
+
+   private:
+    fftwf_plan plan_;
+};
+#endif /* WITH_BCM_VC */
+
+// Portable radix-2 FFT, a fallback which works everywhere
+class BuiltinFftEngine : public FftEngine {
+   public:
+    BuiltinFftEngine(size_t size_log, size_t batch) : FftEngine((size_t)1 << size_log, batch), buffer_(4 * size_ * batch), twiddles_(size_), reversed_(size_) {
+        in_ = buffer_.data();
+        out_ = buffer_.data() + 2 * size_ * batch;
+        for (size_t k = 0; k < size_ / 2; k++) {
+            twiddles_[2 * k] = (float)cos(-2.0 * M_PI * k / size_);
+            twiddles_[2 * k + 1] = (float)sin(-2.0 * M_PI * k / size_);
+        }
+        for (size_t i = 0; i < size_; i++) {
+            size_t r = 0;
+            for (size_t bit = 0; bit < size_log; bit++) {
+                r |= ((i >> bit) & 1) << (size_log - 1 - bit);
+            }
+            reversed_[i] = r;
+        }
+    }
+    bool ready(void) const { return true; }
+    const char* name(void) const { return "builtin"; }
+    void execute(void) {
+        for (size_t b = 0; b < batch_; b++) {
+            transform(input(b), out_ + b * out_stride_);
+        }
+    }
+
+   private:
+    void transform(const float* in, float* out) {
+        for (size_t i = 0; i < size_; i++) {
+            out[2 * reversed_[i]] = in[2 * i];
+            out[2 * reversed_[i] + 1] = in[2 * i + 1];
+        }
+        for (size_t half = 1; half < size_; half *= 2) {
+            const size_t twiddle_step = size_ / (2 * half);
+            for (size_t start = 0; start < size_; start += 2 * half) {
+                for (size_t k = 0; k < half; k++) {
+                    const float wr = twiddles_[2 * k * twiddle_step];
+                    const float wi = twiddles_[2 * k * twiddle_step + 1];
+                    float* a = out + 2 * (start + k);
+                    float* b = out + 2 * (start + k + half);
+                    const float tr = b[0] * wr - b[1] * wi;
+                    const float ti = b[0] * wi + b[1] * wr;
+                    b[0] = a[0] - tr;
+                    b[1] = a[1] - ti;
+                    a[0] += tr;
+                    a[1] += ti;
+                }
+            }
+        }
+    }
+
+    vector<float> buffer_;    // inputs followed by outputs
+    vector<float> twiddles_;  // interleaved re/im, size_ / 2 values
+    vector<size_t> reversed_;
+};
+
+vector<string> fft_engine_names(void) {
+    vector<string> names;
+#ifdef WITH_BCM_VC
+    names.push_back("gpu");
+#else
+    names.push_back("fftw");
+#endif /* WITH_BCM_VC */
+    names.push_back("builtin");
+    return names;
+}
+
+size_t fft_engine_default_batch(const string& name) {
+    // the GPU needs large batches to make up for the cost of starting it
+    return name == "gpu" ? 250 : 1;
+}
+
+template <class ENGINE>
+static FftEngine* fft_engine_setup(size_t size_log, size_t batch) {
+    ENGINE* engine = new ENGINE(size_log, batch);
+    if (!engine->ready()) {
+        delete engine;
+        return NULL;
+    }
+    return engine;
+}
+
+FftEngine* fft_engine_new(const string& name, size_t size_log, size_t batch) {
+#ifdef WITH_BCM_VC
+    if (name == "gpu") {
+        return fft_engine_setup<GpuFftEngine>(size_log, batch);
+    }
+#else
+    if (name == "fftw") {
+        return fft_engine_setup<FftwEngine>(size_log, batch);
+    }
+#endif /* WITH_BCM_VC */
+    if (name == "builtin") {
+        return fft_engine_setup<BuiltinFftEngine>(size_log, batch);
+    }
+    return NULL;
+}
+
+// Seconds per transform, or a negative value if the engine doesn't work
+double fft_engine_time(const string& name, size_t size_log, size_t batch) {
+    FftEngine* engine = fft_engine_new(name, size_log, batch);
+    if (engine == NULL) {
+        return -1.0;
+    }
+    for (size_t b = 0; b < batch; b++) {
+        float* in = engine->input(b);
+        for (size_t i = 0; i < 2 * engine->size(); i++) {
+            in[i] = (float)rand() / RAND_MAX - 0.5f;
+        }
+    }
+    engine->execute();  // warm up caches
+
+    size_t transforms = 0;
+    chrono::duration<double> elapsed(0);
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    while (elapsed.count() < BENCHMARK_TIME) {
+        engine->execute();
+        transforms += batch;
+        elapsed = chrono::steady_clock::now() - start;
+    }
+    delete engine;
+    return elapsed.count() / transforms;
+}
+
+bool fft_engine_benchmark(size_t size_log, string& name, size_t& batch) {
+    vector<string> names = name.empty() ? fft_engine_names() : vector<string>(1, name);
+    const size_t requested_batch = batch;
+    double best = -1.0;
+    for (size_t k = 0; k < names.size(); k++) {
+        vector<size_t> batches;
+        if (requested_batch != 0) {
+            batches.push_back(requested_batch);
+        } else if (names[k] == "gpu") {
+            batches.push_back(fft_engine_default_batch(names[k]));
+        } else {
+            // larger batches save per call overhead, but need more memory and cache
+            batches = {1, 8, 32};
+        }
+        for (size_t b = 0; b < batches.size(); b++) {
+            double t = fft_engine_time(names[k], size_log, batches[b]);
+            debug_print("%s batch %zu: %.2f us per FFT\n", names[k].c_str(), batches[b], t * 1e6);
+            if (t > 0.0 && (best < 0.0 || t < best)) {
+                best = t;
+                name = names[k];
+                batch = batches[b];
+            }
+        }
+    }
+    return best > 0.0;
+}
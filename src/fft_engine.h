@@ -0,0 +1,74 @@
+/*
+ * fft_engine.h
+ *
+ * Copyright (C) 2024 charlie-foxtrot
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _FFT_ENGINE_H
+#define _FFT_ENGINE_H
+
+#include <cstddef>  // size_t
+#include <string>
+#include <vector>
+
+/*
+ * Forward complex FFT of a batch of transforms, unnormalized. Inputs and
+ * outputs are interleaved re/im floats; consecutive transforms of a batch
+ * are not necessarily adjacent in memory, so always go through input() and
+ * output().
+ */
+class FftEngine {
+   public:
+    virtual ~FftEngine(void) {}
+    virtual const char* name(void) const = 0;
+    virtual void execute(void) = 0;
+
+    size_t size(void) const { return size_; }
+    size_t batch(void) const { return batch_; }
+    float* input(size_t b) { return in_ + b * in_stride_; }
+    const float* output(size_t b) const { return out_ + b * out_stride_; }
+
+   protected:
+    FftEngine(size_t size, size_t batch) : size_(size), batch_(batch), in_(NULL), out_(NULL), in_stride_(2 * size), out_stride_(2 * size) {}
+
+    size_t size_;
+    size_t batch_;
+    float* in_;
+    float* out_;
+    size_t in_stride_;  // floats between two transforms of the batch
+    size_t out_stride_;
+};
+
+// Names of the engines compiled in, the first one is the default
+std::vector<std::string> fft_engine_names(void);
+
+// Batch size to use for the engine when none is configured
+size_t fft_engine_default_batch(const std::string& name);
+
+// Returns NULL if the engine is unknown or can't be set up
+FftEngine* fft_engine_new(const std::string& name, size_t size_log, size_t batch);
+
+// Seconds per transform of the engine with the given batch size, negative if it can't be set up
+double fft_engine_time(const std::string& name, size_t size_log, size_t batch);
+
+/*
+ * Time every engine (or only the given one, if name is not empty) with its
+ * candidate batch sizes (or only the given batch, if not 0) and return the
+ * fastest combination in name and batch. Returns false if no engine works.
+ */
+bool fft_engine_benchmark(size_t size_log, std::string& name, size_t& batch);
+
+#endif /* _FFT_ENGINE_H */
@@ -12,6 +12,7 @@
 #include <queue>
 #include <set>
 #include <thread>
+#include "thread_sched.h"
 
 struct upload_task {
     std::string path;
@@ -75,6 +76,7 @@ void init_file_uploader() {
     curl_global_init(CURL_GLOBAL_DEFAULT);
     uploader_running = true;
     uploader_thread = std::thread([]() {
+        thread_sched_apply(THREAD_UPLOADER);
         std::unique_lock<std::mutex> lock(queue_mutex);
         while (uploader_running) {
             if (upload_queue.empty()) {
@@ -63,6 +63,13 @@ void NotchFilter::apply(float& value) {
     value = y[2];
 }
 
+bool NotchFilter::same_coefficients(const NotchFilter& other) const {
+    if (!enabled_ || !other.enabled_) {
+        return enabled_ == other.enabled_;
+    }
+    return d[0] == other.d[0] && d[1] == other.d[1] && d[2] == other.d[2];
+}
+
 // Default constructor is no filter
 LowpassFilter::LowpassFilter(void) : enabled_(false) {}
 
@@ -143,6 +150,13 @@ void LowpassFilter::multin(complex<double> w, int npz, complex<double> coeffs[])
     coeffs[0] = nw * coeffs[0];
 }
 
+bool LowpassFilter::same_coefficients(const LowpassFilter& other) const {
+    if (!enabled_ || !other.enabled_) {
+        return enabled_ == other.enabled_;
+    }
+    return gain == other.gain && ycoeffs[0] == other.ycoeffs[0] && ycoeffs[1] == other.ycoeffs[1];
+}
+
 void LowpassFilter::apply(float& r, float& j) {
     if (!enabled_) {
         return;
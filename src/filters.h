@@ -28,6 +28,7 @@ class NotchFilter {
     NotchFilter(float notch_freq, float sample_freq, float q);
     void apply(float& value);
     bool enabled(void) { return enabled_; }
+    bool same_coefficients(const NotchFilter& other) const;
 
    private:
     bool enabled_;
@@ -44,6 +45,7 @@ class LowpassFilter {
     LowpassFilter(float freq, float sample_freq);
     void apply(float& r, float& j);
     bool enabled(void) const { return enabled_; }
+    bool same_coefficients(const LowpassFilter& other) const;
 
    private:
     static std::complex<double> blt(std::complex<double> pz);
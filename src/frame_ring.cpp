@@ -0,0 +1,74 @@
+/*
+ * frame_ring.cpp
+ * Most recent encoded audio frames of a stream, shared by all its listeners
+ *
+ * Copyright (C) 2024 charlie-foxtrot
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "frame_ring.h"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+
+void FrameRing::push(const unsigned char* frames, size_t len) {
+    const size_t capacity = data_.size();
+    if (len == 0 || capacity == 0) {
+        return;
+    }
+    if (len > capacity) {
+        // only the tail fits, which doesn't start at a frame boundary
+        frames += len - capacity;
+        head_ += len - capacity;
+        len = capacity;
+    } else {
+        frames_.push_back(head_);
+    }
+    size_t offset = head_ % capacity;
+    size_t first = min(len, capacity - offset);
+    memcpy(data_.data() + offset, frames, first);
+    memcpy(data_.data(), frames + first, len - first);
+    head_ += len;
+
+    while (!frames_.empty() && frames_.front() + capacity < head_) {
+        frames_.pop_front();
+    }
+}
+
+uint64_t FrameRing::burst_start(size_t burst) const {
+    for (size_t i = 0; i < frames_.size(); i++) {
+        if (frames_[i] + burst >= head_) {
+            return frames_[i];
+        }
+    }
+    return head_;
+}
+
+size_t FrameRing::peek(uint64_t* pos, size_t burst, const unsigned char** data, bool* skipped) const {
+    const size_t capacity = data_.size();
+    *skipped = false;
+    if (*pos > head_ || *pos + capacity < head_) {
+        *pos = burst_start(burst);
+        *skipped = true;
+    }
+    if (*pos == head_) {
+        return 0;
+    }
+    const size_t offset = *pos % capacity;
+    *data = data_.data() + offset;
+    return min((size_t)(head_ - *pos), capacity - offset);
+}
@@ -0,0 +1,60 @@
+/*
+ * frame_ring.h
+ * Most recent encoded audio frames of a stream, shared by all its listeners
+ *
+ * Copyright (C) 2024 charlie-foxtrot
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _FRAME_RING_H
+#define _FRAME_RING_H
+
+#include <cstddef>  // size_t
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+/*
+ * Byte ring of the last capacity bytes of a stream. Positions count the bytes
+ * since the start of the stream, so every reader only keeps its own position
+ * and reads straight from the ring. Writes are whole frames (or groups of
+ * them), and new readers start at a frame boundary. Not thread safe.
+ */
+class FrameRing {
+   public:
+    explicit FrameRing(size_t capacity) : data_(capacity), head_(0) {}
+
+    void push(const unsigned char* frames, size_t len);
+
+    // Position after the last byte written
+    uint64_t head(void) const { return head_; }
+
+    // Position of a new reader: the oldest frame boundary at most burst bytes behind the head
+    uint64_t burst_start(size_t burst) const;
+
+    /*
+     * Data at *pos, as much as is contiguous in the ring, returns its length (0
+     * if the reader is up to date). A reader overtaken by the writer is moved to
+     * burst_start(burst) first, and true is returned in skipped.
+     */
+    size_t peek(uint64_t* pos, size_t burst, const unsigned char** data, bool* skipped) const;
+
+   private:
+    std::vector<unsigned char> data_;
+    uint64_t head_;
+    std::deque<uint64_t> frames_;  // positions of the frames still in the ring
+};
+
+#endif /* _FRAME_RING_H */
@@ -0,0 +1,68 @@
+/*
+ * governor.cpp
+ * Sheds optional work while the program can't keep up with the input
+ *
+ * Copyright (C) 2024 charlie-foxtrot
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "governor.h"
+
+using namespace std;
+
+static const char* const shed_action_names[SHED_ACTION_COUNT] = {"tui", "ctcss", "afc", "channels"};
+
+const char* shed_action_name(int action) {
+    if (action < 0 || action >= SHED_ACTION_COUNT) {
+        return NULL;
+    }
+    return shed_action_names[action];
+}
+
+Governor::Governor(const vector<int>& order, float high_water, float low_water, double shed_interval, double restore_delay)
+    : order_(order), high_water_(high_water), low_water_(low_water), shed_interval_(shed_interval), restore_delay_(restore_delay), level_(0), last_change_(-1e9), calm_since_(-1.0) {}
+
+bool Governor::update(double now, float fill, bool lost_samples, int* action, bool* shed) {
+    const bool overloaded = lost_samples || fill > high_water_;
+    const bool calm = !lost_samples && fill < low_water_;
+    if (!calm) {
+        calm_since_ = -1.0;
+    } else if (calm_since_ < 0.0) {
+        calm_since_ = now;
+    }
+
+    if (overloaded && level_ < order_.size() && now - last_change_ >= shed_interval_) {
+        *action = order_[level_++];
+        *shed = true;
+        last_change_ = now;
+        return true;
+    }
+    if (calm && level_ > 0 && now - calm_since_ >= restore_delay_ && now - last_change_ >= restore_delay_) {
+        *action = order_[--level_];
+        *shed = false;
+        last_change_ = now;
+        return true;
+    }
+    return false;
+}
+
+bool Governor::shed(int action) const {
+    for (size_t i = 0; i < level_; i++) {
+        if (order_[i] == action) {
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,71 @@
+/*
+ * governor.h
+ * Sheds optional work while the program can't keep up with the input
+ *
+ * Copyright (C) 2024 charlie-foxtrot
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _GOVERNOR_H
+#define _GOVERNOR_H
+
+#include <cstddef>  // size_t
+#include <vector>
+
+// Work which can be given up, the default shedding order
+enum shed_action_t {
+    SHED_TUI,       // textual waterfalls
+    SHED_CTCSS,     // full rate CTCSS tone detection, the tones are detected at a quarter of the sample rate
+    SHED_AFC,       // new AFC corrections
+    SHED_CHANNELS,  // channels with low_priority set are silenced
+    SHED_ACTION_COUNT
+};
+
+#define GOVERNOR_SHED_INTERVAL 2.0   // seconds for shedding an action to take effect
+#define GOVERNOR_RESTORE_DELAY 10.0  // seconds with headroom before restoring one
+
+// Name of the action in the configuration and the statistics, NULL if there is none
+const char* shed_action_name(int action);
+
+/*
+ * The input is overloaded when the fullest device buffer is filled above
+ * high_water or samples were lost since the last update. Every time it is
+ * overloaded, at least shed_interval seconds after the last change, the next
+ * action of the order is shed. Once the fill level has stayed below low_water
+ * without lost samples for restore_delay seconds, the last shed action is
+ * restored, and so on.
+ */
+class Governor {
+   public:
+    Governor(const std::vector<int>& order, float high_water, float low_water, double shed_interval, double restore_delay);
+
+    // Returns true if an action was shed or restored, which one in action and whether it was shed in shed
+    bool update(double now, float fill, bool lost_samples, int* action, bool* shed);
+
+    size_t level(void) const { return level_; }
+    bool shed(int action) const;
+
+   private:
+    std::vector<int> order_;
+    float high_water_;
+    float low_water_;
+    double shed_interval_;
+    double restore_delay_;
+    size_t level_;        // actions of order_ shed
+    double last_change_;  // time of the last shed or restore
+    double calm_since_;   // start of the current stretch below low_water, < 0 if not calm
+};
+
+#endif /* _GOVERNOR_H */
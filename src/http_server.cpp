@@ -0,0 +1,312 @@
+/*
+ * http_server.cpp
+ * Serves the MP3 streams of http outputs to any number of listeners
+ *
+ * Copyright (C) 2024 charlie-foxtrot
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>  // getaddrinfo()
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "frame_ring.h"
+#include "rtl_airband.h"
+
+using namespace std;
+
+/*
+ * Each http output encodes its channel once, into the frame ring of its
+ * mount. A single thread accepts the listeners and writes to all of them
+ * straight from the rings, so a listener costs a socket and a position, and a
+ * slow one only falls behind (and eventually skips ahead) on its own.
+ */
+
+#define HTTP_RING_SIZE 65536    // bytes of MP3 kept for every mount
+#define HTTP_REQUEST_MAX 4096   // longer requests are refused
+#define HTTP_POLL_MS 1000       // the writers wake the thread up, this is only for do_exit
+
+struct http_mount_t {
+    string path;
+    FrameRing ring;
+    size_t listeners;
+    pthread_mutex_t lock;  // guards ring and listeners
+    http_mount_t(const string& p) : path(p), ring(HTTP_RING_SIZE), listeners(0) { pthread_mutex_init(&lock, NULL); }
+};
+
+struct http_client_t {
+    int fd;
+    string request;       // until the headers are complete
+    string reply;         // response headers still to send
+    http_mount_t* mount;  // NULL while the request is read
+    uint64_t pos;
+    vector<unsigned char> chunk;  // copied out of the ring, sent without holding the mount lock
+};
+
+http_server_t* http_server = NULL;
+
+// mounts are created by the output threads and never go away, the list is guarded by mounts_lock
+static vector<http_mount_t*> mounts;
+static pthread_mutex_t mounts_lock = PTHREAD_MUTEX_INITIALIZER;
+static int wake_pipe[2] = {-1, -1};
+
+http_mount_t* http_mount(const char* path) {
+    pthread_mutex_lock(&mounts_lock);
+    http_mount_t* mount = NULL;
+    for (size_t i = 0; i < mounts.size() && mount == NULL; i++) {
+        if (mounts[i]->path == path) {
+            mount = mounts[i];
+        }
+    }
+    if (mount == NULL) {
+        mount = new http_mount_t(path);
+        mounts.push_back(mount);
+    }
+    pthread_mutex_unlock(&mounts_lock);
+    return mount;
+}
+
+void http_write(http_mount_t* mount, const unsigned char* data, size_t len) {
+    pthread_mutex_lock(&mount->lock);
+    mount->ring.push(data, len);
+    pthread_mutex_unlock(&mount->lock);
+    if (wake_pipe[1] >= 0) {
+        char c = 0;
+        if (write(wake_pipe[1], &c, 1) < 0) {
+            // the pipe is full, the thread is going to wake up anyway
+        }
+    }
+}
+
+size_t http_listeners(http_mount_t* mount) {
+    pthread_mutex_lock(&mount->lock);
+    size_t count = mount->listeners;
+    pthread_mutex_unlock(&mount->lock);
+    return count;
+}
+
+static int http_listen(void) {
+    struct addrinfo hints, *result;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+    char port[16];
+    snprintf(port, sizeof(port), "%d", http_server->port);
+    int ret = getaddrinfo(http_server->address, port, &hints, &result);
+    if (ret != 0) {
+        log(LOG_ERR, "HTTP server: cannot resolve %s: %s\n", http_server->address ? http_server->address : "*", gai_strerror(ret));
+        return -1;
+    }
+    int fd = -1;
+    for (struct addrinfo* rp = result; rp != NULL && fd < 0; rp = rp->ai_next) {
+        fd = socket(rp->ai_family, rp->ai_socktype, rp->ai_protocol);
+        if (fd < 0) {
+            continue;
+        }
+        int one = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        if (bind(fd, rp->ai_addr, rp->ai_addrlen) < 0 || listen(fd, 16) < 0) {
+            close(fd);
+            fd = -1;
+        }
+    }
+    freeaddrinfo(result);
+    if (fd < 0) {
+        log(LOG_ERR, "HTTP server: cannot listen on port %d: %s\n", http_server->port, strerror(errno));
+        return -1;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    log(LOG_INFO, "HTTP server listening on port %d\n", http_server->port);
+    return fd;
+}
+
+// Parses the request once its headers are complete and prepares the reply
+static void http_start(http_client_t* client) {
+    char method[8], path[256];
+    if (sscanf(client->request.c_str(), "%7s %255s", method, path) != 2 || strcmp(method, "GET") != 0) {
+        client->reply = "HTTP/1.0 405 Method Not Allowed\r\nConnection: close\r\n\r\n";
+        return;
+    }
+    http_mount_t* mount = NULL;
+    string list;
+    pthread_mutex_lock(&mounts_lock);
+    for (size_t i = 0; i < mounts.size(); i++) {
+        if (mounts[i]->path == path) {
+            mount = mounts[i];
+        }
+        list += mounts[i]->path + "\n";
+    }
+    pthread_mutex_unlock(&mounts_lock);
+    if (mount != NULL) {
+        pthread_mutex_lock(&mount->lock);
+        mount->listeners++;
+        client->pos = mount->ring.burst_start(http_server->burst_size);
+        pthread_mutex_unlock(&mount->lock);
+    }
+
+    if (mount == NULL && strcmp(path, "/") == 0) {
+        client->reply = "HTTP/1.0 200 OK\r\nContent-Type: text/plain\r\nConnection: close\r\n\r\n" + list;
+    } else if (mount == NULL) {
+        client->reply = "HTTP/1.0 404 Not Found\r\nConnection: close\r\n\r\n";
+    } else {
+        client->mount = mount;
+        client->reply = "HTTP/1.0 200 OK\r\nContent-Type: audio/mpeg\r\nCache-Control: no-cache, no-store\r\nConnection: close\r\n\r\n";
+    }
+}
+
+// Reads the request or writes whatever is due, returns false if the client is done
+static bool http_serve(http_client_t* client, short revents) {
+    if (revents & (POLLERR | POLLHUP | POLLNVAL)) {
+        return false;
+    }
+    if (client->mount == NULL && client->reply.empty()) {
+        char buf[512];
+        ssize_t len = recv(client->fd, buf, sizeof(buf), MSG_DONTWAIT);
+        if (len <= 0) {
+            return len < 0 && (errno == EAGAIN || errno == EINTR);
+        }
+        client->request.append(buf, len);
+        if (client->request.find("\r\n\r\n") == string::npos && client->request.find("\n\n") == string::npos) {
+            return client->request.size() < HTTP_REQUEST_MAX;
+        }
+        http_start(client);
+    }
+    while (!client->reply.empty()) {
+        ssize_t len = send(client->fd, client->reply.data(), client->reply.size(), MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (len < 0) {
+            return errno == EAGAIN || errno == EINTR;
+        }
+        client->reply.erase(0, len);
+    }
+    if (client->mount == NULL) {
+        return false;  // a complete error or listing reply
+    }
+
+    // the writer is only held off while the data is copied out of the ring, not while it is sent
+    http_mount_t* mount = client->mount;
+    while (true) {
+        const unsigned char* data;
+        bool skipped;
+        pthread_mutex_lock(&mount->lock);
+        size_t len = mount->ring.peek(&client->pos, http_server->burst_size, &data, &skipped);
+        if (len > 0) {
+            client->chunk.assign(data, data + len);
+        }
+        pthread_mutex_unlock(&mount->lock);
+        if (len == 0) {
+            return true;
+        }
+        ssize_t sent = send(client->fd, client->chunk.data(), len, MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (sent < 0) {
+            return errno == EAGAIN || errno == EINTR;
+        }
+        client->pos += sent;
+        if ((size_t)sent < len) {
+            return true;  // the rest is copied again once there is room, unless the writer has overtaken it by then
+        }
+    }
+}
+
+// Does the client have anything to send which didn't fit into the socket buffer
+static bool http_pending(const http_client_t* client) {
+    if (!client->reply.empty()) {
+        return true;
+    }
+    if (client->mount == NULL) {
+        return false;
+    }
+    pthread_mutex_lock(&client->mount->lock);
+    bool pending = client->pos != client->mount->ring.head();
+    pthread_mutex_unlock(&client->mount->lock);
+    return pending;
+}
+
+static void http_drop(http_client_t* client) {
+    if (client->mount != NULL) {
+        pthread_mutex_lock(&client->mount->lock);
+        client->mount->listeners--;
+        pthread_mutex_unlock(&client->mount->lock);
+    }
+    close(client->fd);
+}
+
+void* http_server_thread(void*) {
+    int listen_fd = http_listen();
+    if (listen_fd < 0 || pipe(wake_pipe) < 0) {
+        return NULL;
+    }
+    fcntl(wake_pipe[0], F_SETFL, fcntl(wake_pipe[0], F_GETFL) | O_NONBLOCK);
+    fcntl(wake_pipe[1], F_SETFL, fcntl(wake_pipe[1], F_GETFL) | O_NONBLOCK);
+
+    vector<http_client_t> clients;
+    vector<struct pollfd> fds;
+    while (!do_exit) {
+        fds.resize(2 + clients.size());
+        fds[0].fd = listen_fd;
+        fds[0].events = (clients.size() < (size_t)http_server->max_listeners ? POLLIN : 0);
+        fds[1].fd = wake_pipe[0];
+        fds[1].events = POLLIN;
+        for (size_t i = 0; i < clients.size(); i++) {
+            fds[2 + i].fd = clients[i].fd;
+            // listeners which are up to date wait for the writers, the others for room in their socket buffer
+            fds[2 + i].events = (clients[i].mount == NULL && clients[i].reply.empty()) ? POLLIN : (http_pending(&clients[i]) ? POLLOUT : 0);
+            fds[2 + i].revents = 0;
+        }
+        if (poll(fds.data(), fds.size(), HTTP_POLL_MS) <= 0) {
+            continue;
+        }
+
+        const bool woken = (fds[1].revents & POLLIN);
+        if (woken) {
+            char buf[256];
+            while (read(wake_pipe[0], buf, sizeof(buf)) > 0)
+                ;
+        }
+        for (size_t i = clients.size(); i > 0; i--) {
+            http_client_t* client = &clients[i - 1];
+            short revents = fds[i + 1].revents;
+            if (revents == 0 && !(woken && client->mount != NULL)) {
+                continue;
+            }
+            if (!http_serve(client, revents)) {
+                http_drop(client);
+                clients.erase(clients.begin() + (i - 1));
+            }
+        }
+        if (fds[0].revents & POLLIN) {
+            int fd;
+            while (clients.size() < (size_t)http_server->max_listeners && (fd = accept(listen_fd, NULL, NULL)) >= 0) {
+                http_client_t client;
+                client.fd = fd;
+                client.mount = NULL;
+                client.pos = 0;
+                clients.push_back(client);
+            }
+        }
+    }
+    for (size_t i = 0; i < clients.size(); i++) {
+        http_drop(&clients[i]);
+    }
+    close(listen_fd);
+    return NULL;
+}
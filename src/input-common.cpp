@@ -27,6 +27,7 @@
 #include <stdlib.h>  // free
 #include <string.h>
 #include <iostream>
+#include "thread_sched.h"  // thread_sched_apply()
 
 using namespace std;
 
@@ -57,12 +58,13 @@ int input_init(input_t* const input) {
     assert(input != NULL);
     input_state_t new_state = INPUT_FAILED;  // fail-safe default
     errno = 0;
-    int ret = input->init(input);
-    if (ret < 0) {
-        ret = -1;
-    } else if ((ret = pthread_mutex_init(&input->buffer_lock, NULL)) != 0) {
+    int ret = 0;
+    // a restarted input keeps its lock, other threads may still be holding it
+    if (input->state == INPUT_UNKNOWN && (ret = pthread_mutex_init(&input->buffer_lock, NULL)) != 0) {
         errno = ret;
         ret = -1;
+    } else if (input->init(input) < 0) {
+        ret = -1;
     } else {
         new_state = INPUT_INITIALIZED;
         ret = 0;
@@ -71,11 +73,17 @@ int input_init(input_t* const input) {
     return ret;
 }
 
+static void* rx_thread_main(void* ctx) {
+    input_t* input = (input_t*)ctx;
+    thread_sched_apply(THREAD_RX);
+    return input->run_rx_thread(input);
+}
+
 int input_start(input_t* const input) {
     assert(input != NULL);
     assert(input->dev_data != NULL);
     assert(input->state == INPUT_INITIALIZED);
-    int err = pthread_create(&input->rx_thread, NULL, input->run_rx_thread, (void*)input);
+    int err = pthread_create(&input->rx_thread, NULL, &rx_thread_main, (void*)input);
     if (err != 0) {
         errno = err;
         return -1;
@@ -99,7 +107,12 @@ int input_stop(input_t* const input) {
     assert(input->dev_data != NULL);
     int err = 0;
     errno = 0;
-    if (input->state == INPUT_RUNNING && input->stop != NULL) {
+    if (input->state == INPUT_DISABLED) {
+        // stopped already when it failed, there is no thread left to join
+        input->state = INPUT_STOPPED;
+        return 0;
+    }
+    if ((input->state == INPUT_RUNNING || input->state == INPUT_FAILED) && input->stop != NULL) {
         err = input->stop(input);
         if (err != 0) {
             input->state = INPUT_FAILED;
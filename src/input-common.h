@@ -20,6 +20,7 @@
 #ifndef _INPUT_COMMON_H
 #define _INPUT_COMMON_H 1
 #include <pthread.h>
+#include <stdint.h>
 #include <libconfig.h++>
 
 #if __GNUC__ >= 4
@@ -41,6 +42,8 @@ struct input_t {
     void* dev_data;
     size_t buf_size, bufs, bufe;
     size_t overflow_count;
+    uint64_t samples_written;  // total number of I/Q samples appended to the buffer (guarded by buffer_lock)
+    uint64_t samples_read;     // total number of I/Q samples consumed by the demodulator
     input_state_t state;
     sample_format_t sfmt;
     float fullscale;
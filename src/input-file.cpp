@@ -40,7 +40,7 @@ int file_parse_config(input_t* const input, libconfig::Setting& cfg) {
     if (cfg.exists("filepath")) {
         dev_data->filepath = strdup(cfg["filepath"]);
     } else {
-        cerr << "File configuration error: no 'filepath' given\n";
+        config_errors() << "File configuration error: no 'filepath' given\n";
         error();
     }
 
@@ -50,11 +50,11 @@ int file_parse_config(input_t* const input, libconfig::Setting& cfg) {
         } else if (cfg["speedup_factor"].getType() == libconfig::Setting::TypeFloat) {
             dev_data->speedup_factor = (float)cfg["speedup_factor"];
         } else {
-            cerr << "File configuration error: 'speedup_factor' must be a float or int if set\n";
+            config_errors() << "File configuration error: 'speedup_factor' must be a float or int if set\n";
             error();
         }
         if (dev_data->speedup_factor <= 0.0) {
-            cerr << "File configuration error: 'speedup_factor' must be >= 0.0\n";
+            config_errors() << "File configuration error: 'speedup_factor' must be >= 0.0\n";
             error();
         }
     } else {
@@ -69,6 +69,9 @@ int file_init(input_t* const input) {
     file_dev_data_t* dev_data = (file_dev_data_t*)input->dev_data;
     assert(dev_data != NULL);
 
+    if (dev_data->input_file != NULL) {
+        fclose(dev_data->input_file);  // restarted after hitting the end of the file
+    }
     dev_data->input_file = fopen(dev_data->filepath, "rb");
     if (!dev_data->input_file) {
         cerr << "File input failed to open '" << dev_data->filepath << "' - " << strerror(errno) << endl;
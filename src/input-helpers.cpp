@@ -20,14 +20,13 @@
 
 #include <pthread.h>       // pthread_mutex_lock, unlock
 #include <string.h>        // memcpy
-#include <iostream>        // cerr
 #include "input-common.h"  // input_t
-#include "rtl_airband.h"   // debug_print
+#include "rtl_airband.h"   // debug_print, log()
 
 /* Write input data into circular buffer input->buffer.
  * In general, input->buffer_size is not an exact multiple of len,
  * so we have to take care about proper wrapping.
- * input->buffer_size is an exact multiple of FFT_BATCH * bps
+ * input->buffer_size is an exact multiple of fft_batch * bps
  * (input bytes per output audio sample) and input->buffer's real length
  * is input->buf_size + 2 * bytes_per_input-sample * fft_size. On each
  * wrap we copy 2 * fft_size bytes from the start of input->buffer to its end,
@@ -55,9 +54,24 @@ void circbuffer_append(input_t* const input, unsigned char* buf, size_t len) {
 
     size_t old_end = input->bufe;
     input->bufe = (input->bufe + len) % input->buf_size;
-    if (old_end < input->bufs && input->bufe >= input->bufs) {
-        std::cerr << "Warning: buffer overflow\n";
+    input->samples_written += len / (2 * input->bytes_per_sample);
+    const bool overflow = (old_end < input->bufs && input->bufe >= input->bufs);
+    if (overflow) {
         input->overflow_count++;
     }
     pthread_mutex_unlock(&input->buffer_lock);
+    if (overflow) {
+        log(LOG_WARNING, "Warning: buffer overflow\n");
+    }
+}
+
+/* Drop everything in the buffer, like the stale samples of an input which
+ * is being restarted. Both ends go back to the start of the buffer, which
+ * keeps the read position aligned to whole FFT batches.
+ */
+void circbuffer_discard(input_t* const input) {
+    pthread_mutex_lock(&input->buffer_lock);
+    input->bufs = input->bufe = 0;
+    input->samples_read = input->samples_written;
+    pthread_mutex_unlock(&input->buffer_lock);
 }
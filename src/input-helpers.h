@@ -22,3 +22,4 @@
 
 // input-helpers.cpp
 void circbuffer_append(input_t* const input, unsigned char* buf, size_t len);
+void circbuffer_discard(input_t* const input);
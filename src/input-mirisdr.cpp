@@ -95,6 +95,10 @@ int mirisdr_init(input_t* const input) {
         }
     }
 
+    if (dev_data->dev != NULL) {
+        // left open by an earlier run which has failed
+        mirisdr_close(dev_data->dev);
+    }
     dev_data->dev = NULL;
     mirisdr_open(&dev_data->dev, dev_data->index);
     if (NULL == dev_data->dev) {
@@ -160,7 +164,8 @@ int mirisdr_stop(input_t* const input) {
     mirisdr_dev_data_t* dev_data = (mirisdr_dev_data_t*)input->dev_data;
     assert(dev_data->dev != NULL);
 
-    if (mirisdr_cancel_async(dev_data->dev) < 0) {
+    // the async read of a failed device has already ended, so it can't be cancelled
+    if (mirisdr_cancel_async(dev_data->dev) < 0 && input->state != INPUT_FAILED) {
         return -1;
     }
     return 0;
@@ -185,13 +190,13 @@ int mirisdr_parse_config(input_t* const input, libconfig::Setting& cfg) {
     } else if (cfg.exists("index")) {
         dev_data->index = (int)cfg["index"];
     } else {
-        cerr << "MiriSDR configuration error: no index and no serial number given\n";
+        config_errors() << "MiriSDR configuration error: no index and no serial number given\n";
         error();
     }
     if (cfg.exists("gain")) {
         dev_data->gain = (int)cfg["gain"];
     } else {
-        cerr << "MiriSDR configuration error: gain is not configured\n";
+        config_errors() << "MiriSDR configuration error: gain is not configured\n";
         error();
     }
     if (cfg.exists("correction")) {
@@ -200,7 +205,7 @@ int mirisdr_parse_config(input_t* const input, libconfig::Setting& cfg) {
     if (cfg.exists("num_buffers")) {
         dev_data->bufcnt = (int)(cfg["num_buffers"]);
         if (dev_data->bufcnt < 1) {
-            cerr << "MiriSDR configuration error: num_buffers must be greater than 0\n";
+            config_errors() << "MiriSDR configuration error: num_buffers must be greater than 0\n";
             error();
         }
     }
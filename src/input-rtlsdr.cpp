@@ -95,6 +95,10 @@ int rtlsdr_init(input_t* const input) {
         }
     }
 
+    if (dev_data->dev != NULL) {
+        // left open by an earlier attempt which has failed half way
+        rtlsdr_close(dev_data->dev);
+    }
     dev_data->dev = NULL;
     rtlsdr_open(&dev_data->dev, dev_data->index);
     if (NULL == dev_data->dev) {
@@ -171,10 +175,13 @@ int rtlsdr_stop(input_t* const input) {
     rtlsdr_dev_data_t* dev_data = (rtlsdr_dev_data_t*)input->dev_data;
     assert(dev_data->dev != NULL);
 
-    if (rtlsdr_cancel_async(dev_data->dev) < 0) {
+    // the async read of a failed device has already ended, so it can't be cancelled
+    if (rtlsdr_cancel_async(dev_data->dev) < 0 && input->state != INPUT_FAILED) {
         return -1;
     }
-    return rtlsdr_close(dev_data->dev);
+    int r = rtlsdr_close(dev_data->dev);
+    dev_data->dev = NULL;
+    return r;
 }
 
 int rtlsdr_set_centerfreq(input_t* const input, int const centerfreq) {
@@ -196,7 +203,7 @@ int rtlsdr_parse_config(input_t* const input, libconfig::Setting& cfg) {
     } else if (cfg.exists("index")) {
         dev_data->index = (int)cfg["index"];
     } else {
-        cerr << "RTLSDR configuration error: no index and no serial number given\n";
+        config_errors() << "RTLSDR configuration error: no index and no serial number given\n";
         error();
     }
     if (cfg.exists("gain")) {
@@ -206,7 +213,7 @@ int rtlsdr_parse_config(input_t* const input, libconfig::Setting& cfg) {
             dev_data->gain = (int)((float)cfg["gain"] * 10.0f);
         }
     } else {
-        cerr << "RTLSDR configuration error: gain is not configured\n";
+        config_errors() << "RTLSDR configuration error: gain is not configured\n";
         error();
     }
     if (cfg.exists("correction")) {
@@ -215,7 +222,7 @@ int rtlsdr_parse_config(input_t* const input, libconfig::Setting& cfg) {
     if (cfg.exists("buffers")) {
         dev_data->bufcnt = (int)(cfg["buffers"]);
         if (dev_data->bufcnt < 1) {
-            cerr << "RTLSDR configuration error: buffers must be greater than 0\n";
+            config_errors() << "RTLSDR configuration error: buffers must be greater than 0\n";
             error();
         }
     }
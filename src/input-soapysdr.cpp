@@ -20,6 +20,7 @@
 
 #include "input-soapysdr.h"    // soapysdr_dev_data_t
 #include <SoapySDR/Device.h>   // SoapySDRDevice, SoapySDRDevice_makeStrArgs
+#include <SoapySDR/Errors.h>   // SOAPY_SDR_OVERFLOW, SoapySDR_errToStr
 #include <SoapySDR/Formats.h>  // SOAPY_SDR_CS constants
 #include <SoapySDR/Version.h>  // SOAPY_SDR_API_VERSION
 #include <assert.h>
@@ -151,7 +152,7 @@ int soapysdr_parse_config(input_t* const input, libconfig::Setting& cfg) {
     if (cfg.exists("device_string")) {
         dev_data->device_string = strdup(cfg["device_string"]);
     } else {
-        cerr << "SoapySDR configuration error: mandatory parameter missing: device_string\n";
+        config_errors() << "SoapySDR configuration error: mandatory parameter missing: device_string\n";
         error();
     }
     if (cfg.exists("gain")) {
@@ -163,7 +164,7 @@ int soapysdr_parse_config(input_t* const input, libconfig::Setting& cfg) {
             // Either it's a string or an unsupported type which will cause an exception - this is fine
             dev_data->gains = SoapySDRKwargs_fromString((const char*)cfg["gain"]);
             if (dev_data->gains.size < 1) {
-                cerr << "SoapySDR configuration error: device '" << dev_data->device_string << "': gain: syntax error (must be a sequence of 'name1=value1,name2=value2,...')\n";
+                config_errors() << "SoapySDR configuration error: device '" << dev_data->device_string << "': gain: syntax error (must be a sequence of 'name1=value1,name2=value2,...')\n";
                 error();
             }
         }
@@ -177,7 +178,7 @@ int soapysdr_parse_config(input_t* const input, libconfig::Setting& cfg) {
         } else if (cfg["correction"].getType() == libconfig::Setting::TypeFloat) {
             dev_data->correction = (float)cfg["correction"];
         } else {
-            cerr << "SoapySDR configuration error: device '" << dev_data->device_string << "': correction value must be numeric\n";
+            config_errors() << "SoapySDR configuration error: device '" << dev_data->device_string << "': correction value must be numeric\n";
             error();
         }
     }
@@ -199,7 +200,7 @@ int soapysdr_parse_config(input_t* const input, libconfig::Setting& cfg) {
         error();
     }
     if (soapysdr_choose_sample_format(sdr, input) == false) {
-        cerr << "SoapySDR configuration error: device '" << dev_data->device_string << "': no suitable sample format found\n";
+        config_errors() << "SoapySDR configuration error: device '" << dev_data->device_string << "': no suitable sample format found\n";
         error();
     }
     if (input->sample_rate < 0) {
@@ -217,6 +218,10 @@ int soapysdr_parse_config(input_t* const input, libconfig::Setting& cfg) {
 int soapysdr_init(input_t* const input) {
     soapysdr_dev_data_t* dev_data = (soapysdr_dev_data_t*)input->dev_data;
 
+    if (dev_data->dev != NULL) {
+        // left open by an earlier attempt which has failed half way
+        SoapySDRDevice_unmake(dev_data->dev);
+    }
     dev_data->dev = SoapySDRDevice_makeStrArgs(dev_data->device_string);
     if (dev_data->dev == NULL) {
         log(LOG_ERR, "Failed to open SoapySDR device '%s': %s\n", dev_data->device_string, SoapySDRDevice_lastError());
@@ -301,21 +306,28 @@ void* soapysdr_rx_thread(void* ctx) {
     input->state = INPUT_RUNNING;
     log(LOG_NOTICE, "SoapySDR: device '%s' started\n", dev_data->device_string);
 
-    while (!do_exit) {
+    int read_errors = 0;  // in a row, overflows don't count
+    while (!do_exit && input->state == INPUT_RUNNING) {
         void* bufs[] = {buf};  // array of buffers
         int flags;             // flags set by receive operation
         long long timeNs;      // timestamp for receive buffer
         int samples_read = SoapySDRDevice_readStream(sdr, rxStream, bufs, num_elems, &flags, &timeNs, SOAPYSDR_READSTREAM_TIMEOUT_US);
         if (samples_read < 0) {  // when it's negative, it's the error code
             log(LOG_ERR, "SoapySDR device '%s': readStream failed: %s\n", dev_data->device_string, SoapySDR_errToStr(samples_read));
+            if (samples_read != SOAPY_SDR_OVERFLOW && ++read_errors >= SOAPYSDR_MAX_READ_ERRORS) {
+                log(LOG_ERR, "SoapySDR device '%s': too many read errors, disabling\n", dev_data->device_string);
+                input->state = INPUT_FAILED;
+            }
             continue;
         }
+        read_errors = 0;
         circbuffer_append(input, buf, (size_t)(samples_read * 2 * input->bytes_per_sample));
     }
 cleanup:
     SoapySDRDevice_deactivateStream(sdr, rxStream, 0, 0);
     SoapySDRDevice_closeStream(sdr, rxStream);
     SoapySDRDevice_unmake(sdr);
+    dev_data->dev = NULL;
     return 0;
 }
 
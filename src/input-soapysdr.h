@@ -22,6 +22,7 @@
 #define SOAPYSDR_DEFAULT_SAMPLE_RATE 2560000
 #define SOAPYSDR_BUFSIZE 320000
 #define SOAPYSDR_READSTREAM_TIMEOUT_US 1000000L
+#define SOAPYSDR_MAX_READ_ERRORS 10  // readStream failures in a row before the device is given up
 
 typedef struct {
     SoapySDRDevice* dev;        // pointer to device struct
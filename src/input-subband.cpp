@@ -0,0 +1,280 @@
+/*
+ * input-subband.cpp
+ * Sub-band inputs cut out of a wideband SDR
+ *
+ * Copyright (C) 2024 charlie-foxtrot
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "input-subband.h"  // subband_dev_data_t, subband_frontend_t
+#include <assert.h>
+#include <stdlib.h>  // abs
+#include <string.h>
+#include <syslog.h>         // LOG_* levels
+#include <unistd.h>         // usleep
+#include <algorithm>        // fill, min
+#include <libconfig.h++>    // Setting
+#include "decimator.h"      // SubbandDecimator
+#include "input-common.h"   // input_t, sample_format_t, input_state_t
+#include "input-helpers.h"  // circbuffer_append, circbuffer_discard
+#include "rtl_airband.h"    // do_exit, debug_print, XCALLOC, error(), config_errors()
+
+using namespace std;
+
+/*
+ * Every sub-band runs its own thread, which reads the buffer of the wideband
+ * input independently of the others, shifts and decimates its part of the
+ * band and appends the result to its own buffer. The wideband buffer is
+ * released as soon as the slowest sub-band is done with it.
+ */
+
+subband_frontend_t* subband_frontend_new(input_t* wideband, int subband_count) {
+    subband_frontend_t* frontend = (subband_frontend_t*)XCALLOC(1, sizeof(subband_frontend_t));
+    frontend->input = wideband;
+    frontend->subband_count = subband_count;
+    frontend->consumed = (uint64_t*)XCALLOC(subband_count, sizeof(uint64_t));
+    frontend->users = 0;
+    pthread_mutex_init(&frontend->lock, NULL);
+    return frontend;
+}
+
+static int subband_parse_config(input_t* const input, libconfig::Setting& cfg) {
+    subband_dev_data_t* dev_data = (subband_dev_data_t*)input->dev_data;
+    input_t* wideband = dev_data->frontend->input;
+
+    if (!cfg.exists("decimation")) {
+        config_errors() << "Sub-band configuration error: no 'decimation' given\n";
+        error();
+    }
+    dev_data->decimation = (int)cfg["decimation"];
+    if (dev_data->decimation < 2 || dev_data->decimation > 1024 || (dev_data->decimation & (dev_data->decimation - 1)) != 0) {
+        config_errors() << "Sub-band configuration error: decimation must be a power of two between 2 and 1024\n";
+        error();
+    }
+    input->sample_rate = wideband->sample_rate / dev_data->decimation;
+    if (input->sample_rate <= WAVE_RATE) {
+        config_errors() << "Sub-band configuration error: decimation " << dev_data->decimation << " leaves a sample rate of " << input->sample_rate << ", it must be greater than " << WAVE_RATE
+                        << "\n";
+        error();
+    }
+    if (abs(input->centerfreq - wideband->centerfreq) + input->sample_rate / 2 > wideband->sample_rate / 2) {
+        config_errors() << "Sub-band configuration error: sub-band " << input->centerfreq << " Hz +/- " << input->sample_rate / 2 << " Hz is not within the range of the device\n";
+        error();
+    }
+    return 0;
+}
+
+static int subband_init(input_t* const input) {
+    subband_dev_data_t* dev_data = (subband_dev_data_t*)input->dev_data;
+    subband_frontend_t* frontend = dev_data->frontend;
+    delete dev_data->decimator;  // from before a restart
+    dev_data->decimator = new SubbandDecimator(input->centerfreq - frontend->input->centerfreq, frontend->input->sample_rate, dev_data->decimation);
+
+    // the first sub-band brings up the wideband input
+    int ret = 0;
+    pthread_mutex_lock(&frontend->lock);
+    if (frontend->users++ == 0) {
+        input_t* wideband = frontend->input;
+        bool initialized = false;
+        try {
+            initialized = (input_init(wideband) == 0 && wideband->state == INPUT_INITIALIZED);
+        } catch (const RecoverableError& e) {
+            // a restart which has failed, don't leave with the lock held
+        }
+        if (!initialized) {
+            ret = -1;
+        } else {
+            // all sub-bands start over from the current end of the buffer
+            circbuffer_discard(wideband);
+            fill(frontend->consumed, frontend->consumed + frontend->subband_count, wideband->samples_written);
+            if (input_start(wideband) != 0) {
+                ret = -1;
+            }
+        }
+        if (ret != 0) {
+            frontend->users--;  // the next sub-band to be (re)started tries again
+        }
+    }
+    pthread_mutex_unlock(&frontend->lock);
+    if (ret == 0) {
+        log(LOG_INFO, "Sub-band %.3f MHz initialized, sample rate %d\n", input->centerfreq / 1e6, input->sample_rate);
+    }
+    return ret;
+}
+
+static void subband_release(subband_frontend_t* frontend) {
+    pthread_mutex_lock(&frontend->lock);
+    if (--frontend->users == 0 && input_stop(frontend->input) != 0) {
+        log(LOG_ERR, "Failed to stop wideband input: %s\n", strerror(errno));
+    }
+    pthread_mutex_unlock(&frontend->lock);
+}
+
+// Convert count samples starting at byte offset pos of the wideband buffer to floats in the -1..1 range
+static void subband_convert(const input_t* wideband, size_t pos, size_t count, float* out) {
+    const size_t sample_len = 2 * wideband->bytes_per_sample;
+    const float scale = 1.0f / wideband->fullscale;
+    for (size_t i = 0; i < count; i++, pos += sample_len) {
+        if (pos >= wideband->buf_size) {
+            pos -= wideband->buf_size;
+        }
+        const unsigned char* s = wideband->buffer + pos;
+        switch (wideband->sfmt) {
+            case SFMT_U8:
+                out[2 * i] = (s[0] - 127.5f) / 127.5f;
+                out[2 * i + 1] = (s[1] - 127.5f) / 127.5f;
+                break;
+            case SFMT_S8:
+                out[2 * i] = (signed char)s[0] / 128.0f;
+                out[2 * i + 1] = (signed char)s[1] / 128.0f;
+                break;
+            case SFMT_S16:
+                out[2 * i] = scale * ((const int16_t*)s)[0];
+                out[2 * i + 1] = scale * ((const int16_t*)s)[1];
+                break;
+            case SFMT_F32:
+                out[2 * i] = scale * ((const float*)s)[0];
+                out[2 * i + 1] = scale * ((const float*)s)[1];
+                break;
+            default:
+                out[2 * i] = out[2 * i + 1] = 0.0f;
+                break;
+        }
+    }
+}
+
+// Mark wideband samples up to consumed as taken by this sub-band, the wideband buffer advances to the slowest sub-band
+static void subband_advance(subband_frontend_t* frontend, int index, uint64_t consumed) {
+    input_t* wideband = frontend->input;
+    pthread_mutex_lock(&wideband->buffer_lock);
+    frontend->consumed[index] = consumed;
+    uint64_t slowest = *min_element(frontend->consumed, frontend->consumed + frontend->subband_count);
+    if (slowest > wideband->samples_read) {
+        wideband->bufs = (wideband->bufs + (slowest - wideband->samples_read) * 2 * wideband->bytes_per_sample) % wideband->buf_size;
+        wideband->samples_read = slowest;
+    }
+    pthread_mutex_unlock(&wideband->buffer_lock);
+}
+
+static void* subband_rx_thread(void* ctx) {
+    input_t* input = (input_t*)ctx;
+    subband_dev_data_t* dev_data = (subband_dev_data_t*)input->dev_data;
+    subband_frontend_t* frontend = dev_data->frontend;
+    input_t* wideband = frontend->input;
+
+    while (!do_exit && wideband->state == INPUT_INITIALIZED) {
+        SLEEP(10);
+    }
+
+    // about 10 ms of wideband samples at a time, a multiple of the decimation factor
+    const size_t block = max((size_t)dev_data->decimation, (size_t)(wideband->sample_rate / 100 / dev_data->decimation * dev_data->decimation));
+    const size_t capacity = wideband->buf_size / (2 * wideband->bytes_per_sample);
+    float* iq = (float*)XCALLOC(2 * block, sizeof(float));
+    float* out = (float*)XCALLOC(2 * block / dev_data->decimation, sizeof(float));
+    pthread_mutex_lock(&wideband->buffer_lock);
+    uint64_t consumed = frontend->consumed[dev_data->index];
+    pthread_mutex_unlock(&wideband->buffer_lock);
+
+    if (wideband->state == INPUT_RUNNING) {
+        input->state = INPUT_RUNNING;
+    } else if (!do_exit) {
+        input->state = INPUT_FAILED;  // restarted while the wideband input is still down
+    }
+    while (!do_exit && input->state == INPUT_RUNNING) {
+        if (wideband->state != INPUT_RUNNING) {
+            log(LOG_ERR, "Sub-band %.3f MHz: wideband input has failed\n", input->centerfreq / 1e6);
+            input->state = INPUT_FAILED;
+            break;
+        }
+        pthread_mutex_lock(&wideband->buffer_lock);
+        uint64_t available = wideband->samples_written - consumed;
+        size_t pos = (wideband->bufs + (consumed - wideband->samples_read) * 2 * wideband->bytes_per_sample) % wideband->buf_size;
+        pthread_mutex_unlock(&wideband->buffer_lock);
+
+        if (available > capacity) {
+            // this sub-band has fallen behind and the wideband input has overwritten its data
+            debug_print("sub-band %d: skipping %llu samples\n", dev_data->index, (unsigned long long)available);
+            input->overflow_count++;
+            consumed += available;
+            subband_advance(frontend, dev_data->index, consumed);
+            continue;
+        }
+        if (available < block) {
+            SLEEP(5);
+            continue;
+        }
+        subband_convert(wideband, pos, block, iq);
+        size_t n = dev_data->decimator->process(iq, block, out);
+        circbuffer_append(input, (unsigned char*)out, n * 2 * sizeof(float));
+        consumed += block;
+        subband_advance(frontend, dev_data->index, consumed);
+    }
+
+    free(iq);
+    free(out);
+    subband_release(frontend);
+    return 0;
+}
+
+static int subband_set_centerfreq(input_t* const /*input*/, int const /*centerfreq*/) {
+    // sub-bands are fixed, the wideband input can't be retuned for one of them
+    return -1;
+}
+
+input_t* subband_input_new(subband_frontend_t* frontend, int index) {
+    subband_dev_data_t* dev_data = (subband_dev_data_t*)XCALLOC(1, sizeof(subband_dev_data_t));
+    dev_data->frontend = frontend;
+    dev_data->index = index;
+    dev_data->decimation = 0;
+    dev_data->decimator = NULL;
+
+    input_t* input = (input_t*)XCALLOC(1, sizeof(input_t));
+    input->dev_data = dev_data;
+    input->state = INPUT_UNKNOWN;
+    input->sfmt = SFMT_F32;
+    input->fullscale = 1.0f;
+    input->bytes_per_sample = sizeof(float);
+    input->sample_rate = 0;
+    input->parse_config = &subband_parse_config;
+    input->init = &subband_init;
+    input->run_rx_thread = &subband_rx_thread;
+    input->set_centerfreq = &subband_set_centerfreq;
+    input->stop = NULL;  // the thread exits with the program, the last one stops the wideband input
+
+    return input;
+}
+
+void subband_input_free(input_t* input) {
+    subband_dev_data_t* dev_data = (subband_dev_data_t*)input->dev_data;
+    subband_frontend_t* frontend = dev_data->frontend;
+    if (dev_data->index == frontend->subband_count - 1) {
+        free(frontend->input->buffer);
+        free(frontend->input->dev_data);
+        free(frontend->input);
+        free(frontend->consumed);
+        pthread_mutex_destroy(&frontend->lock);
+        free(frontend);
+    }
+    free(input->buffer);
+    free(dev_data);
+    free(input);
+}
+
+input_t* subband_wideband_input(const input_t* input) {
+    if (input->init != &subband_init) {
+        return NULL;
+    }
+    return ((subband_dev_data_t*)input->dev_data)->frontend->input;
+}
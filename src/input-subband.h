@@ -0,0 +1,54 @@
+/*
+ * input-subband.h
+ * Sub-band inputs cut out of a wideband SDR
+ *
+ * Copyright (C) 2024 charlie-foxtrot
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _INPUT_SUBBAND_H
+#define _INPUT_SUBBAND_H 1
+#include <pthread.h>
+#include <stdint.h>
+#include "input-common.h"  // input_t
+
+class SubbandDecimator;
+
+// The wideband input shared by all sub-bands cut out of it
+typedef struct {
+    input_t* input;
+    int subband_count;
+    uint64_t* consumed;  // wideband samples taken by each sub-band (guarded by input->buffer_lock)
+    int users;           // sub-bands which have initialized and not yet released the wideband input
+    pthread_mutex_t lock;
+} subband_frontend_t;
+
+typedef struct {
+    subband_frontend_t* frontend;
+    int index;
+    int decimation;
+    SubbandDecimator* decimator;
+} subband_dev_data_t;
+
+subband_frontend_t* subband_frontend_new(input_t* wideband, int subband_count);
+input_t* subband_input_new(subband_frontend_t* frontend, int index);
+
+// Free a sub-band input which has never been initialized, the last sub-band of a frontend takes the frontend and the wideband input with it
+void subband_input_free(input_t* input);
+
+// The wideband input feeding the given sub-band input, NULL if it is not a sub-band
+input_t* subband_wideband_input(const input_t* input);
+
+#endif /* _INPUT_SUBBAND_H */
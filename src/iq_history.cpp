@@ -0,0 +1,71 @@
+/*
+ * iq_history.cpp
+ * Recent I/Q samples kept in memory, see the pre_trigger option of rawfile outputs
+ *
+ * Copyright (C) 2024 charlie-foxtrot
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "iq_history.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+void IqHistory::push(const float* iq, size_t count) {
+    if (count == 0) {
+        return;
+    }
+    float peak = 0.0f;
+    for (size_t i = 0; i < 2 * count; i++) {
+        peak = max(peak, fabsf(iq[i]));
+    }
+
+    blocks_.push_back(block_t());
+    block_t& block = blocks_.back();
+    block.scale = peak > 0.0f ? peak / 32767.0f : 1.0f;
+    if (!spare_.empty()) {
+        block.iq.swap(spare_.back());
+        spare_.pop_back();
+    }
+    block.iq.resize(2 * count);
+    for (size_t i = 0; i < 2 * count; i++) {
+        block.iq[i] = (int16_t)lrintf(iq[i] / block.scale);
+    }
+    samples_ += count;
+
+    while (blocks_.size() > 1 && samples_ - blocks_.front().iq.size() / 2 >= max_samples_) {
+        samples_ -= blocks_.front().iq.size() / 2;
+        spare_.push_back(vector<int16_t>());
+        spare_.back().swap(blocks_.front().iq);
+        blocks_.pop_front();
+    }
+}
+
+void IqHistory::drain(vector<float>& out) {
+    out.resize(2 * samples_);
+    size_t o = 0;
+    while (!blocks_.empty()) {
+        block_t& block = blocks_.front();
+        for (size_t i = 0; i < block.iq.size(); i++) {
+            out[o++] = block.iq[i] * block.scale;
+        }
+        spare_.push_back(vector<int16_t>());
+        spare_.back().swap(block.iq);
+        blocks_.pop_front();
+    }
+    samples_ = 0;
+}
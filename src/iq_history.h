@@ -0,0 +1,60 @@
+/*
+ * iq_history.h
+ * Recent I/Q samples kept in memory, see the pre_trigger option of rawfile outputs
+ *
+ * Copyright (C) 2024 charlie-foxtrot
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _IQ_HISTORY_H
+#define _IQ_HISTORY_H
+
+#include <cstddef>  // size_t
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+/*
+ * Holds at least the last max_samples complex samples pushed, dropping older
+ * blocks. Every block is stored as 16 bit integers with its own scale, which
+ * takes half the memory of floats and keeps the dynamic range of weak and
+ * strong signals alike.
+ */
+class IqHistory {
+   public:
+    explicit IqHistory(size_t max_samples) : max_samples_(max_samples), samples_(0) {}
+
+    // count complex samples, interleaved I and Q
+    void push(const float* iq, size_t count);
+
+    // complex samples held
+    size_t size(void) const { return samples_; }
+
+    // Replaces out with the history, oldest first, as interleaved floats, and empties it
+    void drain(std::vector<float>& out);
+
+   private:
+    struct block_t {
+        float scale;
+        std::vector<int16_t> iq;
+    };
+
+    size_t max_samples_;
+    size_t samples_;
+    std::deque<block_t> blocks_;
+    std::vector<std::vector<int16_t> > spare_;  // storage of dropped blocks, reused by push()
+};
+
+#endif /* _IQ_HISTORY_H */
@@ -18,21 +18,80 @@
  * along with this program; if not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <pthread.h>
 #include <stdarg.h>  // va_start() / va_end()
+#include <stdint.h>  // uintptr_t
+#include <time.h>    // clock_gettime()
+#include <unistd.h>  // usleep()
+#include <atomic>
 #include <cstdio>    // fopen()
 #include <cstring>   // strerror()
-#include <iostream>  // cerr()
+#include <iostream>  // cerr
 
 #include "logging.h"
 
 LogDestination log_destination = SYSLOG;
 FILE* debugf = NULL;
 
+static thread_local bool errors_recoverable = false;
+static thread_local std::ostream* config_error_sink = NULL;
+
+#define LOG_QUEUE_LEN 256  // power of two
+#define LOG_MESSAGE_LEN 512
+#define LOG_RATE_SLOTS 256
+#define LOG_RATE_PROBES 8
+
+// Bounded multi-producer multi-consumer queue, each entry's sequence number tells whose turn it is
+struct log_entry_t {
+    std::atomic<size_t> seq;
+    int priority;
+    char text[LOG_MESSAGE_LEN];
+};
+
+struct log_rate_t {
+    std::atomic<const char*> format;        // the call site, NULL if the slot is free
+    std::atomic<long> window_start;         // ms
+    std::atomic<int> count;                 // messages in the current window
+    std::atomic<unsigned long> suppressed;  // not reported yet
+};
+
+static log_entry_t log_queue[LOG_QUEUE_LEN];
+static std::atomic<size_t> log_enqueue_pos(0);
+static std::atomic<size_t> log_dequeue_pos(0);
+static log_rate_t log_rates[LOG_RATE_SLOTS];
+static std::atomic<unsigned long> log_suppressed_total(0);
+static std::atomic<unsigned long> log_dropped_total(0);
+static std::atomic<unsigned long> log_dropped_unreported(0);
+
+static std::atomic<bool> log_async(false);
+static std::atomic<bool> log_thread_exit(false);
+static pthread_t log_thread;
+
+static void drain_log_queue();
+
 void error() {
+    if (errors_recoverable) {
+        throw RecoverableError();
+    }
+    if (log_async) {
+        drain_log_queue();  // the reason for exiting is most likely still queued
+    }
     close_debug();
     _Exit(1);
 }
 
+void recoverable_errors(bool enable) {
+    errors_recoverable = enable;
+}
+
+std::ostream& config_errors() {
+    return config_error_sink != NULL ? *config_error_sink : std::cerr;
+}
+
+void collect_config_errors(std::ostream* sink) {
+    config_error_sink = sink;
+}
+
 void init_debug(const char* file) {
 #ifdef DEBUG
     if (!file)
@@ -54,18 +113,195 @@ void close_debug() {
 #endif /* DEBUG */
 }
 
-void log(int priority, const char* format, ...) {
-    va_list args;
-    va_start(args, format);
+static void write_log(int priority, const char* text) {
     switch (log_destination) {
         case SYSLOG:
-            vsyslog(priority, format, args);
+            syslog(priority, "%s", text);
             break;
         case STDERR:
-            vfprintf(stderr, format, args);
+            fputs(text, stderr);
             break;
         case NONE:
             break;
     }
+}
+
+static long monotonic_ms() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static log_rate_t* log_rate_slot(const char* format) {
+    const size_t hash = ((uintptr_t)format >> 3) % LOG_RATE_SLOTS;
+    for (size_t i = 0; i < LOG_RATE_PROBES; i++) {
+        log_rate_t* slot = log_rates + (hash + i) % LOG_RATE_SLOTS;
+        const char* owner = slot->format.load(std::memory_order_acquire);
+        if (owner == NULL) {
+            // a new slot starts with an expired window
+            if (slot->format.compare_exchange_strong(owner, format) || owner == format) {
+                return slot;
+            }
+        } else if (owner == format) {
+            return slot;
+        }
+    }
+    return NULL;  // too many call sites collide here, don't limit this one
+}
+
+static bool log_rate_limited(const char* format) {
+    log_rate_t* slot = log_rate_slot(format);
+    if (slot == NULL) {
+        return false;
+    }
+    const long now = monotonic_ms();
+    long start = slot->window_start.load(std::memory_order_relaxed);
+    if (now - start >= LOG_RATE_WINDOW * 1000 && slot->window_start.compare_exchange_strong(start, now)) {
+        slot->count.store(0);
+    }
+    if (slot->count.fetch_add(1, std::memory_order_relaxed) < LOG_RATE_BURST) {
+        return false;
+    }
+    slot->suppressed++;
+    log_suppressed_total++;
+    return true;
+}
+
+static bool log_enqueue(int priority, const char* format, va_list args) {
+    size_t pos = log_enqueue_pos.load(std::memory_order_relaxed);
+    log_entry_t* entry;
+    for (;;) {
+        entry = log_queue + (pos & (LOG_QUEUE_LEN - 1));
+        const intptr_t diff = (intptr_t)entry->seq.load(std::memory_order_acquire) - (intptr_t)pos;
+        if (diff == 0) {
+            if (log_enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return false;  // full
+        } else {
+            pos = log_enqueue_pos.load(std::memory_order_relaxed);
+        }
+    }
+    entry->priority = priority;
+    vsnprintf(entry->text, LOG_MESSAGE_LEN, format, args);
+    entry->seq.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+// Take the oldest message off the queue, false if there is none
+static bool log_dequeue(int* priority, char* text) {
+    size_t pos = log_dequeue_pos.load(std::memory_order_relaxed);
+    log_entry_t* entry;
+    for (;;) {
+        entry = log_queue + (pos & (LOG_QUEUE_LEN - 1));
+        const intptr_t diff = (intptr_t)entry->seq.load(std::memory_order_acquire) - (intptr_t)(pos + 1);
+        if (diff == 0) {
+            if (log_dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return false;  // empty
+        } else {
+            pos = log_dequeue_pos.load(std::memory_order_relaxed);
+        }
+    }
+    *priority = entry->priority;
+    memcpy(text, entry->text, LOG_MESSAGE_LEN);
+    entry->seq.store(pos + LOG_QUEUE_LEN, std::memory_order_release);
+    return true;
+}
+
+static void report_suppressed() {
+    char text[LOG_MESSAGE_LEN];
+    for (int i = 0; i < LOG_RATE_SLOTS; i++) {
+        log_rate_t* slot = log_rates + i;
+        const char* format = slot->format.load(std::memory_order_acquire);
+        if (format == NULL || slot->suppressed.load(std::memory_order_relaxed) == 0) {
+            continue;
+        }
+        const unsigned long n = slot->suppressed.exchange(0);
+        const int len = (int)strcspn(format, "\n");
+        snprintf(text, sizeof(text), "%lu more messages like \"%.*s\" suppressed\n", n, len, format);
+        write_log(LOG_WARNING, text);
+    }
+    const unsigned long dropped = log_dropped_unreported.exchange(0);
+    if (dropped > 0) {
+        snprintf(text, sizeof(text), "Log queue full, %lu messages dropped\n", dropped);
+        write_log(LOG_WARNING, text);
+    }
+}
+
+static void drain_log_queue() {
+    int priority;
+    char text[LOG_MESSAGE_LEN];
+    while (log_dequeue(&priority, text)) {
+        write_log(priority, text);
+    }
+}
+
+static void* log_thread_main(void*) {
+    long last_report = monotonic_ms();
+    while (!log_thread_exit) {
+        drain_log_queue();
+        const long now = monotonic_ms();
+        if (now - last_report >= 1000) {
+            report_suppressed();
+            last_report = now;
+        }
+        usleep(10000);
+    }
+    return NULL;
+}
+
+void start_log_thread() {
+    if (log_async) {
+        return;
+    }
+    log_enqueue_pos = 0;
+    log_dequeue_pos = 0;
+    for (size_t i = 0; i < LOG_QUEUE_LEN; i++) {
+        log_queue[i].seq.store(i);
+    }
+    log_thread_exit = false;
+    if (pthread_create(&log_thread, NULL, &log_thread_main, NULL) != 0) {
+        return;  // keep writing messages directly
+    }
+    log_async = true;
+}
+
+void stop_log_thread() {
+    if (!log_async) {
+        return;
+    }
+    log_async = false;
+    log_thread_exit = true;
+    pthread_join(log_thread, NULL);
+    // messages queued by threads which were just entering log() while the flag was cleared
+    drain_log_queue();
+    report_suppressed();
+}
+
+void log_counters(unsigned long* suppressed, unsigned long* dropped) {
+    *suppressed = log_suppressed_total;
+    *dropped = log_dropped_total;
+}
+
+void log(int priority, const char* format, ...) {
+    if (log_destination == NONE) {
+        return;
+    }
+    va_list args;
+    va_start(args, format);
+    if (!log_async) {
+        if (log_destination == SYSLOG) {
+            vsyslog(priority, format, args);
+        } else {
+            vfprintf(stderr, format, args);
+        }
+    } else if (!log_rate_limited(format) && !log_enqueue(priority, format, args)) {
+        log_dropped_total++;
+        log_dropped_unreported++;
+    }
     va_end(args);
 }
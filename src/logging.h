@@ -23,6 +23,7 @@
 
 #include <syslog.h>  // LOG_ERR
 #include <cstdio>    // FILE
+#include <iosfwd>    // std::ostream
 
 #define nop() \
     do {      \
@@ -49,9 +50,34 @@ enum LogDestination { SYSLOG, STDERR, NONE };
 extern LogDestination log_destination;
 extern FILE* debugf;
 
+// Thrown by error() instead of exiting the program while recoverable errors are enabled in the calling thread
+class RecoverableError {};
+
 void error();
+void recoverable_errors(bool enable);
+
+// Where the configuration parser describes errors, std::cerr unless collect_config_errors() has redirected them for the calling thread (NULL restores std::cerr)
+std::ostream& config_errors();
+void collect_config_errors(std::ostream* sink);
 void init_debug(const char* file);
 void close_debug();
 void log(int priority, const char* format, ...);
 
+/*
+ * Once the log thread runs, log() only formats the message into a lock-free
+ * queue, which the thread writes out, so that slow syslog or stderr never
+ * stalls the sample or demodulation threads. Every call site (format string)
+ * may log LOG_RATE_BURST messages per LOG_RATE_WINDOW seconds, the ones
+ * above that are counted and reported as suppressed. Before the thread is
+ * started and after it is stopped, messages are written directly.
+ */
+#define LOG_RATE_BURST 20
+#define LOG_RATE_WINDOW 10
+
+void start_log_thread();
+void stop_log_thread();  // writes out whatever is still queued
+
+// Messages suppressed by the rate limit and dropped because the queue was full, since the start
+void log_counters(unsigned long* suppressed, unsigned long* dropped);
+
 #endif /* _LOGGING_H */
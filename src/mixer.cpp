@@ -27,6 +27,7 @@
 #include <cstring>
 #include "config.h"
 #include "rtl_airband.h"
+#include "thread_sched.h"
 
 static char* err;
 
@@ -106,9 +107,22 @@ void mixer_disable_input(mixer_t* mixer, int input_idx) {
         }
     }
 
-    // all inputs are false so disable the mixer
+    // all inputs are false so disable the mixer until one of them comes back
     log(LOG_NOTICE, "Disabling mixer '%s' - all inputs died\n", mixer->name);
-    mixer_disable(mixer);
+    mixer->enabled = false;
+    suspend_channel_outputs(&mixer->channel);
+}
+
+void mixer_enable_input(mixer_t* mixer, int input_idx) {
+    assert(mixer);
+    assert(input_idx < mixer->input_count);
+
+    mixer->input_mask[input_idx] = true;
+    if (!mixer->enabled) {
+        log(LOG_NOTICE, "Enabling mixer '%s' - input %d is back\n", mixer->name, input_idx);
+        mixer->enabled = true;
+        resume_channel_outputs(&mixer->channel);
+    }
 }
 
 void mixer_put_samples(mixer_t* mixer, int input_idx, const float* samples, bool has_signal, unsigned int len) {
@@ -160,6 +174,7 @@ void* mixer_thread(void* param) {
     int interval_usec = 1e+6 * WAVE_BATCH / WAVE_RATE / MIX_DIVISOR;
 
     debug_print("Starting mixer thread, signal %p\n", signal);
+    thread_sched_apply(THREAD_MIXER);
 
     if (mixer_count <= 0)
         return 0;
@@ -171,6 +186,7 @@ void* mixer_thread(void* param) {
         usleep(interval_usec);
         if (do_exit)
             return 0;
+        ConfigReadLock config_read_lock;
         for (int i = 0; i < mixer_count; i++) {
             mixer_t* mixer = mixers + i;
             if (mixer->enabled == false)
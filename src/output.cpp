@@ -47,49 +47,54 @@
 #include <ctime>
 #include <sstream>
 #include <string>
+#include <vector>
+#include "channel_state.h"
 #include "config.h"
 #include "file_upload.h"
 #include "helper_functions.h"
 #include "input-common.h"
 #include "rtl_airband.h"
+#include "thread_sched.h"
 
-void shout_setup(icecast_data* icecast, mix_modes mixmode) {
+// Returns the connection, NULL if it fails. Connecting may take up to 30 seconds, so config_lock must not be held.
+shout_t* shout_connect(const icecast_data* icecast, mix_modes mixmode) {
     int ret;
     shout_t* shouttemp = shout_new();
     if (shouttemp == NULL) {
         printf("cannot allocate\n");
+        return NULL;
     }
     if (shout_set_host(shouttemp, icecast->hostname) != SHOUTERR_SUCCESS) {
         shout_free(shouttemp);
-        return;
+        return NULL;
     }
     if (shout_set_protocol(shouttemp, SHOUT_PROTOCOL_HTTP) != SHOUTERR_SUCCESS) {
         shout_free(shouttemp);
-        return;
+        return NULL;
     }
     if (shout_set_port(shouttemp, icecast->port) != SHOUTERR_SUCCESS) {
         shout_free(shouttemp);
-        return;
+        return NULL;
     }
 #ifdef LIBSHOUT_HAS_TLS
     if (shout_set_tls(shouttemp, icecast->tls_mode) != SHOUTERR_SUCCESS) {
         shout_free(shouttemp);
-        return;
+        return NULL;
     }
 #endif /* LIBSHOUT_HAS_TLS */
     char mp[100];
     sprintf(mp, "/%s", icecast->mountpoint);
     if (shout_set_mount(shouttemp, mp) != SHOUTERR_SUCCESS) {
         shout_free(shouttemp);
-        return;
+        return NULL;
     }
     if (shout_set_user(shouttemp, icecast->username) != SHOUTERR_SUCCESS) {
         shout_free(shouttemp);
-        return;
+        return NULL;
     }
     if (shout_set_password(shouttemp, icecast->password) != SHOUTERR_SUCCESS) {
         shout_free(shouttemp);
-        return;
+        return NULL;
     }
 #ifdef LIBSHOUT_HAS_CONTENT_FORMAT
     if (shout_set_content_format(shouttemp, SHOUT_FORMAT_MP3, SHOUT_USAGE_AUDIO, NULL) != SHOUTERR_SUCCESS) {
@@ -97,19 +102,19 @@ void shout_setup(icecast_data* icecast, mix_modes mixmode) {
     if (shout_set_format(shouttemp, SHOUT_FORMAT_MP3) != SHOUTERR_SUCCESS) {
 #endif /* LIBSHOUT_HAS_CONTENT_FORMAT */
         shout_free(shouttemp);
-        return;
+        return NULL;
     }
     if (icecast->name && shout_set_meta(shouttemp, SHOUT_META_NAME, icecast->name) != SHOUTERR_SUCCESS) {
         shout_free(shouttemp);
-        return;
+        return NULL;
     }
     if (icecast->genre && shout_set_meta(shouttemp, SHOUT_META_GENRE, icecast->genre) != SHOUTERR_SUCCESS) {
         shout_free(shouttemp);
-        return;
+        return NULL;
     }
     if (icecast->description && shout_set_meta(shouttemp, SHOUT_META_DESCRIPTION, icecast->description) != SHOUTERR_SUCCESS) {
         shout_free(shouttemp);
-        return;
+        return NULL;
     }
     char samplerates[20];
     sprintf(samplerates, "%d", MP3_RATE);
@@ -118,7 +123,8 @@ void shout_setup(icecast_data* icecast, mix_modes mixmode) {
 
     if (shout_set_nonblocking(shouttemp, 1) != SHOUTERR_SUCCESS) {
         log(LOG_ERR, "Error setting non-blocking mode: %s\n", shout_get_error(shouttemp));
-        return;
+        shout_free(shouttemp);
+        return NULL;
     }
     ret = shout_open(shouttemp);
     if (ret == SHOUTERR_SUCCESS)
@@ -136,12 +142,12 @@ void shout_setup(icecast_data* icecast, mix_modes mixmode) {
     if (ret == SHOUTERR_CONNECTED) {
         log(LOG_NOTICE, "Connected to %s:%d/%s\n", icecast->hostname, icecast->port, icecast->mountpoint);
         SLEEP(100);
-        icecast->shout = shouttemp;
+        return shouttemp;
     } else {
         log(LOG_WARNING, "Could not connect to %s:%d/%s: %s\n", icecast->hostname, icecast->port, icecast->mountpoint, shout_get_error(shouttemp));
         shout_close(shouttemp);
         shout_free(shouttemp);
-        return;
+        return NULL;
     }
 }
 
@@ -243,12 +249,47 @@ int rename_if_exists(char const* oldpath, char const* newpath) {
     return ret;
 }
 
+/*
+ * WAV files get a header for zero samples, close_file() writes the real one.
+ * They are not opened in append mode as that would put the header at the
+ * end, and no marker tones are inserted when appending.
+ */
+static int open_wav_file(file_data* fdata) {
+    rename_if_exists(fdata->file_path.c_str(), fdata->file_path_tmp.c_str());
+    struct stat st = {};
+    const bool appending = fdata->append && stat(fdata->file_path_tmp.c_str(), &st) == 0 && (size_t)st.st_size >= fdata->wav_encoder->header_size();
+    fdata->f = fopen(fdata->file_path_tmp.c_str(), appending ? "r+" : "w+");
+    if (fdata->f == NULL) {
+        return -1;
+    }
+    if (appending) {
+        fseek(fdata->f, 0, SEEK_END);
+        log(LOG_INFO, "Appending from pos %llu to %s\n", (unsigned long long)st.st_size, fdata->file_path.c_str());
+        return 0;
+    }
+    const std::vector<unsigned char> header = fdata->wav_encoder->header(0);
+    if (fwrite(header.data(), 1, header.size(), fdata->f) < header.size()) {
+        fclose(fdata->f);
+        fdata->f = NULL;
+        return -1;
+    }
+    if (!fdata->split_on_transmission) {
+        log(LOG_INFO, "Writing to %s\n", fdata->file_path.c_str());
+    } else {
+        debug_print("Writing to %s\n", fdata->file_path_tmp.c_str());
+    }
+    return 0;
+}
+
 /*
  * Open output file (mp3 or raw IQ) for append or initial write.
  * If appending to an audio file, insert discontinuity indictor tones
  * as well as the appropriate amount of silence when in continuous mode.
  */
 static int open_file(file_data* fdata, mix_modes mixmode, int is_audio) {
+    if (fdata->wav_encoder != NULL) {
+        return open_wav_file(fdata);
+    }
     int rename_result = rename_if_exists(fdata->file_path.c_str(), fdata->file_path_tmp.c_str());
     fdata->f = fopen(fdata->file_path_tmp.c_str(), fdata->append ? "a+" : "w");
     if (fdata->f == NULL) {
@@ -333,6 +374,18 @@ static void close_file(output_t* output) {
         const int lametag_size = lame_get_lametag_frame(output->lame, output->lamebuf, LAMEBUF_SIZE);
         fseek(fdata->f, 0, SEEK_SET);
         fwrite(output->lamebuf, 1, lametag_size, fdata->f);
+    } else if (fdata->type == O_FILE && fdata->f && fdata->wav_encoder) {
+        const std::vector<unsigned char>& rest = fdata->wav_encoder->flush();
+        if (fwrite(rest.data(), 1, rest.size(), fdata->f) < rest.size()) {
+            log(LOG_WARNING, "Problem writing %s (%s)\n", fdata->file_path.c_str(), strerror(errno));
+        }
+
+        // the header with the final size
+        fseek(fdata->f, 0, SEEK_END);
+        const long size = ftell(fdata->f);
+        const std::vector<unsigned char> header = fdata->wav_encoder->header(size > (long)fdata->wav_encoder->header_size() ? size - fdata->wav_encoder->header_size() : 0);
+        fseek(fdata->f, 0, SEEK_SET);
+        fwrite(header.data(), 1, header.size(), fdata->f);
     }
 
     std::string finished_path;
@@ -407,7 +460,7 @@ static void close_if_necessary(output_t* output) {
  * Otherwise, create a file name based on the current timestamp and
  * open that new file.  If that file open succeeded, return true.
  */
-static bool output_file_ready(channel_t* channel, output_t* output) {
+static bool output_file_ready(channel_t* channel, output_t* output, int freq_idx) {
     file_data* fdata = (file_data*)(output->data);
     if (!fdata) {
         return false;
@@ -450,7 +503,7 @@ static bool output_file_ready(channel_t* channel, output_t* output) {
     std::stringstream ss;
     ss << output_dir << '/' << fdata->basename << timestamp;
     if (fdata->include_freq) {
-        ss << '_' << channel->freqlist[channel->freq_idx].frequency;
+        ss << '_' << channel->freqlist[freq_idx].frequency;
     }
     ss << fdata->suffix;
     fdata->file_path = ss.str();
@@ -468,157 +521,377 @@ static bool output_file_ready(channel_t* channel, output_t* output) {
     return true;
 }
 
-// Create all the output for a particular channel.
-void process_outputs(channel_t* channel, int cur_scan_freq) {
-    for (int k = 0; k < channel->output_count; k++) {
-        if (channel->outputs[k].enabled == false)
-            continue;
-        if (channel->outputs[k].type == O_ICECAST) {
-            icecast_data* icecast = (icecast_data*)(channel->outputs[k].data);
-            if (icecast->shout == NULL)
-                continue;
+static bool icecast_open(channel_t* channel, output_t* output) {
+    icecast_data* icecast = (icecast_data*)(output->data);
+    icecast->shout = shout_connect(icecast, channel->mode);
+    return true;
+}
 
-            // encode and send mp3 to shoutcast output
-            const auto& lame = channel->outputs[k].lame;
-            const auto& lamebuf = channel->outputs[k].lamebuf;
-            int mp3_bytes = lame_encode_buffer_ieee_float(lame, channel->waveout, (channel->mode == MM_STEREO ? channel->waveout_r : NULL), WAVE_BATCH, lamebuf, LAMEBUF_SIZE);
-            if (mp3_bytes < 0) {
-                log(LOG_WARNING, "lame_encode_buffer_ieee_float: %d\n", mp3_bytes);
-            }
+static void icecast_consume(channel_t* channel, output_t* output, const output_batch_t* batch) {
+    icecast_data* icecast = (icecast_data*)(output->data);
+    if (icecast->shout == NULL)
+        return;
 
-            if (mp3_bytes == 0) {
-                continue;
-            }
+    // encode and send mp3 to shoutcast output
+    int mp3_bytes = lame_encode_buffer_ieee_float(output->lame, batch->waveout, batch->waveout_r, WAVE_BATCH, output->lamebuf, LAMEBUF_SIZE);
+    if (mp3_bytes < 0) {
+        log(LOG_WARNING, "lame_encode_buffer_ieee_float: %d\n", mp3_bytes);
+    }
 
-            int ret = shout_send(icecast->shout, channel->outputs[k].lamebuf, mp3_bytes);
-
-            if (ret != SHOUTERR_SUCCESS || shout_queuelen(icecast->shout) > MAX_SHOUT_QUEUELEN) {
-                if (shout_queuelen(icecast->shout) > MAX_SHOUT_QUEUELEN)
-                    log(LOG_WARNING, "Exceeded max backlog for %s:%d/%s, disconnecting\n", icecast->hostname, icecast->port, icecast->mountpoint);
-                // reset connection
-                log(LOG_WARNING, "Lost connection to %s:%d/%s\n", icecast->hostname, icecast->port, icecast->mountpoint);
-                shout_close(icecast->shout);
-                shout_free(icecast->shout);
-                icecast->shout = NULL;
-            } else if (icecast->send_scan_freq_tags && cur_scan_freq >= 0) {
-                shout_metadata_t* meta = shout_metadata_new();
-                char description[32];
-                if (channel->freqlist[channel->freq_idx].label != NULL) {
-                    if (shout_metadata_add(meta, "song", channel->freqlist[channel->freq_idx].label) != SHOUTERR_SUCCESS) {
-                        log(LOG_WARNING, "Failed to add shout metadata\n");
-                    }
-                } else {
-                    snprintf(description, sizeof(description), "%.3f MHz", channel->freqlist[channel->freq_idx].frequency / 1000000.0);
-                    if (shout_metadata_add(meta, "song", description) != SHOUTERR_SUCCESS) {
-                        log(LOG_WARNING, "Failed to add shout metadata\n");
-                    }
-                }
-                if (SHOUT_SET_METADATA(icecast->shout, meta) != SHOUTERR_SUCCESS) {
-                    log(LOG_WARNING, "Failed to add shout metadata\n");
-                }
-                shout_metadata_free(meta);
-            }
-        } else if (channel->outputs[k].type == O_FILE || channel->outputs[k].type == O_RAWFILE) {
-            file_data* fdata = (file_data*)(channel->outputs[k].data);
+    if (mp3_bytes == 0) {
+        return;
+    }
 
-            if (fdata->continuous == false && channel->axcindicate == NO_SIGNAL && channel->outputs[k].active == false) {
-                close_if_necessary(&channel->outputs[k]);
-                continue;
+    int ret = shout_send(icecast->shout, output->lamebuf, mp3_bytes);
+
+    if (ret != SHOUTERR_SUCCESS || shout_queuelen(icecast->shout) > MAX_SHOUT_QUEUELEN) {
+        if (shout_queuelen(icecast->shout) > MAX_SHOUT_QUEUELEN)
+            log(LOG_WARNING, "Exceeded max backlog for %s:%d/%s, disconnecting\n", icecast->hostname, icecast->port, icecast->mountpoint);
+        // reset connection
+        log(LOG_WARNING, "Lost connection to %s:%d/%s\n", icecast->hostname, icecast->port, icecast->mountpoint);
+        shout_close(icecast->shout);
+        shout_free(icecast->shout);
+        icecast->shout = NULL;
+    } else if (icecast->send_scan_freq_tags && batch->cur_scan_freq >= 0) {
+        const freq_t* fparms = channel->freqlist + batch->freq_idx;
+        shout_metadata_t* meta = shout_metadata_new();
+        char description[32];
+        if (fparms->label != NULL) {
+            if (shout_metadata_add(meta, "song", fparms->label) != SHOUTERR_SUCCESS) {
+                log(LOG_WARNING, "Failed to add shout metadata\n");
             }
+        } else {
+            snprintf(description, sizeof(description), "%.3f MHz", fparms->frequency / 1000000.0);
+            if (shout_metadata_add(meta, "song", description) != SHOUTERR_SUCCESS) {
+                log(LOG_WARNING, "Failed to add shout metadata\n");
+            }
+        }
+        if (SHOUT_SET_METADATA(icecast->shout, meta) != SHOUTERR_SUCCESS) {
+            log(LOG_WARNING, "Failed to add shout metadata\n");
+        }
+        shout_metadata_free(meta);
+    }
+}
 
-            if (!output_file_ready(channel, &channel->outputs[k])) {
-                log(LOG_WARNING, "Output disabled\n");
-                channel->outputs[k].enabled = false;
-                continue;
-            };
-
-            // encode mp3 bytes if O_FILE
-            const auto& lame = channel->outputs[k].lame;
-            const auto& lamebuf = channel->outputs[k].lamebuf;
-            int mp3_bytes = 0;
-            if (channel->outputs[k].type == O_FILE) {
-                mp3_bytes = lame_encode_buffer_ieee_float(lame, channel->waveout, (channel->mode == MM_STEREO ? channel->waveout_r : NULL), WAVE_BATCH, lamebuf, LAMEBUF_SIZE);
-                if (mp3_bytes < 0) {
-                    log(LOG_WARNING, "lame_encode_buffer_ieee_float: %d\n", mp3_bytes);
-                }
+static void icecast_flush(output_t* output) {
+    icecast_data* icecast = (icecast_data*)(output->data);
+    if (icecast->shout == NULL)
+        return;
+    log(LOG_WARNING, "Closing connection to %s:%d/%s\n", icecast->hostname, icecast->port, icecast->mountpoint);
+    shout_close(icecast->shout);
+    shout_free(icecast->shout);
+    icecast->shout = NULL;
+}
 
-                if (mp3_bytes <= 0) {
-                    continue;
-                }
-            }
+// Streams which lost their connection. output_check_thread() collects them under config_lock and connects them
+// outside of it, the icecast_data of an output stays allocated when a reload removes the output.
+struct pending_stream_t {
+    icecast_data* icecast;
+    mix_modes mode;
+    shout_t* shout;
+};
+static std::vector<pending_stream_t> pending_streams;
 
-            size_t buflen = 0, written = 0;
-            if (channel->outputs[k].type == O_FILE) {
-                buflen = (size_t)mp3_bytes;
-                written = fwrite(lamebuf, 1, buflen, fdata->f);
-            } else if (channel->outputs[k].type == O_RAWFILE) {
-                buflen = 2 * sizeof(float) * WAVE_BATCH;
-                written = fwrite(channel->iq_out, 1, buflen, fdata->f);
-            }
-            if (written < buflen) {
-                if (ferror(fdata->f))
-                    log(LOG_WARNING, "Cannot write to %s (%s), output disabled\n", fdata->file_path.c_str(), strerror(errno));
-                else
-                    log(LOG_WARNING, "Short write on %s, output disabled\n", fdata->file_path.c_str());
-                close_file(&channel->outputs[k]);
-                channel->outputs[k].enabled = false;
-            }
-            channel->outputs[k].active = (channel->axcindicate != NO_SIGNAL);
-            gettimeofday(&fdata->last_write_time, NULL);
-        } else if (channel->outputs[k].type == O_MIXER) {
-            mixer_data* mdata = (mixer_data*)(channel->outputs[k].data);
-            mixer_put_samples(mdata->mixer, mdata->input, channel->waveout, channel->axcindicate != NO_SIGNAL, WAVE_BATCH);
-        } else if (channel->outputs[k].type == O_UDP_STREAM) {
-            udp_stream_data* sdata = (udp_stream_data*)channel->outputs[k].data;
-
-            if (sdata->continuous == false && channel->axcindicate == NO_SIGNAL) {
-                continue;
-            }
+static void icecast_reconnect(channel_t* channel, output_t* output, int device, bool input_failed) {
+    icecast_data* icecast = (icecast_data*)(output->data);
+    if (input_failed) {
+        if (icecast->shout) {
+            log(LOG_WARNING, "Device #%d failed, disconnecting stream %s:%d/%s\n", device, icecast->hostname, icecast->port, icecast->mountpoint);
+            shout_close(icecast->shout);
+            shout_free(icecast->shout);
+            icecast->shout = NULL;
+        }
+    } else if (icecast->shout == NULL) {
+        pending_stream_t pending = {icecast, channel->mode, NULL};
+        pending_streams.push_back(pending);
+    }
+}
 
-            if (channel->mode == MM_MONO) {
-                udp_stream_write(sdata, channel->waveout, (size_t)WAVE_BATCH * sizeof(float));
-            } else {
-                udp_stream_write(sdata, channel->waveout, channel->waveout_r, (size_t)WAVE_BATCH * sizeof(float));
-            }
+static bool file_open(channel_t* channel, output_t* output) {
+    file_data* fdata = (file_data*)(output->data);
+    if (fdata->wav) {
+        fdata->wav_encoder = new WavEncoder(fdata->wav_type, channel->mode == MM_STEREO ? 2 : 1, WAVE_RATE);
+    }
+    return true;
+}
+
+// file and rawfile outputs
+static void file_consume(channel_t* channel, output_t* output, const output_batch_t* batch) {
+    file_data* fdata = (file_data*)(output->data);
+
+    if (fdata->continuous == false && batch->axcindicate == NO_SIGNAL && output->active == false) {
+        if (fdata->pre_trigger != NULL) {
+            fdata->pre_trigger->push(batch->iq_raw, WAVE_BATCH);
+        }
+        close_if_necessary(output);
+        return;
+    }
+
+    if (!output_file_ready(channel, output, batch->freq_idx)) {
+        log(LOG_WARNING, "Output disabled\n");
+        output->enabled = false;
+        return;
+    };
+
+    // encode mp3 bytes if O_FILE
+    int mp3_bytes = 0;
+    if (output->type == O_FILE && fdata->wav_encoder == NULL) {
+        mp3_bytes = lame_encode_buffer_ieee_float(output->lame, batch->waveout, batch->waveout_r, WAVE_BATCH, output->lamebuf, LAMEBUF_SIZE);
+        if (mp3_bytes < 0) {
+            log(LOG_WARNING, "lame_encode_buffer_ieee_float: %d\n", mp3_bytes);
+        }
+
+        if (mp3_bytes <= 0) {
+            return;
+        }
+    }
+
+    size_t buflen = 0, written = 0;
+    if (output->type == O_FILE && fdata->wav_encoder != NULL) {
+        const std::vector<unsigned char>& wav = fdata->wav_encoder->encode(batch->waveout, batch->waveout_r, WAVE_BATCH);
+        buflen = wav.size();
+        written = fwrite(wav.data(), 1, buflen, fdata->f);
+    } else if (output->type == O_FILE) {
+        buflen = (size_t)mp3_bytes;
+        written = fwrite(output->lamebuf, 1, buflen, fdata->f);
+    } else if (output->type == O_RAWFILE && fdata->pre_trigger != NULL && fdata->pre_trigger->size() > 0) {
+        // a transmission starts - write the history before it, and this batch in full rather than from the squelch opening
+        std::vector<float> history;
+        fdata->pre_trigger->drain(history);
+        history.insert(history.end(), batch->iq_raw, batch->iq_raw + 2 * WAVE_BATCH);
+        buflen = history.size() * sizeof(float);
+        written = fwrite(history.data(), 1, buflen, fdata->f);
+    } else if (output->type == O_RAWFILE) {
+        buflen = 2 * sizeof(float) * WAVE_BATCH;
+        written = fwrite(batch->iq_out, 1, buflen, fdata->f);
+    }
+    if (written < buflen) {
+        if (ferror(fdata->f))
+            log(LOG_WARNING, "Cannot write to %s (%s), output disabled\n", fdata->file_path.c_str(), strerror(errno));
+        else
+            log(LOG_WARNING, "Short write on %s, output disabled\n", fdata->file_path.c_str());
+        close_file(output);
+        output->enabled = false;
+    }
+    output->active = (batch->axcindicate != NO_SIGNAL);
+    gettimeofday(&fdata->last_write_time, NULL);
+}
+
+static void file_flush(output_t* output) {
+    close_file(output);
+}
+
+static void mixer_consume(channel_t*, output_t* output, const output_batch_t* batch) {
+    mixer_data* mdata = (mixer_data*)(output->data);
+    mixer_put_samples(mdata->mixer, mdata->input, batch->waveout, batch->axcindicate != NO_SIGNAL, WAVE_BATCH);
+}
+
+static void mixer_flush(output_t* output) {
+    mixer_data* mdata = (mixer_data*)(output->data);
+    mixer_disable_input(mdata->mixer, mdata->input);
+}
+
+static bool mixer_resume(channel_t*, output_t* output) {
+    mixer_data* mdata = (mixer_data*)(output->data);
+    mixer_enable_input(mdata->mixer, mdata->input);
+    return true;
+}
+
+static bool udp_open(channel_t* channel, output_t* output) {
+    return udp_stream_init((udp_stream_data*)output->data, channel->mode, (size_t)WAVE_BATCH * sizeof(float));
+}
+
+static void udp_consume(channel_t*, output_t* output, const output_batch_t* batch) {
+    udp_stream_data* sdata = (udp_stream_data*)output->data;
+
+    if (sdata->continuous == false && batch->axcindicate == NO_SIGNAL) {
+        return;
+    }
+
+    if (batch->waveout_r == NULL) {
+        udp_stream_write(sdata, batch->waveout, (size_t)WAVE_BATCH * sizeof(float));
+    } else {
+        udp_stream_write(sdata, batch->waveout, batch->waveout_r, (size_t)WAVE_BATCH * sizeof(float));
+    }
+}
+
+static void udp_flush(output_t* output) {
+    udp_stream_shutdown((udp_stream_data*)output->data);
+}
+
+static void udp_reconnect(channel_t*, output_t* output, int, bool input_failed) {
+    if (input_failed) {
+        udp_stream_shutdown((udp_stream_data*)output->data);
+    }
+}
+
+static bool http_open(channel_t*, output_t* output) {
+    http_data* hdata = (http_data*)(output->data);
+    hdata->mount = http_mount(hdata->mountpoint);
+    return true;
+}
+
+static void http_consume(channel_t*, output_t* output, const output_batch_t* batch) {
+    // encoded even without listeners, so the burst for a new one is always at hand
+    http_data* hdata = (http_data*)output->data;
+    int mp3_bytes = lame_encode_buffer_ieee_float(output->lame, batch->waveout, batch->waveout_r, WAVE_BATCH, output->lamebuf, LAMEBUF_SIZE);
+    if (mp3_bytes < 0) {
+        log(LOG_WARNING, "lame_encode_buffer_ieee_float: %d\n", mp3_bytes);
+    } else if (mp3_bytes > 0) {
+        http_write(hdata->mount, output->lamebuf, (size_t)mp3_bytes);
+    }
+}
+
+// LAME's table setup and PulseAudio contexts of the main loop are not thread safe, all the rest is set up in parallel
+static pthread_mutex_t init_output_lock = PTHREAD_MUTEX_INITIALIZER;
 
 #ifdef WITH_PULSEAUDIO
-        } else if (channel->outputs[k].type == O_PULSE) {
-            pulse_data* pdata = (pulse_data*)(channel->outputs[k].data);
-            if (pdata->continuous == false && channel->axcindicate == NO_SIGNAL)
-                continue;
+static bool pulse_open(channel_t* channel, output_t* output) {
+    pthread_mutex_lock(&init_output_lock);
+    pulse_init();
+    pulse_setup((pulse_data*)(output->data), channel->mode);
+    pthread_mutex_unlock(&init_output_lock);
+    return true;
+}
+
+static void pulse_consume(channel_t* channel, output_t* output, const output_batch_t* batch) {
+    pulse_data* pdata = (pulse_data*)(output->data);
+    if (pdata->continuous == false && batch->axcindicate == NO_SIGNAL)
+        return;
 
-            pulse_write_stream(pdata, channel->mode, channel->waveout, channel->waveout_r, (size_t)WAVE_BATCH * sizeof(float));
+    pulse_write_stream(pdata, channel->mode, batch->waveout, batch->waveout_r, (size_t)WAVE_BATCH * sizeof(float));
+}
+
+static void pulse_flush(output_t* output) {
+    pulse_shutdown((pulse_data*)(output->data));
+}
+
+static void pulse_reconnect(channel_t* channel, output_t* output, int, bool input_failed) {
+    pulse_data* pdata = (pulse_data*)(output->data);
+    if (input_failed) {
+        if (pdata->context) {
+            pulse_shutdown(pdata);
+        }
+    } else if (pdata->context == NULL) {
+        pulse_setup(pdata, channel->mode);
+    }
+}
 #endif /* WITH_PULSEAUDIO */
+
+// all outputs run in the output thread unless their exec setting moves them to a worker
+static const output_sink_t icecast_sink = {"icecast", SINK_INLINE, true, icecast_open, icecast_consume, icecast_flush, NULL, icecast_reconnect};
+static const output_sink_t file_sink = {"file", SINK_INLINE, true, file_open, file_consume, file_flush, NULL, NULL};
+static const output_sink_t rawfile_sink = {"rawfile", SINK_INLINE, false, NULL, file_consume, file_flush, NULL, NULL};
+static const output_sink_t mixer_sink = {"mixer", SINK_INLINE, false, NULL, mixer_consume, mixer_flush, mixer_resume, NULL};
+static const output_sink_t udp_sink = {"udp_stream", SINK_INLINE, true, udp_open, udp_consume, udp_flush, udp_open, udp_reconnect};
+static const output_sink_t http_sink = {"http", SINK_INLINE, true, http_open, http_consume, NULL, NULL, NULL};
+#ifdef WITH_PULSEAUDIO
+static const output_sink_t pulse_sink = {"pulse", SINK_INLINE, true, pulse_open, pulse_consume, pulse_flush, NULL, pulse_reconnect};
+#endif /* WITH_PULSEAUDIO */
+
+const output_sink_t* output_sink(enum output_type type) {
+    switch (type) {
+        case O_ICECAST:
+            return &icecast_sink;
+        case O_FILE:
+            return &file_sink;
+        case O_RAWFILE:
+            return &rawfile_sink;
+        case O_MIXER:
+            return &mixer_sink;
+        case O_UDP_STREAM:
+            return &udp_sink;
+        case O_HTTP:
+            return &http_sink;
+#ifdef WITH_PULSEAUDIO
+        case O_PULSE:
+            return &pulse_sink;
+#endif /* WITH_PULSEAUDIO */
+    }
+    return NULL;
+}
+
+bool init_output(channel_t* channel, output_t* output) {
+    if (output->has_mp3_output) {
+        pthread_mutex_lock(&init_output_lock);
+        output->lame = airlame_init(channel->mode, channel->highpass, channel->lowpass);
+        pthread_mutex_unlock(&init_output_lock);
+        output->lamebuf = (unsigned char*)malloc(sizeof(unsigned char) * LAMEBUF_SIZE);
+    }
+    const output_sink_t* sink = output_sink(output->type);
+    if (sink->open != NULL && !sink->open(channel, output)) {
+        return false;
+    }
+    if (output->exec != SINK_INLINE) {
+        sink_attach(channel, output);
+    }
+    return true;
+}
+
+// Create all the output for a particular channel. Returns the frequency index of the batch.
+int process_outputs(channel_t* channel, int cur_scan_freq) {
+    output_batch_t batch;
+    batch.waveout = channel->waveout;
+    batch.waveout_r = (channel->mode == MM_STEREO ? channel->waveout_r : NULL);
+    batch.iq_out = channel->iq_out;
+    batch.iq_raw = channel->iq_raw;
+    batch.axcindicate = channel->axcindicate;
+    batch.freq_idx = channel->freq_idx;
+    batch.cur_scan_freq = cur_scan_freq;
+    for (int k = 0; k < channel->output_count; k++) {
+        output_t* output = channel->outputs + k;
+        if (output->enabled == false || output->muted)
+            continue;
+        if (output->sink != NULL) {
+            sink_enqueue(channel, output, &batch);
+        } else {
+            output_sink(output->type)->consume(channel, output, &batch);
         }
     }
+    return batch.freq_idx;
+}
+
+void disable_output(output_t* output) {
+    sink_lock(output);
+    output->enabled = false;
+    const output_sink_t* sink = output_sink(output->type);
+    if (sink->flush != NULL) {
+        sink->flush(output);
+    }
+    sink_unlock(output);
 }
 
 void disable_channel_outputs(channel_t* channel) {
+    for (int k = 0; k < channel->output_count; k++) {
+        disable_output(channel->outputs + k);
+    }
+}
+
+// Disable the outputs of a channel whose signal has gone away, resume_channel_outputs() brings them back
+void suspend_channel_outputs(channel_t* channel) {
     for (int k = 0; k < channel->output_count; k++) {
         output_t* output = channel->outputs + k;
-        output->enabled = false;
-        if (output->type == O_ICECAST) {
-            icecast_data* icecast = (icecast_data*)(channel->outputs[k].data);
-            if (icecast->shout == NULL)
-                continue;
-            log(LOG_WARNING, "Closing connection to %s:%d/%s\n", icecast->hostname, icecast->port, icecast->mountpoint);
-            shout_close(icecast->shout);
-            shout_free(icecast->shout);
-            icecast->shout = NULL;
-        } else if (output->type == O_FILE || output->type == O_RAWFILE) {
-            close_file(&channel->outputs[k]);
-        } else if (output->type == O_MIXER) {
-            mixer_data* mdata = (mixer_data*)(output->data);
-            mixer_disable_input(mdata->mixer, mdata->input);
-        } else if (output->type == O_UDP_STREAM) {
-            udp_stream_data* sdata = (udp_stream_data*)output->data;
-            udp_stream_shutdown(sdata);
-#ifdef WITH_PULSEAUDIO
-        } else if (output->type == O_PULSE) {
-            pulse_data* pdata = (pulse_data*)(output->data);
-            pulse_shutdown(pdata);
-#endif /* WITH_PULSEAUDIO */
+        if (output->enabled) {
+            disable_output(output);
+            output->suspended = true;
+        }
+    }
+}
+
+// Connections to servers are left to output_check_thread(), it reconnects once the signal is back
+void resume_channel_outputs(channel_t* channel) {
+    for (int k = 0; k < channel->output_count; k++) {
+        output_t* output = channel->outputs + k;
+        if (!output->suspended) {
+            continue;
+        }
+        output->suspended = false;
+        const output_sink_t* sink = output_sink(output->type);
+        if (sink->resume != NULL && !sink->resume(channel, output)) {
+            log(LOG_ERR, "Failed to resume an output, it stays disabled\n");
+            continue;
         }
+        output->enabled = true;
     }
 }
 
@@ -829,6 +1102,77 @@ static void output_device_buffer_overflows(FILE* f) {
     fprintf(f, "\n");
 }
 
+static void output_governor(FILE* f) {
+    if (governor == NULL) {
+        return;
+    }
+    fprintf(f,
+            "# HELP governor_level Number of actions shed by the overload governor.\n"
+            "# TYPE governor_level gauge\n"
+            "governor_level\t%zu\n\n",
+            governor->level());
+
+    fprintf(f,
+            "# HELP governor_shed Whether the overload governor has shed an action.\n"
+            "# TYPE governor_shed gauge\n");
+    for (int i = 0; i < SHED_ACTION_COUNT; i++) {
+        fprintf(f, "governor_shed{action=\"%s\"}\t%d\n", shed_action_name(i), governor_shed[i] ? 1 : 0);
+    }
+    fprintf(f, "\n");
+
+    fprintf(f,
+            "# HELP governor_shed_count Number of times the overload governor has shed an action.\n"
+            "# TYPE governor_shed_count counter\n");
+    for (int i = 0; i < SHED_ACTION_COUNT; i++) {
+        fprintf(f, "governor_shed_count{action=\"%s\"}\t%zu\n", shed_action_name(i), governor_shed_count[i]);
+    }
+    fprintf(f, "\n");
+}
+
+static void output_log_counters(FILE* f) {
+    unsigned long suppressed, dropped;
+    log_counters(&suppressed, &dropped);
+    fprintf(f,
+            "# HELP log_messages_suppressed Number of log messages suppressed by the rate limit.\n"
+            "# TYPE log_messages_suppressed counter\n"
+            "log_messages_suppressed\t%lu\n\n"
+            "# HELP log_messages_dropped Number of log messages dropped because the log queue was full.\n"
+            "# TYPE log_messages_dropped counter\n"
+            "log_messages_dropped\t%lu\n\n",
+            suppressed, dropped);
+}
+
+static void output_device_restarts(FILE* f) {
+    timeval now;
+    gettimeofday(&now, NULL);
+
+    fprintf(f,
+            "# HELP device_up Whether a device's input is running (1) or down after a failure (0).\n"
+            "# TYPE device_up gauge\n");
+    for (int i = 0; i < device_count; i++) {
+        fprintf(f, "device_up{device=\"%d\"}\t%d\n", i, devices[i].down ? 0 : 1);
+    }
+    fprintf(f, "\n");
+
+    fprintf(f,
+            "# HELP device_restart_count Number of times a failed device has been restarted.\n"
+            "# TYPE device_restart_count counter\n");
+    for (int i = 0; i < device_count; i++) {
+        fprintf(f, "device_restart_count{device=\"%d\"}\t%d\n", i, devices[i].restart_count);
+    }
+    fprintf(f, "\n");
+
+    fprintf(f,
+            "# HELP device_downtime_seconds Total time a device has been down after failures.\n"
+            "# TYPE device_downtime_seconds counter\n");
+    for (int i = 0; i < device_count; i++) {
+        device_t* dev = devices + i;
+        double downtime = dev->downtime + (dev->down ? delta_sec(&dev->down_since, &now) : 0.0);
+        fprintf(f, "device_downtime_seconds{device=\"%d\"}\t%.1f\n", i, downtime);
+    }
+    fprintf(f, "\n");
+}
+
 static void output_output_overruns(FILE* f) {
     fprintf(f,
             "# HELP output_overrun_count Number of times a device or mixer output has overrun.\n"
@@ -864,6 +1208,182 @@ static void output_input_overruns(FILE* f) {
     fprintf(f, "\n");
 }
 
+static void output_http_listeners(FILE* f, channel_t* channel, bool* header) {
+    for (int k = 0; k < channel->output_count; k++) {
+        if (channel->outputs[k].type != O_HTTP || channel->outputs[k].data == NULL) {
+            continue;
+        }
+        http_data* hdata = (http_data*)channel->outputs[k].data;
+        if (hdata->mount == NULL) {
+            continue;
+        }
+        if (!*header) {
+            fprintf(f,
+                    "# HELP http_listeners Number of listeners connected to an http output.\n"
+                    "# TYPE http_listeners gauge\n");
+            *header = true;
+        }
+        fprintf(f, "http_listeners{mount=\"%s\"}\t%zu\n", hdata->mountpoint, http_listeners(hdata->mount));
+    }
+}
+
+static void output_event_stream(FILE* f) {
+    if (event_stream == NULL) {
+        return;
+    }
+    fprintf(f,
+            "# HELP events_dropped Number of transmission events dropped because the event queue was full.\n"
+            "# TYPE events_dropped counter\n"
+            "events_dropped\t%zu\n\n",
+            event_queue->dropped());
+}
+
+static void output_http_server(FILE* f) {
+    if (http_server == NULL) {
+        return;
+    }
+    bool header = false;
+    for (int i = 0; i < device_count; i++) {
+        for (int j = 0; j < devices[i].channel_count; j++) {
+            output_http_listeners(f, devices[i].channels + j, &header);
+        }
+    }
+    for (int i = 0; i < mixer_count; i++) {
+        output_http_listeners(f, &mixers[i].channel, &header);
+    }
+    if (header) {
+        fprintf(f, "\n");
+    }
+}
+
+static void output_queue_drops(FILE* f, channel_t* channel, const char* labels, bool* header) {
+    for (int k = 0; k < channel->output_count; k++) {
+        if (channel->outputs[k].sink == NULL) {
+            continue;
+        }
+        if (!*header) {
+            fprintf(f,
+                    "# HELP output_queue_dropped Number of batches of audio dropped because an output running on a worker thread fell behind.\n"
+                    "# TYPE output_queue_dropped counter\n");
+            *header = true;
+        }
+        fprintf(f, "output_queue_dropped{%s,output=\"%d\"}\t%zu\n", labels, k, sink_dropped(channel->outputs + k));
+    }
+}
+
+static void output_sink_queues(FILE* f) {
+    bool header = false;
+    char labels[64];
+    for (int i = 0; i < device_count; i++) {
+        for (int j = 0; j < devices[i].channel_count; j++) {
+            snprintf(labels, sizeof(labels), "device=\"%d\",channel=\"%d\"", i, j);
+            output_queue_drops(f, devices[i].channels + j, labels, &header);
+        }
+    }
+    for (int i = 0; i < mixer_count; i++) {
+        snprintf(labels, sizeof(labels), "mixer=\"%d\"", i);
+        output_queue_drops(f, &mixers[i].channel, labels, &header);
+    }
+    if (header) {
+        fprintf(f, "\n");
+    }
+}
+
+static void output_channel_revisit_latencies(FILE* f) {
+    bool scanning = false;
+    for (int i = 0; i < device_count; i++) {
+        scanning |= (devices[i].mode == R_SCAN);
+    }
+    if (!scanning) {
+        return;
+    }
+
+    fprintf(f,
+            "# HELP channel_revisit_latency Seconds between the two most recent visits of a scanned frequency.\n"
+            "# TYPE channel_revisit_latency gauge\n");
+    for (int i = 0; i < device_count; i++) {
+        device_t* dev = devices + i;
+        if (dev->mode != R_SCAN) {
+            continue;
+        }
+        for (int j = 0; j < dev->channel_count; j++) {
+            channel_t* channel = dev->channels + j;
+            for (int k = 0; k < channel->freq_count; k++) {
+                print_channel_metric(f, "channel_revisit_latency", channel->freqlist[k].frequency, channel->freqlist[k].label);
+                fprintf(f, "\t%.3f\n", channel->freqlist[k].revisit_latency);
+            }
+        }
+    }
+    fprintf(f, "\n");
+
+    fprintf(f,
+            "# HELP channel_revisit_latency_max Longest time in seconds between two visits of a scanned frequency.\n"
+            "# TYPE channel_revisit_latency_max gauge\n");
+    for (int i = 0; i < device_count; i++) {
+        device_t* dev = devices + i;
+        if (dev->mode != R_SCAN) {
+            continue;
+        }
+        for (int j = 0; j < dev->channel_count; j++) {
+            channel_t* channel = dev->channels + j;
+            for (int k = 0; k < channel->freq_count; k++) {
+                print_channel_metric(f, "channel_revisit_latency_max", channel->freqlist[k].frequency, channel->freqlist[k].label);
+                fprintf(f, "\t%.3f\n", channel->freqlist[k].revisit_latency_max);
+            }
+        }
+    }
+    fprintf(f, "\n");
+}
+
+static void output_scan_stats(FILE* f) {
+    bool scanning = false;
+    for (int i = 0; i < device_count; i++) {
+        scanning |= (devices[i].mode == R_SCAN);
+    }
+    if (!scanning) {
+        return;
+    }
+
+    fprintf(f,
+            "# HELP scan_retune_count Number of times a scanning device has been retuned.\n"
+            "# TYPE scan_retune_count counter\n");
+    for (int i = 0; i < device_count; i++) {
+        if (devices[i].mode == R_SCAN) {
+            fprintf(f, "scan_retune_count{device=\"%d\"}\t%zu\n", i, devices[i].scan_retune_count);
+        }
+    }
+    fprintf(f, "\n");
+
+    fprintf(f,
+            "# HELP scan_sweep_count Number of complete sweeps through a scan channel's frequency list.\n"
+            "# TYPE scan_sweep_count counter\n");
+    for (int i = 0; i < device_count; i++) {
+        if (devices[i].mode == R_SCAN) {
+            for (int j = 0; j < devices[i].channel_count; j++) {
+                if (devices[i].channels[j].freq_count > 1) {
+                    fprintf(f, "scan_sweep_count{device=\"%d\",channel=\"%d\"}\t%zu\n", i, j, devices[i].channels[j].scan_sweep_count);
+                }
+            }
+        }
+    }
+    fprintf(f, "\n");
+
+    fprintf(f,
+            "# HELP scan_sweep_rate Sweeps per minute, based on the duration of the last complete sweep.\n"
+            "# TYPE scan_sweep_rate gauge\n");
+    for (int i = 0; i < device_count; i++) {
+        if (devices[i].mode == R_SCAN) {
+            for (int j = 0; j < devices[i].channel_count; j++) {
+                if (devices[i].channels[j].freq_count > 1) {
+                    float duration = devices[i].channels[j].scan_sweep_duration;
+                    fprintf(f, "scan_sweep_rate{device=\"%d\",channel=\"%d\"}\t%.3f\n", i, j, duration > 0.0f ? 60.0f / duration : 0.0f);
+                }
+            }
+        }
+    }
+    fprintf(f, "\n");
+}
+
 void write_stats_file(timeval* last_stats_write) {
     if (!stats_filepath) {
         return;
@@ -896,12 +1416,114 @@ void write_stats_file(timeval* last_stats_write) {
     output_channel_ctcss_counter(file);
     output_channel_no_ctcss_counter(file);
     output_device_buffer_overflows(file);
+    output_device_restarts(file);
     output_output_overruns(file);
     output_input_overruns(file);
+    output_scan_stats(file);
+    output_channel_revisit_latencies(file);
+    output_governor(file);
+    output_http_server(file);
+    output_event_stream(file);
+    output_sink_queues(file);
+    output_log_counters(file);
 
     fclose(file);
 }
 
+// Checkpoint the noise floors and AGC levels of all channels for a warm start, see restore_channel_state()
+static void write_state_file(timeval* last_state_write) {
+    if (!state_filepath) {
+        return;
+    }
+
+    timeval current_time;
+    gettimeofday(&current_time, NULL);
+
+    static const double STATE_FILE_TIMING = 60.0;
+    if (!do_exit && delta_sec(last_state_write, &current_time) < STATE_FILE_TIMING) {
+        return;
+    }
+
+    *last_state_write = current_time;
+
+    std::vector<channel_state_t> states;
+    for (int i = 0; i < device_count; i++) {
+        device_t* dev = devices + i;
+        // discovery slots come and go with the carriers
+        const int channel_count = dev->discovery != NULL ? dev->discovery->first_slot : dev->channel_count;
+        for (int j = 0; j < channel_count; j++) {
+            channel_t* channel = dev->channels + j;
+            for (int k = 0; k < channel->freq_count; k++) {
+                freq_t* fparms = channel->freqlist + k;
+                channel_state_t state = {i, fparms->frequency, fparms->squelch.levels(), fparms->agcavgfast};
+                states.push_back(state);
+            }
+        }
+    }
+    channel_state_write(state_filepath, fft_size, states);
+}
+
+// Load the channel states saved by write_state_file(), frequencies which have been saved for the same device start where they left off
+void restore_channel_state(device_t* devs, int count) {
+    if (!state_filepath) {
+        return;
+    }
+    std::vector<channel_state_t> states;
+    if (!channel_state_read(state_filepath, fft_size, states)) {
+        return;
+    }
+    ChannelStateMatcher matcher(states);
+    int restored = 0, total = 0;
+    for (int i = 0; i < count; i++) {
+        device_t* dev = devs + i;
+        const int channel_count = dev->discovery != NULL ? dev->discovery->first_slot : dev->channel_count;
+        for (int j = 0; j < channel_count; j++) {
+            channel_t* channel = dev->channels + j;
+            for (int k = 0; k < channel->freq_count; k++, total++) {
+                freq_t* fparms = channel->freqlist + k;
+                const channel_state_t* state = matcher.take(i, fparms->frequency);
+                if (state != NULL) {
+                    fparms->squelch.restore_levels(state->squelch);
+                    fparms->agcavgfast = state->agc_level;
+                    restored++;
+                }
+            }
+        }
+    }
+    log(LOG_INFO, "Restored the state of %d of %d frequencies from %s\n", restored, total, state_filepath);
+}
+
+// Queue an event for the event stream when the squelch of a channel has opened or closed in this batch
+static void track_transmission(int device, int index, channel_t* channel, int freq_idx) {
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    tx_event_t event;
+    // the frequency of this batch, the one a transmission ends on is taken from its start
+    const freq_t* fparms = channel->freqlist + freq_idx;
+    event.frequency = fparms->frequency;
+    snprintf(event.label, sizeof(event.label), "%s", fparms->label != NULL ? fparms->label : "");
+    event.ctcss = fparms->squelch.ctcss_freq();
+    if (!channel->tx.update(channel->axcindicate != NO_SIGNAL, level_to_dBFS(channel->tui.signal_level), now, &event)) {
+        return;
+    }
+    event.device = device;
+    event.channel = index;
+    event.path[0] = '\0';
+    for (int k = 0; k < channel->output_count && event.path[0] == '\0'; k++) {
+        output_t* output = channel->outputs + k;
+        if (output->type != O_FILE && output->type != O_RAWFILE) {
+            continue;
+        }
+        // a file output on a worker may be switching files right now
+        sink_lock(output);
+        if (output->enabled && ((file_data*)output->data)->f != NULL) {
+            snprintf(event.path, sizeof(event.path), "%s", ((file_data*)output->data)->file_path.c_str());
+        }
+        sink_unlock(output);
+    }
+    event_queue->push(event);
+}
+
 void* output_thread(void* param) {
     assert(param != NULL);
     output_params_t* output_param = (output_params_t*)param;
@@ -909,6 +1531,9 @@ void* output_thread(void* param) {
     struct timeval tv;
     int new_freq = -1;
     timeval last_stats_write = {0, 0};
+    thread_sched_apply(THREAD_OUTPUT);
+    timeval last_state_write;
+    gettimeofday(&last_state_write, NULL);  // nothing worth saving has been learned yet
 
     debug_print("Starting output thread, devices %d:%d, mixers %d:%d, signal %p\n", output_param->device_start, output_param->device_end, output_param->mixer_start, output_param->mixer_end,
                 output_param->mp3_signal);
@@ -919,6 +1544,7 @@ void* output_thread(void* param) {
 #endif /* DEBUG */
     while (!do_exit) {
         output_param->mp3_signal->wait();
+        ConfigReadLock config_read_lock;
         for (int i = output_param->mixer_start; i < output_param->mixer_end; i++) {
             if (mixers[i].enabled == false)
                 continue;
@@ -950,7 +1576,10 @@ void* output_thread(void* param) {
                 }
                 for (int j = 0; j < dev->channel_count; j++) {
                     channel_t* channel = devices[i].channels + j;
-                    process_outputs(channel, new_freq);
+                    const int freq_idx = process_outputs(channel, new_freq);
+                    if (event_stream != NULL) {
+                        track_transmission(i, j, channel, freq_idx);
+                    }
                     memcpy(channel->waveout, channel->waveout + WAVE_BATCH, AGC_EXTRA * 4);
                 }
                 dev->waveavail = 0;
@@ -961,79 +1590,100 @@ void* output_thread(void* param) {
         }
         if (output_param->device_start == 0) {
             write_stats_file(&last_stats_write);
+            write_state_file(&last_state_write);
         }
     }
     return 0;
 }
 
 // reconnect as required
+// Ask the outputs of a channel to connect again or to close their connections
+static void reconnect_outputs(channel_t* channel, int device, bool input_failed, bool enabled_only) {
+    for (int k = 0; k < channel->output_count; k++) {
+        output_t* output = channel->outputs + k;
+        const output_sink_t* sink = output_sink(output->type);
+        if (sink->reconnect == NULL || (enabled_only && !output->enabled)) {
+            continue;
+        }
+        sink_lock(output);
+        sink->reconnect(channel, output, device, input_failed);
+        sink_unlock(output);
+    }
+}
+
+// Hand the new connections over to the outputs which are still waiting for them
+static void attach_streams(channel_t* channel, bool input_running) {
+    for (int k = 0; k < channel->output_count; k++) {
+        output_t* output = channel->outputs + k;
+        if (output->type != O_ICECAST || !output->enabled || !input_running) {
+            continue;
+        }
+        icecast_data* icecast = (icecast_data*)(output->data);
+        for (size_t p = 0; p < pending_streams.size(); p++) {
+            if (pending_streams[p].icecast != icecast || pending_streams[p].shout == NULL) {
+                continue;
+            }
+            sink_lock(output);
+            if (icecast->shout == NULL) {
+                icecast->shout = pending_streams[p].shout;
+                pending_streams[p].shout = NULL;
+            }
+            sink_unlock(output);
+        }
+    }
+}
+
 void* output_check_thread(void*) {
     while (!do_exit) {
         SLEEP(10000);
-        for (int i = 0; i < device_count; i++) {
-            device_t* dev = devices + i;
-            for (int j = 0; j < dev->channel_count; j++) {
-                for (int k = 0; k < dev->channels[j].output_count; k++) {
-                    if (dev->channels[j].outputs[k].type == O_ICECAST) {
-                        icecast_data* icecast = (icecast_data*)(dev->channels[j].outputs[k].data);
-                        if (dev->input->state == INPUT_FAILED) {
-                            if (icecast->shout) {
-                                log(LOG_WARNING, "Device #%d failed, disconnecting stream %s:%d/%s\n", i, icecast->hostname, icecast->port, icecast->mountpoint);
-                                shout_close(icecast->shout);
-                                shout_free(icecast->shout);
-                                icecast->shout = NULL;
-                            }
-                        } else if (dev->input->state == INPUT_RUNNING) {
-                            if (icecast->shout == NULL) {
-                                log(LOG_NOTICE, "Trying to reconnect to %s:%d/%s...\n", icecast->hostname, icecast->port, icecast->mountpoint);
-                                shout_setup(icecast, dev->channels[j].mode);
-                            }
-                        }
-                    } else if (dev->channels[j].outputs[k].type == O_UDP_STREAM) {
-                        udp_stream_data* sdata = (udp_stream_data*)dev->channels[j].outputs[k].data;
-
-                        if (dev->input->state == INPUT_FAILED) {
-                            udp_stream_shutdown(sdata);
-                        }
-#ifdef WITH_PULSEAUDIO
-                    } else if (dev->channels[j].outputs[k].type == O_PULSE) {
-                        pulse_data* pdata = (pulse_data*)(dev->channels[j].outputs[k].data);
-                        if (dev->input->state == INPUT_FAILED) {
-                            if (pdata->context) {
-                                pulse_shutdown(pdata);
-                            }
-                        } else if (dev->input->state == INPUT_RUNNING) {
-                            if (pdata->context == NULL) {
-                                pulse_setup(pdata, dev->channels[j].mode);
-                            }
-                        }
-#endif /* WITH_PULSEAUDIO */
-                    }
+        {
+            ConfigReadLock config_read_lock;
+            for (int i = 0; i < device_count; i++) {
+                device_t* dev = devices + i;
+                if (dev->input->state != INPUT_FAILED && dev->input->state != INPUT_RUNNING) {
+                    continue;
+                }
+                for (int j = 0; j < dev->channel_count; j++) {
+                    reconnect_outputs(dev->channels + j, i, dev->input->state == INPUT_FAILED, false);
                 }
             }
-        }
-        for (int i = 0; i < mixer_count; i++) {
-            if (mixers[i].enabled == false)
-                continue;
-            for (int k = 0; k < mixers[i].channel.output_count; k++) {
-                if (mixers[i].channel.outputs[k].enabled == false)
+            for (int i = 0; i < mixer_count; i++) {
+                if (mixers[i].enabled == false)
                     continue;
-                if (mixers[i].channel.outputs[k].type == O_ICECAST) {
-                    icecast_data* icecast = (icecast_data*)(mixers[i].channel.outputs[k].data);
-                    if (icecast->shout == NULL) {
-                        log(LOG_NOTICE, "Trying to reconnect to %s:%d/%s...\n", icecast->hostname, icecast->port, icecast->mountpoint);
-                        shout_setup(icecast, mixers[i].channel.mode);
-                    }
-#ifdef WITH_PULSEAUDIO
-                } else if (mixers[i].channel.outputs[k].type == O_PULSE) {
-                    pulse_data* pdata = (pulse_data*)(mixers[i].channel.outputs[k].data);
-                    if (pdata->context == NULL) {
-                        pulse_setup(pdata, mixers[i].channel.mode);
-                    }
-#endif /* WITH_PULSEAUDIO */
+                reconnect_outputs(&mixers[i].channel, -1, false, true);
+            }
+        }
+        if (pending_streams.empty()) {
+            continue;
+        }
+
+        // connecting takes a while, the other threads can't wait for it
+        for (size_t p = 0; p < pending_streams.size(); p++) {
+            icecast_data* icecast = pending_streams[p].icecast;
+            log(LOG_NOTICE, "Trying to reconnect to %s:%d/%s...\n", icecast->hostname, icecast->port, icecast->mountpoint);
+            pending_streams[p].shout = shout_connect(icecast, pending_streams[p].mode);
+        }
+
+        // the outputs may have been removed or disabled in the meantime
+        {
+            ConfigReadLock config_read_lock;
+            for (int i = 0; i < device_count; i++) {
+                device_t* dev = devices + i;
+                for (int j = 0; j < dev->channel_count; j++) {
+                    attach_streams(dev->channels + j, dev->input->state == INPUT_RUNNING);
                 }
             }
+            for (int i = 0; i < mixer_count; i++) {
+                attach_streams(&mixers[i].channel, mixers[i].enabled);
+            }
+        }
+        for (size_t p = 0; p < pending_streams.size(); p++) {
+            if (pending_streams[p].shout != NULL) {
+                shout_close(pending_streams[p].shout);
+                shout_free(pending_streams[p].shout);
+            }
         }
+        pending_streams.clear();
     }
     return 0;
 }
@@ -0,0 +1,319 @@
+/*
+ * output_workers.cpp
+ * Threads running the outputs which don't run in the output thread
+ *
+ * Copyright (C) 2024 charlie-foxtrot
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <pthread.h>
+#include <algorithm>  // find()
+#include <cstring>
+#include <vector>
+
+#include "rtl_airband.h"
+
+using namespace std;
+
+/*
+ * An output running on a worker gets a queue of batches, filled by the
+ * output thread in process_outputs() and drained by the worker, which calls
+ * the consume() function of the sink just like the output thread would.
+ * A worker which falls behind loses batches instead of holding up the other
+ * outputs. The pool workers are shared by all the outputs with exec = "pool",
+ * an output with exec = "thread" gets a worker of its own.
+ *
+ * The workers don't take config_lock, a slow disk or server would hold up a
+ * reload and with it the demodulators. Each worker keeps a list of its
+ * outputs instead, and the busy mutex of an output is held while a batch is
+ * consumed, so that disable_output() and output_check_thread() never touch an
+ * output in the middle of it. A reload holds the busy mutexes of all the
+ * outputs while it moves them around (hold_output_sinks()).
+ */
+
+#define SINK_QUEUE_LEN 32  // batches, four seconds of audio
+
+struct sink_state_t {
+    SinkQueue queue;
+    pthread_mutex_t busy;
+    int worker;
+    channel_t* channel;  // where the output is, a reload moves it
+    output_t* output;
+    bool held;      // busy is held by a reload
+    bool detached;  // the worker frees it once it's done with it
+    sink_state_t(size_t floats, int worker_id, channel_t* ch, output_t* out)
+        : queue(SINK_QUEUE_LEN, floats), worker(worker_id), channel(ch), output(out), held(false), detached(false) {
+        pthread_mutex_init(&busy, NULL);
+    }
+};
+
+struct sink_worker_t {
+    THREAD thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    bool pending;
+    bool stop;
+    bool dedicated;
+    bool in_use;
+    vector<sink_state_t*> sinks;    // under workers_lock
+    vector<sink_state_t*> retired;  // detached, under workers_lock
+};
+
+int output_pool_threads = 2;
+
+static vector<sink_worker_t*> workers;
+static vector<int> pool_workers;
+static size_t next_pool_worker = 0;
+static vector<sink_state_t*> all_sinks;
+static bool sinks_held = false;
+static pthread_mutex_t workers_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// Called with busy held. Batches are taken off the queue under busy, so that sink_detach() can drain it instead of the worker.
+static bool consume_batch(sink_state_t* state) {
+    batch_info_t info;
+    const float* samples = state->queue.front(&info);
+    if (samples == NULL) {
+        return false;
+    }
+    channel_t* channel = state->channel;
+    output_t* output = state->output;
+    output_batch_t batch;
+    batch.waveout = samples;
+    batch.waveout_r = (channel->mode == MM_STEREO ? samples + WAVE_BATCH : NULL);
+    batch.iq_out = batch.iq_raw = NULL;
+    batch.axcindicate = (status)info.axcindicate;
+    batch.freq_idx = info.freq_idx;
+    batch.cur_scan_freq = info.cur_scan_freq;
+    if (output->enabled && !output->muted) {
+        output_sink(output->type)->consume(channel, output, &batch);
+    }
+    state->queue.pop();
+    return true;
+}
+
+static void drain_queue(sink_state_t* state) {
+    bool more = true;
+    while (more) {
+        pthread_mutex_lock(&state->busy);
+        more = !state->detached && consume_batch(state);
+        pthread_mutex_unlock(&state->busy);
+    }
+}
+
+static void drain_outputs(sink_worker_t* worker) {
+    pthread_mutex_lock(&workers_lock);
+    // the outputs detached since the last round are no longer in use
+    vector<sink_state_t*> retired;
+    retired.swap(worker->retired);
+    vector<sink_state_t*> sinks = worker->sinks;
+    pthread_mutex_unlock(&workers_lock);
+    for (size_t i = 0; i < retired.size(); i++) {
+        pthread_mutex_destroy(&retired[i]->busy);
+        delete retired[i];
+    }
+    for (size_t i = 0; i < sinks.size(); i++) {
+        drain_queue(sinks[i]);
+    }
+}
+
+static void* sink_worker_main(void* param) {
+    sink_worker_t* worker = (sink_worker_t*)param;
+    bool stop = false;
+    while (!stop) {
+        pthread_mutex_lock(&worker->mutex);
+        while (!worker->pending && !worker->stop) {
+            pthread_cond_wait(&worker->cond, &worker->mutex);
+        }
+        worker->pending = false;
+        stop = worker->stop;
+        pthread_mutex_unlock(&worker->mutex);
+        // on the way out whatever is still queued is written, so that files are complete
+        drain_outputs(worker);
+    }
+    return NULL;
+}
+
+// Called with workers_lock held
+static int start_worker(bool dedicated) {
+    sink_worker_t* worker = new sink_worker_t;
+    pthread_mutex_init(&worker->mutex, NULL);
+    pthread_cond_init(&worker->cond, NULL);
+    worker->pending = worker->stop = false;
+    worker->dedicated = dedicated;
+    worker->in_use = true;
+    workers.push_back(worker);
+    pthread_create(&worker->thread, NULL, &sink_worker_main, worker);
+    return workers.size() - 1;
+}
+
+void sink_attach(channel_t* channel, output_t* output) {
+    int id = -1;
+    pthread_mutex_lock(&workers_lock);
+    if (output->exec == SINK_POOL) {
+        if (pool_workers.size() < (size_t)output_pool_threads) {
+            id = start_worker(false);
+            pool_workers.push_back(id);
+        } else {
+            id = pool_workers[next_pool_worker++ % pool_workers.size()];
+        }
+    } else {
+        for (size_t i = 0; i < workers.size(); i++) {
+            if (workers[i]->dedicated && !workers[i]->in_use) {
+                workers[i]->in_use = true;
+                id = i;
+                break;
+            }
+        }
+        if (id < 0) {
+            id = start_worker(true);
+        }
+    }
+    // room for both sides, so that a change to the channel mode doesn't need a new queue
+    sink_state_t* state = new sink_state_t(2 * WAVE_BATCH, id, channel, output);
+    if (sinks_held) {
+        pthread_mutex_lock(&state->busy);
+        state->held = true;
+    }
+    workers[id]->sinks.push_back(state);
+    all_sinks.push_back(state);
+    pthread_mutex_unlock(&workers_lock);
+    output->sink = state;
+}
+
+// Called under config_write_lock(). Whatever is still queued is written before the output goes.
+void sink_detach(output_t* output) {
+    sink_state_t* state = output->sink;
+    if (state == NULL) {
+        return;
+    }
+    if (!state->held) {
+        pthread_mutex_lock(&state->busy);
+    }
+    while (consume_batch(state)) {
+    }
+    state->detached = true;
+
+    pthread_mutex_lock(&workers_lock);
+    sink_worker_t* worker = workers[state->worker];
+    if (worker->dedicated) {
+        worker->in_use = false;
+    }
+    worker->sinks.erase(find(worker->sinks.begin(), worker->sinks.end(), state));
+    all_sinks.erase(find(all_sinks.begin(), all_sinks.end(), state));
+    // the worker may have it in the list of the round it is in, it frees it in the next one
+    worker->retired.push_back(state);
+    pthread_mutex_unlock(&workers_lock);
+
+    pthread_mutex_unlock(&state->busy);
+    output->sink = NULL;
+}
+
+void hold_output_sinks(void) {
+    pthread_mutex_lock(&workers_lock);
+    sinks_held = true;
+    vector<sink_state_t*> sinks = all_sinks;
+    pthread_mutex_unlock(&workers_lock);
+    for (size_t i = 0; i < sinks.size(); i++) {
+        pthread_mutex_lock(&sinks[i]->busy);
+        sinks[i]->held = true;
+    }
+}
+
+static void rebind_sinks(channel_t* channel) {
+    for (int k = 0; k < channel->output_count; k++) {
+        output_t* output = channel->outputs + k;
+        if (output->sink != NULL) {
+            output->sink->channel = channel;
+            output->sink->output = output;
+        }
+    }
+}
+
+void release_output_sinks(void) {
+    for (int i = 0; i < device_count; i++) {
+        device_t* dev = devices + i;
+        for (int j = 0; j < dev->channel_count; j++) {
+            rebind_sinks(dev->channels + j);
+        }
+    }
+    for (int i = 0; i < mixer_count; i++) {
+        rebind_sinks(&mixers[i].channel);
+    }
+    pthread_mutex_lock(&workers_lock);
+    sinks_held = false;
+    vector<sink_state_t*> sinks = all_sinks;
+    pthread_mutex_unlock(&workers_lock);
+    for (size_t i = 0; i < sinks.size(); i++) {
+        sinks[i]->held = false;
+        pthread_mutex_unlock(&sinks[i]->busy);
+    }
+}
+
+void sink_enqueue(channel_t* channel, output_t* output, const output_batch_t* batch) {
+    float* samples = output->sink->queue.back();
+    if (samples == NULL) {
+        return;
+    }
+    memcpy(samples, batch->waveout, sizeof(float) * WAVE_BATCH);
+    if (channel->mode == MM_STEREO) {
+        memcpy(samples + WAVE_BATCH, batch->waveout_r, sizeof(float) * WAVE_BATCH);
+    }
+    batch_info_t info = {batch->axcindicate, batch->freq_idx, batch->cur_scan_freq};
+    output->sink->queue.push(info);
+
+    pthread_mutex_lock(&workers_lock);
+    sink_worker_t* worker = workers[output->sink->worker];
+    pthread_mutex_unlock(&workers_lock);
+    pthread_mutex_lock(&worker->mutex);
+    worker->pending = true;
+    pthread_cond_signal(&worker->cond);
+    pthread_mutex_unlock(&worker->mutex);
+}
+
+// While a reload holds the outputs, they are its own
+void sink_lock(output_t* output) {
+    if (output->sink != NULL && !output->sink->held) {
+        pthread_mutex_lock(&output->sink->busy);
+    }
+}
+
+void sink_unlock(output_t* output) {
+    if (output->sink != NULL && !output->sink->held) {
+        pthread_mutex_unlock(&output->sink->busy);
+    }
+}
+
+size_t sink_dropped(const output_t* output) {
+    return output->sink != NULL ? output->sink->queue.dropped() : 0;
+}
+
+void stop_output_workers(void) {
+    pthread_mutex_lock(&workers_lock);
+    vector<sink_worker_t*> stopping = workers;
+    pthread_mutex_unlock(&workers_lock);
+    if (stopping.empty()) {
+        return;
+    }
+    log(LOG_INFO, "Closing %zu output worker(s)\n", stopping.size());
+    for (size_t i = 0; i < stopping.size(); i++) {
+        pthread_mutex_lock(&stopping[i]->mutex);
+        stopping[i]->stop = true;
+        pthread_cond_signal(&stopping[i]->cond);
+        pthread_mutex_unlock(&stopping[i]->mutex);
+    }
+    for (size_t i = 0; i < stopping.size(); i++) {
+        pthread_join(stopping[i]->thread, NULL);
+    }
+}
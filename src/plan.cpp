@@ -0,0 +1,305 @@
+/*
+ * plan.cpp
+ * Predicted CPU load of the configuration, measured on this host
+ *
+ * Copyright (C) 2024 charlie-foxtrot
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <unistd.h>  // sysconf
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "capacity.h"
+#include "ctcss.h"
+#include "fft_engine.h"
+#include "filters.h"
+#include "rtl_airband.h"
+#include "squelch.h"
+
+using namespace std;
+
+#define PLAN_BENCHMARK_TIME 0.05  // seconds per micro-benchmark
+
+// CPU seconds taken by the building blocks of the demodulator and the outputs
+struct plan_costs_t {
+    double fft;         // per transform
+    double convert;     // per transform, converting and windowing its input samples
+    double channel;     // per wave sample: squelch and AGC, every channel
+    double derotation;  // per wave sample, channels working on raw I/Q (NFM, lowpass filter or I/Q outputs)
+    double lowpass;     // per wave sample
+    double nfm;         // per wave sample
+    double notch;       // per wave sample
+    double ctcss;       // per wave sample
+    double mixing;      // per wave sample of a mixer input
+    double mp3_mono;    // per wave sample
+    double mp3_stereo;  // per wave sample
+};
+
+static volatile float plan_sink;  // keeps the compiler from dropping the benchmarked work
+
+static float noise(void) {
+    return (float)rand() / RAND_MAX - 0.5f;
+}
+
+static double per_sample(const function<void(void)>& batch) {
+    return benchmark_call(batch, PLAN_BENCHMARK_TIME) / (WAVE_BATCH);
+}
+
+static void measure_costs(plan_costs_t* costs) {
+    vector<float> wave(WAVE_BATCH), iq(2 * WAVE_BATCH), out(WAVE_BATCH);
+    for (int j = 0; j < WAVE_BATCH; j++) {
+        wave[j] = fabs(noise());
+        iq[2 * j] = noise();
+        iq[2 * j + 1] = noise();
+    }
+
+    costs->fft = fft_engine_time(fft_engine_name, fft_size_log, fft_batch);
+
+    vector<float> levels(256), window(fft_size), fft_in(2 * fft_size);
+    vector<unsigned char> raw(2 * fft_size);
+    for (size_t i = 0; i < fft_size; i++) {
+        window[i] = noise();
+        raw[2 * i] = rand() & 0xff;
+        raw[2 * i + 1] = rand() & 0xff;
+    }
+    for (int i = 0; i < 256; i++) {
+        levels[i] = (i - 127.5f) / 127.5f;
+    }
+    costs->convert = benchmark_call(
+        [&](void) {
+            for (size_t i = 0; i < fft_size; i++) {
+                fft_in[2 * i] = levels[raw[2 * i]] * window[i];
+                fft_in[2 * i + 1] = levels[raw[2 * i + 1]] * window[i];
+            }
+            plan_sink = fft_in[0];
+        },
+        PLAN_BENCHMARK_TIME);
+
+    Squelch squelch;
+    float agcavgfast = 0.5f;
+    costs->channel = per_sample([&](void) {
+        for (int j = 0; j < WAVE_BATCH; j++) {
+            squelch.process_raw_sample(wave[j]);
+            if (wave[j] > squelch.squelch_level()) {
+                agcavgfast = agcavgfast * 0.995f + wave[j] * 0.005f;
+            }
+            out[j] = (wave[j] - agcavgfast) / (agcavgfast * 1.5f);
+        }
+        plan_sink = out[0];
+    });
+
+    uint32_t phi = 0;
+    costs->derotation = per_sample([&](void) {
+        for (int j = 0; j < WAVE_BATCH; j++) {
+            float swf, cwf, re, im;
+            sincosf_lut(phi, &swf, &cwf);
+            multiply(iq[2 * j], iq[2 * j + 1], cwf, -swf, &re, &im);
+            phi = (phi + 0x12345) & 0xffffff;
+            out[j] = sqrt(re * re + im * im);
+        }
+        plan_sink = out[0];
+    });
+
+    LowpassFilter lowpass(2500.0f, WAVE_RATE);
+    costs->lowpass = per_sample([&](void) {
+        for (int j = 0; j < WAVE_BATCH; j++) {
+            float re = iq[2 * j], im = iq[2 * j + 1];
+            lowpass.apply(re, im);
+            out[j] = re;
+        }
+        plan_sink = out[0];
+    });
+
+#ifdef NFM
+    costs->nfm = per_sample([&](void) {
+        for (int j = 1; j < WAVE_BATCH; j++) {
+            out[j] = polar_disc_fast(iq[2 * j], iq[2 * j + 1], iq[2 * j - 2], iq[2 * j - 1]);
+        }
+        plan_sink = out[1];
+    });
+#else
+    costs->nfm = 0.0;
+#endif /* NFM */
+
+    NotchFilter notch(100.0f, WAVE_RATE, 10.0f);
+    costs->notch = per_sample([&](void) {
+        for (int j = 0; j < WAVE_BATCH; j++) {
+            out[j] = iq[j];
+            notch.apply(out[j]);
+        }
+        plan_sink = out[0];
+    });
+
+    // the same two detectors as Squelch::set_ctcss_freq()
+    CTCSS ctcss_fast(100.0f, WAVE_RATE, WAVE_RATE * 0.05);
+    CTCSS ctcss_slow(100.0f, WAVE_RATE, WAVE_RATE * 0.4);
+    costs->ctcss = per_sample([&](void) {
+        for (int j = 0; j < WAVE_BATCH; j++) {
+            ctcss_fast.process_audio_sample(iq[j]);
+            ctcss_slow.process_audio_sample(iq[j]);
+        }
+    });
+
+    costs->mixing = per_sample([&](void) {
+        for (int j = 0; j < WAVE_BATCH; j++) {
+            out[j] += wave[j] * 0.7f;
+        }
+        plan_sink = out[0];
+    });
+
+    unsigned char* lamebuf = (unsigned char*)XCALLOC(LAMEBUF_SIZE, sizeof(unsigned char));
+    for (int stereo = 0; stereo < 2; stereo++) {
+        lame_t lame = airlame_init(stereo ? MM_STEREO : MM_MONO, 0, 0);
+        double t = 0.0;
+        if (lame != NULL) {
+            t = per_sample([&](void) { lame_encode_buffer_ieee_float(lame, iq.data(), stereo ? iq.data() + WAVE_BATCH : NULL, WAVE_BATCH, lamebuf, LAMEBUF_SIZE); });
+            lame_close(lame);
+        }
+        (stereo ? costs->mp3_stereo : costs->mp3_mono) = t;
+    }
+    free(lamebuf);
+}
+
+// CPU seconds per wave sample of one demodulator of the channel
+static double channel_cost(const plan_costs_t& costs, channel_t* channel, string* features) {
+    bool nfm = false, lowpass = false, notch = false, ctcss = false;
+    for (int f = 0; f < channel->freq_count; f++) {
+        freq_t* fparms = channel->freqlist + f;
+#ifdef NFM
+        nfm |= (fparms->modulation == MOD_NFM);
+#endif /* NFM */
+        lowpass |= fparms->lowpass_filter.enabled();
+        notch |= fparms->notch_filter.enabled();
+        ctcss |= fparms->squelch.ctcss_enabled();
+    }
+
+    double cost = costs.channel;
+    *features = nfm ? "NFM" : "AM";
+    if (channel->needs_raw_iq) {
+        cost += costs.derotation;
+    }
+    if (nfm) {
+        cost += costs.nfm;
+    }
+    if (lowpass) {
+        cost += costs.lowpass;
+        *features += ", lowpass";
+    }
+    if (notch) {
+        cost += costs.notch;
+        *features += ", notch";
+    }
+    if (ctcss) {
+        cost += costs.ctcss;
+        *features += ", CTCSS";
+    }
+    return cost;
+}
+
+static void plan_encoders(CapacityPlan& plan, const plan_costs_t& costs, channel_t* channel, const string& thread, const string& device, const string& name, int encoders) {
+    if (encoders > 0) {
+        char item[128];
+        snprintf(item, sizeof(item), "%s: %d MP3 encoder(s)", name.c_str(), encoders);
+        plan.add(thread, device, item, encoders * WAVE_RATE * (channel->mode == MM_STEREO ? costs.mp3_stereo : costs.mp3_mono));
+    }
+}
+
+// The encoders of outputs with exec = "pool" or "thread" run on the output workers and not on the output thread
+static void plan_outputs(CapacityPlan& plan, const plan_costs_t& costs, channel_t* channel, const string& thread, const string& device, const string& name) {
+    int encoders = 0, pooled = 0;
+    for (int k = 0; k < channel->output_count; k++) {
+        const output_t* output = channel->outputs + k;
+        if (!output->has_mp3_output) {
+            continue;
+        }
+        if (output->exec == SINK_INLINE) {
+            encoders++;
+        } else if (output->exec == SINK_POOL) {
+            pooled++;
+        } else {
+            plan_encoders(plan, costs, channel, name + " " + output_sink(output->type)->name + " thread", device, name, 1);
+        }
+    }
+    plan_encoders(plan, costs, channel, thread, device, name, encoders);
+    plan_encoders(plan, costs, channel, "output pool", device, name, pooled);
+}
+
+int print_capacity_plan(void) {
+    plan_costs_t costs;
+    sincosf_lut_init();
+    measure_costs(&costs);
+    if (costs.fft < 0.0) {
+        cerr << "Cannot set up the " << fft_engine_name << " FFT engine\n";
+        return 1;
+    }
+
+    printf("Measured on this host, in microseconds:\n");
+    printf("  %s FFT of %zu points, %zu per batch: %.2f per transform\n", fft_engine_name.c_str(), fft_size, fft_batch, costs.fft * 1e6);
+    printf("  sample conversion and windowing: %.2f per transform\n", costs.convert * 1e6);
+    printf("  per wave sample: channel %.3f, raw I/Q %.3f, lowpass %.3f, NFM %.3f, notch %.3f, CTCSS %.3f\n", costs.channel * 1e6, costs.derotation * 1e6, costs.lowpass * 1e6, costs.nfm * 1e6,
+           costs.notch * 1e6, costs.ctcss * 1e6);
+    printf("  per wave sample: MP3 mono %.3f, MP3 stereo %.3f, mixing %.3f\n\n", costs.mp3_mono * 1e6, costs.mp3_stereo * 1e6, costs.mixing * 1e6);
+
+    CapacityPlan plan;
+    char name[128];
+    for (int i = 0; i < device_count; i++) {
+        device_t* dev = devices + i;
+        snprintf(name, sizeof(name), "device %d", i);
+        const string device = name;
+        snprintf(name, sizeof(name), "demod %d", i);
+        const string demod = multiple_demod_threads ? name : "demod";
+        snprintf(name, sizeof(name), "output %d", i);
+        const string output = (multiple_output_threads && multiple_demod_threads) ? name : "output";
+
+        // one FFT per wave sample
+        plan.add(demod, device, device + ": FFT", WAVE_RATE * (costs.fft + costs.convert));
+        for (int j = 0; j < dev->channel_count; j++) {
+            channel_t* channel = dev->channels + j;
+            string features;
+            const int demodulators = channel->lane_count > 0 ? channel->lane_count : 1;
+            const double cost = channel_cost(costs, channel, &features);
+            if (demodulators > 1) {
+                snprintf(name, sizeof(name), "%s channel %d (%s, %d lanes)", device.c_str(), j, features.c_str(), demodulators);
+            } else {
+                snprintf(name, sizeof(name), "%s channel %d (%s)", device.c_str(), j, features.c_str());
+            }
+            plan.add(demod, device, name, demodulators * WAVE_RATE * cost);
+            snprintf(name, sizeof(name), "%s channel %d", device.c_str(), j);
+            plan_outputs(plan, costs, channel, output, device, name);
+        }
+    }
+    for (int i = 0; i < mixer_count; i++) {
+        mixer_t* mixer = mixers + i;
+        snprintf(name, sizeof(name), "mixer %s", mixer->name);
+        const string device = name;
+        snprintf(name, sizeof(name), "%s: %d inputs", device.c_str(), mixer->input_count);
+        plan.add("mixer", device, name, mixer->input_count * WAVE_RATE * costs.mixing * (mixer->channel.mode == MM_STEREO ? 2 : 1));
+        plan_outputs(plan, costs, &mixer->channel, multiple_output_threads ? "output mixers" : "output", device, device);
+    }
+
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpus < 1) {
+        cpus = 1;
+    }
+    fputs(plan.format(CAPACITY_THREAD_LIMIT, (unsigned)cpus).c_str(), stdout);
+    return plan.warnings(CAPACITY_THREAD_LIMIT, (unsigned)cpus).empty() ? 0 : 1;
+}
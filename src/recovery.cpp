@@ -0,0 +1,155 @@
+/*
+ * recovery.cpp
+ * Restarting failed input devices
+ *
+ * Copyright (C) 2024 charlie-foxtrot
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <pthread.h>
+#include <sys/time.h>
+#include <syslog.h>
+#include <algorithm>        // min
+#include "input-common.h"   // input_t, input_init(), input_start(), input_stop()
+#include "input-helpers.h"  // circbuffer_discard()
+#include "rtl_airband.h"
+
+using namespace std;
+
+/*
+ * When an input fails (USB device unplugged or reset, read errors), the
+ * outputs of its channels are suspended and the input is stopped. It is then
+ * initialized and started again, waiting RESTART_DELAY_MIN after the failure
+ * and twice as long after every attempt which didn't work, up to
+ * RESTART_DELAY_MAX. Once it runs, the outputs resume.
+ *
+ * All of this runs in the main thread. The config lock is held for writing
+ * only while outputs are suspended or resumed, opening a device may take a
+ * while and the other devices keep running meanwhile.
+ */
+
+#define RESTART_DELAY_MIN 1000   // ms
+#define RESTART_DELAY_MAX 60000  // ms
+#define RESTART_STABLE_TIME 60   // s a restarted input has to run before the delay starts over from the minimum
+
+// Called with config_lock held for writing
+static void take_down(int i, device_t* dev, timeval* now) {
+    if (dev->restart) {
+        log(LOG_ERR, "Device #%d failed, restarting it\n", i);
+    } else {
+        log(LOG_ERR, "Device #%d failed, disabling it\n", i);
+    }
+    for (int j = 0; j < dev->channel_count; j++) {
+        suspend_channel_outputs(dev->channels + j);
+    }
+    dev->down = true;
+    dev->down_since = dev->last_attempt = *now;
+    // an input which keeps failing right after a restart is retried less and less often
+    if (dev->restart_delay == 0 || delta_sec(&dev->up_since, now) >= RESTART_STABLE_TIME) {
+        dev->restart_delay = RESTART_DELAY_MIN;
+    } else {
+        dev->restart_delay = min(2 * dev->restart_delay, RESTART_DELAY_MAX);
+    }
+}
+
+static bool restart_input(input_t* input) {
+    bool started = false;
+    recoverable_errors(true);
+    try {
+        if (input_init(input) == 0 && input->state == INPUT_INITIALIZED) {
+            circbuffer_discard(input);  // samples from before the failure
+            started = (input_start(input) == 0);
+        }
+    } catch (const RecoverableError& e) {
+        // the driver has logged why
+    }
+    recoverable_errors(false);
+    if (!started) {
+        input->state = INPUT_DISABLED;  // nothing is running
+    }
+    return started;
+}
+
+// Called with config_lock held for writing
+static void bring_up(int i, device_t* dev, timeval* now) {
+    for (int j = 0; j < dev->channel_count; j++) {
+        resume_channel_outputs(dev->channels + j);
+    }
+    if (dev->mode == R_SCAN) {
+        scan_resume(dev);  // the scan channels settle on their current step again
+    }
+    const double outage = delta_sec(&dev->down_since, now);
+    dev->downtime += outage;
+    dev->restart_count++;
+    dev->down = false;
+    dev->up_since = *now;
+    log(LOG_NOTICE, "Device #%d restarted after %.1f s (restart #%d)\n", i, outage, dev->restart_count);
+}
+
+void supervise_devices(void) {
+    timeval now;
+    gettimeofday(&now, NULL);
+
+    bool failed = false;
+    for (int i = 0; i < device_count; i++) {
+        failed |= (!devices[i].down && devices[i].input->state == INPUT_FAILED);
+    }
+    if (failed) {
+        config_write_lock();
+        for (int i = 0; i < device_count; i++) {
+            if (!devices[i].down && devices[i].input->state == INPUT_FAILED) {
+                take_down(i, devices + i, &now);
+            }
+        }
+        pthread_rwlock_unlock(&config_lock);
+
+        // the demodulators don't touch inputs which aren't running, so stopping them needs no lock
+        for (int i = 0; i < device_count; i++) {
+            device_t* dev = devices + i;
+            if (dev->down && dev->input->state == INPUT_FAILED) {
+                if (input_stop(dev->input) != 0) {
+                    log(LOG_ERR, "Device #%d: failed to stop the input, it can't be restarted\n", i);
+                    dev->restart = false;
+                }
+                dev->input->state = INPUT_DISABLED;
+            }
+        }
+    }
+
+    int alive = 0;
+    for (int i = 0; i < device_count; i++) {
+        device_t* dev = devices + i;
+        if (dev->down && dev->restart && dev->input->state == INPUT_DISABLED && delta_sec(&dev->last_attempt, &now) * 1000.0 >= dev->restart_delay) {
+            if (restart_input(dev->input)) {
+                config_write_lock();
+                gettimeofday(&now, NULL);
+                bring_up(i, dev, &now);
+                pthread_rwlock_unlock(&config_lock);
+            } else {
+                gettimeofday(&now, NULL);
+                dev->last_attempt = now;
+                dev->restart_delay = min(2 * dev->restart_delay, RESTART_DELAY_MAX);
+                log(LOG_WARNING, "Device #%d: restart failed, trying again in %d s\n", i, dev->restart_delay / 1000);
+            }
+        }
+        if (!dev->down || dev->restart) {
+            alive++;
+        }
+    }
+    if (alive == 0) {
+        log(LOG_ERR, "All receivers failed, exiting\n");
+        do_exit = 1;
+    }
+}
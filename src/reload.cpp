@@ -0,0 +1,617 @@
+/*
+ * reload.cpp
+ * Applying configuration changes at runtime
+ *
+ * Copyright (C) 2024 charlie-foxtrot
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <pthread.h>
+#include <syslog.h>
+#include <algorithm>  // min
+#include <cstdlib>
+#include <cstring>
+#include <libconfig.h++>
+#include <sstream>
+#include <vector>
+#include "carrier_discovery.h"  // CarrierTracker
+#include "dense_bins.h"
+#include "input-common.h"   // input_t
+#include "input-subband.h"  // subband_wideband_input(), subband_input_free()
+#include "rtl_airband.h"
+
+using namespace std;
+using namespace libconfig;
+
+/*
+ * On SIGHUP the configuration file is parsed again, the result is compared
+ * with the running devices and mixers and the differences are applied in
+ * place: channels and outputs are added and removed, channel settings are
+ * updated, and everything which hasn't changed keeps running untouched.
+ * Inputs are never restarted, changes which would need it are only logged.
+ *
+ * All of this happens with config_lock held for writing, so the demodulator,
+ * output, mixer and controller threads are paused between two iterations.
+ */
+
+pthread_rwlock_t config_lock = PTHREAD_RWLOCK_INITIALIZER;
+volatile int reload_waiting = 0;
+
+struct reload_stats_t {
+    int channels_added, channels_removed;
+    int outputs_added, outputs_removed;
+};
+
+static bool same_string(const char* a, const char* b) {
+    if (a == NULL || b == NULL) {
+        return a == b;
+    }
+    return strcmp(a, b) == 0;
+}
+
+// true if both outputs write the same stream to the same place
+static bool same_output(const output_t* a, const output_t* b) {
+    if (a->type != b->type || a->exec != b->exec) {
+        return false;
+    }
+    switch (a->type) {
+        case O_ICECAST: {
+            const icecast_data* x = (const icecast_data*)a->data;
+            const icecast_data* y = (const icecast_data*)b->data;
+            return same_string(x->hostname, y->hostname) && x->port == y->port && same_string(x->mountpoint, y->mountpoint) && same_string(x->username, y->username) &&
+                   same_string(x->password, y->password) && same_string(x->name, y->name) && same_string(x->genre, y->genre) && same_string(x->description, y->description) &&
+#ifdef LIBSHOUT_HAS_TLS
+                   x->tls_mode == y->tls_mode &&
+#endif /* LIBSHOUT_HAS_TLS */
+                   x->send_scan_freq_tags == y->send_scan_freq_tags;
+        }
+        case O_FILE:
+        case O_RAWFILE: {
+            const file_data* x = (const file_data*)a->data;
+            const file_data* y = (const file_data*)b->data;
+            return x->basedir == y->basedir && x->basename == y->basename && x->suffix == y->suffix && x->dated_subdirectories == y->dated_subdirectories && x->continuous == y->continuous &&
+                   x->append == y->append && x->split_on_transmission == y->split_on_transmission && x->include_freq == y->include_freq && x->upload_url == y->upload_url &&
+                   x->delete_after_upload == y->delete_after_upload && x->upload_retry_interval == y->upload_retry_interval && x->pre_trigger_samples == y->pre_trigger_samples &&
+                   x->wav == y->wav && (!x->wav || x->wav_type == y->wav_type);
+        }
+        case O_MIXER:
+            return same_string(((const mixer_data*)a->data)->mixer->name, ((const mixer_data*)b->data)->mixer->name);
+        case O_UDP_STREAM: {
+            const udp_stream_data* x = (const udp_stream_data*)a->data;
+            const udp_stream_data* y = (const udp_stream_data*)b->data;
+            return same_string(x->dest_address, y->dest_address) && same_string(x->dest_port, y->dest_port) && x->continuous == y->continuous;
+        }
+        case O_HTTP:
+            return same_string(((const http_data*)a->data)->mountpoint, ((const http_data*)b->data)->mountpoint);
+#ifdef WITH_PULSEAUDIO
+        case O_PULSE: {
+            const pulse_data* x = (const pulse_data*)a->data;
+            const pulse_data* y = (const pulse_data*)b->data;
+            return same_string(x->server, y->server) && same_string(x->name, y->name) && same_string(x->sink, y->sink) && same_string(x->stream_name, y->stream_name) &&
+                   x->continuous == y->continuous;
+        }
+#endif /* WITH_PULSEAUDIO */
+        default:
+            return false;
+    }
+}
+
+// Move a parsed mixer output over to the running mixer of the same name
+static bool connect_mixer_output(output_t* output) {
+    mixer_data* mdata = (mixer_data*)output->data;
+    const mixinput_t* parsed_input = mdata->mixer->inputs + mdata->input;
+    const float balance = parsed_input->ampr - parsed_input->ampl;
+    mixer_t* mixer = getmixerbyname(mdata->mixer->name);
+    if (mixer == NULL || !mixer->enabled || (balance != 0.0f && mixer->channel.mode != MM_STEREO)) {
+        log(LOG_WARNING, "Mixer %s can't take new inputs until restarted\n", mdata->mixer->name);
+        return false;
+    }
+    int input = mixer_connect_input(mixer, parsed_input->ampfactor, balance);
+    if (input < 0) {
+        log(LOG_ERR, "Could not connect to mixer %s: %s\n", mixer->name, mixer_get_error());
+        return false;
+    }
+    mdata->mixer = mixer;
+    mdata->input = input;
+    return true;
+}
+
+static void update_mixer_input(const output_t* output, const output_t* parsed) {
+    const mixer_data* mdata = (const mixer_data*)output->data;
+    const mixer_data* pdata = (const mixer_data*)parsed->data;
+    const mixinput_t* parsed_input = pdata->mixer->inputs + pdata->input;
+    if (parsed_input->ampl != parsed_input->ampr && mdata->mixer->channel.mode != MM_STEREO) {
+        log(LOG_WARNING, "Mixer %s: balance can't be set on a mono mixer until restarted\n", mdata->mixer->name);
+        return;
+    }
+    mixinput_t* input = mdata->mixer->inputs + mdata->input;
+    input->ampfactor = parsed_input->ampfactor;
+    input->ampl = parsed_input->ampl;
+    input->ampr = parsed_input->ampr;
+}
+
+// Free the settings the parser has allocated for an output which is not started
+static void free_output_data(output_t* output) {
+    if (output->type == O_ICECAST) {
+        icecast_data* idata = (icecast_data*)output->data;
+        free(const_cast<char*>(idata->hostname));
+        free(const_cast<char*>(idata->mountpoint));
+        free(const_cast<char*>(idata->username));
+        free(const_cast<char*>(idata->password));
+        free(const_cast<char*>(idata->name));
+        free(const_cast<char*>(idata->genre));
+        free(const_cast<char*>(idata->description));
+        free(idata);
+    } else if (output->type == O_FILE || output->type == O_RAWFILE) {
+        file_data* fdata = (file_data*)output->data;
+        delete fdata->pre_trigger;
+        delete fdata;
+    } else if (output->type == O_UDP_STREAM) {
+        udp_stream_data* sdata = (udp_stream_data*)output->data;
+        free(const_cast<char*>(sdata->dest_address));
+        free(const_cast<char*>(sdata->dest_port));
+        free(sdata);
+    } else if (output->type == O_HTTP) {
+        http_data* hdata = (http_data*)output->data;
+        free(const_cast<char*>(hdata->mountpoint));
+        free(hdata);
+#ifdef WITH_PULSEAUDIO
+    } else if (output->type == O_PULSE) {
+        pulse_data* pdata = (pulse_data*)output->data;
+        free(const_cast<char*>(pdata->server));
+        free(const_cast<char*>(pdata->name));
+        free(const_cast<char*>(pdata->sink));
+        free(const_cast<char*>(pdata->stream_name));
+        free(pdata);
+#endif /* WITH_PULSEAUDIO */
+    } else {
+        free(output->data);  // mixer outputs, the parsed mixers they point at stay allocated (see reload_config())
+    }
+    output->data = NULL;
+}
+
+static void start_output(channel_t* channel, output_t* output) {
+    bool started;
+    if (output->type == O_MIXER) {
+        started = connect_mixer_output(output);
+    } else if (output->type == O_ICECAST) {
+        // connecting could stall the paused threads, output_check_thread() does it shortly
+        output->lame = airlame_init(channel->mode, channel->highpass, channel->lowpass);
+        output->lamebuf = (unsigned char*)malloc(sizeof(unsigned char) * LAMEBUF_SIZE);
+        started = true;
+        if (output->exec != SINK_INLINE) {
+            sink_attach(channel, output);
+        }
+    } else {
+        started = init_output(channel, output);
+    }
+    if (!started) {
+        log(LOG_ERR, "Failed to start a new output, it stays disabled\n");
+        output->enabled = false;
+    }
+}
+
+static bool output_is_wav(const output_t* output) {
+    return output->type == O_FILE && ((const file_data*)output->data)->wav;
+}
+
+static void stop_output(output_t* output) {
+    // the batches still queued for a worker are written first
+    sink_detach(output);
+    if (output->enabled) {
+        disable_output(output);
+    }
+    if (output->lame) {
+        lame_close(output->lame);
+        output->lame = NULL;
+    }
+    free(output->lamebuf);
+    output->lamebuf = NULL;
+    if (output->type == O_FILE) {
+        file_data* fdata = (file_data*)output->data;
+        delete fdata->wav_encoder;
+        fdata->wav_encoder = NULL;
+    }
+}
+
+// Switch a running channel (or mixer) over to the parsed list of outputs, the ones which haven't changed keep running
+static void update_outputs(channel_t* channel, channel_t* parsed, reload_stats_t* stats) {
+    // the mp3 encoders are set up for these, the wav ones for the mode
+    const bool encoder_changed = channel->mode != parsed->mode || channel->highpass != parsed->highpass || channel->lowpass != parsed->lowpass;
+    vector<bool> kept(channel->output_count, false);
+    for (int o = 0; o < parsed->output_count; o++) {
+        output_t* output = parsed->outputs + o;
+        int k = 0;
+        while (k < channel->output_count && (kept[k] || !channel->outputs[k].enabled || (encoder_changed && (channel->outputs[k].has_mp3_output || output_is_wav(channel->outputs + k))) || !same_output(channel->outputs + k, output))) {
+            k++;
+        }
+        if (k < channel->output_count) {
+            kept[k] = true;
+            if (output->type == O_MIXER) {
+                update_mixer_input(channel->outputs + k, output);
+            }
+            free_output_data(output);  // the running output keeps its own
+            *output = channel->outputs[k];
+        } else {
+            start_output(parsed, output);
+            stats->outputs_added++;
+        }
+    }
+    for (int k = 0; k < channel->output_count; k++) {
+        if (!kept[k]) {
+            stop_output(channel->outputs + k);
+            stats->outputs_removed++;
+        }
+    }
+    free(channel->outputs);
+    channel->outputs = parsed->outputs;
+    channel->output_count = parsed->output_count;
+    channel->highpass = parsed->highpass;
+    channel->lowpass = parsed->lowpass;
+    parsed->outputs = NULL;
+    parsed->output_count = 0;
+}
+
+// Take over the settings of a parsed channel tuned to the same frequencies, keeping the squelch and filter state unless they have changed
+static void update_channel(channel_t* channel, channel_t* parsed, reload_stats_t* stats) {
+    channel->afc = parsed->afc;
+    channel->low_priority = parsed->low_priority;
+    channel->needs_raw_iq = parsed->needs_raw_iq;
+    channel->has_iq_outputs = parsed->has_iq_outputs;
+    channel->has_pre_trigger = parsed->has_pre_trigger;
+    channel->dm_dphi = parsed->dm_dphi;
+#ifdef NFM
+    channel->alpha = parsed->alpha;
+#endif /* NFM */
+    for (int k = 0; k < channel->lane_count; k++) {
+        channel_t* lane = channel->lanes + k;
+        lane->afc = channel->afc;
+        lane->needs_raw_iq = channel->needs_raw_iq;
+        lane->has_iq_outputs = channel->has_iq_outputs;
+        lane->has_pre_trigger = channel->has_pre_trigger;
+#ifdef NFM
+        lane->alpha = channel->alpha;
+#endif /* NFM */
+    }
+    for (int f = 0; f < channel->freq_count; f++) {
+        freq_t* fparms = channel->freqlist + f;
+        const freq_t* pparms = parsed->freqlist + f;
+        if (!same_string(fparms->label, pparms->label)) {
+            free(fparms->label);
+            fparms->label = pparms->label != NULL ? strdup(pparms->label) : NULL;
+        }
+        fparms->ampfactor = pparms->ampfactor;
+        fparms->modulation = pparms->modulation;
+        fparms->squelch.copy_settings(pparms->squelch);
+        if (!fparms->notch_filter.same_coefficients(pparms->notch_filter)) {
+            fparms->notch_filter = pparms->notch_filter;
+        }
+        if (!fparms->lowpass_filter.same_coefficients(pparms->lowpass_filter)) {
+            fparms->lowpass_filter = pparms->lowpass_filter;
+        }
+    }
+    update_outputs(channel, parsed, stats);
+}
+
+static bool same_frequencies(const channel_t* a, const channel_t* b) {
+    if (a->freq_count != b->freq_count) {
+        return false;
+    }
+    for (int f = 0; f < a->freq_count; f++) {
+        if (a->freqlist[f].frequency != b->freqlist[f].frequency) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool same_input(const device_t* dev, const device_t* parsed) {
+    const input_t* a = dev->input;
+    const input_t* b = parsed->input;
+    if (a->init != b->init || a->sample_rate != b->sample_rate || dev->mode != parsed->mode) {
+        return false;
+    }
+    // scanning devices move their center frequency around
+    if (dev->mode == R_MULTICHANNEL && a->centerfreq != b->centerfreq) {
+        return false;
+    }
+    const input_t* wideband = subband_wideband_input(a);
+    const input_t* parsed_wideband = subband_wideband_input(b);
+    if (wideband != NULL && (wideband->centerfreq != parsed_wideband->centerfreq || wideband->sample_rate != parsed_wideband->sample_rate)) {
+        return false;
+    }
+    return true;
+}
+
+static void reload_device(int i, device_t* dev, device_t* parsed, reload_stats_t* stats) {
+    dev->restart = parsed->restart;
+    if (dev->input->state != INPUT_RUNNING) {
+        return;  // down or being restarted, reload again once it is back
+    }
+    if (!same_input(dev, parsed) || (dev->discovery == NULL) != (parsed->discovery == NULL)) {
+        log(LOG_WARNING, "Device #%d: input or mode settings have changed, restart to apply them\n", i);
+        return;
+    }
+
+    // match the configured channels by frequency, discovery slots are left alone
+    const int channel_count = dev->discovery != NULL ? dev->discovery->first_slot : dev->channel_count;
+    const int parsed_count = parsed->discovery != NULL ? parsed->discovery->first_slot : parsed->channel_count;
+    vector<int> match(parsed_count, -1);
+    vector<bool> kept(channel_count, false);
+    bool unchanged = (channel_count == parsed_count);
+    for (int j = 0; j < parsed_count; j++) {
+        for (int k = 0; k < channel_count && match[j] < 0; k++) {
+            if (!kept[k] && same_frequencies(dev->channels + k, parsed->channels + j)) {
+                match[j] = k;
+                kept[k] = true;
+            }
+        }
+        unchanged = unchanged && match[j] == j;
+    }
+
+    if (unchanged) {
+        for (int j = 0; j < channel_count; j++) {
+            update_channel(dev->channels + j, parsed->channels + j, stats);
+        }
+    } else if (dev->mode == R_SCAN || dev->discovery != NULL) {
+        // the scan controller and the discovery slots index the channel list
+        log(LOG_WARNING, "Device #%d: channels have changed, restart to apply\n", i);
+        return;
+    } else {
+        channel_t* channels = (channel_t*)XCALLOC(parsed_count, sizeof(channel_t));
+        size_t* bins = (size_t*)XCALLOC(parsed_count, sizeof(size_t));
+        size_t* base_bins = (size_t*)XCALLOC(parsed_count, sizeof(size_t));
+        for (int j = 0; j < parsed_count; j++) {
+            channel_t* channel = channels + j;
+            if (match[j] >= 0) {
+                *channel = dev->channels[match[j]];
+                bins[j] = dev->bins[match[j]];  // keeps the AFC correction
+                base_bins[j] = dev->base_bins[match[j]];
+                update_channel(channel, parsed->channels + j, stats);
+            } else {
+                *channel = parsed->channels[j];
+                parsed->channels[j].freqlist = NULL;  // taken over, see release_parsed_channel()
+                bins[j] = parsed->bins[j];
+                base_bins[j] = parsed->base_bins[j];
+                for (int o = 0; o < channel->output_count; o++) {
+                    start_output(channel, channel->outputs + o);
+                }
+                log(LOG_INFO, "Device #%d: added channel %.3f MHz\n", i, channel->freqlist[0].frequency / 1000000.0);
+                stats->channels_added++;
+            }
+        }
+        for (int k = 0; k < channel_count; k++) {
+            if (!kept[k]) {
+                channel_t* channel = dev->channels + k;
+                for (int o = 0; o < channel->output_count; o++) {
+                    stop_output(channel->outputs + o);
+                }
+                log(LOG_INFO, "Device #%d: removed channel %.3f MHz\n", i, channel->freqlist[0].frequency / 1000000.0);
+                stats->channels_removed++;
+            }
+        }
+        free(dev->channels);
+        free(dev->bins);
+        free(dev->base_bins);
+        dev->channels = channels;
+        dev->bins = bins;
+        dev->base_bins = base_bins;
+        dev->channel_count = parsed_count;
+    }
+
+    if (!unchanged || (dev->dense == NULL) != (parsed->dense == NULL)) {
+        delete dev->dense;
+        dev->dense = (parsed->dense != NULL ? new DenseBinReader(dev->base_bins, dev->channel_count) : NULL);
+    }
+}
+
+static void reload_mixers(mixer_t* parsed_mixers, int parsed_count, reload_stats_t* stats) {
+    vector<bool> kept(mixer_count, false);
+    for (int m = 0; m < parsed_count; m++) {
+        mixer_t* parsed = parsed_mixers + m;
+        mixer_t* mixer = getmixerbyname(parsed->name);
+        if (mixer == NULL) {
+            log(LOG_WARNING, "Mixer %s: new mixers are set up on restart\n", parsed->name);
+            continue;
+        }
+        kept[mixer - mixers] = true;
+        if (!mixer->enabled) {
+            continue;
+        }
+        if (mixer->channel.mode != parsed->channel.mode) {
+            log(LOG_WARNING, "Mixer %s: switching between mono and stereo requires a restart\n", mixer->name);
+            continue;
+        }
+        update_outputs(&mixer->channel, &parsed->channel, stats);
+    }
+    for (int m = 0; m < mixer_count; m++) {
+        if (!kept[m] && mixers[m].enabled) {
+            log(LOG_INFO, "Mixer %s removed from the configuration, disabling it\n", mixers[m].name);
+            mixer_disable(mixers + m);
+        }
+    }
+}
+
+// Free a parsed channel which no running device has taken over, the taken ones are left with a NULL freqlist
+static void release_parsed_channel(channel_t* channel) {
+    if (channel->freqlist == NULL) {
+        return;
+    }
+    // Squelch has no destructor (its copies share the history buffer), that one is left behind
+    for (int f = 0; f < channel->freq_count; f++) {
+        free(channel->freqlist[f].label);
+        channel->freqlist[f].~freq_t();
+    }
+    free(channel->freqlist);
+    for (int o = 0; o < channel->output_count; o++) {
+        free_output_data(channel->outputs + o);
+    }
+    free(channel->outputs);
+    for (int w = 0; w < channel->scan_window_count; w++) {
+        free(channel->scan_windows[w].freqs);
+    }
+    free(channel->scan_windows);
+    free(channel->lanes);  // they share the freqlist of the channel
+    free(channel->lane_bins);
+    free(channel->lane_base_bins);
+}
+
+static void release_parsed_spectrum(spectrum_t* spectrum) {
+    if (spectrum == NULL) {
+        return;
+    }
+    free(const_cast<char*>(spectrum->path));
+    free(const_cast<char*>(spectrum->dest_address));
+    free(const_cast<char*>(spectrum->dest_port));
+    free(spectrum);
+}
+
+/*
+ * Free what the parser has allocated for a device, its input is never started.
+ * The strings the input drivers copy into their dev_data are left behind, the
+ * drivers have no way to free them.
+ */
+static void release_parsed_device(device_t* parsed) {
+    if (subband_wideband_input(parsed->input) != NULL) {
+        subband_input_free(parsed->input);
+    } else {
+        free(parsed->input->buffer);
+        free(parsed->input->dev_data);
+        free(parsed->input);
+    }
+    for (int j = 0; j < parsed->channel_count; j++) {
+        release_parsed_channel(parsed->channels + j);
+    }
+    free(parsed->channels);
+    free(parsed->bins);
+    free(parsed->base_bins);
+    delete parsed->dense;
+    release_parsed_spectrum(parsed->spectrum);
+    if (parsed->discovery != NULL) {
+        delete parsed->discovery->tracker;
+        free(parsed->discovery->active_counters);
+        free(parsed->discovery->last_activity);
+        free(parsed->discovery);
+    }
+}
+
+/*
+ * The readers stand back while a writer is waiting for the lock, otherwise
+ * they would hold it off indefinitely. None of them keeps it for long (the
+ * icecast connections are made outside of it), so the writer gets it as soon
+ * as the current readers are done.
+ */
+void config_write_lock(void) {
+    atomic_inc(&reload_waiting);  // the reloads and the control socket may both be waiting
+    while (pthread_rwlock_trywrlock(&config_lock) != 0) {
+        SLEEP(1);
+    }
+    atomic_dec(&reload_waiting);
+}
+
+void reload_config(const char* cfgfile) {
+    log(LOG_NOTICE, "Reloading configuration from %s\n", cfgfile);
+    Config config;
+    try {
+        config.readFile(cfgfile);
+    } catch (const FileIOException& e) {
+        log(LOG_ERR, "Cannot read configuration file %s, keeping the running configuration\n", cfgfile);
+        return;
+    } catch (const ParseException& e) {
+        log(LOG_ERR, "Error while parsing configuration file %s line %d: %s, keeping the running configuration\n", cfgfile, e.getLine(), e.getError());
+        return;
+    }
+
+    config_write_lock();
+
+    // the parser fills in the globals, point them at new arrays while it runs and collect its messages
+    device_t* running_devices = devices;
+    int running_device_count = device_count;
+    mixer_t* running_mixers = mixers;
+    int running_mixer_count = mixer_count;
+    devices = NULL;
+    mixers = NULL;
+    device_count = mixer_count = 0;
+
+    ostringstream messages;
+    collect_config_errors(&messages);
+    recoverable_errors(true);
+    bool parsed = false;
+    try {
+        Setting& root = config.getRoot();
+        if (root.exists("mixers")) {
+            Setting& mx = config.lookup("mixers");
+            mixers = (mixer_t*)XCALLOC(mx.getLength() + 1, sizeof(struct mixer_t));
+            mixer_count = parse_mixers(mx);
+        }
+        Setting& devs = config.lookup("devices");
+        devices = (device_t*)XCALLOC(count_devices(devs) + 1, sizeof(device_t));
+        device_count = parse_devices(devs);
+        parsed = true;
+    } catch (const RecoverableError& e) {
+        // error() has already described it
+    } catch (const SettingNotFoundException& e) {
+        messages << "Configuration error: mandatory parameter missing: " << e.getPath() << "\n";
+    } catch (const SettingTypeException& e) {
+        messages << "Configuration error: invalid parameter type: " << e.getPath() << "\n";
+    } catch (const ConfigException& e) {
+        messages << "Unhandled config exception\n";
+    }
+    recoverable_errors(false);
+    collect_config_errors(NULL);
+
+    device_t* parsed_devices = devices;
+    int parsed_device_count = device_count;
+    mixer_t* parsed_mixers = mixers;
+    int parsed_mixer_count = mixer_count;
+    devices = running_devices;
+    device_count = running_device_count;
+    mixers = running_mixers;
+    mixer_count = running_mixer_count;
+
+    if (!messages.str().empty()) {
+        log(parsed ? LOG_WARNING : LOG_ERR, "%s", messages.str().c_str());
+    }
+    if (!parsed) {
+        pthread_rwlock_unlock(&config_lock);
+        log(LOG_ERR, "Configuration has errors, keeping the running configuration\n");
+        return;
+    }
+
+    // new channels start from their saved state, the others keep running as they are
+    hold_output_sinks();
+    restore_channel_state(parsed_devices, parsed_device_count);
+    reload_stats_t stats = {0, 0, 0, 0};
+    reload_mixers(parsed_mixers, parsed_mixer_count, &stats);
+    if (parsed_device_count != device_count) {
+        log(LOG_WARNING, "%d devices configured, %d running: devices are added or removed on restart\n", parsed_device_count, device_count);
+    }
+    for (int i = 0; i < min(device_count, parsed_device_count); i++) {
+        reload_device(i, devices + i, parsed_devices + i, &stats);
+    }
+    for (int i = 0; i < parsed_device_count; i++) {
+        release_parsed_device(parsed_devices + i);
+    }
+    free(parsed_devices);
+    // mixer outputs which failed to connect still point at the parsed mixers, so these stay allocated, minus their outputs
+    for (int m = 0; m < parsed_mixer_count; m++) {
+        parsed_mixers[m].channel.output_count = 0;
+    }
+    release_output_sinks();
+    pthread_rwlock_unlock(&config_lock);
+
+    log(LOG_NOTICE, "Configuration reloaded: %d channel(s) added, %d removed, %d output(s) added, %d removed\n", stats.channels_added, stats.channels_removed, stats.outputs_added,
+        stats.outputs_removed);
+}
@@ -26,12 +26,8 @@
 
 // From this point we may safely assume that WITH_BCM_VC implies __arm__
 
-#ifdef WITH_BCM_VC
-#include "hello_fft/gpu_fft.h"
-#include "hello_fft/mailbox.h"
-#endif /* WITH_BCM_VC */
-
 #include <fcntl.h>
+#include <getopt.h>  // getopt_long
 #include <lame/lame.h>
 #include <ogg/ogg.h>
 #include <pthread.h>
@@ -56,11 +52,16 @@
 #include <ctime>
 #include <iostream>
 #include <libconfig.h++>
+#include "carrier_discovery.h"
+#include "dense_bins.h"
+#include "fft_engine.h"
 #include "file_upload.h"
 #include "input-common.h"
 #include "logging.h"
 #include "rtl_airband.h"
+#include "scan_planner.h"
 #include "squelch.h"
+#include "thread_sched.h"
 
 #ifdef WITH_PROFILING
 #include "gperftools/profiler.h"
@@ -72,17 +73,24 @@ using namespace libconfig;
 device_t* devices;
 mixer_t* mixers;
 int device_count, mixer_count;
-static int devices_running = 0;
 int tui = 0;  // do not display textual user interface
 int shout_metadata_delay = 3;
 volatile int do_exit = 0;
+volatile int do_reload = 0;
 bool use_localtime = false;
 bool multiple_demod_threads = false;
 bool multiple_output_threads = false;
 bool log_scan_activity = false;
 char* stats_filepath = NULL;
+char* state_filepath = NULL;
+char* control_path = NULL;
 size_t fft_size_log = DEFAULT_FFT_SIZE_LOG;
 size_t fft_size = 1 << fft_size_log;
+size_t fft_batch = 0;
+string fft_engine_name;
+Governor* governor = NULL;
+volatile bool governor_shed[SHED_ACTION_COUNT];
+size_t governor_shed_count[SHED_ACTION_COUNT];
 
 #ifdef NFM
 float alpha = exp(-1.0f / (WAVE_RATE * 2e-4));
@@ -99,43 +107,320 @@ void sighandler(int sig) {
     do_exit = 1;
 }
 
+void reload_handler(int) {
+    do_reload = 1;
+}
+
+/*
+ * Mark the device as retuned. Samples already in the input buffer (and the
+ * ones arriving during the settle time) belong to the previous center frequency
+ * and are discarded by the demodulator, which then points every channel in
+ * SCAN_SETTLING state at its new frequency and probes it.
+ * Must be called with dev->input->buffer_lock held.
+ */
+static void scan_mark_retuned(device_t* dev, bool retuned) {
+    if (retuned) {
+        // all bins move with the center frequency
+        for (int j = 0; j < dev->channel_count; j++) {
+            if (dev->channels[j].scan_state != SCAN_PARKED) {
+                dev->channels[j].scan_state = SCAN_SETTLING;
+            }
+        }
+        dev->retune_sample = dev->input->samples_written + dev->scan_settle_samples;
+    } else if (dev->retune_sample < dev->input->samples_written) {
+        dev->retune_sample = dev->input->samples_written;
+    }
+    dev->retune_settling = true;
+}
+
+// Combined scan state of a channel - for wideband scanning, of all lanes monitoring the current window
+static enum scan_states scan_channel_state(device_t* dev, channel_t* channel) {
+    pthread_mutex_lock(&dev->input->buffer_lock);
+    enum scan_states state = channel->scan_state;
+    pthread_mutex_unlock(&dev->input->buffer_lock);
+    if (state == SCAN_SETTLING || state == SCAN_PARKED || channel->lane_count == 0) {
+        return state;
+    }
+    state = SCAN_IDLE;
+    for (int k = 0; k < channel->lanes_used; k++) {
+        if (channel->lanes[k].scan_state == SCAN_PROBING) {
+            return SCAN_PROBING;
+        } else if (channel->lanes[k].scan_state == SCAN_ACTIVE) {
+            state = SCAN_ACTIVE;
+        }
+    }
+    return state;
+}
+
+// Scan priority of a step, that is of a frequency or a wideband window
+static void scan_step_priority(channel_t* channel, int step, int* priority, double* revisit_interval) {
+    int count = 1;
+    int* freqs = &step;
+    if (channel->lane_count > 0) {
+        count = channel->scan_windows[step].freq_count;
+        freqs = channel->scan_windows[step].freqs;
+    }
+    *priority = 0;
+    *revisit_interval = 0.0;
+    for (int k = 0; k < count; k++) {
+        freq_t* fparms = channel->freqlist + freqs[k];
+        if (fparms->priority == 0) {
+            continue;
+        }
+        double interval = fparms->revisit_interval / 1000.0;
+        if (*priority == 0 || interval < *revisit_interval) {
+            *revisit_interval = interval;
+        }
+        *priority = std::max(*priority, fparms->priority);
+    }
+}
+
+// Update revisit latency of all frequencies monitored in the given step
+static void scan_record_visit(channel_t* channel, int step, const timeval* tv) {
+    int count = 1;
+    int* freqs = &step;
+    if (channel->lane_count > 0) {
+        count = channel->scan_windows[step].freq_count;
+        freqs = channel->scan_windows[step].freqs;
+    }
+    for (int k = 0; k < count; k++) {
+        freq_t* fparms = channel->freqlist + freqs[k];
+        if (fparms->last_visit.tv_sec != 0) {
+            fparms->revisit_latency = delta_sec(&fparms->last_visit, tv);
+            fparms->revisit_latency_max = std::max(fparms->revisit_latency_max, fparms->revisit_latency);
+        }
+        fparms->last_visit = *tv;
+    }
+}
+
+// Step of a channel monitoring the given frequency, for wideband scanning the first window containing it
+static int scan_freq_step(channel_t* channel, int freq_idx) {
+    for (int w = 0; w < channel->scan_window_count && channel->lane_count > 0; w++) {
+        for (int k = 0; k < channel->scan_windows[w].freq_count; k++) {
+            if (channel->scan_windows[w].freqs[k] == freq_idx) {
+                return w;
+            }
+        }
+    }
+    return freq_idx;
+}
+
+// Controller state of a single scan channel
+struct scan_control_t {
+    channel_t* channel;
+    ScanScheduler* scheduler;
+    int step_count;
+    int pending;  // step waiting for a time slice, -1 if none
+    int active_freq;
+    bool probed, activity;
+    struct timeval probe_done, last_activity, sweep_start, wait_since;
+};
+
+// Frequency monitored (or about to be monitored) by a narrowband scan channel
+static int scan_current_freq(channel_t* channel) {
+    return channel->freqlist[channel->scan_next_freq].frequency;
+}
+
+static bool scan_waited_longer(const scan_control_t* a, const scan_control_t* b) {
+    return timercmp(&a->wait_since, &b->wait_since, <);
+}
+
+/*
+ * Hop the channels which are done with their current step. The center frequency
+ * has to cover the fixed channels and the scan channels which stay where they
+ * are, and as many of the hopping channels as possible, longest waiting first.
+ * The ones which don't fit get their turn later.
+ */
+static void scan_hop(device_t* dev, std::vector<scan_control_t*>& hopping, const timeval* tv) {
+    const int half_span = scan_half_span(dev->input->sample_rate);
+    const int dc_guard = scan_dc_guard(dev->input->sample_rate);
+    int new_centerfreq;
+    std::vector<bool> accepted(hopping.size(), true);
+
+    if (dev->channels[0].lane_count > 0) {
+        // wideband scanning - the device has one channel and the windows are planned in advance
+        new_centerfreq = dev->channels[0].scan_windows[hopping[0]->pending].centerfreq;
+    } else {
+        std::sort(hopping.begin(), hopping.end(), scan_waited_longer);
+        std::vector<int> pinned, wanted;
+        for (int j = 0; j < dev->channel_count; j++) {
+            channel_t* channel = dev->channels + j;
+            bool is_hopping = false;
+            for (size_t h = 0; h < hopping.size(); h++) {
+                is_hopping |= (hopping[h]->channel == channel);
+            }
+            if (!is_hopping && channel->scan_state != SCAN_PARKED) {
+                pinned.push_back(scan_current_freq(channel));
+            }
+        }
+        for (size_t h = 0; h < hopping.size(); h++) {
+            wanted.push_back(hopping[h]->channel->freqlist[hopping[h]->pending].frequency);
+        }
+        if (!plan_centerfreq(pinned, wanted, dev->input->centerfreq, half_span, dc_guard, &new_centerfreq, &accepted)) {
+            return;
+        }
+    }
+
+    const bool retune = (new_centerfreq != dev->input->centerfreq);
+    if (retune) {
+        if (input_set_centerfreq(dev->input, new_centerfreq) < 0) {
+            return;  // the input has failed, the steps stay pending until it is restarted
+        }
+        dev->scan_retune_count++;
+    }
+
+    bool changed = retune;
+    pthread_mutex_lock(&dev->input->buffer_lock);
+    for (size_t h = 0; h < hopping.size(); h++) {
+        scan_control_t* ctl = hopping[h];
+        channel_t* channel = ctl->channel;
+        if (accepted[h]) {
+            changed = true;
+            scan_record_visit(channel, ctl->pending, tv);
+            if (channel->lane_count > 0) {
+                channel->scan_window = ctl->pending;
+            } else {
+                channel->scan_next_freq = ctl->pending;
+            }
+            channel->scan_state = SCAN_SETTLING;
+            ctl->pending = -1;
+            ctl->active_freq = -1;
+            ctl->probed = ctl->activity = false;
+        } else if (retune && channel->scan_state != SCAN_PARKED) {
+            const int offset = abs(scan_current_freq(channel) - new_centerfreq);
+            if (offset > half_span || offset < dc_guard) {
+                channel->scan_state = SCAN_PARKED;
+            }
+        }
+    }
+    if (changed) {
+        scan_mark_retuned(dev, retune);
+    }
+    pthread_mutex_unlock(&dev->input->buffer_lock);
+}
+
+// Called by supervise_devices() with config_lock held for writing, the restarted input is back on its last center frequency
+void scan_resume(device_t* dev) {
+    pthread_mutex_lock(&dev->input->buffer_lock);
+    scan_mark_retuned(dev, true);
+    pthread_mutex_unlock(&dev->input->buffer_lock);
+}
+
 void* controller_thread(void* params) {
     device_t* dev = (device_t*)params;
-    int i = 0;
-    int consecutive_squelch_off = 0;
-    int new_centerfreq = 0;
+    std::vector<scan_control_t> controls;
+    std::vector<scan_control_t*> hopping;
     struct timeval tv;
 
-    if (dev->channels[0].freq_count < 2)
+    thread_sched_apply(THREAD_CONTROLLER);
+    gettimeofday(&tv, NULL);
+    for (int j = 0; j < dev->channel_count; j++) {
+        channel_t* channel = dev->channels + j;
+        if (channel->freq_count < 2) {
+            continue;  // fixed frequency
+        }
+        scan_control_t ctl;
+        ctl.channel = channel;
+        // wideband scanning steps through windows of frequencies, otherwise through single frequencies
+        ctl.step_count = (channel->lane_count > 0 ? channel->scan_window_count : channel->freq_count);
+        std::vector<int> priorities(ctl.step_count);
+        std::vector<double> revisit_intervals(ctl.step_count);
+        for (int s = 0; s < ctl.step_count; s++) {
+            scan_step_priority(channel, s, &priorities[s], &revisit_intervals[s]);
+        }
+        ctl.scheduler = new ScanScheduler(priorities, revisit_intervals, tv.tv_sec + tv.tv_usec / 1000000.0);
+        ctl.active_freq = -1;
+        ctl.probed = ctl.activity = false;
+        ctl.sweep_start = ctl.wait_since = tv;
+        // channels whose first frequency didn't fit in the initial span wait for it
+        ctl.pending = (channel->scan_state == SCAN_PARKED ? 0 : -1);
+        if (ctl.pending < 0) {
+            scan_record_visit(channel, 0, &tv);
+        }
+        controls.push_back(ctl);
+    }
+    // point all channels at their initial frequencies
+    pthread_mutex_lock(&dev->input->buffer_lock);
+    scan_mark_retuned(dev, true);
+    pthread_mutex_unlock(&dev->input->buffer_lock);
+    if (controls.empty())
         return 0;
+
     while (!do_exit) {
-        SLEEP(200);
-        if (dev->channels[0].axcindicate == NO_SIGNAL) {
-            if (consecutive_squelch_off < 10) {
-                consecutive_squelch_off++;
-            } else {
-                i++;
-                i %= dev->channels[0].freq_count;
-                dev->channels[0].freq_idx = i;
-                new_centerfreq = dev->channels[0].freqlist[i].frequency + 20 * (double)(dev->input->sample_rate / fft_size);
-                if (input_set_centerfreq(dev->input, new_centerfreq) < 0) {
-                    break;
+        SLEEP(SCAN_POLL_INTERVAL);
+        ConfigReadLock config_read_lock;
+        if (dev->down || dev->input->state != INPUT_RUNNING) {
+            continue;  // can't be retuned until supervise_devices() has restarted it
+        }
+        gettimeofday(&tv, NULL);
+        hopping.clear();
+        for (size_t c = 0; c < controls.size(); c++) {
+            scan_control_t* ctl = &controls[c];
+            channel_t* channel = ctl->channel;
+            enum scan_states state = scan_channel_state(dev, channel);
+            if (state == SCAN_SETTLING || state == SCAN_PROBING) {
+                continue;
+            }
+            if (channel->scan_force >= 0) {
+                // jump requested over the control socket, ahead of the channels waiting for their turn
+                ctl->pending = scan_freq_step(channel, channel->scan_force);
+                channel->scan_force = -1;
+                timerclear(&ctl->wait_since);
+                hopping.push_back(ctl);
+                continue;
+            }
+            if (channel->scan_hold && ctl->pending < 0 && state != SCAN_PARKED) {
+                continue;
+            }
+            if (state != SCAN_PARKED) {
+                if (!ctl->probed) {
+                    ctl->probed = true;
+                    ctl->probe_done = tv;
+                }
+                if (channel->axcindicate != NO_SIGNAL) {
+                    ctl->activity = true;
+                    ctl->last_activity = tv;
+                    if (channel->freq_idx != ctl->active_freq) {
+                        ctl->active_freq = channel->freq_idx;
+                        if (log_scan_activity)
+                            log(LOG_INFO, "Activity on %7.3f MHz\n", channel->freqlist[ctl->active_freq].frequency / 1000000.0);
+                        if (channel == dev->channels && ctl->active_freq != dev->last_frequency) {
+                            // squelch has just opened on a new frequency - we might need to update outputs' metadata
+                            tag_queue_put(dev, ctl->active_freq, tv);
+                            dev->last_frequency = ctl->active_freq;
+                        }
+                    }
+                    continue;
+                }
+                if (ctl->step_count < 2) {
+                    continue;
+                }
+                // stay for hang time after activity, or give the squelch a chance to open when there is a carrier
+                if (ctl->activity && delta_sec(&ctl->last_activity, &tv) * 1000.0 < dev->scan_hang_time) {
+                    continue;
+                } else if (!ctl->activity && state == SCAN_ACTIVE && delta_sec(&ctl->probe_done, &tv) * 1000.0 < SCAN_CONFIRM_TIME) {
+                    continue;
                 }
             }
-        } else {
-            if (consecutive_squelch_off == 10) {
-                if (log_scan_activity)
-                    log(LOG_INFO, "Activity on %7.3f MHz\n", dev->channels[0].freqlist[i].frequency / 1000000.0);
-                if (i != dev->last_frequency) {
-                    // squelch has just opened on a new frequency - we might need to update outputs' metadata
-                    gettimeofday(&tv, NULL);
-                    tag_queue_put(dev, i, tv);
-                    dev->last_frequency = i;
+            if (ctl->pending < 0) {
+                bool sweep_done;
+                ctl->pending = ctl->scheduler->next(tv.tv_sec + tv.tv_usec / 1000000.0, &sweep_done);
+                ctl->wait_since = tv;
+                if (sweep_done) {
+                    channel->scan_sweep_count++;
+                    channel->scan_sweep_duration = delta_sec(&ctl->sweep_start, &tv);
+                    ctl->sweep_start = tv;
                 }
             }
-            consecutive_squelch_off = 0;
+            hopping.push_back(ctl);
+        }
+        if (!hopping.empty()) {
+            scan_hop(dev, hopping, &tv);
         }
     }
+    for (size_t c = 0; c < controls.size(); c++) {
+        delete controls[c].scheduler;
+    }
     return 0;
 }
 
@@ -181,18 +466,10 @@ float fm_quadri_demod(float ar, float aj, float br, float bj) {
 class AFC {
     const status _prev_axcindicate;
 
-#ifdef WITH_BCM_VC
-    float square(const GPU_FFT_COMPLEX* fft_results, size_t index) {
-        return fft_results[index].re * fft_results[index].re + fft_results[index].im * fft_results[index].im;
-    }
-#else
-    float square(const fftwf_complex* fft_results, size_t index) {
-        return fft_results[index][0] * fft_results[index][0] + fft_results[index][1] * fft_results[index][1];
-    }
-#endif /* WITH_BCM_VC */
+    float square(const float* fft_results, size_t index) { return fft_results[2 * index] * fft_results[2 * index] + fft_results[2 * index + 1] * fft_results[2 * index + 1]; }
 
-    template <class FFT_RESULTS, int STEP>
-    size_t check(const FFT_RESULTS* fft_results, const size_t base, const float base_value, unsigned char afc) {
+    template <int STEP>
+    size_t check(const float* fft_results, const size_t base, const float base_value, unsigned char afc) {
         float threshold = 0;
         size_t bin;
         for (bin = base;; bin += STEP) {
@@ -220,34 +497,32 @@ class AFC {
     }
 
    public:
-    AFC(device_t* dev, int index) : _prev_axcindicate(dev->channels[index].axcindicate) {}
+    AFC(const channel_t* channel) : _prev_axcindicate(channel->axcindicate) {}
 
-    template <class FFT_RESULTS>
-    void finalize(device_t* dev, int index, const FFT_RESULTS* fft_results) {
-        channel_t* channel = &dev->channels[index];
+    void finalize(channel_t* channel, size_t& channel_bin, const size_t base, const float* fft_results) {
         if (channel->afc == 0)
             return;
 
         const char axcindicate = channel->axcindicate;
-        if (axcindicate != NO_SIGNAL && _prev_axcindicate == NO_SIGNAL) {
-            const size_t base = dev->base_bins[index];
+        // while AFC is shed, corrections made before still return to the base bin when the signal ends
+        if (axcindicate != NO_SIGNAL && _prev_axcindicate == NO_SIGNAL && !governor_shed[SHED_AFC]) {
             const float base_value = square(fft_results, base);
-            size_t bin = check<FFT_RESULTS, -1>(fft_results, base, base_value, channel->afc);
+            size_t bin = check<-1>(fft_results, base, base_value, channel->afc);
             if (bin == base)
-                bin = check<FFT_RESULTS, 1>(fft_results, base, base_value, channel->afc);
+                bin = check<1>(fft_results, base, base_value, channel->afc);
 
-            if (dev->bins[index] != bin) {
+            if (channel_bin != bin) {
 #ifdef AFC_LOGGING
-                log(LOG_INFO, "AFC device=%d channel=%d: base=%zu prev=%zu now=%zu\n", dev->device, index, base, dev->bins[index], bin);
+                log(LOG_INFO, "AFC freq=%d: base=%zu prev=%zu now=%zu\n", channel->freqlist[channel->freq_idx].frequency, base, channel_bin, bin);
 #endif /* AFC_LOGGING */
-                dev->bins[index] = bin;
+                channel_bin = bin;
                 if (bin > base)
                     channel->axcindicate = AFC_UP;
                 else if (bin < base)
                     channel->axcindicate = AFC_DOWN;
             }
         } else if (axcindicate == NO_SIGNAL && _prev_axcindicate != NO_SIGNAL)
-            dev->bins[index] = dev->base_bins[index];
+            channel_bin = base;
     }
 };
 
@@ -259,33 +534,12 @@ void init_demod(demod_params_t* params, Signal* signal, int device_start, int de
     params->device_start = device_start;
     params->device_end = device_end;
 
-#ifndef WITH_BCM_VC
-    params->fftin = fftwf_alloc_complex(fft_size);
-    params->fftout = fftwf_alloc_complex(fft_size);
-    params->fft = fftwf_plan_dft_1d(fft_size, params->fftin, params->fftout, FFTW_FORWARD, FFTW_MEASURE);
-#endif /* WITH_BCM_VC */
-}
-
-bool init_output(channel_t* channel, output_t* output) {
-    if (output->has_mp3_output) {
-        output->lame = airlame_init(channel->mode, channel->highpass, channel->lowpass);
-        output->lamebuf = (unsigned char*)malloc(sizeof(unsigned char) * LAMEBUF_SIZE);
-    }
-    if (output->type == O_ICECAST) {
-        shout_setup((icecast_data*)(output->data), channel->mode);
-    } else if (output->type == O_UDP_STREAM) {
-        udp_stream_data* sdata = (udp_stream_data*)(output->data);
-        if (!udp_stream_init(sdata, channel->mode, (size_t)WAVE_BATCH * sizeof(float))) {
-            return false;
-        }
-#ifdef WITH_PULSEAUDIO
-    } else if (output->type == O_PULSE) {
-        pulse_init();
-        pulse_setup((pulse_data*)(output->data), channel->mode);
-#endif /* WITH_PULSEAUDIO */
+    // FFTW planning is not thread safe, so the engines are set up here and not in the demod threads
+    params->fft = fft_engine_new(fft_engine_name, fft_size_log, fft_batch);
+    if (params->fft == NULL) {
+        log(LOG_CRIT, "Failed to set up the %s FFT engine\n", fft_engine_name.c_str());
+        error();
     }
-
-    return true;
 }
 
 void init_output_params(output_params_t* params, int device_start, int device_end, int mixer_start, int mixer_end) {
@@ -306,35 +560,434 @@ int next_device(demod_params_t* params, int current) {
     return params->device_start;
 }
 
+// Point the lanes of a wideband scan channel at the frequencies of its current window
+static void scan_apply_window(device_t* dev, channel_t* channel) {
+    scan_window_t* window = channel->scan_windows + channel->scan_window;
+    for (int k = 0; k < window->freq_count; k++) {
+        channel_t* lane = channel->lanes + k;
+        const int freq = channel->freqlist[window->freqs[k]].frequency;
+        lane->freq_idx = window->freqs[k];
+        channel->lane_bins[k] = channel->lane_base_bins[k] = freq_to_bin(freq, window->centerfreq, dev->input->sample_rate);
+        if (lane->needs_raw_iq) {
+            lane->dm_dphi = downmix_dphi(freq, window->centerfreq, dev->input->sample_rate);
+            lane->dm_phi = 0;
+        }
+        lane->scan_probe_sum = 0.0f;
+        lane->scan_probe_count = 0;
+        lane->scan_state = SCAN_PROBING;
+    }
+    channel->lanes_used = window->freq_count;
+    channel->lane_selected = 0;
+}
+
+// Called with dev->input->buffer_lock held, once the retuned frequency delivers valid samples
+static void scan_start_probes(device_t* dev) {
+    for (int i = 0; i < dev->channel_count; i++) {
+        channel_t* channel = dev->channels + i;
+        if (channel->scan_state == SCAN_SETTLING) {
+            if (channel->lane_count > 0) {
+                scan_apply_window(dev, channel);
+            } else {
+                const int freq = channel->freqlist[channel->scan_next_freq].frequency;
+                channel->freq_idx = channel->scan_next_freq;
+                dev->bins[i] = dev->base_bins[i] = freq_to_bin(freq, dev->input->centerfreq, dev->input->sample_rate);
+                if (channel->needs_raw_iq) {
+                    channel->dm_dphi = downmix_dphi(freq, dev->input->centerfreq, dev->input->sample_rate);
+                    channel->dm_phi = 0;
+                }
+            }
+            channel->scan_probe_sum = 0.0f;
+            channel->scan_probe_count = 0;
+            channel->scan_state = SCAN_PROBING;
+        }
+    }
+}
+
+// Quick carrier check - compare the average level of the first few samples against the squelch level
+static inline void scan_probe(device_t* dev, channel_t* channel, float level) {
+    channel->scan_probe_sum += level;
+    if (++channel->scan_probe_count < dev->scan_probe_len) {
+        return;
+    }
+    freq_t* fparms = channel->freqlist + channel->freq_idx;
+    channel->scan_state = (channel->scan_probe_sum / channel->scan_probe_count >= fparms->squelch.squelch_level()) ? SCAN_ACTIVE : SCAN_IDLE;
+}
+
+// Append fft_batch samples of the given bin to the channel waveform (and raw I/Q, if needed)
+static inline void read_bin(device_t* dev, channel_t* channel, size_t bin, const FftEngine* fft) {
+    float* wavein = channel->wavein + dev->waveend;
+    __builtin_prefetch(wavein, 1);
+    for (size_t b = 0; b < fft_batch; b++) {
+        const float* v = fft->output(b) + 2 * bin;
+        wavein[b] = sqrtf(v[0] * v[0] + v[1] * v[1]);
+    }
+    if (channel->scan_state == SCAN_PROBING) {
+        for (size_t b = 0; b < fft_batch; b++)
+            scan_probe(dev, channel, wavein[b]);
+    }
+    if (channel->needs_raw_iq) {
+        for (size_t b = 0; b < fft_batch; b++) {
+            const float* v = fft->output(b) + 2 * bin;
+            channel->iq_in[2 * (dev->waveend + b)] = v[0];
+            channel->iq_in[2 * (dev->waveend + b) + 1] = v[1];
+        }
+    }
+}
+
+// Point a discovery slot at a new frequency, or park it if freq is 0
+static void discovery_assign_slot(device_t* dev, int slot, int freq, const timeval* tv) {
+    discovery_t* discovery = dev->discovery;
+    const int i = discovery->first_slot + slot;
+    channel_t* channel = dev->channels + i;
+    if (freq == 0) {
+        channel->scan_state = SCAN_PARKED;
+        discovery->slots_used--;
+        return;
+    }
+    channel->freqlist[0].frequency = freq;
+    channel->freqlist[0].agcavgfast = 0.5f;
+    dev->bins[i] = dev->base_bins[i] = freq_to_bin(freq, dev->input->centerfreq, dev->input->sample_rate);
+    if (channel->needs_raw_iq) {
+        channel->dm_dphi = downmix_dphi(freq, dev->input->centerfreq, dev->input->sample_rate);
+        channel->dm_phi = 0;
+    }
+    discovery->active_counters[slot] = channel->freqlist[0].active_counter;
+    discovery->last_activity[slot] = *tv;
+    discovery->slots_used++;
+    channel->scan_state = SCAN_IDLE;
+}
+
+/*
+ * Look for new carriers in the last spectrum frame and allocate free slots to
+ * them, release slots which had no squelch activity for idle_timeout seconds.
+ */
+static void discovery_update(device_t* dev, int device_num) {
+    discovery_t* discovery = dev->discovery;
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+
+    for (int k = 0; k < discovery->slot_count; k++) {
+        channel_t* channel = dev->channels + discovery->first_slot + k;
+        if (channel->scan_state == SCAN_PARKED) {
+            continue;
+        }
+        if (channel->freqlist[0].active_counter != discovery->active_counters[k]) {
+            discovery->active_counters[k] = channel->freqlist[0].active_counter;
+            discovery->last_activity[k] = tv;
+        } else if (delta_sec(&discovery->last_activity[k], &tv) > discovery->idle_timeout) {
+            log(LOG_INFO, "Device %d: releasing channel on %.3f MHz after %d seconds of inactivity\n", device_num, channel->freqlist[0].frequency / 1000000.0, discovery->idle_timeout);
+            discovery_assign_slot(dev, k, 0, &tv);
+        }
+    }
+
+    const spectrum_t* spectrum = dev->spectrum;
+    const float* levels = spectrum_levels(spectrum);
+    std::vector<int> carriers = find_carriers(std::vector<float>(levels, levels + spectrum->bin_count), spectrum->centerfreq, dev->input->sample_rate, discovery->threshold, discovery->raster,
+                                              scan_half_span(dev->input->sample_rate), scan_dc_guard(dev->input->sample_rate));
+    std::vector<int> confirmed = discovery->tracker->update(carriers);
+
+    // carriers closer than half a channel (or one FFT bin) to a monitored frequency are already covered
+    const double min_distance = std::max(discovery->raster / 2.0, (double)dev->input->sample_rate / fft_size);
+    for (size_t c = 0; c < confirmed.size() && discovery->slots_used < discovery->slot_count; c++) {
+        bool covered = false;
+        for (int j = 0; j < dev->channel_count && !covered; j++) {
+            channel_t* channel = dev->channels + j;
+            covered = (channel->scan_state != SCAN_PARKED && abs(channel->freqlist[0].frequency - confirmed[c]) < min_distance);
+        }
+        if (covered) {
+            continue;
+        }
+        for (int k = 0; k < discovery->slot_count; k++) {
+            if (dev->channels[discovery->first_slot + k].scan_state == SCAN_PARKED) {
+                log(LOG_INFO, "Device %d: carrier found on %.3f MHz, allocating a channel\n", device_num, confirmed[c] / 1000000.0);
+                discovery_assign_slot(dev, k, confirmed[c], &tv);
+                break;
+            }
+        }
+    }
+}
+
+// Channel which isn't demodulated: muted over the control socket, or low priority while the governor sheds channels
+static inline bool channel_shed(const channel_t* channel) {
+    return channel->muted || (channel->low_priority && governor_shed[SHED_CHANNELS]);
+}
+
+// Dense mode counterpart of read_bin() for all channels of the device
+static void dense_read_bins(device_t* dev, const FftEngine* fft) {
+    for (int i = 0; i < dev->channel_count; i++) {
+        dev->dense->set_active(i, !channel_shed(dev->channels + i) && dev->channels[i].scan_state != SCAN_PARKED);
+    }
+    for (size_t b = 0; b < fft_batch; b++) {
+        dev->dense->read(fft->output(b), dev->bins);
+        for (int i = 0; i < dev->channel_count; i++) {
+            channel_t* channel = dev->channels + i;
+            if (!dev->dense->active(i)) {
+                continue;
+            }
+            channel->wavein[dev->waveend + b] = dev->dense->level(i);
+            if (channel->needs_raw_iq) {
+                channel->iq_in[2 * (dev->waveend + b)] = dev->dense->re(i);
+                channel->iq_in[2 * (dev->waveend + b) + 1] = dev->dense->im(i);
+            }
+        }
+    }
+}
+
+// Add the power of the first FFT of the batch to the device spectrum
+static void spectrum_add_fft(device_t* dev, int device_num, const float* fft_results) {
+    float* power = spectrum_accumulator(dev->spectrum, dev->input->centerfreq);
+    for (size_t k = 0; k < fft_size; k++)
+        power[k] += fft_results[2 * k] * fft_results[2 * k] + fft_results[2 * k + 1] * fft_results[2 * k + 1];
+    if (spectrum_fft_added(dev->spectrum, dev->input->sample_rate) && dev->discovery != NULL) {
+        discovery_update(dev, device_num);
+    }
+}
+
+// Emit a batch of silent samples in place of the ones discarded during a retune
+static void blank_channel_batch(device_t* dev, channel_t* channel) {
+    memset(channel->wavein + dev->waveend, 0, fft_batch * sizeof(float));
+    if (channel->needs_raw_iq) {
+        memset(channel->iq_in + 2 * dev->waveend, 0, 2 * fft_batch * sizeof(float));
+    }
+}
+
+static void blank_wave_batch(device_t* dev) {
+    for (int i = 0; i < dev->channel_count; i++) {
+        channel_t* channel = dev->channels + i;
+        blank_channel_batch(dev, channel);
+        for (int k = 0; k < channel->lane_count; k++) {
+            blank_channel_batch(dev, channel->lanes + k);
+        }
+    }
+    memset(dev->wave_blank + dev->waveend, 1, fft_batch);
+}
+
+// Silence for a channel which has nothing to listen to, eg. parked outside of the tuned span
+static void silence_channel_batch(channel_t* channel) {
+    memset(channel->waveout + AGC_EXTRA, 0, WAVE_BATCH * sizeof(float));
+    if (channel->has_iq_outputs) {
+        memset(channel->iq_out, 0, 2 * WAVE_BATCH * sizeof(float));
+    }
+    if (channel->has_pre_trigger) {
+        memset(channel->iq_raw, 0, 2 * WAVE_BATCH * sizeof(float));
+    }
+    channel->axcindicate = NO_SIGNAL;
+}
+
+/*
+ * Route the audio of one lane of a wideband scan channel to the channel outputs.
+ * Stay on the selected lane while its squelch is open, otherwise switch to the
+ * first lane which has a signal.
+ */
+static void select_lane(channel_t* channel) {
+    int sel = channel->lane_selected;
+    if (channel->lanes_used == 0) {
+        silence_channel_batch(channel);
+        return;
+    }
+    if (sel >= channel->lanes_used || channel->lanes[sel].axcindicate == NO_SIGNAL) {
+        for (int k = 0; k < channel->lanes_used; k++) {
+            if (channel->lanes[k].axcindicate != NO_SIGNAL) {
+                sel = k;
+                break;
+            }
+        }
+        if (sel >= channel->lanes_used) {
+            sel = 0;
+        }
+    }
+    channel->lane_selected = sel;
+
+    channel_t* lane = channel->lanes + sel;
+    memcpy(channel->waveout + AGC_EXTRA, lane->waveout + AGC_EXTRA, WAVE_BATCH * sizeof(float));
+    if (channel->has_iq_outputs) {
+        memcpy(channel->iq_out, lane->iq_out, 2 * WAVE_BATCH * sizeof(float));
+    }
+    if (channel->has_pre_trigger) {
+        memcpy(channel->iq_raw, lane->iq_raw, 2 * WAVE_BATCH * sizeof(float));
+    }
+    channel->freq_idx = lane->freq_idx;
+    channel->axcindicate = lane->axcindicate;
+
+    // lanes have no outputs, so keep the AGC_EXTRA tail for the next batch here
+    for (int k = 0; k < channel->lanes_used; k++) {
+        memmove(channel->lanes[k].waveout, channel->lanes[k].waveout + WAVE_BATCH, AGC_EXTRA * sizeof(float));
+    }
+}
+
+// Squelch, AGC and demodulation of one batch of channel waveform
+static void demod_channel_batch(device_t* dev, channel_t* channel) {
+    freq_t* fparms = channel->freqlist + channel->freq_idx;
+    fparms->squelch.set_ctcss_reduced(governor_shed[SHED_CTCSS]);
+
+    // set to NO_SIGNAL, will be updated to SIGNAL based on squelch below
+    channel->axcindicate = NO_SIGNAL;
+
+    int j = AGC_EXTRA;
+    if (!channel->has_pre_trigger && fparms->squelch.is_idle() && memchr(dev->wave_blank + AGC_EXTRA, 1, WAVE_BATCH) == NULL) {
+        // Idle fast path - while the squelch is closed and nothing in this batch comes close to opening it,
+        // only the squelch levels need updating. Once it starts opening, the rest of the batch is processed
+        // in full; the AGC_EXTRA samples of wavein history are kept either way for the AGC bootstrap.
+        // Channels keeping a pre-trigger history need all I/Q samples, so they don't take it.
+        float level_max = 0.0f;
+        for (int k = AGC_EXTRA; k < WAVE_BATCH + AGC_EXTRA; k++) {
+            level_max = std::max(level_max, channel->wavein[k]);
+        }
+        if (level_max < fparms->squelch.squelch_level()) {
+            j += fparms->squelch.process_idle_samples(channel->wavein + AGC_EXTRA, WAVE_BATCH);
+            memset(channel->waveout + AGC_EXTRA, 0, (j - AGC_EXTRA) * sizeof(float));
+            if (channel->has_iq_outputs) {
+                memset(channel->iq_out, 0, 2 * (j - AGC_EXTRA) * sizeof(float));
+            }
+        }
+    }
+
+    for (; j < WAVE_BATCH + AGC_EXTRA; j++) {
+        float& real = channel->iq_in[2 * (j - AGC_EXTRA)];
+        float& imag = channel->iq_in[2 * (j - AGC_EXTRA) + 1];
+
+        // samples discarded while retuning carry no signal, keep them out of squelch and AGC
+        if (dev->wave_blank[j]) {
+            channel->waveout[j] = 0;
+            if (channel->has_iq_outputs) {
+                channel->iq_out[2 * (j - AGC_EXTRA)] = 0;
+                channel->iq_out[2 * (j - AGC_EXTRA) + 1] = 0;
+            }
+            continue;
+        }
+
+        fparms->squelch.process_raw_sample(channel->wavein[j]);
+
+        // If squelch is open / opening and using I/Q, then cleanup the signal and possibly update squelch.
+        if (fparms->squelch.should_filter_sample() && channel->needs_raw_iq) {
+            // remove phase rotation introduced by FFT sliding window
+            float swf, cwf, re_tmp, im_tmp;
+            sincosf_lut(channel->dm_phi, &swf, &cwf);
+            multiply(real, imag, cwf, -swf, &re_tmp, &im_tmp);
+            channel->dm_phi += channel->dm_dphi;
+            channel->dm_phi &= 0xffffff;
+
+            // apply lowpass filter, will be a no-op if not configured
+            fparms->lowpass_filter.apply(re_tmp, im_tmp);
+
+            // update I/Q and wave
+            real = re_tmp;
+            imag = im_tmp;
+            channel->wavein[j] = sqrt(real * real + imag * imag);
+
+            // update squelch post-cleanup
+            if (fparms->lowpass_filter.enabled()) {
+                fparms->squelch.process_filtered_sample(channel->wavein[j]);
+            }
+        }
+
+        if (fparms->modulation == MOD_AM) {
+            // if squelch is just opening then bootstrip agcavgfast with prior values of wavein
+            if (fparms->squelch.first_open_sample()) {
+                for (int k = j - AGC_EXTRA; k < j; k++) {
+                    if (channel->wavein[k] >= fparms->squelch.squelch_level()) {
+                        fparms->agcavgfast = fparms->agcavgfast * 0.9f + channel->wavein[k] * 0.1f;
+                    }
+                }
+            }
+            // if squelch is just closing then fade out the prior samples of waveout
+            else if (fparms->squelch.last_open_sample()) {
+                for (int k = j - AGC_EXTRA + 1; k < j; k++) {
+                    channel->waveout[k] = channel->waveout[k - 1] * 0.94f;
+                }
+            }
+        }
+
+        float& waveout = channel->waveout[j];
+
+        // If squelch sees power then do modulation-specific processing
+        if (fparms->squelch.should_process_audio()) {
+            if (fparms->modulation == MOD_AM) {
+                if (channel->wavein[j] > fparms->squelch.squelch_level()) {
+                    fparms->agcavgfast = fparms->agcavgfast * 0.995f + channel->wavein[j] * 0.005f;
+                }
+
+                waveout = (channel->wavein[j - AGC_EXTRA] - fparms->agcavgfast) / (fparms->agcavgfast * 1.5f);
+                if (abs(waveout) > 0.8f) {
+                    waveout *= 0.85f;
+                    fparms->agcavgfast *= 1.15f;
+                }
+            }
+#ifdef NFM
+            else if (fparms->modulation == MOD_NFM) {
+                // FM demod
+                if (fm_demod == FM_FAST_ATAN2) {
+                    waveout = polar_disc_fast(real, imag, channel->pr, channel->pj);
+                } else if (fm_demod == FM_QUADRI_DEMOD) {
+                    waveout = fm_quadri_demod(real, imag, channel->pr, channel->pj);
+                }
+                channel->pr = real;
+                channel->pj = imag;
+
+                // de-emphasis IIR + DC blocking
+                fparms->agcavgfast = fparms->agcavgfast * 0.995f + waveout * 0.005f;
+                waveout -= fparms->agcavgfast;
+                waveout = waveout * (1.0f - channel->alpha) + channel->prev_waveout * channel->alpha;
+
+                // save off waveout before notch and ampfactor
+                channel->prev_waveout = waveout;
+            }
+#endif /* NFM */
+
+            // process audio sample for CTCSS, will be no-op if not configured
+            fparms->squelch.process_audio_sample(waveout);
+        }
+
+        // If squelch is still open then save samples to output
+        if (fparms->squelch.is_open()) {
+            // apply the notch filter, will be a no-op if not configured
+            fparms->notch_filter.apply(waveout);
+
+            // apply the ampfactor
+            waveout *= fparms->ampfactor;
+
+            // make sure the value is between +/- 1 (requirement for libmp3lame)
+            if (isnan(waveout)) {
+                waveout = 0.0;
+            } else if (waveout > 1.0) {
+                waveout = 1.0;
+            } else if (waveout < -1.0) {
+                waveout = -1.0;
+            }
+
+            channel->axcindicate = SIGNAL;
+            if (channel->has_iq_outputs) {
+                channel->iq_out[2 * (j - AGC_EXTRA)] = real;
+                channel->iq_out[2 * (j - AGC_EXTRA) + 1] = imag;
+            }
+
+            // Squelch is closed
+        } else {
+            waveout = 0;
+            if (channel->has_iq_outputs) {
+                channel->iq_out[2 * (j - AGC_EXTRA)] = 0;
+                channel->iq_out[2 * (j - AGC_EXTRA) + 1] = 0;
+            }
+        }
+        if (channel->has_pre_trigger) {
+            channel->iq_raw[2 * (j - AGC_EXTRA)] = real;
+            channel->iq_raw[2 * (j - AGC_EXTRA) + 1] = imag;
+        }
+    }
+    memmove(channel->wavein, channel->wavein + WAVE_BATCH, (dev->waveend - WAVE_BATCH) * sizeof(float));
+    if (channel->needs_raw_iq) {
+        memmove(channel->iq_in, channel->iq_in + 2 * WAVE_BATCH, (dev->waveend - WAVE_BATCH) * sizeof(float) * 2);
+    }
+}
+
 void* demodulate(void* params) {
     assert(params != NULL);
     demod_params_t* demod_params = (demod_params_t*)params;
 
     debug_print("Starting demod thread, devices %d:%d, signal %p\n", demod_params->device_start, demod_params->device_end, demod_params->mp3_signal);
+    thread_sched_apply(THREAD_DEMOD);
 
-    // initialize fft engine
-#ifdef WITH_BCM_VC
-    int mb = mbox_open();
-    struct GPU_FFT* fft;
-    int ret = gpu_fft_prepare(mb, fft_size_log, GPU_FFT_FWD, FFT_BATCH, &fft);
-    switch (ret) {
-        case -1:
-            log(LOG_CRIT, "Unable to enable V3D. Please check your firmware is up to date.\n");
-            error();
-            break;
-        case -2:
-            log(LOG_CRIT, "log2_N=%d not supported. Try between 8 and 17.\n", fft_size_log);
-            error();
-            break;
-        case -3:
-            log(LOG_CRIT, "Out of memory. Try a smaller batch or increase GPU memory.\n");
-            error();
-            break;
-    }
-#else
-    fftwf_complex* fftin = demod_params->fftin;
-    fftwf_complex* fftout = demod_params->fftout;
-#endif /* WITH_BCM_VC */
+    FftEngine* fft = demod_params->fft;
 
     float ALIGNED32 levels_u8[256], levels_s8[256];
     float* levels_ptr = NULL;
@@ -349,10 +1002,9 @@ void* demodulate(void* params) {
     // initialize fft window
     // blackman 7
     // the whole matrix is computed
-#ifdef WITH_BCM_VC
-    float ALIGNED32 window[fft_size * 2];
-#else
     float ALIGNED32 window[fft_size];
+#ifdef WITH_BCM_VC
+    float ALIGNED32 window_neon[fft_size * 2];  // every value twice, as samplefft() expects it
 #endif /* WITH_BCM_VC */
 
     const double a0 = 0.27105140069342f;
@@ -366,10 +1018,9 @@ void* demodulate(void* params) {
     for (size_t i = 0; i < fft_size; i++) {
         double x = a0 - (a1 * cos((2.0 * M_PI * i) / (fft_size - 1))) + (a2 * cos((4.0 * M_PI * i) / (fft_size - 1))) - (a3 * cos((6.0 * M_PI * i) / (fft_size - 1))) +
                    (a4 * cos((8.0 * M_PI * i) / (fft_size - 1))) - (a5 * cos((10.0 * M_PI * i) / (fft_size - 1))) + (a6 * cos((12.0 * M_PI * i) / (fft_size - 1)));
-#ifdef WITH_BCM_VC
-        window[i * 2] = window[i * 2 + 1] = (float)x;
-#else
         window[i] = (float)x;
+#ifdef WITH_BCM_VC
+        window_neon[i * 2] = window_neon[i * 2 + 1] = (float)x;
 #endif /* WITH_BCM_VC */
     }
 
@@ -381,292 +1032,147 @@ void* demodulate(void* params) {
     int device_num = demod_params->device_start;
     while (true) {
         if (do_exit) {
-#ifdef WITH_BCM_VC
-            log(LOG_INFO, "Freeing GPU memory\n");
-            gpu_fft_release(fft);
-#endif /* WITH_BCM_VC */
+            delete fft;
             return NULL;
         }
 
+        ConfigReadLock config_read_lock;
         device_t* dev = devices + device_num;
 
+        if (dev->input->state != INPUT_RUNNING) {
+            // not started yet, failed or being restarted (supervise_devices() takes care of that)
+            device_num = next_device(demod_params, device_num);
+            SLEEP(10);
+            continue;
+        }
+
+        bool retuning = false;
         pthread_mutex_lock(&dev->input->buffer_lock);
         if (dev->input->bufe >= dev->input->bufs)
             available = dev->input->bufe - dev->input->bufs;
         else
             available = dev->input->buf_size - dev->input->bufs + dev->input->bufe;
-        pthread_mutex_unlock(&dev->input->buffer_lock);
-
-        if (devices_running == 0) {
-            log(LOG_ERR, "All receivers failed, exiting\n");
-            do_exit = 1;
-            continue;
-        }
-
-        if (dev->input->state != INPUT_RUNNING) {
-            if (dev->input->state == INPUT_FAILED) {
-                dev->input->state = INPUT_DISABLED;
-                disable_device_outputs(dev);
-                devices_running--;
+        if (dev->retune_settling) {
+            if (dev->input->samples_read < dev->retune_sample) {
+                retuning = true;
+            } else {
+                dev->retune_settling = false;
+                scan_start_probes(dev);
             }
-            device_num = next_device(demod_params, device_num);
-            continue;
         }
+        pthread_mutex_unlock(&dev->input->buffer_lock);
 
         // number of input bytes per output wave sample (x 2 for I and Q)
         size_t bps = 2 * dev->input->bytes_per_sample * (size_t)round((double)dev->input->sample_rate / (double)WAVE_RATE);
-        if (available < bps * FFT_BATCH + fft_size * dev->input->bytes_per_sample * 2) {
+        if (available < bps * fft_batch + fft_size * dev->input->bytes_per_sample * 2) {
             // move to next device
             device_num = next_device(demod_params, device_num);
             SLEEP(10);
             continue;
         }
 
-        if (dev->input->sfmt == SFMT_S16) {
-            float const scale = 1.0f / dev->input->fullscale;
-#ifdef WITH_BCM_VC
-            struct GPU_FFT_COMPLEX* ptr = fft->in;
-            for (size_t b = 0; b < FFT_BATCH; b++, ptr += fft->step) {
-                short* buf2 = (short*)(dev->input->buffer + dev->input->bufs + b * bps);
-                for (size_t i = 0; i < fft_size; i++, buf2 += 2) {
-                    ptr[i].re = scale * (float)buf2[0] * window[i * 2];
-                    ptr[i].im = scale * (float)buf2[1] * window[i * 2];
+        if (retuning) {
+            // samples up to the retune point belong to the previous frequency - skip them without demodulating
+            blank_wave_batch(dev);
+        } else {
+            if (dev->input->sfmt == SFMT_S16) {
+                float const scale = 1.0f / dev->input->fullscale;
+                for (size_t b = 0; b < fft_batch; b++) {
+                    float* in = fft->input(b);
+                    short* buf2 = (short*)(dev->input->buffer + dev->input->bufs + b * bps);
+                    for (size_t i = 0; i < fft_size; i++, buf2 += 2) {
+                        in[2 * i] = scale * (float)buf2[0] * window[i];
+                        in[2 * i + 1] = scale * (float)buf2[1] * window[i];
+                    }
                 }
-            }
-#else
-            short* buf2 = (short*)(dev->input->buffer + dev->input->bufs);
-            for (size_t i = 0; i < fft_size; i++, buf2 += 2) {
-                fftin[i][0] = scale * (float)buf2[0] * window[i];
-                fftin[i][1] = scale * (float)buf2[1] * window[i];
-            }
-#endif /* WITH_BCM_VC */
-        } else if (dev->input->sfmt == SFMT_F32) {
-            float const scale = 1.0f / dev->input->fullscale;
-#ifdef WITH_BCM_VC
-            struct GPU_FFT_COMPLEX* ptr = fft->in;
-            for (size_t b = 0; b < FFT_BATCH; b++, ptr += fft->step) {
-                float* buf2 = (float*)(dev->input->buffer + dev->input->bufs + b * bps);
-                for (size_t i = 0; i < fft_size; i++, buf2 += 2) {
-                    ptr[i].re = scale * buf2[0] * window[i * 2];
-                    ptr[i].im = scale * buf2[1] * window[i * 2];
+            } else if (dev->input->sfmt == SFMT_F32) {
+                float const scale = 1.0f / dev->input->fullscale;
+                for (size_t b = 0; b < fft_batch; b++) {
+                    float* in = fft->input(b);
+                    float* buf2 = (float*)(dev->input->buffer + dev->input->bufs + b * bps);
+                    for (size_t i = 0; i < fft_size; i++, buf2 += 2) {
+                        in[2 * i] = scale * buf2[0] * window[i];
+                        in[2 * i + 1] = scale * buf2[1] * window[i];
+                    }
                 }
-            }
-#else  // WITH_BCM_VC
-            float* buf2 = (float*)(dev->input->buffer + dev->input->bufs);
-            for (size_t i = 0; i < fft_size; i++, buf2 += 2) {
-                fftin[i][0] = scale * buf2[0] * window[i];
-                fftin[i][1] = scale * buf2[1] * window[i];
-            }
-#endif /* WITH_BCM_VC */
-
-        } else {  // S8 or U8
-            levels_ptr = (dev->input->sfmt == SFMT_U8 ? levels_u8 : levels_s8);
+            } else {  // S8 or U8
+                levels_ptr = (dev->input->sfmt == SFMT_U8 ? levels_u8 : levels_s8);
 
+                for (size_t b = 0; b < fft_batch; b++) {
 #ifdef WITH_BCM_VC
-            sample_fft_arg sfa = {fft_size / 4, fft->in};
-            for (size_t i = 0; i < FFT_BATCH; i++) {
-                samplefft(&sfa, dev->input->buffer + dev->input->bufs + i * bps, window, levels_ptr);
-                sfa.dest += fft->step;
-            }
+                    sample_fft_arg sfa = {fft_size / 4, (GPU_FFT_COMPLEX*)fft->input(b)};
+                    samplefft(&sfa, dev->input->buffer + dev->input->bufs + b * bps, window_neon, levels_ptr);
 #else
-            unsigned char* buf2 = dev->input->buffer + dev->input->bufs;
-            for (size_t i = 0; i < fft_size; i++, buf2 += 2) {
-                fftin[i][0] = levels_ptr[buf2[0]] * window[i];
-                fftin[i][1] = levels_ptr[buf2[1]] * window[i];
-            }
+                    float* in = fft->input(b);
+                    unsigned char* buf2 = dev->input->buffer + dev->input->bufs + b * bps;
+                    for (size_t i = 0; i < fft_size; i++, buf2 += 2) {
+                        in[2 * i] = levels_ptr[buf2[0]] * window[i];
+                        in[2 * i + 1] = levels_ptr[buf2[1]] * window[i];
+                    }
 #endif /* WITH_BCM_VC */
-        }
+                }
+            }
 
-#ifdef WITH_BCM_VC
-        gpu_fft_execute(fft);
-#else
-        fftwf_execute(demod_params->fft);
-#endif /* WITH_BCM_VC */
+            fft->execute();
 
-#ifdef WITH_BCM_VC
-        for (int i = 0; i < dev->channel_count; i++) {
-            float* wavein = dev->channels[i].wavein + dev->waveend;
-            __builtin_prefetch(wavein, 1);
-            const int bin = dev->bins[i];
-            const GPU_FFT_COMPLEX* fftout = fft->out + bin;
-            for (int j = 0; j < FFT_BATCH; j++, ++wavein, fftout += fft->step)
-                *wavein = sqrtf(fftout->im * fftout->im + fftout->re * fftout->re);
-        }
-        for (int j = 0; j < dev->channel_count; j++) {
-            if (dev->channels[j].needs_raw_iq) {
-                struct GPU_FFT_COMPLEX* ptr = fft->out;
-                for (int job = 0; job < FFT_BATCH; job++) {
-                    dev->channels[j].iq_in[2 * (dev->waveend + job)] = ptr[dev->bins[j]].re;
-                    dev->channels[j].iq_in[2 * (dev->waveend + job) + 1] = ptr[dev->bins[j]].im;
-                    ptr += fft->step;
+            for (int i = 0; i < dev->channel_count && dev->dense == NULL; i++) {
+                channel_t* channel = dev->channels + i;
+                if (channel_shed(channel)) {
+                    continue;
+                } else if (channel->lane_count > 0) {
+                    for (int k = 0; k < channel->lanes_used; k++) {
+                        read_bin(dev, channel->lanes + k, channel->lane_bins[k], fft);
+                    }
+                } else if (channel->scan_state != SCAN_PARKED) {
+                    read_bin(dev, channel, dev->bins[i], fft);
                 }
             }
-        }
-#else
-        for (int j = 0; j < dev->channel_count; j++) {
-            dev->channels[j].wavein[dev->waveend] = sqrtf(fftout[dev->bins[j]][0] * fftout[dev->bins[j]][0] + fftout[dev->bins[j]][1] * fftout[dev->bins[j]][1]);
-            if (dev->channels[j].needs_raw_iq) {
-                dev->channels[j].iq_in[2 * dev->waveend] = fftout[dev->bins[j]][0];
-                dev->channels[j].iq_in[2 * dev->waveend + 1] = fftout[dev->bins[j]][1];
+            if (dev->dense != NULL) {
+                dense_read_bins(dev, fft);
+            }
+            // only every stride-th FFT goes into the spectrum, which keeps its cost low
+            if (dev->spectrum != NULL && (dev->spectrum->countdown -= fft_batch) <= 0) {
+                spectrum_add_fft(dev, device_num, fft->output(0));
             }
+            memset(dev->wave_blank + dev->waveend, 0, fft_batch);
         }
-#endif /* WITH_BCM_VC */
 
-        dev->waveend += FFT_BATCH;
+        dev->waveend += fft_batch;
 
         if (dev->waveend >= WAVE_BATCH + AGC_EXTRA) {
             for (int i = 0; i < dev->channel_count; i++) {
-                AFC afc(dev, i);
                 channel_t* channel = dev->channels + i;
-                freq_t* fparms = channel->freqlist + channel->freq_idx;
-
-                // set to NO_SIGNAL, will be updated to SIGNAL based on squelch below
-                channel->axcindicate = NO_SIGNAL;
-
-                for (int j = AGC_EXTRA; j < WAVE_BATCH + AGC_EXTRA; j++) {
-                    float& real = channel->iq_in[2 * (j - AGC_EXTRA)];
-                    float& imag = channel->iq_in[2 * (j - AGC_EXTRA) + 1];
-
-                    fparms->squelch.process_raw_sample(channel->wavein[j]);
-
-                    // If squelch is open / opening and using I/Q, then cleanup the signal and possibly update squelch.
-                    if (fparms->squelch.should_filter_sample() && channel->needs_raw_iq) {
-                        // remove phase rotation introduced by FFT sliding window
-                        float swf, cwf, re_tmp, im_tmp;
-                        sincosf_lut(channel->dm_phi, &swf, &cwf);
-                        multiply(real, imag, cwf, -swf, &re_tmp, &im_tmp);
-                        channel->dm_phi += channel->dm_dphi;
-                        channel->dm_phi &= 0xffffff;
-
-                        // apply lowpass filter, will be a no-op if not configured
-                        fparms->lowpass_filter.apply(re_tmp, im_tmp);
-
-                        // update I/Q and wave
-                        real = re_tmp;
-                        imag = im_tmp;
-                        channel->wavein[j] = sqrt(real * real + imag * imag);
-
-                        // update squelch post-cleanup
-                        if (fparms->lowpass_filter.enabled()) {
-                            fparms->squelch.process_filtered_sample(channel->wavein[j]);
+                const float* fft_results = fft->output(0);
+                if (channel_shed(channel)) {
+                    silence_channel_batch(channel);
+                } else if (channel->lane_count > 0) {
+                    for (int k = 0; k < channel->lanes_used; k++) {
+                        channel_t* lane = channel->lanes + k;
+                        AFC afc(lane);
+                        demod_channel_batch(dev, lane);
+                        afc.finalize(lane, channel->lane_bins[k], channel->lane_base_bins[k], fft_results);
+                        if (lane->axcindicate != NO_SIGNAL) {
+                            lane->freqlist[lane->freq_idx].active_counter++;
                         }
                     }
-
-                    if (fparms->modulation == MOD_AM) {
-                        // if squelch is just opening then bootstrip agcavgfast with prior values of wavein
-                        if (fparms->squelch.first_open_sample()) {
-                            for (int k = j - AGC_EXTRA; k < j; k++) {
-                                if (channel->wavein[k] >= fparms->squelch.squelch_level()) {
-                                    fparms->agcavgfast = fparms->agcavgfast * 0.9f + channel->wavein[k] * 0.1f;
-                                }
-                            }
-                        }
-                        // if squelch is just closing then fade out the prior samples of waveout
-                        else if (fparms->squelch.last_open_sample()) {
-                            for (int k = j - AGC_EXTRA + 1; k < j; k++) {
-                                channel->waveout[k] = channel->waveout[k - 1] * 0.94f;
-                            }
-                        }
-                    }
-
-                    float& waveout = channel->waveout[j];
-
-                    // If squelch sees power then do modulation-specific processing
-                    if (fparms->squelch.should_process_audio()) {
-                        if (fparms->modulation == MOD_AM) {
-                            if (channel->wavein[j] > fparms->squelch.squelch_level()) {
-                                fparms->agcavgfast = fparms->agcavgfast * 0.995f + channel->wavein[j] * 0.005f;
-                            }
-
-                            waveout = (channel->wavein[j - AGC_EXTRA] - fparms->agcavgfast) / (fparms->agcavgfast * 1.5f);
-                            if (abs(waveout) > 0.8f) {
-                                waveout *= 0.85f;
-                                fparms->agcavgfast *= 1.15f;
-                            }
-                        }
-#ifdef NFM
-                        else if (fparms->modulation == MOD_NFM) {
-                            // FM demod
-                            if (fm_demod == FM_FAST_ATAN2) {
-                                waveout = polar_disc_fast(real, imag, channel->pr, channel->pj);
-                            } else if (fm_demod == FM_QUADRI_DEMOD) {
-                                waveout = fm_quadri_demod(real, imag, channel->pr, channel->pj);
-                            }
-                            channel->pr = real;
-                            channel->pj = imag;
-
-                            // de-emphasis IIR + DC blocking
-                            fparms->agcavgfast = fparms->agcavgfast * 0.995f + waveout * 0.005f;
-                            waveout -= fparms->agcavgfast;
-                            waveout = waveout * (1.0f - channel->alpha) + channel->prev_waveout * channel->alpha;
-
-                            // save off waveout before notch and ampfactor
-                            channel->prev_waveout = waveout;
-                        }
-#endif /* NFM */
-
-                        // process audio sample for CTCSS, will be no-op if not configured
-                        fparms->squelch.process_audio_sample(waveout);
-                    }
-
-                    // If squelch is still open then save samples to output
-                    if (fparms->squelch.is_open()) {
-                        // apply the notch filter, will be a no-op if not configured
-                        fparms->notch_filter.apply(waveout);
-
-                        // apply the ampfactor
-                        waveout *= fparms->ampfactor;
-
-                        // make sure the value is between +/- 1 (requirement for libmp3lame)
-                        if (isnan(waveout)) {
-                            waveout = 0.0;
-                        } else if (waveout > 1.0) {
-                            waveout = 1.0;
-                        } else if (waveout < -1.0) {
-                            waveout = -1.0;
-                        }
-
-                        channel->axcindicate = SIGNAL;
-                        if (channel->has_iq_outputs) {
-                            channel->iq_out[2 * (j - AGC_EXTRA)] = real;
-                            channel->iq_out[2 * (j - AGC_EXTRA) + 1] = imag;
-                        }
-
-                        // Squelch is closed
-                    } else {
-                        waveout = 0;
-                        if (channel->has_iq_outputs) {
-                            channel->iq_out[2 * (j - AGC_EXTRA)] = 0;
-                            channel->iq_out[2 * (j - AGC_EXTRA) + 1] = 0;
-                        }
-                    }
-                }
-                memmove(channel->wavein, channel->wavein + WAVE_BATCH, (dev->waveend - WAVE_BATCH) * sizeof(float));
-                if (channel->needs_raw_iq) {
-                    memmove(channel->iq_in, channel->iq_in + 2 * WAVE_BATCH, (dev->waveend - WAVE_BATCH) * sizeof(float) * 2);
-                }
-
-#ifdef WITH_BCM_VC
-                afc.finalize(dev, i, fft->out);
-#else
-                afc.finalize(dev, i, demod_params->fftout);
-#endif /* WITH_BCM_VC */
-
-                if (tui) {
-                    char symbol = fparms->squelch.signal_outside_filter() ? '~' : (char)channel->axcindicate;
-                    if (dev->mode == R_SCAN) {
-                        GOTOXY(0, device_num * 17 + dev->row + 3);
-                        printf("%4.0f/%3.0f%c %7.3f ", level_to_dBFS(fparms->squelch.signal_level()), level_to_dBFS(fparms->squelch.noise_level()), symbol,
-                               (dev->channels[0].freqlist[channel->freq_idx].frequency / 1000000.0));
-                    } else {
-                        GOTOXY(i * 10, device_num * 17 + dev->row + 3);
-                        printf("%4.0f/%3.0f%c ", level_to_dBFS(fparms->squelch.signal_level()), level_to_dBFS(fparms->squelch.noise_level()), symbol);
+                    select_lane(channel);
+                } else if (channel->scan_state == SCAN_PARKED) {
+                    silence_channel_batch(channel);
+                } else {
+                    AFC afc(channel);
+                    demod_channel_batch(dev, channel);
+                    afc.finalize(channel, dev->bins[i], dev->base_bins[i], fft_results);
+                    if (channel->axcindicate != NO_SIGNAL) {
+                        channel->freqlist[channel->freq_idx].active_counter++;
                     }
-                    fflush(stdout);
                 }
 
-                if (channel->axcindicate != NO_SIGNAL) {
-                    channel->freqlist[channel->freq_idx].active_counter++;
+                if (tui || control_path != NULL || event_stream != NULL) {
+                    freq_t* fparms = channel->freqlist + channel->freq_idx;
+                    channel->tui.signal_level = fparms->squelch.signal_level();
+                    channel->tui.noise_level = fparms->squelch.noise_level();
+                    channel->tui.symbol = fparms->squelch.signal_outside_filter() ? '~' : (char)channel->axcindicate;
+                    channel->tui.frequency = fparms->frequency;
                 }
             }
             if (dev->waveavail == 1) {
@@ -675,6 +1181,7 @@ void* demodulate(void* params) {
             } else {
                 dev->waveavail = 1;
             }
+            memmove(dev->wave_blank, dev->wave_blank + WAVE_BATCH, dev->waveend - WAVE_BATCH);
             dev->waveend -= WAVE_BATCH;
 #ifdef DEBUG
             gettimeofday(&te, NULL);
@@ -683,13 +1190,10 @@ void* demodulate(void* params) {
             ts.tv_usec = te.tv_usec;
 #endif /* DEBUG */
             demod_params->mp3_signal->send();
-            dev->row++;
-            if (dev->row == 12) {
-                dev->row = 0;
-            }
         }
 
-        dev->input->bufs = (dev->input->bufs + bps * FFT_BATCH) % dev->input->buf_size;
+        dev->input->bufs = (dev->input->bufs + bps * fft_batch) % dev->input->buf_size;
+        dev->input->samples_read += bps * fft_batch / (2 * dev->input->bytes_per_sample);
         device_num = next_device(demod_params, device_num);
     }
 }
@@ -698,7 +1202,8 @@ void usage() {
     cout << "Usage: rtl_airband [options] [-c <config_file_path>]\n\
 \t-h\t\t\tDisplay this help text\n\
 \t-f\t\t\tRun in foreground, display textual waterfalls\n\
-\t-F\t\t\tRun in foreground, do not display waterfalls (for running as a systemd service)\n";
+\t-F\t\t\tRun in foreground, do not display waterfalls (for running as a systemd service)\n\
+\t-n, --dry-run, --plan\tDry run: measure this host, print the predicted CPU load of the configuration and exit\n";
 #ifdef NFM
     cout << "\t-Q\t\t\tUse quadri correlator for FM demodulation (default is atan2)\n";
 #endif /* NFM */
@@ -721,7 +1226,146 @@ static int count_devices_running() {
     return ret;
 }
 
+// Feed the governor with the fill level of the fullest device buffer and whether samples were lost, and apply what it decides
+static void govern_load() {
+    static size_t last_lost = 0;
+    static bool first = true;
+    if (governor == NULL) {
+        return;
+    }
+    float fill = 0.0f;
+    size_t lost = 0;
+    for (int i = 0; i < device_count; i++) {
+        device_t* dev = devices + i;
+        input_t* input = dev->input;
+        lost += input->overflow_count + dev->output_overrun_count;
+        if (dev->down || input->state != INPUT_RUNNING) {
+            continue;
+        }
+        pthread_mutex_lock(&input->buffer_lock);
+        uint64_t unread = input->samples_written - input->samples_read;
+        pthread_mutex_unlock(&input->buffer_lock);
+        fill = std::max(fill, (float)(unread * 2 * input->bytes_per_sample) / input->buf_size);
+    }
+    const bool lost_samples = (!first && lost != last_lost);
+    last_lost = lost;
+    first = false;
+
+    timeval tv;
+    gettimeofday(&tv, NULL);
+    int action;
+    bool shed;
+    if (!governor->update(tv.tv_sec + tv.tv_usec / 1e6, fill, lost_samples, &action, &shed)) {
+        return;
+    }
+    governor_shed[action] = shed;
+    if (shed) {
+        governor_shed_count[action]++;
+        log(LOG_WARNING, "Overloaded (buffer %.0f%% full%s), shedding %s\n", fill * 100.0f, lost_samples ? ", samples lost" : "", shed_action_name(action));
+    } else {
+        log(LOG_NOTICE, "Load is back to normal, restoring %s\n", shed_action_name(action));
+    }
+}
+
+static timeval startup_time;
+
+// Log when a step of the startup was done and how long it took
+static void log_startup_step(const char* step, const timeval* step_start) {
+    timeval now;
+    gettimeofday(&now, NULL);
+    log(LOG_INFO, "Startup: %s done in %.0f ms, %.0f ms after start\n", step, delta_sec(step_start, &now) * 1000.0, delta_sec(&startup_time, &now) * 1000.0);
+}
+
+// Run fn(0) .. fn(count - 1) in threads of their own
+static void start_parallel(int count, void* (*fn)(void*), THREAD* threads) {
+    for (int i = 0; i < count; i++) {
+        pthread_create(&threads[i], NULL, fn, (void*)(intptr_t)i);
+    }
+}
+
+static void join_parallel(int count, THREAD* threads) {
+    for (int i = 0; i < count; i++) {
+        pthread_join(threads[i], NULL);
+    }
+}
+
+// Outputs of mixer index, or of device index - mixer_count, including its spectrum
+static void* init_outputs(void* arg) {
+    const int index = (int)(intptr_t)arg;
+    timeval step_start;
+    gettimeofday(&step_start, NULL);
+    char step[64];
+    if (index < mixer_count) {
+        const int i = index;
+        if (mixers[i].enabled == false) {
+            return NULL;  // no inputs connected = no need to initialize output
+        }
+        channel_t* channel = &mixers[i].channel;
+        for (int k = 0; k < channel->output_count; k++) {
+            output_t* output = channel->outputs + k;
+            if (!init_output(channel, output)) {
+                cerr << "Failed to initialize mixer " << i << " output " << k << " - aborting\n";
+                error();
+            }
+        }
+        snprintf(step, sizeof(step), "mixer %d outputs", i);
+    } else {
+        const int i = index - mixer_count;
+        device_t* dev = devices + i;
+        for (int j = 0; j < dev->channel_count; j++) {
+            channel_t* channel = dev->channels + j;
+
+            for (int k = 0; k < channel->output_count; k++) {
+                output_t* output = channel->outputs + k;
+                if (!init_output(channel, output)) {
+                    cerr << "Failed to initialize device " << i << " channel " << j << " output " << k << " - aborting\n";
+                    error();
+                }
+            }
+        }
+        if (dev->spectrum != NULL && !spectrum_init(dev->spectrum, i)) {
+            cerr << "Failed to initialize spectrum output of device " << i << " - aborting\n";
+            error();
+        }
+        snprintf(step, sizeof(step), "device %d outputs", i);
+    }
+    log_startup_step(step, &step_start);
+    return NULL;
+}
+
+// Open and start the input of a device, and its scan controller
+static void* start_device(void* arg) {
+    const int i = (int)(intptr_t)arg;
+    device_t* dev = devices + i;
+    timeval step_start;
+    gettimeofday(&step_start, NULL);
+
+    // the demodulator reads this buffer most, keep it on its NUMA node
+    thread_sched_place(dev->input->buffer, dev->input->buf_size + 2 * dev->input->bytes_per_sample * fft_size, THREAD_DEMOD);
+    if (input_init(dev->input) != 0 || dev->input->state != INPUT_INITIALIZED) {
+        if (errno != 0) {
+            cerr << "Failed to initialize input device " << i << ": " << strerror(errno) << " - aborting\n";
+        } else {
+            cerr << "Failed to initialize input device " << i << " - aborting\n";
+        }
+        error();
+    }
+    if (input_start(dev->input) != 0) {
+        cerr << "Failed to start input on device " << i << ": " << strerror(errno) << " - aborting\n";
+        error();
+    }
+    if (dev->mode == R_SCAN) {
+        // FIXME: not needed when freq_count == 1?
+        pthread_create(&dev->controller_thread, NULL, &controller_thread, dev);
+    }
+    char step[64];
+    snprintf(step, sizeof(step), "device %d input", i);
+    log_startup_step(step, &step_start);
+    return NULL;
+}
+
 int main(int argc, char* argv[]) {
+    gettimeofday(&startup_time, NULL);
 #ifdef WITH_PROFILING
     ProfilerStart("rtl_airband.prof");
 #endif /* WITH_PROFILING */
@@ -732,7 +1376,7 @@ int main(int argc, char* argv[]) {
 #pragma GCC diagnostic warning "-Wwrite-strings"
 
     int opt;
-    char optstring[16] = "efFhvc:";
+    char optstring[16] = "efFhnvc:";
 
 #ifdef NFM
     strcat(optstring, "Q");
@@ -744,8 +1388,11 @@ int main(int argc, char* argv[]) {
 
     int foreground = 0;  // daemonize
     int do_syslog = 1;
+    int dry_run = 0;  // print the capacity plan and exit
 
-    while ((opt = getopt(argc, argv, optstring)) != -1) {
+    static const struct option long_options[] = {{"dry-run", no_argument, NULL, 'n'}, {"plan", no_argument, NULL, 'n'}, {NULL, 0, NULL, 0}};
+
+    while ((opt = getopt_long(argc, argv, optstring, long_options, NULL)) != -1) {
         switch (opt) {
 #ifdef NFM
             case 'Q':
@@ -770,6 +1417,11 @@ int main(int argc, char* argv[]) {
                 foreground = 1;
                 tui = 0;
                 break;
+            case 'n':
+                dry_run = 1;
+                foreground = 1;
+                do_syslog = 0;
+                break;
             case 'c':
                 cfgfile = optarg;
                 break;
@@ -830,40 +1482,89 @@ int main(int argc, char* argv[]) {
         if (root.exists("localtime") && (bool)root["localtime"] == true)
             use_localtime = true;
         if (root.exists("multiple_demod_threads") && (bool)root["multiple_demod_threads"] == true) {
-#ifdef WITH_BCM_VC
-            cerr << "Using multiple_demod_threads not supported with BCM VideoCore for FFT\n";
-            exit(1);
-#endif /* WITH_BCM_VC */
-
             multiple_demod_threads = true;
         }
         if (root.exists("multiple_output_threads") && (bool)root["multiple_output_threads"] == true) {
             multiple_output_threads = true;
         }
+        if (root.exists("output_pool_threads")) {
+            output_pool_threads = (int)(root["output_pool_threads"]);
+            if (output_pool_threads < 1) {
+                cerr << "Configuration error: output_pool_threads must be at least 1\n";
+                error();
+            }
+        }
         if (root.exists("log_scan_activity") && (bool)root["log_scan_activity"] == true)
             log_scan_activity = true;
         if (root.exists("stats_filepath"))
             stats_filepath = strdup(root["stats_filepath"]);
+        if (root.exists("state_file"))
+            state_filepath = strdup(root["state_file"]);
+        if (root.exists("control_socket"))
+            control_path = strdup(root["control_socket"]);
+        if (root.exists("threads"))
+            parse_threads(root["threads"]);
+        if (root.exists("governor"))
+            governor = parse_governor(root["governor"]);
+        if (root.exists("http_server"))
+            http_server = parse_http_server(root["http_server"]);
+        if (root.exists("event_stream"))
+            event_stream = parse_event_stream(root["event_stream"]);
 #ifdef NFM
         if (root.exists("tau"))
             alpha = ((int)root["tau"] == 0 ? 0.0f : exp(-1.0f / (WAVE_RATE * 1e-6 * (int)root["tau"])));
 #endif /* NFM */
 
+        // "auto" picks the fastest engine and batch size for fft_size with a short benchmark
+        string requested_engine = root.exists("fft_engine") ? (const char*)root["fft_engine"] : "auto";
+        int batch = root.exists("fft_batch") ? (int)root["fft_batch"] : 0;
+        if (batch < 0 || batch > WAVE_BATCH) {
+            cerr << "Configuration error: fft_batch must be between 1 and " << WAVE_BATCH << "\n";
+            error();
+        }
+        fft_batch = batch;
+        if (requested_engine == "auto") {
+            if (!fft_engine_benchmark(fft_size_log, fft_engine_name, fft_batch)) {
+                cerr << "No working FFT engine found\n";
+                error();
+            }
+        } else {
+            vector<string> names = fft_engine_names();
+            if (find(names.begin(), names.end(), requested_engine) == names.end()) {
+                cerr << "Configuration error: unsupported fft_engine " << requested_engine << " (must be \"auto\" or one of:";
+                for (size_t i = 0; i < names.size(); i++) {
+                    cerr << " \"" << names[i] << "\"";
+                }
+                cerr << ")\n";
+                error();
+            }
+            fft_engine_name = requested_engine;
+            if (fft_batch == 0) {
+                fft_batch = fft_engine_default_batch(fft_engine_name);
+            }
+        }
+        if (fft_engine_name == "gpu" && multiple_demod_threads) {
+            cerr << "Using multiple_demod_threads not supported with BCM VideoCore for FFT\n";
+            exit(1);
+        }
+
         Setting& devs = config.lookup("devices");
-        device_count = devs.getLength();
+        device_count = count_devices(devs);
         if (device_count < 1) {
             cerr << "Configuration error: no devices defined\n";
             error();
         }
 
-        struct sigaction sigact, pipeact;
+        struct sigaction sigact, pipeact, reloadact;
 
         memset(&sigact, 0, sizeof(sigact));
         memset(&pipeact, 0, sizeof(pipeact));
+        memset(&reloadact, 0, sizeof(reloadact));
         pipeact.sa_handler = SIG_IGN;
         sigact.sa_handler = &sighandler;
+        reloadact.sa_handler = &reload_handler;
         sigaction(SIGPIPE, &pipeact, NULL);
-        sigaction(SIGHUP, &sigact, NULL);
+        sigaction(SIGHUP, &reloadact, NULL);
         sigaction(SIGINT, &sigact, NULL);
         sigaction(SIGQUIT, &sigact, NULL);
         sigaction(SIGTERM, &sigact, NULL);
@@ -922,7 +1623,13 @@ int main(int argc, char* argv[]) {
         error();
     }
 
+    if (dry_run) {
+        exit(print_capacity_plan() == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+
     log(LOG_INFO, "RTLSDR-Airband version %s starting\n", RTL_AIRBAND_VERSION);
+    log(LOG_INFO, "Using the %s FFT engine, %zu FFTs per batch\n", fft_engine_name.c_str(), fft_batch);
+    restore_channel_state(devices, device_count);
 
     if (!foreground) {
         int pid1, pid2;
@@ -964,85 +1671,50 @@ int main(int argc, char* argv[]) {
             }
         }
     }
+    // threads don't survive fork(), so only now
+    start_log_thread();
 
-    for (int i = 0; i < mixer_count; i++) {
-        if (mixers[i].enabled == false) {
-            continue;  // no inputs connected = no need to initialize output
-        }
-        channel_t* channel = &mixers[i].channel;
-        for (int k = 0; k < channel->output_count; k++) {
-            output_t* output = channel->outputs + k;
-            if (!init_output(channel, output)) {
-                cerr << "Failed to initialize mixer " << i << " output " << k << " - aborting\n";
-                error();
-            }
-        }
-    }
     for (int i = 0; i < device_count; i++) {
-        device_t* dev = devices + i;
-        for (int j = 0; j < dev->channel_count; j++) {
-            channel_t* channel = dev->channels + j;
-
-            for (int k = 0; k < channel->output_count; k++) {
-                output_t* output = channel->outputs + k;
-                if (!init_output(channel, output)) {
-                    cerr << "Failed to initialize device " << i << " channel " << j << " output " << k << " - aborting\n";
-                    error();
-                }
-            }
-        }
-        if (input_init(dev->input) != 0 || dev->input->state != INPUT_INITIALIZED) {
-            if (errno != 0) {
-                cerr << "Failed to initialize input device " << i << ": " << strerror(errno) << " - aborting\n";
-            } else {
-                cerr << "Failed to initialize input device " << i << " - aborting\n";
-            }
+        // the output threads read the tag queues of scanning devices from the start
+        // FIXME: set errno
+        if (devices[i].mode == R_SCAN && pthread_mutex_init(&devices[i].tag_queue_lock, NULL) != 0) {
+            cerr << "Failed to initialize mutex - aborting\n";
             error();
         }
-        if (input_start(dev->input) != 0) {
-            cerr << "Failed to start input on device " << i << ": " << strerror(errno) << " - aborting\n";
-            error();
-        }
-        if (dev->mode == R_SCAN) {
-            // FIXME: set errno
-            if (pthread_mutex_init(&dev->tag_queue_lock, NULL) != 0) {
-                cerr << "Failed to initialize mutex - aborting\n";
-                error();
-            }
-            // FIXME: not needed when freq_count == 1?
-            pthread_create(&dev->controller_thread, NULL, &controller_thread, dev);
-        }
     }
 
-    int timeout = 50;  // 5 seconds
-    while ((devices_running = count_devices_running()) != device_count && timeout > 0) {
-        SLEEP(100);
-        timeout--;
-    }
-    if ((devices_running = count_devices_running()) != device_count) {
-        log(LOG_ERR, "%d device(s) failed to initialize - aborting\n", device_count - devices_running);
-        error();
-    }
+    // outputs first, the output threads use them as soon as they are started
+    timeval step_start;
+    gettimeofday(&step_start, NULL);
+    THREAD* startup_threads = (THREAD*)XCALLOC(mixer_count + device_count, sizeof(THREAD));
+    start_parallel(mixer_count + device_count, &init_outputs, startup_threads);
+    join_parallel(mixer_count + device_count, startup_threads);
+    log_startup_step("all outputs", &step_start);
+
+    // the devices come up in the background, each one is demodulated as soon as it runs
+    gettimeofday(&step_start, NULL);
+    start_parallel(device_count, &start_device, startup_threads);
+
+    THREAD tui_renderer;
     if (tui) {
-        printf("\e[1;1H\e[2J");
-
-        GOTOXY(0, 0);
-        printf("                                                                               ");
-        for (int i = 0; i < device_count; i++) {
-            GOTOXY(0, i * 17 + 1);
-            for (int j = 0; j < devices[i].channel_count; j++) {
-                printf(" %7.3f  ", devices[i].channels[j].freqlist[devices[i].channels[j].freq_idx].frequency / 1000000.0);
-            }
-            if (i != device_count - 1) {
-                GOTOXY(0, i * 17 + 16);
-                printf("-------------------------------------------------------------------------------");
-            }
-        }
+        pthread_create(&tui_renderer, NULL, &tui_thread, NULL);
     }
     init_file_uploader();
     scan_pending_uploads();
     THREAD output_check;
     pthread_create(&output_check, NULL, &output_check_thread, NULL);
+    THREAD control;
+    if (control_path != NULL) {
+        pthread_create(&control, NULL, &control_thread, control_path);
+    }
+    THREAD http;
+    if (http_server != NULL) {
+        pthread_create(&http, NULL, &http_server_thread, NULL);
+    }
+    THREAD events;
+    if (event_stream != NULL) {
+        pthread_create(&events, NULL, &event_stream_thread, NULL);
+    }
 
     int demod_thread_count = multiple_demod_threads ? device_count : 1;
     demod_params_t* demod_params = (demod_params_t*)XCALLOC(demod_thread_count, sizeof(demod_params_t));
@@ -1106,11 +1778,46 @@ int main(int argc, char* argv[]) {
         pthread_create(&demod_threads[i], NULL, &demodulate, &demod_params[i]);
     }
 
-    // Wait for demod threads to exit
+    join_parallel(device_count, startup_threads);
+    free(startup_threads);
+    log_startup_step("all inputs", &step_start);
+
+    int timeout = 50;  // 5 seconds
+    int devices_running;
+    while ((devices_running = count_devices_running()) != device_count && timeout > 0) {
+        SLEEP(100);
+        timeout--;
+    }
+    if ((devices_running = count_devices_running()) != device_count) {
+        log(LOG_ERR, "%d device(s) failed to initialize - aborting\n", device_count - devices_running);
+        error();
+    }
+    log_startup_step("startup", &startup_time);
+
+    // SIGHUP reloads the configuration, failed devices are restarted, everything else runs until the demod threads exit
+    while (!do_exit) {
+        if (do_reload) {
+            do_reload = 0;
+            reload_config(cfgfile);
+        }
+        supervise_devices();
+        govern_load();
+        SLEEP(100);
+    }
     for (int i = 0; i < demod_thread_count; i++) {
         pthread_join(demod_threads[i], NULL);
     }
 
+    if (tui) {
+        pthread_join(tui_renderer, NULL);
+    }
+    if (control_path != NULL) {
+        pthread_join(control, NULL);
+    }
+    if (http_server != NULL) {
+        pthread_join(http, NULL);
+    }
+
     log(LOG_INFO, "Cleaning up\n");
     for (int i = 0; i < device_count; i++) {
         if (devices[i].mode == R_SCAN)
@@ -1125,9 +1832,14 @@ int main(int argc, char* argv[]) {
     }
     log(LOG_INFO, "Input threads closed\n");
 
+    stop_output_workers();
+
     for (int i = 0; i < device_count; i++) {
         device_t* dev = devices + i;
         disable_device_outputs(dev);
+        if (dev->spectrum != NULL) {
+            spectrum_shutdown(dev->spectrum);
+        }
     }
 
     if (mixer_count > 0) {
@@ -1140,6 +1852,9 @@ int main(int argc, char* argv[]) {
         output_params[i].mp3_signal->send();
         pthread_join(output_threads[i], NULL);
     }
+    if (event_stream != NULL) {
+        pthread_join(events, NULL);
+    }
 
     for (int i = 0; i < device_count; i++) {
         device_t* dev = devices + i;
@@ -1156,6 +1871,7 @@ int main(int argc, char* argv[]) {
 
     shutdown_file_uploader();
 
+    stop_log_thread();
     close_debug();
 #ifdef WITH_PROFILING
     ProfilerStop();
@@ -25,7 +25,9 @@
 #include <pthread.h>
 #include <shout/shout.h>
 #include <stdint.h>  // uint32_t
+#include <sys/socket.h>  // sockaddr_storage
 #include <sys/time.h>
+#include <unistd.h>  // usleep
 #include <complex>
 #include <cstdio>
 #include <libconfig.h++>
@@ -35,8 +37,6 @@
 
 #ifdef WITH_BCM_VC
 #include "hello_fft/gpu_fft.h"
-#else
-#include <fftw3.h>
 #endif /* WITH_BCM_VC */
 
 #ifdef WITH_PULSEAUDIO
@@ -44,10 +44,15 @@
 #include <pulse/stream.h>
 #endif /* WITH_PULSEAUDIO */
 
+#include "events.h"
 #include "filters.h"
+#include "governor.h"  // Governor, SHED_ACTION_COUNT
 #include "input-common.h"  // input_t
+#include "iq_history.h"
 #include "logging.h"
+#include "sink_queue.h"
 #include "squelch.h"
+#include "wav.h"
 
 #define ALIGNED32 __attribute__((aligned(32)))
 #define SLEEP(x) usleep(x * 1000)
@@ -76,6 +81,9 @@
 #define MP3_RATE 8000
 #define MAX_SHOUT_QUEUELEN 32768
 #define TAG_QUEUE_LEN 16
+#define MAX_PRE_TRIGGER 30  // seconds
+#define SCAN_POLL_INTERVAL 5   // ms
+#define SCAN_CONFIRM_TIME 300  // ms to wait for the squelch to open after a carrier has been detected
 
 #define MIN_FFT_SIZE_LOG 8
 #define DEFAULT_FFT_SIZE_LOG 9
@@ -90,10 +98,6 @@ struct sample_fft_arg {
     GPU_FFT_COMPLEX* dest;
 };
 extern "C" void samplefft(sample_fft_arg* a, unsigned char* buffer, float* window, float* levels);
-
-#define FFT_BATCH 250
-#else
-#define FFT_BATCH 1
 #endif /* WITH_BCM_VC */
 
 //#define AFC_LOGGING
@@ -106,7 +110,8 @@ enum output_type {
     O_FILE,
     O_RAWFILE,
     O_MIXER,
-    O_UDP_STREAM
+    O_UDP_STREAM,
+    O_HTTP
 #ifdef WITH_PULSEAUDIO
     ,
     O_PULSE
@@ -148,6 +153,11 @@ struct file_data {
     timeval last_write_time;
     FILE* f;
     enum output_type type;
+    size_t pre_trigger_samples;  // rawfile: I/Q written ahead of each transmission, 0 if disabled
+    IqHistory* pre_trigger;      // NULL if disabled
+    bool wav;                    // file: WAV rather than MP3
+    wav_format wav_type;
+    WavEncoder* wav_encoder;  // set up by init_output()
 };
 
 struct udp_stream_data {
@@ -163,6 +173,30 @@ struct udp_stream_data {
     socklen_t dest_sockaddr_len;
 };
 
+struct http_mount_t;
+
+struct http_data {
+    const char* mountpoint;
+    http_mount_t* mount;  // set up by init_output()
+};
+
+// Destinations of transmission events, see event_stream.cpp
+struct event_stream_t {
+    const char* socket_path;  // NULL if none
+    const char* udp_address;  // NULL if none
+    const char* udp_port;
+};
+
+#define EVENT_QUEUE_LEN 256  // power of two
+
+// Built-in HTTP server for the http outputs
+struct http_server_t {
+    const char* address;  // NULL for all addresses
+    int port;
+    int burst_size;  // bytes of recent audio sent to a new listener at once
+    int max_listeners;
+};
+
 #ifdef WITH_PULSEAUDIO
 struct pulse_data {
     const char* server;
@@ -182,11 +216,20 @@ struct mixer_data {
     int input;
 };
 
+// Where the batches of an output are encoded and written, see output_sink_t
+enum sink_exec { SINK_INLINE, SINK_POOL, SINK_THREAD };
+
+struct sink_state_t;
+
 struct output_t {
     enum output_type type;
     bool enabled;
     bool active;
+    bool suspended;  // disabled while its device or mixer is down, comes back with it
+    bool muted;      // set over the control socket, gets no audio
     void* data;
+    sink_exec exec;
+    sink_state_t* sink;  // queue and worker, NULL for SINK_INLINE
 
     // set to true in order to initialize `lame` and `lamebuf` after config parsing
     // is complete
@@ -198,6 +241,36 @@ struct output_t {
     unsigned char* lamebuf;
 };
 
+// One batch of a channel as seen by its outputs
+struct output_batch_t {
+    const float* waveout;
+    const float* waveout_r;  // NULL for mono
+    const float* iq_out;     // I/Q, only for outputs run inline
+    const float* iq_raw;
+    status axcindicate;
+    int freq_idx;
+    int cur_scan_freq;  // -1 unless a scan channel has just retuned
+};
+
+struct channel_t;
+
+/*
+ * The operations of an output type. Outputs run inline in the output thread
+ * unless their sink is queueable and they are set to run on the shared
+ * worker pool or on a thread of their own (see output_workers.cpp), where a
+ * slow disk or server doesn't hold up the other outputs.
+ */
+struct output_sink_t {
+    const char* name;  // the type in the configuration
+    sink_exec exec;    // unless set for the output
+    bool queueable;    // false if it needs the I/Q of the channel or has to keep in step with it
+    bool (*open)(channel_t* channel, output_t* output);  // once the configuration is parsed, NULL if there is nothing to do
+    void (*consume)(channel_t* channel, output_t* output, const output_batch_t* batch);
+    void (*flush)(output_t* output);                                              // disable_output(), NULL if there is nothing to do
+    bool (*resume)(channel_t* channel, output_t* output);                         // resume_channel_outputs(), NULL if there is nothing to do
+    void (*reconnect)(channel_t* channel, output_t* output, int device, bool input_failed);  // output_check_thread(), device is -1 for mixers, NULL if there is nothing to do
+};
+
 struct freq_tag {
     int freq;
     struct timeval tv;
@@ -233,6 +306,29 @@ class Signal {
     pthread_mutex_t mutex_;
 };
 
+// Taken by the threads using devices, channels, outputs and mixers while they
+// work with them. A configuration reload (reload.cpp) changes them under the
+// write lock.
+extern pthread_rwlock_t config_lock;
+extern volatile int reload_waiting;  // writers waiting for config_lock
+
+class ConfigReadLock {
+   public:
+    ConfigReadLock(void) {
+        // keep out of the way of a waiting reload, the readers would hold it off indefinitely
+        while (reload_waiting > 0) {
+            SLEEP(1);
+        }
+        pthread_rwlock_rdlock(&config_lock);
+    }
+    ~ConfigReadLock(void) { pthread_rwlock_unlock(&config_lock); }
+};
+
+// SCAN_SETTLING and SCAN_PROBING are left by the demodulator thread, the others
+// by the controller thread. SCAN_PARKED channels wait for a time slice while
+// their next frequency doesn't fit in the span and produce no output.
+enum scan_states { SCAN_IDLE, SCAN_ACTIVE, SCAN_SETTLING, SCAN_PROBING, SCAN_PARKED };
+
 struct freq_t {
     int frequency;     // scan frequency
     char* label;       // frequency label
@@ -243,13 +339,33 @@ struct freq_t {
     NotchFilter notch_filter;      // notch filter - good to remove CTCSS tones
     LowpassFilter lowpass_filter;  // lowpass filter, applied to I/Q after derotation, set at bandwidth/2 to remove out of band noise
     enum modulations modulation;
+    int priority;                 // scan priority, 0 - visited once per sweep only
+    int revisit_interval;         // ms, how often a priority frequency should be checked
+    struct timeval last_visit;    // when the scanner last tuned to this frequency
+    float revisit_latency;        // seconds between the last two visits
+    float revisit_latency_max;    // longest time between two visits
+};
+struct scan_window_t {
+    int centerfreq;
+    int freq_count;
+    int* freqs;  // indexes into the channel's freqlist
+};
+
+// Latest levels of a channel, written by the demodulator after every batch and drawn by tui_thread()
+struct tui_snapshot_t {
+    float signal_level;
+    float noise_level;
+    char symbol;
+    int frequency;
 };
+
 struct channel_t {
     float wavein[WAVE_LEN];      // FFT output waveform
     float waveout[WAVE_LEN];     // waveform after squelch + AGC (left/center channel mixer output)
     float waveout_r[WAVE_LEN];   // right channel mixer output
     float iq_in[2 * WAVE_LEN];   // raw input samples for I/Q outputs and NFM demod
     float iq_out[2 * WAVE_LEN];  // raw output samples for I/Q outputs (FIXME: allocate only if required)
+    float iq_raw[2 * WAVE_BATCH];  // raw output samples whatever the squelch state, for the pre-trigger of I/Q outputs
 #ifdef NFM
     float pr;            // previous sample - real part
     float pj;            // previous sample - imaginary part
@@ -265,14 +381,82 @@ struct channel_t {
     int freq_idx;
     int needs_raw_iq;
     int has_iq_outputs;
+    int has_pre_trigger;  // some I/Q output keeps a pre-trigger history, iq_raw is filled
     enum ch_states state;  // mixer channel state flag
     int output_count;
     output_t* outputs;
     int highpass;  // highpass filter cutoff
     int lowpass;   // lowpass filter cutoff
+    enum scan_states scan_state;  // scan engine state, see controller_thread()
+    int scan_next_freq;           // freq_idx to switch to once the current retune completes
+    size_t scan_sweep_count;
+    float scan_sweep_duration;  // seconds
+    float scan_probe_sum;         // sum of levels measured while probing the current frequency
+    int scan_probe_count;         // number of levels measured while probing the current frequency
+    struct scan_window_t* scan_windows;  // wideband scan: frequencies monitored together at each center frequency
+    int scan_window_count;
+    int scan_window;                  // window monitored once the current retune completes
+    struct channel_t* lanes;          // wideband scan: one demodulator for each frequency of the current window
+    size_t *lane_bins, *lane_base_bins;
+    int lane_count;     // lanes allocated (size of the largest window)
+    int lanes_used;     // lanes monitoring the current window
+    int lane_selected;  // lane routed to the channel outputs
+    bool low_priority;  // silenced first when the governor sheds channels
+    bool muted;         // set over the control socket, not demodulated
+    int scan_force;     // freq_idx to jump to, requested over the control socket, -1 if none
+    bool scan_hold;     // stay on the frequency jumped to until resumed
+    struct tui_snapshot_t tui;
+    TxTracker tx;  // transmissions reported to the event stream
 };
 
 enum rec_modes { R_MULTICHANNEL, R_SCAN };
+enum spectrum_sinks { SPECTRUM_FILE, SPECTRUM_UDP, SPECTRUM_UNIX, SPECTRUM_NONE };  // SPECTRUM_NONE - only feeds carrier discovery
+
+// Averaged spectrum of a device, published at a low rate for monitoring
+struct spectrum_t {
+    enum spectrum_sinks sink;
+    const char* path;  // file or unix socket
+    const char* dest_address;
+    const char* dest_port;
+    int bin_count;  // output resolution, fft_size / bin_count FFT bins are merged into one
+    int averaging;  // FFTs averaged per frame
+    int stride;     // FFTs computed between two averaged ones
+    int countdown;  // FFTs left until the next averaged one
+    int device;
+    int centerfreq;  // the accumulated FFTs were taken at this center frequency
+    int fft_count;
+    float* power;  // accumulated power of each FFT bin
+    unsigned char* frame;
+    size_t frame_len;
+    // SPECTRUM_FILE: frames are written by a thread of their own, a slow disk must not hold up the demodulator
+    THREAD writer;
+    pthread_mutex_t write_lock;
+    pthread_cond_t write_cond;
+    unsigned char* pending;  // the latest frame not written yet
+    bool pending_ready;
+    bool writer_stop;
+    int send_socket;
+    struct sockaddr_storage dest_sockaddr;
+    socklen_t dest_sockaddr_len;
+};
+
+class CarrierTracker;
+class DenseBinReader;
+class FftEngine;
+
+// Carrier discovery - slots at the end of the channel list are allocated to carriers found in the spectrum
+struct discovery_t {
+    float threshold;  // dB above the noise floor
+    double raster;    // Hz, channel spacing discovered frequencies are snapped to
+    int idle_timeout;  // seconds without squelch activity before a slot is released
+    int first_slot;    // index of the first slot in dev->channels
+    int slot_count;
+    int slots_used;
+    size_t* active_counters;        // active_counter of each slot at the last check
+    struct timeval* last_activity;  // of each slot
+    CarrierTracker* tracker;
+};
+
 struct device_t {
     input_t* input;
 #ifdef NFM
@@ -284,15 +468,33 @@ struct device_t {
     // FIXME: size_t
     int waveend;
     int waveavail;
+    unsigned char wave_blank[WAVE_LEN];  // non-zero for wave samples discarded while retuning
+    uint64_t retune_sample;              // input sample count at which retuned data becomes valid
+    bool retune_settling;                // retune_sample not reached yet (guarded by input->buffer_lock)
+    int scan_settle_samples;             // input samples to discard after a retune
+    int scan_probe_len;                  // wave samples to measure before deciding whether a frequency is idle
+    int scan_hang_time;                  // ms to stay on a frequency after activity
+    size_t scan_retune_count;
     THREAD controller_thread;
     struct freq_tag tag_queue[TAG_QUEUE_LEN];
     int tq_head, tq_tail;
     int last_frequency;
     pthread_mutex_t tag_queue_lock;
-    int row;
     int failed;
     enum rec_modes mode;
     size_t output_overrun_count;
+    spectrum_t* spectrum;    // NULL if disabled
+    discovery_t* discovery;  // NULL if disabled
+    DenseBinReader* dense;   // reads all channel bins in one pass, NULL if dense mode is disabled
+    // recovery of a failed input, see supervise_devices()
+    bool restart;                 // reopen the input when it fails
+    bool down;                    // failed, its outputs are suspended until the input is back
+    int restart_count;
+    int restart_delay;            // ms between restart attempts, doubled after every failed one
+    struct timeval up_since;      // last time the input was (re)started
+    struct timeval down_since;
+    struct timeval last_attempt;  // of a restart, or the failure
+    double downtime;              // seconds, outages which are over
 };
 
 struct mixinput_t {
@@ -321,12 +523,7 @@ struct demod_params_t {
     Signal* mp3_signal;
     int device_start;
     int device_end;
-
-#ifndef WITH_BCM_VC
-    fftwf_plan fft;
-    fftwf_complex* fftin;
-    fftwf_complex* fftout;
-#endif /* WITH_BCM_VC */
+    FftEngine* fft;
 };
 
 struct output_params_t {
@@ -341,25 +538,43 @@ struct output_params_t {
 extern char const* RTL_AIRBAND_VERSION;
 
 // output.cpp
+const output_sink_t* output_sink(enum output_type type);
+bool init_output(channel_t* channel, output_t* output);
 lame_t airlame_init(mix_modes mixmode, int highpass, int lowpass);
-void shout_setup(icecast_data* icecast, mix_modes mixmode);
+void restore_channel_state(device_t* devs, int count);
+shout_t* shout_connect(const icecast_data* icecast, mix_modes mixmode);
 void disable_device_outputs(device_t* dev);
 void disable_channel_outputs(channel_t* channel);
+void disable_output(output_t* output);
+void suspend_channel_outputs(channel_t* channel);
+void resume_channel_outputs(channel_t* channel);
 void* output_check_thread(void* params);
 void* output_thread(void* params);
 
 // rtl_airband.cpp
+void multiply(float ar, float aj, float br, float bj, float* cr, float* cj);
+#ifdef NFM
+float polar_disc_fast(float ar, float aj, float br, float bj);
+#endif /* NFM */
+void scan_resume(device_t* dev);
 extern bool use_localtime;
 extern bool multiple_demod_threads;
 extern bool multiple_output_threads;
 extern char* stats_filepath;
+extern char* state_filepath;
+extern char* control_path;  // NULL if there is no control socket
 extern size_t fft_size, fft_size_log;
+extern size_t fft_batch;  // FFTs computed at once, one wave sample each
+extern std::string fft_engine_name;
 extern int device_count, mixer_count;
 extern int shout_metadata_delay;
-extern volatile int do_exit, device_opened;
+extern volatile int do_exit, do_reload, device_opened;
 extern float alpha;
 extern device_t* devices;
 extern mixer_t* mixers;
+extern Governor* governor;  // NULL if disabled
+extern volatile bool governor_shed[SHED_ACTION_COUNT];
+extern size_t governor_shed_count[SHED_ACTION_COUNT];
 
 // util.cpp
 int atomic_inc(volatile int* pv);
@@ -379,18 +594,69 @@ void* xrealloc(void* ptr, size_t size, const char* file, const int line, const c
 #define XREALLOC(ptr, size) xrealloc((ptr), (size), __FILE__, __LINE__, __func__)
 float dBFS_to_level(const float& dBFS);
 float level_to_dBFS(const float& level);
+size_t freq_to_bin(int freq, int centerfreq, int sample_rate);
+uint32_t downmix_dphi(int freq, int centerfreq, int sample_rate);
+int scan_half_span(int sample_rate);
+int scan_dc_guard(int sample_rate);
 
 // mixer.cpp
 mixer_t* getmixerbyname(const char* name);
+void mixer_disable(mixer_t* mixer);
 int mixer_connect_input(mixer_t* mixer, float ampfactor, float balance);
 void mixer_disable_input(mixer_t* mixer, int input_idx);
+void mixer_enable_input(mixer_t* mixer, int input_idx);
 void mixer_put_samples(mixer_t* mixer, int input_idx, const float* samples, bool has_signal, unsigned int len);
 void* mixer_thread(void* params);
 const char* mixer_get_error();
 
 // config.cpp
+int count_devices(libconfig::Setting& devs);
 int parse_devices(libconfig::Setting& devs);
 int parse_mixers(libconfig::Setting& mx);
+void parse_threads(libconfig::Setting& threads);
+Governor* parse_governor(libconfig::Setting& cfg);
+http_server_t* parse_http_server(libconfig::Setting& cfg);
+event_stream_t* parse_event_stream(libconfig::Setting& cfg);
+
+// reload.cpp
+void config_write_lock(void);  // pauses all threads holding a ConfigReadLock, release with pthread_rwlock_unlock()
+void reload_config(const char* cfgfile);
+
+// recovery.cpp
+void supervise_devices(void);
+
+// tui.cpp
+void* tui_thread(void* params);
+
+// http_server.cpp
+extern http_server_t* http_server;  // NULL if disabled
+http_mount_t* http_mount(const char* path);
+void http_write(http_mount_t* mount, const unsigned char* data, size_t len);
+size_t http_listeners(http_mount_t* mount);
+void* http_server_thread(void* params);
+
+// control.cpp
+void* control_thread(void* params);
+
+// output_workers.cpp
+extern int output_pool_threads;
+void sink_attach(channel_t* channel, output_t* output);
+void sink_detach(output_t* output);
+void hold_output_sinks(void);  // a reload takes the outputs away from the workers while it moves them
+void release_output_sinks(void);
+void sink_enqueue(channel_t* channel, output_t* output, const output_batch_t* batch);
+void sink_lock(output_t* output);  // no-op for inline outputs
+void sink_unlock(output_t* output);
+size_t sink_dropped(const output_t* output);
+void stop_output_workers();  // once the inputs have stopped
+
+// event_stream.cpp
+extern event_stream_t* event_stream;  // NULL if disabled
+extern TxEventQueue* event_queue;
+void* event_stream_thread(void* params);
+
+// plan.cpp
+int print_capacity_plan(void);  // returns non-zero if the configuration may not run in real time
 
 // udp_stream.cpp
 bool udp_stream_init(udp_stream_data* sdata, mix_modes mode, size_t len);
@@ -398,6 +664,13 @@ void udp_stream_write(udp_stream_data* sdata, const float* data, size_t len);
 void udp_stream_write(udp_stream_data* sdata, const float* data_left, const float* data_right, size_t len);
 void udp_stream_shutdown(udp_stream_data* sdata);
 
+// spectrum.cpp
+bool spectrum_init(spectrum_t* spectrum, int device);
+float* spectrum_accumulator(spectrum_t* spectrum, int centerfreq);
+bool spectrum_fft_added(spectrum_t* spectrum, int sample_rate);
+const float* spectrum_levels(const spectrum_t* spectrum);
+void spectrum_shutdown(spectrum_t* spectrum);
+
 #ifdef WITH_PULSEAUDIO
 #define PULSE_STREAM_LATENCY_LIMIT 10000000UL
 // pulse.cpp
@@ -0,0 +1,162 @@
+/*
+ * scan_planner.cpp
+ *
+ * Copyright (C) 2024 charlie-foxtrot
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "scan_planner.h"
+
+#include <algorithm>  // sort
+#include <cstdlib>    // abs, llabs
+
+using namespace std;
+
+static bool centerfreq_fits(const vector<int>& sorted_freqs, size_t first, size_t last, int half_span, int dc_guard, long long c) {
+    for (size_t i = first; i < last; i++) {
+        long long offset = llabs((long long)sorted_freqs[i] - c);
+        if (offset > half_span || offset < dc_guard) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool find_centerfreq(const vector<int>& sorted_freqs, size_t first, size_t last, int half_span, int dc_guard, int* centerfreq) {
+    if (first >= last) {
+        return false;
+    }
+    long long mid = ((long long)sorted_freqs[first] + sorted_freqs[last - 1]) / 2;
+
+    vector<long long> candidates;
+    candidates.push_back(mid);
+    // prefer tuning above the signal, like the narrowband scanner always did
+    for (size_t i = first; i < last; i++) {
+        candidates.push_back((long long)sorted_freqs[i] + dc_guard);
+        candidates.push_back((long long)sorted_freqs[i] - dc_guard);
+    }
+    stable_sort(candidates.begin(), candidates.end(), [mid](long long a, long long b) { return llabs(a - mid) < llabs(b - mid); });
+
+    for (size_t i = 0; i < candidates.size(); i++) {
+        if (centerfreq_fits(sorted_freqs, first, last, half_span, dc_guard, candidates[i])) {
+            *centerfreq = (int)candidates[i];
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool freqs_fit(vector<int> freqs, int half_span, int dc_guard, int* centerfreq) {
+    sort(freqs.begin(), freqs.end());
+    return find_centerfreq(freqs, 0, freqs.size(), half_span, dc_guard, centerfreq);
+}
+
+bool plan_centerfreq(const vector<int>& pinned, const vector<int>& wanted, int current, int half_span, int dc_guard, int* centerfreq, vector<bool>* accepted) {
+    vector<int> freqs(pinned);
+    int c;
+
+    if (!freqs.empty() && !freqs_fit(freqs, half_span, dc_guard, &c)) {
+        return false;
+    }
+    accepted->assign(wanted.size(), false);
+    for (size_t i = 0; i < wanted.size(); i++) {
+        freqs.push_back(wanted[i]);
+        if (freqs_fit(freqs, half_span, dc_guard, &c)) {
+            (*accepted)[i] = true;
+        } else {
+            freqs.pop_back();
+        }
+    }
+
+    if (freqs.empty() || centerfreq_fits(freqs, 0, freqs.size(), half_span, dc_guard, current)) {
+        *centerfreq = current;
+    } else {
+        freqs_fit(freqs, half_span, dc_guard, centerfreq);
+    }
+    return true;
+}
+
+vector<ScanWindow> plan_scan_windows(const vector<int>& freqs, int half_span, int dc_guard) {
+    vector<int> order(freqs.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        order[i] = i;
+    }
+    stable_sort(order.begin(), order.end(), [&freqs](int a, int b) { return freqs[a] < freqs[b]; });
+
+    vector<int> sorted_freqs(order.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        sorted_freqs[i] = freqs[order[i]];
+    }
+
+    vector<ScanWindow> windows;
+    size_t first = 0;
+    while (first < sorted_freqs.size()) {
+        ScanWindow window;
+        // a single frequency always fits as long as the guard is narrower than the span
+        if (!find_centerfreq(sorted_freqs, first, first + 1, half_span, dc_guard, &window.centerfreq)) {
+            window.centerfreq = sorted_freqs[first] + dc_guard;
+        }
+        size_t last = first + 1;
+        int centerfreq;
+        while (last < sorted_freqs.size() && find_centerfreq(sorted_freqs, first, last + 1, half_span, dc_guard, &centerfreq)) {
+            window.centerfreq = centerfreq;
+            last++;
+        }
+        for (size_t i = first; i < last; i++) {
+            window.members.push_back(order[i]);
+        }
+        windows.push_back(window);
+        first = last;
+    }
+    return windows;
+}
+
+ScanScheduler::ScanScheduler(const vector<int>& priorities, const vector<double>& revisit_intervals, double now)
+    : priorities_(priorities), revisit_intervals_(revisit_intervals), last_visit_(priorities.size(), now), cursor_(0), current_(0), interleaved_(false) {}
+
+int ScanScheduler::next(double now, bool* sweep_done) {
+    const int step_count = priorities_.size();
+    int best = -1;
+
+    *sweep_done = false;
+    // never check two priority steps in a row, so that the normal ones don't starve
+    if (!interleaved_) {
+        for (int s = 0; s < step_count; s++) {
+            if (priorities_[s] <= 0 || s == current_ || now - last_visit_[s] < revisit_intervals_[s]) {
+                continue;
+            }
+            if (best < 0 || priorities_[s] > priorities_[best] || (priorities_[s] == priorities_[best] && last_visit_[s] < last_visit_[best])) {
+                best = s;
+            }
+        }
+    }
+
+    if (best >= 0) {
+        interleaved_ = true;
+    } else {
+        interleaved_ = false;
+        // skip the step which has just been checked out of order
+        do {
+            cursor_ = (cursor_ + 1) % step_count;
+            if (cursor_ == 0) {
+                *sweep_done = true;
+            }
+        } while (cursor_ == current_ && step_count > 1);
+        best = cursor_;
+    }
+    current_ = best;
+    last_visit_[best] = now;
+    return best;
+}
@@ -0,0 +1,80 @@
+/*
+ * scan_planner.h
+ *
+ * Copyright (C) 2024 charlie-foxtrot
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _SCAN_PLANNER_H
+#define _SCAN_PLANNER_H
+
+#include <cstddef>  // size_t
+#include <vector>
+
+struct ScanWindow {
+    int centerfreq;
+    std::vector<int> members;  // indexes into the frequency list, in ascending frequency order
+};
+
+/*
+ * Find a center frequency that puts every frequency in [first, last) of the
+ * sorted list between dc_guard and half_span Hz away from it. Candidates are
+ * the middle of the range and the edges of the DC guard around each frequency,
+ * the one closest to the middle wins. Returns false if there is none.
+ */
+bool find_centerfreq(const std::vector<int>& sorted_freqs, size_t first, size_t last, int half_span, int dc_guard, int* centerfreq);
+
+/*
+ * Choose a center frequency covering all pinned frequencies and as many of the
+ * wanted ones as possible, trying them in the given order. The current center
+ * frequency is kept if it already covers everything which has been accepted.
+ * Returns false if the pinned frequencies alone don't fit in a single span.
+ */
+bool plan_centerfreq(const std::vector<int>& pinned, const std::vector<int>& wanted, int current, int half_span, int dc_guard, int* centerfreq, std::vector<bool>* accepted);
+
+/*
+ * Group frequencies into as few center frequency windows as possible, so that
+ * a wideband scanner only has to retune between windows. Frequencies are
+ * taken in ascending order and each window is grown for as long as a valid
+ * center frequency exists.
+ */
+std::vector<ScanWindow> plan_scan_windows(const std::vector<int>& freqs, int half_span, int dc_guard);
+
+/*
+ * Decides which scan step (a single frequency, or a window of frequencies when
+ * scanning wideband) to visit next. Steps are visited in round-robin order, but
+ * a step with a non-zero priority is checked in between two normal hops as
+ * soon as its revisit interval has elapsed. The highest priority wins, ties go
+ * to the step which has been waiting for longest.
+ */
+class ScanScheduler {
+   public:
+    ScanScheduler(const std::vector<int>& priorities, const std::vector<double>& revisit_intervals, double now);
+
+    // Returns the step to visit at time now (in seconds). sweep_done is set
+    // when the round-robin order has gone through all steps.
+    int next(double now, bool* sweep_done);
+    int current(void) const { return current_; }
+
+   private:
+    std::vector<int> priorities_;
+    std::vector<double> revisit_intervals_;
+    std::vector<double> last_visit_;
+    int cursor_;   // position in round-robin order
+    int current_;  // step being visited
+    bool interleaved_;
+};
+
+#endif /* _SCAN_PLANNER_H */
@@ -0,0 +1,53 @@
+/*
+ * sink_queue.cpp
+ * Batches of audio handed from the output thread to an output worker
+ *
+ * Copyright (C) 2024 charlie-foxtrot
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "sink_queue.h"
+
+using namespace std;
+
+SinkQueue::SinkQueue(size_t slots, size_t floats) : slots_(slots), floats_(floats), data_(slots * floats), info_(slots), head_(0), tail_(0), dropped_(0) {}
+
+float* SinkQueue::back(void) {
+    const size_t tail = tail_.load(memory_order_relaxed);
+    if (tail - head_.load(memory_order_acquire) >= slots_) {
+        dropped_++;
+        return NULL;
+    }
+    return data_.data() + (tail % slots_) * floats_;
+}
+
+void SinkQueue::push(const batch_info_t& info) {
+    const size_t tail = tail_.load(memory_order_relaxed);
+    info_[tail % slots_] = info;
+    tail_.store(tail + 1, memory_order_release);
+}
+
+const float* SinkQueue::front(batch_info_t* info) const {
+    const size_t head = head_.load(memory_order_relaxed);
+    if (head == tail_.load(memory_order_acquire)) {
+        return NULL;
+    }
+    *info = info_[head % slots_];
+    return data_.data() + (head % slots_) * floats_;
+}
+
+void SinkQueue::pop(void) {
+    head_.store(head_.load(memory_order_relaxed) + 1, memory_order_release);
+}
@@ -0,0 +1,65 @@
+/*
+ * sink_queue.h
+ * Batches of audio handed from the output thread to an output worker
+ *
+ * Copyright (C) 2024 charlie-foxtrot
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _SINK_QUEUE_H
+#define _SINK_QUEUE_H
+
+#include <atomic>
+#include <cstddef>  // size_t
+#include <vector>
+
+// The state of the channel which came with a batch
+struct batch_info_t {
+    int axcindicate;
+    int freq_idx;
+    int cur_scan_freq;
+};
+
+/*
+ * Fixed number of batches of a fixed number of floats, filled in place by
+ * one thread and read in place by another, without locks. When the reader
+ * falls behind, new batches are dropped and counted.
+ */
+class SinkQueue {
+   public:
+    SinkQueue(size_t slots, size_t floats);
+
+    // Storage for the next batch, NULL if the queue is full
+    float* back(void);
+    // Makes the batch written to back() available
+    void push(const batch_info_t& info);
+
+    // The oldest batch, NULL if there is none
+    const float* front(batch_info_t* info) const;
+    void pop(void);
+
+    size_t dropped(void) const { return dropped_; }
+
+   private:
+    size_t slots_;
+    size_t floats_;
+    std::vector<float> data_;
+    std::vector<batch_info_t> info_;
+    std::atomic<size_t> head_;  // next batch to read
+    std::atomic<size_t> tail_;  // next batch to write
+    std::atomic<size_t> dropped_;
+};
+
+#endif /* _SINK_QUEUE_H */
@@ -0,0 +1,229 @@
+/*
+ * spectrum.cpp
+ * Averaged spectrum frames for monitoring the band of a device
+ *
+ * Copyright (C) 2024 charlie-foxtrot
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+#include <math.h>        // sqrtf()
+#include <pthread.h>
+#include <stdio.h>       // fopen(), rename()
+#include <string.h>      // strerror()
+#include <sys/socket.h>  // socket(), sendto()
+#include <sys/time.h>    // gettimeofday()
+#include <sys/un.h>      // sockaddr_un
+#include <syslog.h>      // LOG_INFO / LOG_ERR
+#include <unistd.h>      // close()
+#include <string>        // std::string
+
+#include <netdb.h>  // getaddrinfo()
+
+#include "rtl_airband.h"
+
+/*
+ * Frame layout, host byte order:
+ *   spectrum_frame_header
+ *   bin_count x float - average power in dBFS, lowest frequency first
+ */
+struct spectrum_frame_header {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t device;
+    uint32_t centerfreq;   // Hz
+    uint32_t sample_rate;  // Hz, the frame covers centerfreq +/- sample_rate / 2
+    uint32_t bin_count;
+    uint32_t fft_count;  // number of FFTs averaged into this frame
+    int64_t timestamp;   // microseconds since the epoch
+};
+
+#define SPECTRUM_MAGIC 0x43455053  // "SPEC"
+#define SPECTRUM_VERSION 1
+
+static void spectrum_reset(spectrum_t* spectrum, int centerfreq) {
+    memset(spectrum->power, 0, fft_size * sizeof(float));
+    spectrum->fft_count = 0;
+    spectrum->centerfreq = centerfreq;
+}
+
+static void spectrum_write_file(spectrum_t* spectrum, const unsigned char* frame) {
+    // write the latest frame next to the target and rename it, so readers never see a partial frame
+    std::string tmp_path = std::string(spectrum->path) + ".tmp";
+    FILE* f = fopen(tmp_path.c_str(), "wb");
+    if (f == NULL) {
+        log(LOG_WARNING, "spectrum: cannot open %s: %s\n", tmp_path.c_str(), strerror(errno));
+        return;
+    }
+    size_t written = fwrite(frame, 1, spectrum->frame_len, f);
+    fclose(f);
+    if (written != spectrum->frame_len || rename(tmp_path.c_str(), spectrum->path) != 0) {
+        log(LOG_WARNING, "spectrum: cannot write %s: %s\n", spectrum->path, strerror(errno));
+    }
+}
+
+static void* spectrum_writer_thread(void* param) {
+    spectrum_t* spectrum = (spectrum_t*)param;
+    unsigned char* frame = (unsigned char*)XCALLOC(1, spectrum->frame_len);
+    pthread_mutex_lock(&spectrum->write_lock);
+    while (true) {
+        while (!spectrum->pending_ready && !spectrum->writer_stop) {
+            pthread_cond_wait(&spectrum->write_cond, &spectrum->write_lock);
+        }
+        if (!spectrum->pending_ready) {
+            break;
+        }
+        memcpy(frame, spectrum->pending, spectrum->frame_len);
+        spectrum->pending_ready = false;
+        pthread_mutex_unlock(&spectrum->write_lock);
+        spectrum_write_file(spectrum, frame);
+        pthread_mutex_lock(&spectrum->write_lock);
+    }
+    pthread_mutex_unlock(&spectrum->write_lock);
+    free(frame);
+    return NULL;
+}
+
+// Hands the frame over to the writer thread. The file only keeps the latest frame, so one which
+// comes while the writer is busy just replaces the one waiting.
+static void spectrum_queue_file(spectrum_t* spectrum) {
+    if (pthread_mutex_trylock(&spectrum->write_lock) != 0) {
+        return;
+    }
+    memcpy(spectrum->pending, spectrum->frame, spectrum->frame_len);
+    spectrum->pending_ready = true;
+    pthread_cond_signal(&spectrum->write_cond);
+    pthread_mutex_unlock(&spectrum->write_lock);
+}
+
+bool spectrum_init(spectrum_t* spectrum, int device) {
+    spectrum->device = device;
+    spectrum->power = (float*)XCALLOC(fft_size, sizeof(float));
+    spectrum->frame_len = sizeof(spectrum_frame_header) + spectrum->bin_count * sizeof(float);
+    spectrum->frame = (unsigned char*)XCALLOC(1, spectrum->frame_len);
+    spectrum->send_socket = -1;
+    spectrum->countdown = spectrum->stride;
+    spectrum_reset(spectrum, 0);
+
+    if (spectrum->sink == SPECTRUM_UDP) {
+        struct addrinfo hints, *result;
+        memset(&hints, 0, sizeof(struct addrinfo));
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_DGRAM;
+        int error = getaddrinfo(spectrum->dest_address, spectrum->dest_port, &hints, &result);
+        if (error) {
+            log(LOG_ERR, "spectrum: could not resolve %s:%s - %s\n", spectrum->dest_address, spectrum->dest_port, gai_strerror(error));
+            return false;
+        }
+        spectrum->send_socket = socket(result->ai_family, result->ai_socktype, result->ai_protocol);
+        memcpy(&spectrum->dest_sockaddr, result->ai_addr, result->ai_addrlen);
+        spectrum->dest_sockaddr_len = result->ai_addrlen;
+        freeaddrinfo(result);
+    } else if (spectrum->sink == SPECTRUM_UNIX) {
+        struct sockaddr_un* addr = (struct sockaddr_un*)&spectrum->dest_sockaddr;
+        if (strlen(spectrum->path) >= sizeof(addr->sun_path)) {
+            log(LOG_ERR, "spectrum: socket path %s is too long\n", spectrum->path);
+            return false;
+        }
+        memset(addr, 0, sizeof(struct sockaddr_un));
+        addr->sun_family = AF_UNIX;
+        strcpy(addr->sun_path, spectrum->path);
+        spectrum->dest_sockaddr_len = sizeof(struct sockaddr_un);
+        spectrum->send_socket = socket(AF_UNIX, SOCK_DGRAM, 0);
+    } else if (spectrum->sink == SPECTRUM_FILE) {
+        spectrum->pending = (unsigned char*)XCALLOC(1, spectrum->frame_len);
+        spectrum->pending_ready = spectrum->writer_stop = false;
+        pthread_mutex_init(&spectrum->write_lock, NULL);
+        pthread_cond_init(&spectrum->write_cond, NULL);
+        pthread_create(&spectrum->writer, NULL, &spectrum_writer_thread, spectrum);
+        return true;
+    } else {
+        return true;
+    }
+    if (spectrum->send_socket == -1) {
+        log(LOG_ERR, "spectrum: socket failed: %s\n", strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+// Accumulator for the power of the next FFT, restarted when the device has been retuned
+float* spectrum_accumulator(spectrum_t* spectrum, int centerfreq) {
+    if (centerfreq != spectrum->centerfreq) {
+        spectrum_reset(spectrum, centerfreq);
+    }
+    return spectrum->power;
+}
+
+static void spectrum_emit(spectrum_t* spectrum, int sample_rate) {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+
+    spectrum_frame_header* header = (spectrum_frame_header*)spectrum->frame;
+    header->magic = SPECTRUM_MAGIC;
+    header->version = SPECTRUM_VERSION;
+    header->device = spectrum->device;
+    header->centerfreq = spectrum->centerfreq;
+    header->sample_rate = sample_rate;
+    header->bin_count = spectrum->bin_count;
+    header->fft_count = spectrum->fft_count;
+    header->timestamp = (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+
+    // FFT bins go from DC up to +fs/2, then from -fs/2 back to DC; output bins are merged groups of them, lowest frequency first
+    float* out = (float*)(spectrum->frame + sizeof(spectrum_frame_header));
+    const size_t group = fft_size / spectrum->bin_count;
+    for (int b = 0; b < spectrum->bin_count; b++) {
+        float sum = 0.0f;
+        for (size_t k = b * group; k < (b + 1) * group; k++) {
+            sum += spectrum->power[(k + fft_size / 2) % fft_size];
+        }
+        out[b] = level_to_dBFS(sqrtf(sum / (group * spectrum->fft_count)));
+    }
+
+    if (spectrum->sink == SPECTRUM_FILE) {
+        spectrum_queue_file(spectrum);
+    } else if (spectrum->sink != SPECTRUM_NONE) {
+        // nobody listening is not an error, just drop the frame
+        sendto(spectrum->send_socket, spectrum->frame, spectrum->frame_len, MSG_DONTWAIT | MSG_NOSIGNAL, (struct sockaddr*)&spectrum->dest_sockaddr, spectrum->dest_sockaddr_len);
+    }
+}
+
+// Called after the power of one FFT has been added to the accumulator, returns true when a new frame is complete
+bool spectrum_fft_added(spectrum_t* spectrum, int sample_rate) {
+    spectrum->countdown += spectrum->stride;
+    if (++spectrum->fft_count < spectrum->averaging) {
+        return false;
+    }
+    spectrum_emit(spectrum, sample_rate);
+    spectrum_reset(spectrum, spectrum->centerfreq);
+    return true;
+}
+
+// Levels (dBFS) of the last complete frame
+const float* spectrum_levels(const spectrum_t* spectrum) {
+    return (const float*)(spectrum->frame + sizeof(spectrum_frame_header));
+}
+
+void spectrum_shutdown(spectrum_t* spectrum) {
+    if (spectrum->sink == SPECTRUM_FILE) {
+        pthread_mutex_lock(&spectrum->write_lock);
+        spectrum->writer_stop = true;
+        pthread_cond_signal(&spectrum->write_cond);
+        pthread_mutex_unlock(&spectrum->write_lock);
+        pthread_join(spectrum->writer, NULL);
+    }
+    if (spectrum->send_socket != -1) {
+        close(spectrum->send_socket);
+        spectrum->send_socket = -1;
+    }
+}
@@ -33,6 +33,9 @@
 
 using namespace std;
 
+// CTCSS tones are below 255 Hz, at 8 kHz a quarter of the samples is plenty
+static const int ctcss_reduced_decimation = 4;
+
 Squelch::Squelch(void) {
     noise_floor_ = 5.0f;
     set_squelch_snr_threshold(9.54f);  // depends on noise_floor_, sets using_manual_level_, normal_signal_ratio_, flappy_signal_ratio_, and moving_avg_cap_
@@ -64,6 +67,11 @@ Squelch::Squelch(void) {
     recent_open_count_ = 0;
     closed_sample_count_ = 0;
 
+    ctcss_sample_rate_ = 0.0f;
+    ctcss_decimation_ = 1;
+    ctcss_phase_ = 0;
+    ctcss_sum_ = 0.0f;
+
     buffer_size_ = 102;  // NOTE: this is specific to the 2nd order lowpass Bessel filter
     buffer_head_ = 0;
     buffer_tail_ = 1;
@@ -108,11 +116,63 @@ void Squelch::set_squelch_snr_threshold(const float& db) {
 }
 
 void Squelch::set_ctcss_freq(const float& ctcss_freq, const float& sample_rate) {
+    ctcss_sample_rate_ = sample_rate;
+    set_ctcss_detectors(ctcss_freq);
+}
+
+void Squelch::set_ctcss_detectors(const float& ctcss_freq) {
     // create two CTCSS detectors with different window sizes.  0.4 sec is required to tell between all the "standard"
     // tones but 0.05 is enough to tell between tones ~20 Hz appart.  Will use ctcss_fast_ until there are enough samples
     // for ctcss_slow_
-    ctcss_fast_ = CTCSS(ctcss_freq, sample_rate, sample_rate * 0.05);
-    ctcss_slow_ = CTCSS(ctcss_freq, sample_rate, sample_rate * 0.4);
+    const float rate = ctcss_sample_rate_ / ctcss_decimation_;
+    ctcss_fast_ = CTCSS(ctcss_freq, rate, rate * 0.05);
+    ctcss_slow_ = CTCSS(ctcss_freq, rate, rate * 0.4);
+    ctcss_phase_ = 0;
+    ctcss_sum_ = 0.0f;
+}
+
+bool Squelch::ctcss_enabled(void) const {
+    return ctcss_slow_.is_enabled();
+}
+
+float Squelch::ctcss_freq(void) const {
+    return ctcss_slow_.is_enabled() ? ctcss_slow_.freq() : 0.0f;
+}
+
+void Squelch::copy_settings(const Squelch& other) {
+    using_manual_level_ = other.using_manual_level_;
+    manual_signal_level_ = other.manual_signal_level_;
+    normal_signal_ratio_ = other.normal_signal_ratio_;
+    flappy_signal_ratio_ = other.flappy_signal_ratio_;
+    calculate_moving_avg_cap();
+
+    // the tone detectors restart only if the tone has changed
+    if (ctcss_slow_.is_enabled() != other.ctcss_slow_.is_enabled() || ctcss_slow_.freq() != other.ctcss_slow_.freq()) {
+        ctcss_sample_rate_ = other.ctcss_sample_rate_;
+        ctcss_fast_ = other.ctcss_fast_;
+        ctcss_slow_ = other.ctcss_slow_;
+        ctcss_phase_ = 0;
+        ctcss_sum_ = 0.0f;
+        if (ctcss_slow_.is_enabled() && ctcss_decimation_ != other.ctcss_decimation_) {
+            set_ctcss_detectors(ctcss_slow_.freq());
+        }
+    }
+}
+
+SquelchLevels Squelch::levels(void) const {
+    SquelchLevels levels = {noise_floor_, pre_filter_.full_, post_filter_.full_};
+    return levels;
+}
+
+void Squelch::restore_levels(const SquelchLevels& levels) {
+    noise_floor_ = levels.noise_floor;
+    calculate_moving_avg_cap();
+    squelch_level_ = 0.0f;
+
+    pre_filter_.full_ = levels.signal;
+    pre_filter_.capped_ = min(moving_avg_cap_, levels.signal);
+    post_filter_.full_ = levels.filtered_signal;
+    post_filter_.capped_ = min(moving_avg_cap_, levels.filtered_signal);
 }
 
 bool Squelch::is_open(void) const {
@@ -133,6 +193,10 @@ bool Squelch::is_open(void) const {
     return false;
 }
 
+bool Squelch::is_idle(void) const {
+    return (current_state_ == CLOSED && next_state_ == CLOSED);
+}
+
 bool Squelch::should_filter_sample(void) {
     return ((has_pre_filter_signal() || current_state_ != CLOSED) && current_state_ != LOW_SIGNAL_ABORT);
 }
@@ -245,6 +309,19 @@ void Squelch::process_raw_sample(const float& sample) {
     }
 }
 
+// Raw samples of an idle (CLOSED) squelch, for callers which skip all other per-sample processing while idle.
+// Stops after the sample which starts opening the squelch, returns the number of samples consumed.
+size_t Squelch::process_idle_samples(const float* samples, size_t len) {
+    assert(is_idle());
+    for (size_t i = 0; i < len; i++) {
+        process_raw_sample(samples[i]);
+        if (next_state_ != CLOSED) {
+            return i + 1;
+        }
+    }
+    return len;
+}
+
 void Squelch::process_filtered_sample(const float& sample) {
 #ifdef DEBUG_SQUELCH
     filtered_input_ = sample;
@@ -275,6 +352,18 @@ void Squelch::process_filtered_sample(const float& sample) {
     }
 }
 
+void Squelch::set_ctcss_reduced(bool reduced) {
+    const int decimation = reduced ? ctcss_reduced_decimation : 1;
+    if (decimation == ctcss_decimation_) {
+        return;
+    }
+    ctcss_decimation_ = decimation;
+    // detection starts over at the new rate, the squelch stays closed until the tone is found again
+    if (ctcss_slow_.is_enabled()) {
+        set_ctcss_detectors(ctcss_slow_.freq());
+    }
+}
+
 void Squelch::process_audio_sample(const float& sample) {
 #ifdef DEBUG_SQUELCH
     audio_input_ = sample;
@@ -286,10 +375,21 @@ void Squelch::process_audio_sample(const float& sample) {
 
     // ctcss_ is reset on transition to CLOSED and stays "unused" while CLOSED
     if (current_state_ != CLOSED) {
+        float ctcss_sample = sample;
+        if (ctcss_decimation_ > 1) {
+            // the sum is a boxcar filter, its zeros are at the frequencies which would alias onto the tones
+            ctcss_sum_ += sample;
+            if (++ctcss_phase_ < ctcss_decimation_) {
+                return;
+            }
+            ctcss_sample = ctcss_sum_ / ctcss_decimation_;
+            ctcss_phase_ = 0;
+            ctcss_sum_ = 0.0f;
+        }
         // always send the sample to the slow (more accurate) detector, also send to the fast if there havent been enough yet
-        ctcss_slow_.process_audio_sample(sample);
+        ctcss_slow_.process_audio_sample(ctcss_sample);
         if (!ctcss_slow_.enough_samples()) {
-            ctcss_fast_.process_audio_sample(sample);
+            ctcss_fast_.process_audio_sample(ctcss_sample);
         }
     }
 }
@@ -439,6 +539,8 @@ void Squelch::update_current_state(void) {
         current_state_ = next_state_;
         ctcss_fast_.reset();
         ctcss_slow_.reset();
+        ctcss_phase_ = 0;
+        ctcss_sum_ = 0.0f;
     } else if (next_state_ == CLOSED && current_state_ == CLOSED) {
         // Count this as a closed sample towards flap detection (can stop counting at recent_sample_size_)
         if (closed_sample_count_ < recent_sample_size_) {
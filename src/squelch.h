@@ -66,6 +66,13 @@
  detector.
  */
 
+// What a squelch has learned about its channel, kept across restarts (see channel_state.h)
+struct SquelchLevels {
+    float noise_floor;
+    float signal;           // moving average of the raw samples
+    float filtered_signal;  // moving average of the filtered samples
+};
+
 class Squelch {
    public:
     Squelch();
@@ -73,12 +80,25 @@ class Squelch {
     void set_squelch_level_threshold(const float& level);
     void set_squelch_snr_threshold(const float& db);
     void set_ctcss_freq(const float& ctcss_freq, const float& sample_rate);
+    bool ctcss_enabled(void) const;
+    float ctcss_freq(void) const;  // 0 if CTCSS is not enabled
+
+    // run CTCSS detection at a fraction of the sample rate, to save CPU while overloaded
+    void set_ctcss_reduced(bool reduced);
+
+    // take the thresholds and CTCSS tone of another squelch, keeping the noise floor and state of this one
+    void copy_settings(const Squelch& other);
+
+    SquelchLevels levels(void) const;
+    void restore_levels(const SquelchLevels& levels);
 
     void process_raw_sample(const float& sample);
     void process_filtered_sample(const float& sample);
     void process_audio_sample(const float& sample);
+    size_t process_idle_samples(const float* samples, size_t len);
 
     bool is_open(void) const;
+    bool is_idle(void) const;
     bool should_filter_sample(void);
     bool should_process_audio(void);
 
@@ -156,7 +176,12 @@ class Squelch {
 
     CTCSS ctcss_fast_;  // ctcss tone detection
     CTCSS ctcss_slow_;  // ctcss tone detection
+    float ctcss_sample_rate_;
+    int ctcss_decimation_;  // audio samples summed into each sample of the detectors
+    int ctcss_phase_;
+    float ctcss_sum_;
 
+    void set_ctcss_detectors(const float& ctcss_freq);
     void set_state(State update);
     void update_current_state(void);
     bool has_pre_filter_signal(void);
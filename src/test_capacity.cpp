@@ -0,0 +1,77 @@
+/*
+ * test_capacity.cpp
+ *
+ * Copyright (C) 2024 charlie-foxtrot
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "test_base_class.h"
+
+#include "capacity.h"
+
+using namespace std;
+
+class CapacityTest : public TestBaseClass {
+   protected:
+    void SetUp(void) {
+        TestBaseClass::SetUp();
+        plan.add("demod", "device 0", "FFT", 0.2);
+        plan.add("demod", "device 0", "channel 0", 0.1);
+        plan.add("demod", "device 1", "FFT", 0.2);
+        plan.add("output", "device 0", "channel 0 mp3", 0.05);
+        plan.add("output", "", "idle", 0.01);
+    }
+
+    CapacityPlan plan;
+};
+
+TEST_F(CapacityTest, sums) {
+    EXPECT_NEAR(plan.thread_load("demod"), 0.5, 1e-9);
+    EXPECT_NEAR(plan.thread_load("output"), 0.06, 1e-9);
+    EXPECT_NEAR(plan.thread_load("mixer"), 0.0, 1e-9);
+    EXPECT_NEAR(plan.device_load("device 0"), 0.35, 1e-9);
+    EXPECT_NEAR(plan.device_load("device 1"), 0.2, 1e-9);
+    EXPECT_NEAR(plan.total_load(), 0.56, 1e-9);
+}
+
+TEST_F(CapacityTest, fits) {
+    EXPECT_TRUE(plan.warnings(0.8, 1).empty());
+    EXPECT_EQ(plan.format(0.8, 1).find("WARNING"), string::npos);
+}
+
+TEST_F(CapacityTest, thread_over_limit) {
+    plan.add("demod", "device 1", "channel 0", 0.4);
+    vector<string> w = plan.warnings(0.8, 4);
+    ASSERT_EQ(w.size(), 1);
+    EXPECT_EQ(w[0].find("demod"), 0);
+    EXPECT_NE(plan.format(0.8, 4).find("WARNING: demod"), string::npos);
+}
+
+TEST_F(CapacityTest, total_over_cpus) {
+    plan.add("mixer", "", "mixing", 0.7);
+    plan.add("uploader", "", "uploads", 0.7);
+    EXPECT_TRUE(plan.warnings(0.8, 4).empty());
+    vector<string> w = plan.warnings(0.8, 2);
+    ASSERT_EQ(w.size(), 1);
+    EXPECT_EQ(w[0].find("all threads"), 0);
+}
+
+TEST_F(CapacityTest, benchmark_call) {
+    size_t calls = 0;
+    double t = benchmark_call([&calls](void) { calls++; }, 0.001);
+    EXPECT_GT(calls, 1);
+    EXPECT_GT(t, 0.0);
+    EXPECT_LT(t, 0.001);
+}
@@ -0,0 +1,86 @@
+/*
+ * test_carrier_discovery.cpp
+ *
+ * Copyright (C) 2024 charlie-foxtrot
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "test_base_class.h"
+
+#include "carrier_discovery.h"
+
+using namespace std;
+
+static const int centerfreq = 120000000;
+static const int sample_rate = 2560000;  // 10 kHz per bin with 256 bins
+static const int half_span = 1152000;
+static const int dc_guard = 100000;
+
+class CarrierDiscoveryTest : public TestBaseClass {
+   protected:
+    vector<float> levels;
+
+    void SetUp(void) {
+        TestBaseClass::SetUp();
+        levels.assign(256, -60.0f);
+    }
+
+    // put a carrier into the bin holding the given frequency
+    void add_carrier(int freq, float level) { levels[(freq - (centerfreq - sample_rate / 2)) / 10000] = level; }
+};
+
+TEST_F(CarrierDiscoveryTest, empty_band) {
+    EXPECT_TRUE(find_carriers(levels, centerfreq, sample_rate, 10.0f, 0, half_span, dc_guard).empty());
+}
+
+TEST_F(CarrierDiscoveryTest, finds_carriers_above_threshold) {
+    add_carrier(119500000, -30.0f);
+    add_carrier(120500000, -55.0f);  // only 5 dB above the floor
+    vector<int> carriers = find_carriers(levels, centerfreq, sample_rate, 10.0f, 25000, half_span, dc_guard);
+    ASSERT_EQ(carriers.size(), 1);
+    EXPECT_EQ(carriers[0], 119500000);
+}
+
+TEST_F(CarrierDiscoveryTest, snaps_to_raster) {
+    add_carrier(120300000, -30.0f);
+    add_carrier(120290000, -30.0f);  // spill-over into the neighbouring bin
+    vector<int> carriers = find_carriers(levels, centerfreq, sample_rate, 10.0f, 25000, half_span, dc_guard);
+    ASSERT_EQ(carriers.size(), 1);
+    EXPECT_EQ(carriers[0], 120300000);
+}
+
+TEST_F(CarrierDiscoveryTest, skips_dc_and_band_edges) {
+    add_carrier(120000000, -30.0f);
+    add_carrier(118730000, -30.0f);
+    add_carrier(121260000, -30.0f);
+    EXPECT_TRUE(find_carriers(levels, centerfreq, sample_rate, 10.0f, 0, half_span, dc_guard).empty());
+}
+
+TEST_F(CarrierDiscoveryTest, tracker_needs_consecutive_frames) {
+    CarrierTracker tracker(3);
+    vector<int> a(1, 119000000), both;
+    both.push_back(119000000);
+    both.push_back(121000000);
+
+    EXPECT_TRUE(tracker.update(a).empty());
+    EXPECT_TRUE(tracker.update(both).empty());
+    vector<int> confirmed = tracker.update(both);
+    ASSERT_EQ(confirmed.size(), 1);
+    EXPECT_EQ(confirmed[0], 119000000);
+
+    // a gap resets the count
+    EXPECT_TRUE(tracker.update(vector<int>()).empty());
+    EXPECT_TRUE(tracker.update(both).empty());
+}
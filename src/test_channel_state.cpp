@@ -0,0 +1,111 @@
+/*
+ * test_channel_state.cpp
+ *
+ * Copyright (C) 2024 charlie-foxtrot
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "test_base_class.h"
+
+#include <stdio.h>
+
+#include "channel_state.h"
+
+using namespace std;
+
+class ChannelStateTest : public TestBaseClass {
+   protected:
+    channel_state_t make_state(int device, int frequency, float noise_floor) {
+        channel_state_t state = {device, frequency, {noise_floor, 2.0f * noise_floor, 1.5f * noise_floor}, 0.25f};
+        return state;
+    }
+};
+
+TEST_F(ChannelStateTest, write_and_read) {
+    const string path = temp_dir + "/state";
+    vector<channel_state_t> states;
+    states.push_back(make_state(0, 118000000, 0.0123456f));
+    states.push_back(make_state(1, 121500000, 1e-5f));
+    ASSERT_TRUE(channel_state_write(path.c_str(), 512, states));
+
+    vector<channel_state_t> read;
+    ASSERT_TRUE(channel_state_read(path.c_str(), 512, read));
+    ASSERT_EQ(read.size(), states.size());
+    for (size_t i = 0; i < states.size(); i++) {
+        EXPECT_EQ(read[i].device, states[i].device);
+        EXPECT_EQ(read[i].frequency, states[i].frequency);
+        EXPECT_EQ(read[i].squelch.noise_floor, states[i].squelch.noise_floor);
+        EXPECT_EQ(read[i].squelch.signal, states[i].squelch.signal);
+        EXPECT_EQ(read[i].squelch.filtered_signal, states[i].squelch.filtered_signal);
+        EXPECT_EQ(read[i].agc_level, states[i].agc_level);
+    }
+
+    // the temporary file has been renamed over the state file
+    FILE* f = fopen((path + ".tmp").c_str(), "r");
+    EXPECT_TRUE(f == NULL);
+}
+
+TEST_F(ChannelStateTest, other_fft_size) {
+    const string path = temp_dir + "/state";
+    vector<channel_state_t> states(1, make_state(0, 118000000, 0.01f));
+    ASSERT_TRUE(channel_state_write(path.c_str(), 512, states));
+
+    vector<channel_state_t> read;
+    EXPECT_FALSE(channel_state_read(path.c_str(), 1024, read));
+    EXPECT_TRUE(read.empty());
+}
+
+TEST_F(ChannelStateTest, missing_and_damaged_files) {
+    vector<channel_state_t> read;
+    EXPECT_FALSE(channel_state_read((temp_dir + "/missing").c_str(), 512, read));
+
+    const string path = temp_dir + "/damaged";
+    FILE* f = fopen(path.c_str(), "w");
+    ASSERT_TRUE(f != NULL);
+    fprintf(f, "rtl_airband-state 1 512\n0 118000000 0.01 0.02 0.015 0.25\n1 121500000 garbage\n");
+    fclose(f);
+    EXPECT_FALSE(channel_state_read(path.c_str(), 512, read));
+    EXPECT_TRUE(read.empty());
+
+    f = fopen(path.c_str(), "w");
+    ASSERT_TRUE(f != NULL);
+    fprintf(f, "something else\n");
+    fclose(f);
+    EXPECT_FALSE(channel_state_read(path.c_str(), 512, read));
+}
+
+TEST_F(ChannelStateTest, matcher) {
+    vector<channel_state_t> states;
+    states.push_back(make_state(0, 118000000, 1.0f));
+    states.push_back(make_state(0, 121500000, 2.0f));
+    states.push_back(make_state(0, 118000000, 3.0f));
+    states.push_back(make_state(1, 118000000, 4.0f));
+    ChannelStateMatcher matcher(states);
+
+    // the same frequency on the same device is matched in order
+    const channel_state_t* state = matcher.take(0, 118000000);
+    ASSERT_TRUE(state != NULL);
+    EXPECT_EQ(state->squelch.noise_floor, 1.0f);
+    state = matcher.take(0, 118000000);
+    ASSERT_TRUE(state != NULL);
+    EXPECT_EQ(state->squelch.noise_floor, 3.0f);
+    EXPECT_TRUE(matcher.take(0, 118000000) == NULL);
+
+    state = matcher.take(1, 118000000);
+    ASSERT_TRUE(state != NULL);
+    EXPECT_EQ(state->squelch.noise_floor, 4.0f);
+    EXPECT_TRUE(matcher.take(1, 121500000) == NULL);
+    EXPECT_TRUE(matcher.take(2, 118000000) == NULL);
+}
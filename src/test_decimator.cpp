@@ -0,0 +1,111 @@
+/*
+ * test_decimator.cpp
+ *
+ * Copyright (C) 2024 charlie-foxtrot
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "test_base_class.h"
+
+#include <cmath>
+
+#include "decimator.h"
+
+using namespace std;
+
+class DecimatorTest : public TestBaseClass {
+   protected:
+    // complex tone of unit amplitude, frequency relative to the sample rate
+    vector<float> tone(double freq, size_t count) {
+        vector<float> iq(2 * count);
+        for (size_t i = 0; i < count; i++) {
+            iq[2 * i] = (float)cos(2.0 * M_PI * freq * i);
+            iq[2 * i + 1] = (float)sin(2.0 * M_PI * freq * i);
+        }
+        return iq;
+    }
+
+    // average magnitude of the second half of the output, after the filters have settled
+    float magnitude(const vector<float>& iq, size_t count) {
+        float sum = 0.0f;
+        for (size_t i = count / 2; i < count; i++) {
+            sum += sqrtf(iq[2 * i] * iq[2 * i] + iq[2 * i + 1] * iq[2 * i + 1]);
+        }
+        return sum / (count - count / 2);
+    }
+};
+
+TEST_F(DecimatorTest, halfband_passband) {
+    HalfbandDecimator hb;
+    vector<float> in = tone(0.05, 4000);
+    vector<float> out(in.size());
+    size_t n = hb.process(in.data(), 4000, out.data());
+    EXPECT_EQ(n, 2000);
+    EXPECT_NEAR(magnitude(out, n), 1.0f, 0.01f);
+}
+
+TEST_F(DecimatorTest, halfband_rejects_aliases) {
+    // 0.35 of the input rate would alias to -0.15
+    HalfbandDecimator hb;
+    vector<float> in = tone(0.35, 4000);
+    vector<float> out(in.size());
+    size_t n = hb.process(in.data(), 4000, out.data());
+    EXPECT_LT(magnitude(out, n), 0.001f);
+}
+
+TEST_F(DecimatorTest, halfband_split_calls) {
+    // feeding the input in odd sized pieces gives the same result
+    HalfbandDecimator whole, pieces;
+    vector<float> in = tone(0.1, 1001);
+    vector<float> expected(in.size()), out(in.size());
+    size_t n = whole.process(in.data(), 1001, expected.data());
+    size_t m = pieces.process(in.data(), 333, out.data());
+    m += pieces.process(in.data() + 2 * 333, 668, out.data() + 2 * m);
+    ASSERT_EQ(n, m);
+    for (size_t i = 0; i < 2 * n; i++) {
+        EXPECT_FLOAT_EQ(out[i], expected[i]);
+    }
+}
+
+TEST_F(DecimatorTest, cic_unity_gain) {
+    CicDecimator cic(8);
+    vector<float> in(2 * 800);
+    for (size_t i = 0; i < 800; i++) {
+        in[2 * i] = 0.5f;
+        in[2 * i + 1] = -0.25f;
+    }
+    vector<float> out(in.size());
+    size_t n = cic.process(in.data(), 800, out.data());
+    ASSERT_EQ(n, 100);
+    EXPECT_NEAR(out[2 * (n - 1)], 0.5f, 1e-5f);
+    EXPECT_NEAR(out[2 * (n - 1) + 1], -0.25f, 1e-5f);
+}
+
+TEST_F(DecimatorTest, subband_shifts_and_filters) {
+    // 16x decimation of 1.6 MHz, the sub-band is centered 400 kHz above the input center
+    const double rate = 1600000.0;
+    vector<float> in = tone((400000.0 + 20000.0) / rate, 64000);
+    vector<float> out(in.size());
+    SubbandDecimator sub(400000.0, rate, 16);
+    size_t n = sub.process(in.data(), 64000, out.data());
+    EXPECT_EQ(n, 4000);
+    EXPECT_NEAR(magnitude(out, n), 1.0f, 0.1f);
+
+    // a carrier in the neighbouring sub-band is gone
+    vector<float> other = tone((400000.0 + 150000.0) / rate, 64000);
+    SubbandDecimator sub2(400000.0, rate, 16);
+    n = sub2.process(other.data(), 64000, out.data());
+    EXPECT_LT(magnitude(out, n), 0.001f);
+}
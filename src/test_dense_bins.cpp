@@ -0,0 +1,62 @@
+/*
+ * test_dense_bins.cpp
+ *
+ * Copyright (C) 2024 charlie-foxtrot
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "test_base_class.h"
+
+#include <cmath>
+
+#include "dense_bins.h"
+
+using namespace std;
+
+class DenseBinsTest : public TestBaseClass {};
+
+TEST_F(DenseBinsTest, matches_per_channel_reads) {
+    const size_t fft_size = 64;
+    vector<float> fft(2 * fft_size);
+    for (size_t k = 0; k < fft_size; k++) {
+        fft[2 * k] = k * 0.5f;
+        fft[2 * k + 1] = -(float)k;
+    }
+    size_t bins[] = {40, 3, 17, 63, 3};
+    DenseBinReader reader(bins, 5);
+    reader.read(fft.data(), bins);
+    for (int i = 0; i < 5; i++) {
+        EXPECT_EQ(reader.re(i), fft[2 * bins[i]]);
+        EXPECT_EQ(reader.im(i), fft[2 * bins[i] + 1]);
+        EXPECT_FLOAT_EQ(reader.level(i), sqrtf(fft[2 * bins[i]] * fft[2 * bins[i]] + fft[2 * bins[i] + 1] * fft[2 * bins[i] + 1]));
+    }
+
+    // bins moved after the reader was set up (AFC) are still read correctly
+    bins[2] = 18;
+    reader.read(fft.data(), bins);
+    EXPECT_EQ(reader.re(2), fft[36]);
+}
+
+TEST_F(DenseBinsTest, inactive_channels_read_as_silence) {
+    vector<float> fft(2 * 8, 1.0f);
+    size_t bins[] = {1, 2, 3};
+    DenseBinReader reader(bins, 3);
+    reader.set_active(1, false);
+    reader.read(fft.data(), bins);
+    EXPECT_FALSE(reader.active(1));
+    EXPECT_EQ(reader.level(1), 0.0f);
+    EXPECT_FLOAT_EQ(reader.level(0), sqrtf(2.0f));
+    EXPECT_FLOAT_EQ(reader.level(2), sqrtf(2.0f));
+}
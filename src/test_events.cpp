@@ -0,0 +1,135 @@
+/*
+ * test_events.cpp
+ *
+ * Copyright (C) 2024 charlie-foxtrot
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <cstdio>
+#include <cstring>
+
+#include "test_base_class.h"
+
+#include "events.h"
+
+using namespace std;
+
+class EventsTest : public TestBaseClass {
+   protected:
+    tx_event_t event(tx_event_type type) {
+        tx_event_t e;
+        memset(&e, 0, sizeof(e));
+        e.type = type;
+        e.device = 1;
+        e.channel = 2;
+        e.frequency = 118100000;
+        e.start.tv_sec = 1700000000;
+        e.start.tv_usec = 250000;
+        return e;
+    }
+
+    struct timeval at(long ms) {
+        struct timeval tv;
+        tv.tv_sec = 1000 + ms / 1000;
+        tv.tv_usec = (ms % 1000) * 1000;
+        return tv;
+    }
+};
+
+TEST_F(EventsTest, start_json) {
+    tx_event_t e = event(TX_START);
+    EXPECT_EQ(tx_event_json(e), "{\"event\":\"start\",\"device\":1,\"channel\":2,\"freq\":118100000,\"label\":null,\"start\":1700000000.250,\"ctcss\":null,\"path\":null}");
+}
+
+TEST_F(EventsTest, end_json) {
+    tx_event_t e = event(TX_END);
+    strcpy(e.label, "Tower \"north\"");
+    strcpy(e.path, "/rec/a\\b.mp3");
+    e.end.tv_sec = 1700000002;
+    e.end.tv_usec = 750000;
+    e.peak_dbfs = -12.34f;
+    e.avg_dbfs = -20.0f;
+    e.ctcss = 88.5f;
+    EXPECT_EQ(tx_event_json(e),
+              "{\"event\":\"end\",\"device\":1,\"channel\":2,\"freq\":118100000,\"label\":\"Tower \\\"north\\\"\",\"start\":1700000000.250,\"end\":1700000002.750,\"duration\":2.500,"
+              "\"peak_dbfs\":-12.3,\"avg_dbfs\":-20.0,\"ctcss\":88.5,\"path\":\"/rec/a\\\\b.mp3\"}");
+}
+
+TEST_F(EventsTest, tracker) {
+    TxTracker tracker;
+    tx_event_t e;
+    EXPECT_FALSE(tracker.update(false, -60.0f, at(0), &e));
+
+    ASSERT_TRUE(tracker.update(true, -30.0f, at(100), &e));
+    EXPECT_EQ(e.type, TX_START);
+    EXPECT_EQ(e.start.tv_usec, 100000);
+
+    EXPECT_FALSE(tracker.update(true, -10.0f, at(200), &e));
+    EXPECT_FALSE(tracker.update(true, -20.0f, at(300), &e));
+
+    ASSERT_TRUE(tracker.update(false, -60.0f, at(400), &e));
+    EXPECT_EQ(e.type, TX_END);
+    EXPECT_EQ(e.start.tv_usec, 100000);
+    EXPECT_EQ(e.end.tv_usec, 400000);
+    EXPECT_EQ(e.peak_dbfs, -10.0f);
+    EXPECT_EQ(e.avg_dbfs, -20.0f);
+
+    EXPECT_FALSE(tracker.update(false, -60.0f, at(500), &e));
+}
+
+TEST_F(EventsTest, tracker_keeps_frequency) {
+    TxTracker tracker;
+    tx_event_t e = event(TX_START);
+    e.frequency = 118100000;
+    snprintf(e.label, sizeof(e.label), "Tower");
+    e.ctcss = 88.5f;
+    ASSERT_TRUE(tracker.update(true, -30.0f, at(100), &e));
+    EXPECT_EQ(e.frequency, 118100000);
+
+    // the channel has moved on by the time the transmission ends
+    e.frequency = 121500000;
+    snprintf(e.label, sizeof(e.label), "Guard");
+    e.ctcss = 0.0f;
+    ASSERT_TRUE(tracker.update(false, -60.0f, at(400), &e));
+    EXPECT_EQ(e.type, TX_END);
+    EXPECT_EQ(e.frequency, 118100000);
+    EXPECT_STREQ(e.label, "Tower");
+    EXPECT_EQ(e.ctcss, 88.5f);
+}
+
+TEST_F(EventsTest, queue) {
+    TxEventQueue queue(4);
+    tx_event_t e = event(TX_START), out;
+    EXPECT_FALSE(queue.pop(&out));
+
+    for (int i = 0; i < 6; i++) {
+        e.channel = i;
+        EXPECT_EQ(queue.push(e), i < 4);
+    }
+    EXPECT_EQ(queue.dropped(), 2);
+
+    // the slots are reused after being read
+    for (int i = 0; i < 3; i++) {
+        ASSERT_TRUE(queue.pop(&out));
+        EXPECT_EQ(out.channel, i);
+    }
+    e.channel = 10;
+    EXPECT_TRUE(queue.push(e));
+    ASSERT_TRUE(queue.pop(&out));
+    EXPECT_EQ(out.channel, 3);
+    ASSERT_TRUE(queue.pop(&out));
+    EXPECT_EQ(out.channel, 10);
+    EXPECT_FALSE(queue.pop(&out));
+}
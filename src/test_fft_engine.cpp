@@ -0,0 +1,102 @@
+/*
+ * test_fft_engine.cpp
+ *
+ * Copyright (C) 2024 charlie-foxtrot
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "test_base_class.h"
+
+#include <cmath>
+
+#include "fft_engine.h"
+
+using namespace std;
+
+class FftEngineTest : public TestBaseClass {
+   protected:
+    // fill transform b with a complex tone in the given bin and check that all the energy ends up there
+    void check_tone(FftEngine* fft, size_t b, size_t bin) {
+        const size_t n = fft->size();
+        float* in = fft->input(b);
+        for (size_t i = 0; i < n; i++) {
+            in[2 * i] = (float)cos(2.0 * M_PI * bin * i / n);
+            in[2 * i + 1] = (float)sin(2.0 * M_PI * bin * i / n);
+        }
+        fft->execute();
+        const float* out = fft->output(b);
+        for (size_t k = 0; k < n; k++) {
+            float mag = sqrtf(out[2 * k] * out[2 * k] + out[2 * k + 1] * out[2 * k + 1]);
+            EXPECT_NEAR(mag, k == bin ? (float)n : 0.0f, 0.01f * n) << "bin " << k;
+        }
+    }
+};
+
+TEST_F(FftEngineTest, unknown_engine) {
+    EXPECT_EQ(fft_engine_new("no_such_engine", 8, 1), (FftEngine*)NULL);
+}
+
+TEST_F(FftEngineTest, builtin_single) {
+    FftEngine* fft = fft_engine_new("builtin", 8, 1);
+    ASSERT_NE(fft, (FftEngine*)NULL);
+    EXPECT_EQ(fft->size(), 256);
+    check_tone(fft, 0, 5);
+    check_tone(fft, 0, 200);
+    delete fft;
+}
+
+TEST_F(FftEngineTest, builtin_matches_dft) {
+    const size_t n = 256;
+    FftEngine* fft = fft_engine_new("builtin", 8, 1);
+    ASSERT_NE(fft, (FftEngine*)NULL);
+    float* in = fft->input(0);
+    for (size_t i = 0; i < 2 * n; i++) {
+        in[i] = (float)((i * 7919) % 101) / 101.0f - 0.5f;
+    }
+    fft->execute();
+    for (size_t k = 0; k < n; k += 17) {
+        double re = 0.0, im = 0.0;
+        for (size_t i = 0; i < n; i++) {
+            double phi = -2.0 * M_PI * k * i / n;
+            re += in[2 * i] * cos(phi) - in[2 * i + 1] * sin(phi);
+            im += in[2 * i] * sin(phi) + in[2 * i + 1] * cos(phi);
+        }
+        EXPECT_NEAR(fft->output(0)[2 * k], re, 1e-3);
+        EXPECT_NEAR(fft->output(0)[2 * k + 1], im, 1e-3);
+    }
+    delete fft;
+}
+
+TEST_F(FftEngineTest, builtin_batch) {
+    FftEngine* fft = fft_engine_new("builtin", 9, 4);
+    ASSERT_NE(fft, (FftEngine*)NULL);
+    EXPECT_EQ(fft->batch(), 4);
+    for (size_t b = 0; b < 4; b++) {
+        check_tone(fft, b, 10 + 50 * b);
+    }
+    delete fft;
+}
+
+TEST_F(FftEngineTest, benchmark_picks_batch) {
+    string name = "builtin";
+    size_t batch = 0;
+    EXPECT_TRUE(fft_engine_benchmark(8, name, batch));
+    EXPECT_EQ(name, "builtin");
+    EXPECT_GT(batch, 0);
+
+    batch = 3;
+    EXPECT_TRUE(fft_engine_benchmark(8, name, batch));
+    EXPECT_EQ(batch, 3);
+}
@@ -39,3 +39,14 @@ TEST_F(FiltersTest, default_lowpass) {
     LowpassFilter lowpass;
     EXPECT_FALSE(lowpass.enabled());
 }
+
+TEST_F(FiltersTest, same_coefficients) {
+    EXPECT_TRUE(NotchFilter().same_coefficients(NotchFilter()));
+    EXPECT_TRUE(NotchFilter(100, 8000, 10).same_coefficients(NotchFilter(100, 8000, 10)));
+    EXPECT_FALSE(NotchFilter(100, 8000, 10).same_coefficients(NotchFilter(110, 8000, 10)));
+    EXPECT_FALSE(NotchFilter(100, 8000, 10).same_coefficients(NotchFilter()));
+
+    EXPECT_TRUE(LowpassFilter(1000, 8000).same_coefficients(LowpassFilter(1000, 8000)));
+    EXPECT_FALSE(LowpassFilter(1000, 8000).same_coefficients(LowpassFilter(1500, 8000)));
+    EXPECT_FALSE(LowpassFilter().same_coefficients(LowpassFilter(1000, 8000)));
+}
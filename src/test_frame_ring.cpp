@@ -0,0 +1,110 @@
+/*
+ * test_frame_ring.cpp
+ *
+ * Copyright (C) 2024 charlie-foxtrot
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "test_base_class.h"
+
+#include "frame_ring.h"
+
+using namespace std;
+
+class FrameRingTest : public TestBaseClass {
+   protected:
+    FrameRingTest(void) : ring(100) {}
+
+    // a frame of len bytes, all set to value
+    void push(unsigned char value, size_t len) {
+        vector<unsigned char> frame(len, value);
+        ring.push(frame.data(), len);
+    }
+
+    // everything the reader at pos gets until it's up to date
+    string read(uint64_t* pos, size_t burst, bool* skipped) {
+        string out;
+        const unsigned char* data;
+        bool skip;
+        size_t len;
+        *skipped = false;
+        while ((len = ring.peek(pos, burst, &data, &skip)) > 0) {
+            *skipped |= skip;
+            out.append((const char*)data, len);
+            *pos += len;
+        }
+        return out;
+    }
+
+    FrameRing ring;
+};
+
+TEST_F(FrameRingTest, empty) {
+    uint64_t pos = ring.burst_start(50);
+    bool skipped;
+    EXPECT_EQ(pos, 0);
+    EXPECT_EQ(read(&pos, 50, &skipped), "");
+    EXPECT_FALSE(skipped);
+}
+
+TEST_F(FrameRingTest, burst_on_connect) {
+    push('a', 30);
+    push('b', 30);
+    push('c', 30);
+    EXPECT_EQ(ring.head(), 90);
+    EXPECT_EQ(ring.burst_start(0), 90);
+    EXPECT_EQ(ring.burst_start(30), 60);
+    // never in the middle of a frame
+    EXPECT_EQ(ring.burst_start(45), 60);
+    EXPECT_EQ(ring.burst_start(1000), 0);
+
+    uint64_t pos = ring.burst_start(30);
+    bool skipped;
+    EXPECT_EQ(read(&pos, 30, &skipped), string(30, 'c'));
+    EXPECT_FALSE(skipped);
+}
+
+TEST_F(FrameRingTest, wraps_around) {
+    uint64_t pos = 0;
+    bool skipped;
+    push('a', 60);
+    EXPECT_EQ(read(&pos, 30, &skipped), string(60, 'a'));
+    push('b', 60);
+    // the second frame wraps, the reader gets it in two pieces
+    EXPECT_EQ(read(&pos, 30, &skipped), string(60, 'b'));
+    EXPECT_FALSE(skipped);
+    EXPECT_EQ(pos, 120);
+    EXPECT_EQ(ring.burst_start(1000), 60);
+}
+
+TEST_F(FrameRingTest, slow_reader_skips_ahead) {
+    uint64_t pos = 0;
+    bool skipped;
+    for (unsigned char c = 'a'; c < 'h'; c++) {
+        push(c, 20);
+    }
+    // 140 bytes written, the first 40 are gone
+    EXPECT_EQ(read(&pos, 40, &skipped), string(20, 'f') + string(20, 'g'));
+    EXPECT_TRUE(skipped);
+}
+
+TEST_F(FrameRingTest, oversized_write) {
+    push('a', 150);
+    EXPECT_EQ(ring.head(), 150);
+    // no frame boundary left, new readers wait for the next frame
+    EXPECT_EQ(ring.burst_start(1000), 150);
+    push('b', 10);
+    EXPECT_EQ(ring.burst_start(1000), 150);
+}
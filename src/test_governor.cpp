@@ -0,0 +1,99 @@
+/*
+ * test_governor.cpp
+ *
+ * Copyright (C) 2024 charlie-foxtrot
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "test_base_class.h"
+
+#include "governor.h"
+
+using namespace std;
+
+class GovernorTest : public TestBaseClass {
+   protected:
+    GovernorTest(void) : governor(vector<int>({SHED_TUI, SHED_AFC, SHED_CHANNELS}), 0.5f, 0.2f, 2.0, 10.0) {}
+
+    Governor governor;
+    int action;
+    bool shed;
+};
+
+TEST_F(GovernorTest, idle) {
+    for (double t = 0.0; t < 60.0; t += 0.1) {
+        EXPECT_FALSE(governor.update(t, 0.1f, false, &action, &shed));
+    }
+    EXPECT_EQ(governor.level(), 0);
+}
+
+TEST_F(GovernorTest, sheds_in_order) {
+    ASSERT_TRUE(governor.update(0.0, 0.8f, false, &action, &shed));
+    EXPECT_EQ(action, SHED_TUI);
+    EXPECT_TRUE(shed);
+
+    // the next step waits for the first one to take effect
+    EXPECT_FALSE(governor.update(1.0, 0.8f, false, &action, &shed));
+    ASSERT_TRUE(governor.update(2.0, 0.3f, true, &action, &shed));
+    EXPECT_EQ(action, SHED_AFC);
+    ASSERT_TRUE(governor.update(4.0, 0.9f, false, &action, &shed));
+    EXPECT_EQ(action, SHED_CHANNELS);
+
+    // nothing left to shed
+    EXPECT_FALSE(governor.update(6.0, 0.9f, false, &action, &shed));
+    EXPECT_EQ(governor.level(), 3);
+    EXPECT_TRUE(governor.shed(SHED_AFC));
+    EXPECT_FALSE(governor.shed(SHED_CTCSS));
+}
+
+TEST_F(GovernorTest, restores_in_reverse_order) {
+    ASSERT_TRUE(governor.update(0.0, 0.8f, false, &action, &shed));
+    ASSERT_TRUE(governor.update(2.0, 0.8f, false, &action, &shed));
+
+    // between the water marks nothing changes
+    for (double t = 2.1; t < 30.0; t += 0.1) {
+        EXPECT_FALSE(governor.update(t, 0.3f, false, &action, &shed));
+    }
+
+    // headroom has to last for the restore delay
+    EXPECT_FALSE(governor.update(30.0, 0.1f, false, &action, &shed));
+    EXPECT_FALSE(governor.update(39.9, 0.1f, false, &action, &shed));
+    ASSERT_TRUE(governor.update(40.0, 0.1f, false, &action, &shed));
+    EXPECT_EQ(action, SHED_AFC);
+    EXPECT_FALSE(shed);
+
+    // leaving the low water mark starts the wait over
+    EXPECT_FALSE(governor.update(45.0, 0.3f, false, &action, &shed));
+    EXPECT_FALSE(governor.update(50.0, 0.1f, false, &action, &shed));
+    EXPECT_FALSE(governor.update(59.9, 0.1f, false, &action, &shed));
+    ASSERT_TRUE(governor.update(60.0, 0.1f, false, &action, &shed));
+    EXPECT_EQ(action, SHED_TUI);
+    EXPECT_EQ(governor.level(), 0);
+}
+
+TEST_F(GovernorTest, sheds_again_after_restore) {
+    ASSERT_TRUE(governor.update(0.0, 0.8f, false, &action, &shed));
+    EXPECT_FALSE(governor.update(1.0, 0.1f, false, &action, &shed));
+    ASSERT_TRUE(governor.update(11.0, 0.1f, false, &action, &shed));
+    EXPECT_FALSE(shed);
+    ASSERT_TRUE(governor.update(13.0, 0.1f, true, &action, &shed));
+    EXPECT_EQ(action, SHED_TUI);
+    EXPECT_TRUE(shed);
+}
+
+TEST_F(GovernorTest, action_names) {
+    EXPECT_STREQ(shed_action_name(SHED_CTCSS), "ctcss");
+    EXPECT_EQ(shed_action_name(SHED_ACTION_COUNT), (const char*)NULL);
+}
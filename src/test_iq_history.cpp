@@ -0,0 +1,89 @@
+/*
+ * test_iq_history.cpp
+ *
+ * Copyright (C) 2024 charlie-foxtrot
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "test_base_class.h"
+
+#include "iq_history.h"
+
+using namespace std;
+
+class IqHistoryTest : public TestBaseClass {
+   protected:
+    // count complex samples, starting at value first and counting up
+    vector<float> block(float first, size_t count, float step = 1.0f) {
+        vector<float> iq(2 * count);
+        for (size_t i = 0; i < 2 * count; i++) {
+            iq[i] = first + i * step;
+        }
+        return iq;
+    }
+};
+
+TEST_F(IqHistoryTest, empty) {
+    IqHistory history(100);
+    vector<float> out(10);
+    EXPECT_EQ(history.size(), 0);
+    history.drain(out);
+    EXPECT_TRUE(out.empty());
+}
+
+TEST_F(IqHistoryTest, round_trip) {
+    IqHistory history(100);
+    vector<float> strong = block(-20000.0f, 10, 1000.0f);
+    vector<float> weak = block(-0.01f, 10, 0.001f);
+    vector<float> silent(20, 0.0f);
+    history.push(strong.data(), 10);
+    history.push(weak.data(), 10);
+    history.push(silent.data(), 10);
+    EXPECT_EQ(history.size(), 30);
+
+    vector<float> out;
+    history.drain(out);
+    ASSERT_EQ(out.size(), 60);
+    for (size_t i = 0; i < 20; i++) {
+        // each block keeps its own scale, so the weak one is as accurate as the strong one
+        EXPECT_NEAR(out[i], strong[i], 20000.0f / 32767.0f);
+        EXPECT_NEAR(out[20 + i], weak[i], 0.01f / 32767.0f);
+        EXPECT_EQ(out[40 + i], 0.0f);
+    }
+    EXPECT_EQ(history.size(), 0);
+}
+
+TEST_F(IqHistoryTest, keeps_the_latest) {
+    IqHistory history(25);
+    for (int b = 0; b < 10; b++) {
+        vector<float> iq = block(b * 100.0f, 10);
+        history.push(iq.data(), 10);
+    }
+    // whole blocks are dropped, as long as max_samples are left
+    EXPECT_EQ(history.size(), 30);
+
+    vector<float> out;
+    history.drain(out);
+    ASSERT_EQ(out.size(), 60);
+    EXPECT_NEAR(out[0], 700.0f, 0.1f);
+    EXPECT_NEAR(out[59], 919.0f, 0.1f);
+
+    // reusing the storage of the dropped blocks
+    vector<float> iq = block(5.0f, 10);
+    history.push(iq.data(), 10);
+    history.drain(out);
+    ASSERT_EQ(out.size(), 20);
+    EXPECT_NEAR(out[19], 24.0f, 0.01f);
+}
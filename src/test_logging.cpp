@@ -0,0 +1,124 @@
+/*
+ * test_logging.cpp
+ *
+ * Copyright (C) 2024 charlie-foxtrot
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "test_base_class.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+#include "logging.h"
+
+using namespace std;
+
+class LoggingTest : public TestBaseClass {
+   protected:
+    // send everything written to stderr into a file instead
+    void capture_stderr(void) {
+        fflush(stderr);
+        saved_stderr = dup(2);
+        int fd = open((temp_dir + "/stderr").c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        ASSERT_NE(fd, -1);
+        dup2(fd, 2);
+        close(fd);
+    }
+
+    vector<string> captured_lines(void) {
+        fflush(stderr);
+        dup2(saved_stderr, 2);
+        close(saved_stderr);
+
+        vector<string> lines;
+        ifstream file(temp_dir + "/stderr");
+        string line;
+        while (getline(file, line)) {
+            lines.push_back(line);
+        }
+        return lines;
+    }
+
+    int saved_stderr;
+};
+
+TEST_F(LoggingTest, direct_without_thread) {
+    capture_stderr();
+    for (int i = 0; i < 2 * LOG_RATE_BURST; i++) {
+        log(LOG_WARNING, "direct %d\n", i);
+    }
+    vector<string> lines = captured_lines();
+    ASSERT_EQ(lines.size(), 2 * LOG_RATE_BURST);
+    EXPECT_EQ(lines.front(), "direct 0");
+    EXPECT_EQ(lines.back(), "direct " + to_string(2 * LOG_RATE_BURST - 1));
+}
+
+TEST_F(LoggingTest, rate_limit) {
+    unsigned long suppressed_before, suppressed_after, dropped;
+    log_counters(&suppressed_before, &dropped);
+
+    capture_stderr();
+    start_log_thread();
+    for (int i = 0; i < 100; i++) {
+        log(LOG_WARNING, "burst %d\n", i);
+    }
+    log(LOG_WARNING, "another call site\n");
+    stop_log_thread();
+    vector<string> lines = captured_lines();
+
+    log_counters(&suppressed_after, &dropped);
+    EXPECT_EQ(suppressed_after - suppressed_before, 100 - LOG_RATE_BURST);
+
+    // the first messages in order, then the other call site, then the summary
+    ASSERT_EQ(lines.size(), LOG_RATE_BURST + 2);
+    for (int i = 0; i < LOG_RATE_BURST; i++) {
+        EXPECT_EQ(lines[i], "burst " + to_string(i));
+    }
+    EXPECT_EQ(lines[LOG_RATE_BURST], "another call site");
+    EXPECT_EQ(lines[LOG_RATE_BURST + 1], to_string(100 - LOG_RATE_BURST) + " more messages like \"burst %d\" suppressed");
+}
+
+TEST_F(LoggingTest, direct_after_stop) {
+    start_log_thread();
+    stop_log_thread();
+    capture_stderr();
+    log(LOG_WARNING, "after stop\n");
+    vector<string> lines = captured_lines();
+    ASSERT_EQ(lines.size(), 1);
+    EXPECT_EQ(lines[0], "after stop");
+}
+
+TEST_F(LoggingTest, config_errors_collected_per_thread) {
+    ostringstream messages;
+    collect_config_errors(&messages);
+    EXPECT_EQ(&config_errors(), &messages);
+    config_errors() << "collected\n";
+
+    // the other threads keep writing to stderr
+    ostream* other = NULL;
+    thread t([&other]() { other = &config_errors(); });
+    t.join();
+    EXPECT_EQ(other, &cerr);
+
+    collect_config_errors(NULL);
+    EXPECT_EQ(&config_errors(), &cerr);
+    EXPECT_EQ(messages.str(), "collected\n");
+}
@@ -0,0 +1,175 @@
+/*
+ * test_scan_planner.cpp
+ *
+ * Copyright (C) 2024 charlie-foxtrot
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "test_base_class.h"
+
+#include "scan_planner.h"
+
+using namespace std;
+
+static const int half_span = 1080000;  // 2.4 MHz * 0.9 / 2
+static const int dc_guard = 100000;
+
+class ScanPlannerTest : public TestBaseClass {
+   protected:
+    void check_windows(const vector<int>& freqs, const vector<ScanWindow>& windows) {
+        vector<int> seen(freqs.size(), 0);
+        for (size_t w = 0; w < windows.size(); w++) {
+            for (size_t k = 0; k < windows[w].members.size(); k++) {
+                int idx = windows[w].members[k];
+                int offset = abs(freqs[idx] - windows[w].centerfreq);
+                EXPECT_LE(offset, half_span);
+                EXPECT_GE(offset, dc_guard);
+                seen[idx]++;
+            }
+        }
+        for (size_t i = 0; i < seen.size(); i++) {
+            EXPECT_EQ(seen[i], 1);
+        }
+    }
+};
+
+TEST_F(ScanPlannerTest, empty_list) {
+    EXPECT_TRUE(plan_scan_windows(vector<int>(), half_span, dc_guard).empty());
+}
+
+TEST_F(ScanPlannerTest, single_frequency) {
+    vector<int> freqs = {118000000};
+    vector<ScanWindow> windows = plan_scan_windows(freqs, half_span, dc_guard);
+    ASSERT_EQ(windows.size(), 1);
+    check_windows(freqs, windows);
+}
+
+TEST_F(ScanPlannerTest, frequencies_within_span_share_window) {
+    vector<int> freqs = {119100000, 118050000, 118500000, 120000000};
+    vector<ScanWindow> windows = plan_scan_windows(freqs, half_span, dc_guard);
+    ASSERT_EQ(windows.size(), 1);
+    check_windows(freqs, windows);
+
+    // members are listed in ascending frequency order
+    ASSERT_EQ(windows[0].members.size(), 4);
+    EXPECT_EQ(windows[0].members[0], 1);
+    EXPECT_EQ(windows[0].members[1], 2);
+    EXPECT_EQ(windows[0].members[2], 0);
+    EXPECT_EQ(windows[0].members[3], 3);
+}
+
+TEST_F(ScanPlannerTest, distant_frequencies_need_separate_windows) {
+    vector<int> freqs = {118000000, 118900000, 125000000, 135000000, 135500000};
+    vector<ScanWindow> windows = plan_scan_windows(freqs, half_span, dc_guard);
+    EXPECT_EQ(windows.size(), 3);
+    check_windows(freqs, windows);
+}
+
+TEST_F(ScanPlannerTest, center_avoids_dc_spike) {
+    // the middle of the range is occupied, so the center has to be moved aside
+    vector<int> freqs = {118000000, 118500000, 119000000};
+    vector<ScanWindow> windows = plan_scan_windows(freqs, half_span, dc_guard);
+    ASSERT_EQ(windows.size(), 1);
+    check_windows(freqs, windows);
+    EXPECT_NE(windows[0].centerfreq, 118500000);
+}
+
+TEST_F(ScanPlannerTest, dense_band) {
+    vector<int> freqs;
+    for (int f = 118000000; f < 137000000; f += 25000) {
+        freqs.push_back(f);
+    }
+    vector<ScanWindow> windows = plan_scan_windows(freqs, half_span, dc_guard);
+    check_windows(freqs, windows);
+    // no gap for the DC spike, so every window ends up on one side of its center
+    EXPECT_LE(windows.size(), 19000000 / (half_span - dc_guard) + 1);
+}
+
+TEST_F(ScanPlannerTest, find_centerfreq_fails_when_too_wide) {
+    vector<int> freqs = {118000000, 121000000};
+    int centerfreq;
+    EXPECT_FALSE(find_centerfreq(freqs, 0, 2, half_span, dc_guard, &centerfreq));
+    EXPECT_TRUE(find_centerfreq(freqs, 0, 1, half_span, dc_guard, &centerfreq));
+}
+
+TEST_F(ScanPlannerTest, scheduler_round_robin) {
+    ScanScheduler scheduler(vector<int>(3, 0), vector<double>(3, 1.0), 0.0);
+    bool sweep_done;
+    EXPECT_EQ(scheduler.current(), 0);
+    EXPECT_EQ(scheduler.next(1.0, &sweep_done), 1);
+    EXPECT_FALSE(sweep_done);
+    EXPECT_EQ(scheduler.next(2.0, &sweep_done), 2);
+    EXPECT_FALSE(sweep_done);
+    EXPECT_EQ(scheduler.next(3.0, &sweep_done), 0);
+    EXPECT_TRUE(sweep_done);
+}
+
+TEST_F(ScanPlannerTest, scheduler_interleaves_priority_steps) {
+    // step 0 is a priority step which has to be checked every 0.25 s
+    vector<int> priorities = {1, 0, 0, 0, 0, 0};
+    vector<double> revisit = {0.25, 0, 0, 0, 0, 0};
+    ScanScheduler scheduler(priorities, revisit, 0.0);
+    bool sweep_done;
+
+    vector<int> visits;
+    for (int n = 1; n <= 8; n++) {
+        visits.push_back(scheduler.next(n * 0.1, &sweep_done));
+    }
+    vector<int> expected = {1, 2, 0, 3, 4, 0, 5, 0};
+    EXPECT_EQ(visits, expected);
+}
+
+TEST_F(ScanPlannerTest, scheduler_prefers_higher_priority) {
+    vector<int> priorities = {1, 2, 0, 0};
+    vector<double> revisit = {0.1, 1.0, 0, 0};
+    ScanScheduler scheduler(priorities, revisit, 0.0);
+    bool sweep_done;
+
+    EXPECT_EQ(scheduler.next(1.0, &sweep_done), 1);  // both are overdue, step 1 is more important
+    EXPECT_EQ(scheduler.next(1.1, &sweep_done), 2);  // normal hop in between
+    EXPECT_EQ(scheduler.next(1.2, &sweep_done), 0);  // step 1 has been visited recently enough
+}
+
+TEST_F(ScanPlannerTest, plan_centerfreq_tunes_above_single_frequency) {
+    int centerfreq;
+    vector<bool> accepted;
+    EXPECT_TRUE(plan_centerfreq(vector<int>(), {118000000}, 0, half_span, dc_guard, &centerfreq, &accepted));
+    EXPECT_EQ(centerfreq, 118000000 + dc_guard);
+    EXPECT_EQ(accepted, vector<bool>({true}));
+}
+
+TEST_F(ScanPlannerTest, plan_centerfreq_keeps_current_center) {
+    int centerfreq;
+    vector<bool> accepted;
+    EXPECT_TRUE(plan_centerfreq({118500000}, {119000000}, 118700000, half_span, dc_guard, &centerfreq, &accepted));
+    EXPECT_EQ(centerfreq, 118700000);
+    EXPECT_EQ(accepted, vector<bool>({true}));
+}
+
+TEST_F(ScanPlannerTest, plan_centerfreq_time_slices_conflicts) {
+    int centerfreq;
+    vector<bool> accepted;
+    // the second wanted frequency can't share a span with the pinned one
+    EXPECT_TRUE(plan_centerfreq({118500000}, {119000000, 125000000, 118000000}, 0, half_span, dc_guard, &centerfreq, &accepted));
+    EXPECT_EQ(accepted, vector<bool>({true, false, true}));
+    EXPECT_LE(abs(118000000 - centerfreq), half_span);
+    EXPECT_LE(abs(119000000 - centerfreq), half_span);
+}
+
+TEST_F(ScanPlannerTest, plan_centerfreq_pinned_conflict) {
+    int centerfreq;
+    vector<bool> accepted;
+    EXPECT_FALSE(plan_centerfreq({118000000, 125000000}, vector<int>(), 0, half_span, dc_guard, &centerfreq, &accepted));
+}
@@ -0,0 +1,111 @@
+/*
+ * test_sink_queue.cpp
+ *
+ * Copyright (C) 2024 charlie-foxtrot
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <atomic>
+
+#include "test_base_class.h"
+
+#include "sink_queue.h"
+
+using namespace std;
+
+class SinkQueueTest : public TestBaseClass {
+   protected:
+    static bool put(SinkQueue& queue, int value) {
+        float* batch = queue.back();
+        if (batch == NULL) {
+            return false;
+        }
+        batch[0] = batch[1] = value;
+        batch_info_t info = {value, 0, -1};
+        queue.push(info);
+        return true;
+    }
+
+    struct reader_param_t {
+        SinkQueue* queue;
+        std::atomic<bool> done;  // set when the reader exits, so that the writer doesn't wait for it forever
+    };
+
+    static void* reader(void* param) {
+        reader_param_t* p = (reader_param_t*)param;
+        int expected = 0;
+        batch_info_t info;
+        void* result = NULL;
+        while (expected < 10000) {
+            const float* batch = p->queue->front(&info);
+            if (batch == NULL) {
+                sched_yield();
+                continue;
+            }
+            if (batch[0] != expected || batch[1] != expected || info.axcindicate != expected) {
+                result = (void*)1;
+                break;
+            }
+            p->queue->pop();
+            expected++;
+        }
+        p->done = true;
+        return result;
+    }
+};
+
+TEST_F(SinkQueueTest, fifo) {
+    SinkQueue queue(3, 2);
+    batch_info_t info;
+    EXPECT_EQ(queue.front(&info), (const float*)NULL);
+
+    EXPECT_TRUE(put(queue, 1));
+    EXPECT_TRUE(put(queue, 2));
+    EXPECT_TRUE(put(queue, 3));
+    EXPECT_FALSE(put(queue, 4));
+    EXPECT_EQ(queue.dropped(), 1);
+
+    for (int value = 1; value <= 5; value++) {
+        const float* batch = queue.front(&info);
+        ASSERT_NE(batch, (const float*)NULL);
+        EXPECT_EQ(batch[0], value);
+        EXPECT_EQ(info.axcindicate, value);
+        queue.pop();
+        // the slot read last is written next
+        EXPECT_TRUE(put(queue, value + 3));
+    }
+    EXPECT_EQ(queue.dropped(), 1);
+}
+
+TEST_F(SinkQueueTest, threads) {
+    SinkQueue queue(4, 2);
+    reader_param_t param;
+    param.queue = &queue;
+    param.done = false;
+    pthread_t thread;
+    ASSERT_EQ(pthread_create(&thread, NULL, &SinkQueueTest::reader, &param), 0);
+    for (int value = 0; value < 10000 && !param.done;) {
+        if (put(queue, value)) {
+            value++;
+        } else {
+            sched_yield();
+        }
+    }
+    void* result;
+    pthread_join(thread, &result);
+    EXPECT_EQ(result, (void*)NULL);
+}
@@ -164,6 +164,34 @@ TEST_F(SquelchTest, should_process_audio) {
     ASSERT_FALSE(squelch.should_process_audio());
 }
 
+TEST_F(SquelchTest, idle_samples) {
+    Squelch idle, full;
+    send_samples_for_noise_floor(idle);
+    send_samples_for_noise_floor(full);
+    ASSERT_TRUE(idle.is_idle());
+
+    // idle processing tracks the same levels as processing each sample
+    vector<float> samples(300, raw_no_signal_sample);
+    EXPECT_EQ(idle.process_idle_samples(samples.data(), samples.size()), samples.size());
+    for (size_t i = 0; i < samples.size(); ++i) {
+        full.process_raw_sample(samples[i]);
+    }
+    EXPECT_EQ(idle.noise_level(), full.noise_level());
+    EXPECT_EQ(idle.signal_level(), full.signal_level());
+    ASSERT_TRUE(idle.is_idle());
+
+    // and stops as soon as a signal starts opening the squelch
+    samples.assign(300, raw_signal_sample);
+    size_t consumed = idle.process_idle_samples(samples.data(), samples.size());
+    EXPECT_LT(consumed, samples.size());
+    EXPECT_FALSE(idle.is_idle());
+    for (size_t i = 0; i < consumed; ++i) {
+        full.process_raw_sample(samples[i]);
+    }
+    EXPECT_EQ(idle.signal_level(), full.signal_level());
+    EXPECT_FALSE(full.is_idle());
+}
+
 TEST_F(SquelchTest, good_ctcss) {
     float tone = CTCSS::standard_tones[5];
     float sample_rate = 8000;
@@ -233,6 +261,54 @@ TEST_F(SquelchTest, wrong_ctcss) {
     EXPECT_GT(squelch.no_ctcss_count(), 0);
 }
 
+TEST_F(SquelchTest, ctcss_reduced) {
+    float tone = CTCSS::standard_tones[5];
+    float other_tone = CTCSS::standard_tones[7];
+    float sample_rate = 8000;
+
+    // the right tone still opens the squelch at the reduced rate, with speech band audio around it
+    Squelch squelch;
+    squelch.set_ctcss_freq(tone, sample_rate);
+    squelch.set_ctcss_reduced(true);
+    send_samples_for_noise_floor(squelch);
+
+    GenerateSignal signal_with_tone(sample_rate);
+    signal_with_tone.add_tone(tone, Tone::NORMAL);
+    signal_with_tone.add_tone(2100, Tone::STRONG);
+
+    for (int i = 0; i < 500 && !squelch.should_process_audio(); ++i) {
+        squelch.process_raw_sample(raw_signal_sample);
+    }
+    ASSERT_TRUE(squelch.should_process_audio());
+    for (int i = 0; i < 500 && !squelch.is_open(); ++i) {
+        squelch.process_audio_sample(signal_with_tone.get_sample());
+        squelch.process_raw_sample(raw_signal_sample);
+    }
+    ASSERT_TRUE(squelch.is_open());
+    for (int i = 0; i < 100000; ++i) {
+        squelch.process_audio_sample(signal_with_tone.get_sample());
+        squelch.process_raw_sample(raw_signal_sample);
+        ASSERT_TRUE(squelch.is_open());
+    }
+    EXPECT_GT(squelch.ctcss_count(), 0);
+    EXPECT_EQ(squelch.no_ctcss_count(), 0);
+
+    // and a carrier with another tone keeps it closed
+    Squelch wrong;
+    wrong.set_ctcss_freq(other_tone, sample_rate);
+    wrong.set_ctcss_reduced(true);
+    send_samples_for_noise_floor(wrong);
+    for (int i = 0; i < 100000; ++i) {
+        wrong.process_audio_sample(signal_with_tone.get_sample());
+        wrong.process_raw_sample(raw_signal_sample);
+        if (i > 4000) {
+            ASSERT_FALSE(wrong.is_open());
+        }
+    }
+    EXPECT_EQ(wrong.ctcss_count(), 0);
+    EXPECT_GT(wrong.no_ctcss_count(), 0);
+}
+
 TEST_F(SquelchTest, close_ctcss) {
     float actual_tone = CTCSS::standard_tones[5];
     float expected_tone = CTCSS::standard_tones[7];
@@ -279,3 +355,41 @@ TEST_F(SquelchTest, close_ctcss) {
     EXPECT_EQ(squelch.ctcss_count(), 0);
     EXPECT_GT(squelch.no_ctcss_count(), 0);
 }
+
+TEST_F(SquelchTest, copy_settings) {
+    Squelch squelch;
+    send_samples_for_noise_floor(squelch);
+    float noise_level = squelch.noise_level();
+
+    // a manual level above the signal keeps the squelch closed, the measured noise floor stays
+    Squelch configured;
+    configured.set_squelch_level_threshold(2.0f * raw_signal_sample);
+    squelch.copy_settings(configured);
+    EXPECT_EQ(squelch.noise_level(), noise_level);
+    EXPECT_GT(squelch.squelch_level(), raw_signal_sample);
+
+    for (int i = 0; i < 1000; ++i) {
+        squelch.process_raw_sample(raw_signal_sample);
+        ASSERT_FALSE(squelch.is_open());
+    }
+}
+
+TEST_F(SquelchTest, restore_levels) {
+    Squelch squelch;
+    send_samples_for_noise_floor(squelch);
+    SquelchLevels levels = squelch.levels();
+    EXPECT_EQ(levels.noise_floor, squelch.noise_level());
+    EXPECT_EQ(levels.signal, squelch.signal_level());
+
+    // a new squelch starts with the learned noise floor instead of the high default
+    Squelch restored;
+    restored.restore_levels(levels);
+    EXPECT_EQ(restored.noise_level(), squelch.noise_level());
+    EXPECT_EQ(restored.squelch_level(), squelch.squelch_level());
+
+    // and opens on the first signal, without learning the noise floor first
+    for (int i = 0; i < 1000 && !restored.is_open(); ++i) {
+        restored.process_raw_sample(raw_signal_sample);
+    }
+    EXPECT_TRUE(restored.is_open());
+}
@@ -0,0 +1,86 @@
+/*
+ * test_thread_sched.cpp
+ *
+ * Copyright (C) 2024 charlie-foxtrot
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "test_base_class.h"
+
+#include <sched.h>
+
+#include <thread>
+
+#include "thread_sched.h"
+
+using namespace std;
+
+class ThreadSchedTest : public TestBaseClass {
+   protected:
+    void TearDown(void) {
+        for (int i = 0; i < THREAD_CLASS_COUNT; i++) {
+            thread_sched[i] = thread_sched_t();
+        }
+        TestBaseClass::TearDown();
+    }
+};
+
+TEST_F(ThreadSchedTest, parse_cpu_list) {
+    vector<int> cpus;
+    ASSERT_TRUE(parse_cpu_list("3", cpus));
+    EXPECT_EQ(cpus, vector<int>({3}));
+    ASSERT_TRUE(parse_cpu_list("0-3,6", cpus));
+    EXPECT_EQ(cpus, vector<int>({0, 1, 2, 3, 6}));
+    ASSERT_TRUE(parse_cpu_list("6,2-3,3", cpus));
+    EXPECT_EQ(cpus, vector<int>({2, 3, 6}));
+}
+
+TEST_F(ThreadSchedTest, parse_bad_cpu_list) {
+    vector<int> cpus;
+    EXPECT_FALSE(parse_cpu_list("", cpus));
+    EXPECT_FALSE(parse_cpu_list("a", cpus));
+    EXPECT_FALSE(parse_cpu_list("1,", cpus));
+    EXPECT_FALSE(parse_cpu_list("3-1", cpus));
+    EXPECT_FALSE(parse_cpu_list("-1", cpus));
+    EXPECT_FALSE(parse_cpu_list("1 2", cpus));
+    EXPECT_FALSE(parse_cpu_list("5000", cpus));
+}
+
+TEST_F(ThreadSchedTest, class_names) {
+    EXPECT_STREQ(thread_class_name(THREAD_RX), "rx");
+    EXPECT_STREQ(thread_class_name(THREAD_UPLOADER), "uploader");
+    EXPECT_EQ(thread_class_name(THREAD_CLASS_COUNT), (const char*)NULL);
+}
+
+TEST_F(ThreadSchedTest, apply_affinity) {
+    if (!thread_affinity_supported()) {
+        GTEST_SKIP();
+    }
+    cpu_set_t allowed;
+    ASSERT_EQ(sched_getaffinity(0, sizeof(allowed), &allowed), 0);
+    int cpu = 0;
+    while (!CPU_ISSET(cpu, &allowed)) {
+        cpu++;
+    }
+    thread_sched[THREAD_DEMOD].cpus.push_back(cpu);
+
+    int ran_on = -1;
+    thread t([&ran_on]() {
+        thread_sched_apply(THREAD_DEMOD);
+        ran_on = sched_getcpu();
+    });
+    t.join();
+    EXPECT_EQ(ran_on, cpu);
+}
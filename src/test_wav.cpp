@@ -0,0 +1,143 @@
+/*
+ * test_wav.cpp
+ *
+ * Copyright (C) 2024 charlie-foxtrot
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <cmath>
+#include <string>
+
+#include "test_base_class.h"
+
+#include "wav.h"
+
+using namespace std;
+
+class WavTest : public TestBaseClass {
+   protected:
+    static uint32_t get32(const vector<unsigned char>& data, size_t pos) { return data[pos] | (data[pos + 1] << 8) | (data[pos + 2] << 16) | ((uint32_t)data[pos + 3] << 24); }
+    static int16_t get16(const vector<unsigned char>& data, size_t pos) { return (int16_t)(data[pos] | (data[pos + 1] << 8)); }
+
+    // Plain IMA ADPCM decoder of a mono block
+    static vector<int> decode_block(const vector<unsigned char>& data, size_t pos) {
+        static const int steps[89] = {7,    8,    9,    10,   11,   12,   13,   14,   16,   17,    19,    21,    23,    25,    28,    31,    34,    37,    41,    45,    50,    55,    60,
+                                      66,   73,   80,   88,   97,   107,  118,  130,  143,  157,   173,   190,   209,   230,   253,   279,   307,   337,   371,   408,   449,   494,   544,
+                                      598,  658,  724,  796,  876,  963,  1060, 1166, 1282, 1411,  1552,  1707,  1878,  2066,  2272,  2499,  2749,  3024,  3327,  3660,  4026,  4428,  4871,
+                                      5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767};
+        static const int indexes[16] = {-1, -1, -1, -1, 2, 4, 6, 8, -1, -1, -1, -1, 2, 4, 6, 8};
+        vector<int> samples;
+        int predictor = get16(data, pos);
+        int index = data[pos + 2];
+        samples.push_back(predictor);
+        for (size_t i = 4; i < IMA_ADPCM_BLOCK_ALIGN; i++) {
+            for (int shift = 0; shift <= 4; shift += 4) {
+                const int code = (data[pos + i] >> shift) & 0xf;
+                const int step = steps[index];
+                int delta = step >> 3;
+                if (code & 4) {
+                    delta += step;
+                }
+                if (code & 2) {
+                    delta += step >> 1;
+                }
+                if (code & 1) {
+                    delta += step >> 2;
+                }
+                predictor += (code & 8) ? -delta : delta;
+                predictor = max(-32768, min(32767, predictor));
+                index = max(0, min(88, index + indexes[code]));
+                samples.push_back(predictor);
+            }
+        }
+        return samples;
+    }
+};
+
+TEST_F(WavTest, pcm) {
+    WavEncoder encoder(WAV_PCM16, 2, 8000);
+    vector<unsigned char> header = encoder.header(400);
+    ASSERT_EQ(header.size(), encoder.header_size());
+    EXPECT_EQ(string(header.begin(), header.begin() + 4), "RIFF");
+    EXPECT_EQ(get32(header, 4), 36 + 400);
+    EXPECT_EQ(get16(header, 20), 1);
+    EXPECT_EQ(get16(header, 22), 2);
+    EXPECT_EQ(get32(header, 24), 8000);
+    EXPECT_EQ(get32(header, 28), 32000);
+    EXPECT_EQ(get32(header, 40), 400);
+
+    const float left[] = {0.0f, 0.5f, 2.0f};
+    const float right[] = {-0.5f, -1.0f, -2.0f};
+    const vector<unsigned char>& data = encoder.encode(left, right, 3);
+    ASSERT_EQ(data.size(), 12);
+    EXPECT_EQ(get16(data, 0), 0);
+    EXPECT_EQ(get16(data, 2), -16383);
+    EXPECT_EQ(get16(data, 4), 16383);
+    EXPECT_EQ(get16(data, 6), -32767);
+    EXPECT_EQ(get16(data, 8), 32767);  // clipped
+    EXPECT_EQ(get16(data, 10), -32767);
+    EXPECT_TRUE(encoder.flush().empty());
+}
+
+TEST_F(WavTest, adpcm_header) {
+    WavEncoder encoder(WAV_IMA_ADPCM, 1, 8000);
+    vector<unsigned char> header = encoder.header(3 * IMA_ADPCM_BLOCK_ALIGN);
+    ASSERT_EQ(header.size(), encoder.header_size());
+    EXPECT_EQ(get16(header, 20), 0x11);
+    EXPECT_EQ(get16(header, 32), IMA_ADPCM_BLOCK_ALIGN);
+    EXPECT_EQ(get16(header, 38), IMA_ADPCM_BLOCK_SAMPLES);
+    EXPECT_EQ(string(header.begin() + 40, header.begin() + 44), "fact");
+    EXPECT_EQ(get32(header, 48), 3 * IMA_ADPCM_BLOCK_SAMPLES);
+    EXPECT_EQ(string(header.begin() + 52, header.begin() + 56), "data");
+    EXPECT_EQ(get32(header, 56), 3 * IMA_ADPCM_BLOCK_ALIGN);
+}
+
+TEST_F(WavTest, adpcm_round_trip) {
+    WavEncoder encoder(WAV_IMA_ADPCM, 1, 8000);
+    vector<float> tone(2 * IMA_ADPCM_BLOCK_SAMPLES);
+    for (size_t i = 0; i < tone.size(); i++) {
+        tone[i] = 0.5f * sinf(2.0f * M_PI * 440.0f * i / 8000.0f);
+    }
+
+    // a block is written once it is complete, the rest waits for more samples or flush()
+    vector<unsigned char> data = encoder.encode(tone.data(), NULL, IMA_ADPCM_BLOCK_SAMPLES + 100);
+    ASSERT_EQ(data.size(), IMA_ADPCM_BLOCK_ALIGN);
+    const vector<unsigned char>& rest = encoder.flush();
+    ASSERT_EQ(rest.size(), IMA_ADPCM_BLOCK_ALIGN);
+    data.insert(data.end(), rest.begin(), rest.end());
+
+    vector<int> decoded = decode_block(data, 0);
+    vector<int> second = decode_block(data, IMA_ADPCM_BLOCK_ALIGN);
+    decoded.insert(decoded.end(), second.begin(), second.end());
+    ASSERT_EQ(decoded.size(), 2 * IMA_ADPCM_BLOCK_SAMPLES);
+    // the step size adapts within the first few samples
+    for (size_t i = 20; i < IMA_ADPCM_BLOCK_SAMPLES + 100; i++) {
+        EXPECT_NEAR(decoded[i], tone[i] * 32767.0f, 1200.0f) << "sample " << i;
+    }
+    // padded with silence
+    EXPECT_NEAR(decoded.back(), 0, 100);
+}
+
+TEST_F(WavTest, adpcm_stereo_layout) {
+    WavEncoder encoder(WAV_IMA_ADPCM, 2, 8000);
+    vector<float> left(IMA_ADPCM_BLOCK_SAMPLES, 0.25f), right(IMA_ADPCM_BLOCK_SAMPLES, -0.25f);
+    const vector<unsigned char>& data = encoder.encode(left.data(), right.data(), IMA_ADPCM_BLOCK_SAMPLES);
+    ASSERT_EQ(data.size(), 2 * IMA_ADPCM_BLOCK_ALIGN);
+    // one header per channel, then codes in groups of 4 bytes per channel
+    EXPECT_EQ(get16(data, 0), 8191);
+    EXPECT_EQ(get16(data, 4), -8191);
+    EXPECT_EQ(data[8], 0);  // left: no change
+    EXPECT_EQ(data[12], 0);
+}
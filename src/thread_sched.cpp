@@ -0,0 +1,164 @@
+/*
+ * thread_sched.cpp
+ * CPU affinity and scheduling of the program's threads
+ *
+ * Copyright (C) 2024 charlie-foxtrot
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE  // cpu_set_t, pthread_setaffinity_np()
+#endif
+
+#include "config.h"
+
+#include "thread_sched.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>         // sched_param, SCHED_FIFO
+#include <stdlib.h>        // strtol()
+#include <string.h>        // memset(), strerror()
+#include <sys/resource.h>  // setpriority()
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/syscall.h>  // SYS_gettid
+#endif /* __linux__ */
+#include <algorithm>  // sort, unique
+
+#include "logging.h"  // log()
+
+using namespace std;
+
+#define MAX_CPU 1023
+
+thread_sched_t thread_sched[THREAD_CLASS_COUNT];
+
+static const char* const thread_class_names[THREAD_CLASS_COUNT] = {"rx", "demod", "output", "mixer", "controller", "uploader"};
+
+const char* thread_class_name(int cls) {
+    if (cls < 0 || cls >= THREAD_CLASS_COUNT) {
+        return NULL;
+    }
+    return thread_class_names[cls];
+}
+
+bool thread_affinity_supported(void) {
+#ifdef HAVE_PTHREAD_SETAFFINITY_NP
+    return true;
+#else
+    return false;
+#endif /* HAVE_PTHREAD_SETAFFINITY_NP */
+}
+
+static bool parse_cpu(const char* s, char** end, int* cpu) {
+    if (*s < '0' || *s > '9') {
+        return false;
+    }
+    long n = strtol(s, end, 10);
+    if (n > MAX_CPU) {
+        return false;
+    }
+    *cpu = (int)n;
+    return true;
+}
+
+bool parse_cpu_list(const char* list, vector<int>& cpus) {
+    cpus.clear();
+    const char* s = list;
+    for (;;) {
+        char* end;
+        int first, last;
+        if (!parse_cpu(s, &end, &first)) {
+            return false;
+        }
+        last = first;
+        if (*end == '-' && (!parse_cpu(end + 1, &end, &last) || last < first)) {
+            return false;
+        }
+        for (int cpu = first; cpu <= last; cpu++) {
+            cpus.push_back(cpu);
+        }
+        if (*end == '\0') {
+            break;
+        }
+        if (*end != ',') {
+            return false;
+        }
+        s = end + 1;
+    }
+    sort(cpus.begin(), cpus.end());
+    cpus.erase(unique(cpus.begin(), cpus.end()), cpus.end());
+    return true;
+}
+
+#ifdef HAVE_PTHREAD_SETAFFINITY_NP
+static void make_cpu_set(const vector<int>& cpus, cpu_set_t* set) {
+    CPU_ZERO(set);
+    for (size_t i = 0; i < cpus.size(); i++) {
+        CPU_SET(cpus[i], set);
+    }
+}
+#endif /* HAVE_PTHREAD_SETAFFINITY_NP */
+
+void thread_sched_apply(thread_class_t cls) {
+    const thread_sched_t& sched = thread_sched[cls];
+    int err;
+#ifdef HAVE_PTHREAD_SETAFFINITY_NP
+    if (!sched.cpus.empty()) {
+        cpu_set_t set;
+        make_cpu_set(sched.cpus, &set);
+        if ((err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set)) != 0) {
+            log(LOG_WARNING, "Cannot pin %s thread to its CPUs: %s\n", thread_class_names[cls], strerror(err));
+        }
+    }
+#endif /* HAVE_PTHREAD_SETAFFINITY_NP */
+    if (sched.rt_priority > 0) {
+        sched_param param;
+        memset(&param, 0, sizeof(param));
+        param.sched_priority = sched.rt_priority;
+        if ((err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param)) != 0) {
+            log(LOG_WARNING, "Cannot set real-time priority of %s thread: %s\n", thread_class_names[cls], strerror(err));
+        }
+    } else if (sched.nice != 0) {
+#ifdef __linux__
+        // on Linux every thread has its own nice value
+        if (setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), sched.nice) != 0) {
+            log(LOG_WARNING, "Cannot set nice value of %s thread: %s\n", thread_class_names[cls], strerror(errno));
+        }
+#else
+        log(LOG_WARNING, "Nice values of single threads are not supported on this platform\n");
+#endif /* __linux__ */
+    }
+}
+
+void thread_sched_place(void* buf, size_t len, thread_class_t cls) {
+#ifdef HAVE_PTHREAD_SETAFFINITY_NP
+    if (thread_sched[cls].cpus.empty()) {
+        return;
+    }
+    cpu_set_t saved, set;
+    make_cpu_set(thread_sched[cls].cpus, &set);
+    if (pthread_getaffinity_np(pthread_self(), sizeof(saved), &saved) != 0 || pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0) {
+        return;
+    }
+    memset(buf, 0, len);
+    pthread_setaffinity_np(pthread_self(), sizeof(saved), &saved);
+#else
+    UNUSED(buf);
+    UNUSED(len);
+    UNUSED(cls);
+#endif /* HAVE_PTHREAD_SETAFFINITY_NP */
+}
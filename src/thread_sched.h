@@ -0,0 +1,58 @@
+/*
+ * thread_sched.h
+ * CPU affinity and scheduling of the program's threads
+ *
+ * Copyright (C) 2024 charlie-foxtrot
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _THREAD_SCHED_H
+#define _THREAD_SCHED_H
+
+#include <cstddef>  // size_t
+#include <vector>
+
+enum thread_class_t { THREAD_RX, THREAD_DEMOD, THREAD_OUTPUT, THREAD_MIXER, THREAD_CONTROLLER, THREAD_UPLOADER, THREAD_CLASS_COUNT };
+
+struct thread_sched_t {
+    std::vector<int> cpus;  // empty - any CPU
+    int rt_priority;        // SCHED_FIFO priority, 0 - normal scheduling
+    int nice;
+};
+
+// Settings of every thread class, all default to no change
+extern thread_sched_t thread_sched[THREAD_CLASS_COUNT];
+
+// Name of the class in the threads section of the configuration, NULL if there is none
+const char* thread_class_name(int cls);
+
+// Whether CPU affinity can be set on this platform
+bool thread_affinity_supported(void);
+
+// Parse a CPU list like "0-3,6" into cpus (sorted, without duplicates), false if it is malformed
+bool parse_cpu_list(const char* list, std::vector<int>& cpus);
+
+// Apply the settings of the class to the calling thread, failures are only logged
+void thread_sched_apply(thread_class_t cls);
+
+/*
+ * Fault in the pages of buf from the CPUs of the class, so that a NUMA
+ * system allocates them on the node where that class runs (first touch).
+ * buf must not have been written to yet. Does nothing if the class is not
+ * pinned.
+ */
+void thread_sched_place(void* buf, size_t len, thread_class_t cls);
+
+#endif /* _THREAD_SCHED_H */
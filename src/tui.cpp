@@ -0,0 +1,114 @@
+/*
+ * tui.cpp
+ * Textual waterfalls displayed when running in the foreground
+ *
+ * Copyright (C) 2024 charlie-foxtrot
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdarg.h>  // va_start() / va_end()
+#include <stdio.h>   // vsnprintf(), fwrite()
+#include <string>    // std::string
+
+#include "rtl_airband.h"
+
+/*
+ * The demodulator only copies the levels of each channel into
+ * channel->tui after every batch. This thread draws them at its own pace,
+ * building the whole frame first and writing it to the terminal at once, so a
+ * slow terminal delays the display and not the demodulation.
+ */
+
+#define TUI_REFRESH_MS 125  // one waterfall row, about one wave batch
+#define TUI_DEVICE_ROWS 17  // screen rows taken by each device
+#define TUI_WATERFALL_ROWS 12
+
+static void append(std::string& frame, const char* format, ...) {
+    char buf[128];
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(buf, sizeof(buf), format, args);
+    va_end(args);
+    if (len > 0) {
+        frame.append(buf, len < (int)sizeof(buf) ? len : (int)sizeof(buf) - 1);
+    }
+}
+
+// Same as GOTOXY(), into the frame
+static void append_goto(std::string& frame, int x, int y) {
+    append(frame, "%c[%d;%df", 0x1B, y, x);
+}
+
+static void append_header(std::string& frame) {
+    append_goto(frame, 0, 0);
+    append(frame, "                                                                               ");
+    for (int i = 0; i < device_count; i++) {
+        append_goto(frame, 0, i * TUI_DEVICE_ROWS + 1);
+        for (int j = 0; j < devices[i].channel_count; j++) {
+            if (devices[i].mode == R_SCAN) {
+                // scan channels print their current frequency in every row, so their columns are wider
+                append_goto(frame, j * 19, i * TUI_DEVICE_ROWS + 1);
+            }
+            append(frame, " %7.3f  ", devices[i].channels[j].freqlist[devices[i].channels[j].freq_idx].frequency / 1000000.0);
+        }
+        if (i != device_count - 1) {
+            append_goto(frame, 0, i * TUI_DEVICE_ROWS + 16);
+            append(frame, "-------------------------------------------------------------------------------");
+        }
+    }
+}
+
+static void append_row(std::string& frame, int row) {
+    for (int i = 0; i < device_count; i++) {
+        device_t* dev = devices + i;
+        for (int j = 0; j < dev->channel_count; j++) {
+            const tui_snapshot_t& snap = dev->channels[j].tui;
+            if (snap.symbol == 0) {
+                continue;  // not demodulated yet
+            }
+            if (dev->mode == R_SCAN) {
+                append_goto(frame, j * 19, i * TUI_DEVICE_ROWS + row + 3);
+                append(frame, "%4.0f/%3.0f%c %7.3f ", level_to_dBFS(snap.signal_level), level_to_dBFS(snap.noise_level), snap.symbol, snap.frequency / 1000000.0);
+            } else {
+                append_goto(frame, j * 10, i * TUI_DEVICE_ROWS + row + 3);
+                append(frame, "%4.0f/%3.0f%c ", level_to_dBFS(snap.signal_level), level_to_dBFS(snap.noise_level), snap.symbol);
+            }
+        }
+    }
+}
+
+void* tui_thread(void*) {
+    std::string frame;
+    int row = 0;
+    fputs("\e[1;1H\e[2J", stdout);
+    while (!do_exit) {
+        if (governor_shed[SHED_TUI]) {
+            SLEEP(TUI_REFRESH_MS);
+            continue;
+        }
+        frame.clear();
+        {
+            ConfigReadLock config_read_lock;
+            // redrawn every time, as reloading the configuration may change the frequencies
+            append_header(frame);
+            append_row(frame, row);
+        }
+        fwrite(frame.data(), 1, frame.size(), stdout);
+        fflush(stdout);
+        row = (row + 1) % TUI_WATERFALL_ROWS;
+        SLEEP(TUI_REFRESH_MS);
+    }
+    return NULL;
+}
@@ -28,6 +28,7 @@
 
 bool udp_stream_init(udp_stream_data* sdata, mix_modes mode, size_t len) {
     // pre-allocate the stereo buffer
+    free(sdata->stereo_buffer);  // set up again after its device has been restarted
     if (mode == MM_STEREO) {
         sdata->stereo_buffer_len = len * 2;
         sdata->stereo_buffer = (float*)XCALLOC(sdata->stereo_buffer_len, sizeof(float));
@@ -104,5 +105,6 @@ void udp_stream_write(udp_stream_data* sdata, const float* data_left, const floa
 void udp_stream_shutdown(udp_stream_data* sdata) {
     if (sdata->send_socket != -1) {
         close(sdata->send_socket);
+        sdata->send_socket = -1;
     }
 }
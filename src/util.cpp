@@ -178,3 +178,49 @@ float dBFS_to_level(const float& dBFS) {
 float level_to_dBFS(const float& level) {
     return std::min(0.0f, 20.0f * log10f(level / fft_size) + dBFS_offset());
 }
+
+// FFT bin holding the given frequency when the device is tuned to centerfreq
+size_t freq_to_bin(int freq, int centerfreq, int sample_rate) {
+    return (size_t)ceil((freq + sample_rate - centerfreq) / (double)(sample_rate / fft_size) - 1.0) % fft_size;
+}
+
+// Downmixing is done only for NFM and raw IQ outputs. It's not critical to have some residual
+// freq offset in AM, as it doesn't affect sound quality significantly.
+uint32_t downmix_dphi(int freq, int centerfreq, int sample_rate) {
+    double dm_dphi = (double)(freq - centerfreq);  // downmix freq in Hz
+
+    // In general, sample_rate is not required to be an integer multiple of WAVE_RATE.
+    // However the FFT window may only slide by an integer number of input samples. A non-zero rounding error
+    // introduces additional phase rotation which we have to compensate in order to shift the channel of interest
+    // to the center of the spectrum of the output I/Q stream. This is important for correct NFM demodulation.
+    // The error value (in Hz):
+    // - has an absolute value 0..WAVE_RATE/2
+    // - is linear with the error introduced by rounding the value of sample_rate/WAVE_RATE to the nearest integer
+    //   (range of -0.5..0.5)
+    // - is linear with the distance between center frequency and the channel frequency, normalized to 0..1
+    double decimation_factor = ((double)sample_rate / (double)WAVE_RATE);
+    double dm_dphi_correction = (double)WAVE_RATE / 2.0;
+    dm_dphi_correction *= (decimation_factor - round(decimation_factor));
+    dm_dphi_correction *= (double)(freq - centerfreq) / ((double)sample_rate / 2.0);
+
+    debug_print("freq %d: dm_dphi: %f Hz dm_dphi_correction: %f Hz\n", freq, dm_dphi, dm_dphi_correction);
+    dm_dphi -= dm_dphi_correction;
+    // Normalize
+    dm_dphi /= (double)WAVE_RATE;
+    // Unalias it, to prevent overflow of int during cast
+    dm_dphi -= trunc(dm_dphi);
+    // Translate this to uint32_t range 0x00000000-0x00ffffff
+    dm_dphi *= 256.0 * 65536.0;
+    // Cast it to signed int first, because casting negative float to uint is not portable
+    return (uint32_t)((int)dm_dphi);
+}
+
+// Scanning devices keep all monitored frequencies within 90% of the sampled bandwidth
+int scan_half_span(int sample_rate) {
+    return (int)((float)sample_rate / 2.f * 0.9f);
+}
+
+// ... and at least 20 FFT bins away from the DC spike
+int scan_dc_guard(int sample_rate) {
+    return 20 * (sample_rate / fft_size);
+}
@@ -0,0 +1,196 @@
+/*
+ * wav.cpp
+ * WAV encoding (16 bit PCM and IMA ADPCM) for file outputs
+ *
+ * Copyright (C) 2024 charlie-foxtrot
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "wav.h"
+
+using namespace std;
+
+#define WAV_PCM_HEADER_SIZE 44
+#define WAV_ADPCM_HEADER_SIZE 60  // the fmt chunk is longer and followed by a fact chunk
+
+static const int ima_step_table[89] = {7,     8,     9,     10,    11,    12,    13,    14,    16,    17,    19,    21,    23,    25,    28,    31,    34,    37,
+                                       41,    45,    50,    55,    60,    66,    73,    80,    88,    97,    107,   118,   130,   143,   157,   173,   190,   209,
+                                       230,   253,   279,   307,   337,   371,   408,   449,   494,   544,   598,   658,   724,   796,   876,   963,   1060,  1166,
+                                       1282,  1411,  1552,  1707,  1878,  2066,  2272,  2499,  2749,  3024,  3327,  3660,  4026,  4428,  4871,  5358,  5894,  6484,
+                                       7132,  7845,  8630,  9493,  10442, 11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767};
+
+static const int ima_index_table[16] = {-1, -1, -1, -1, 2, 4, 6, 8, -1, -1, -1, -1, 2, 4, 6, 8};
+
+static inline int16_t to_pcm16(float sample) {
+    if (sample >= 1.0f) {
+        return 32767;
+    }
+    if (sample <= -1.0f) {
+        return -32767;
+    }
+    return (int16_t)(sample * 32767.0f);
+}
+
+static void put16(vector<unsigned char>& out, uint16_t v) {
+    out.push_back(v & 0xff);
+    out.push_back(v >> 8);
+}
+
+static void put32(vector<unsigned char>& out, uint32_t v) {
+    put16(out, v & 0xffff);
+    put16(out, v >> 16);
+}
+
+static void put_id(vector<unsigned char>& out, const char* id) {
+    out.insert(out.end(), id, id + 4);
+}
+
+WavEncoder::WavEncoder(wav_format format, int channels, int sample_rate) : format_(format), channels_(channels), sample_rate_(sample_rate) {
+    step_index_[0] = step_index_[1] = 0;
+    if (format_ == WAV_IMA_ADPCM) {
+        block_.reserve(IMA_ADPCM_BLOCK_SAMPLES * channels_);
+    }
+}
+
+size_t WavEncoder::header_size(void) const {
+    return format_ == WAV_PCM16 ? WAV_PCM_HEADER_SIZE : WAV_ADPCM_HEADER_SIZE;
+}
+
+vector<unsigned char> WavEncoder::header(uint32_t data_bytes) const {
+    vector<unsigned char> out;
+    put_id(out, "RIFF");
+    put32(out, header_size() - 8 + data_bytes);
+    put_id(out, "WAVE");
+    put_id(out, "fmt ");
+    if (format_ == WAV_PCM16) {
+        put32(out, 16);
+        put16(out, 1);  // WAVE_FORMAT_PCM
+        put16(out, channels_);
+        put32(out, sample_rate_);
+        put32(out, sample_rate_ * channels_ * 2);
+        put16(out, channels_ * 2);
+        put16(out, 16);
+    } else {
+        const int block_align = IMA_ADPCM_BLOCK_ALIGN * channels_;
+        put32(out, 20);
+        put16(out, 0x11);  // WAVE_FORMAT_IMA_ADPCM
+        put16(out, channels_);
+        put32(out, sample_rate_);
+        put32(out, sample_rate_ * block_align / IMA_ADPCM_BLOCK_SAMPLES);
+        put16(out, block_align);
+        put16(out, 4);
+        put16(out, 2);  // extra format bytes
+        put16(out, IMA_ADPCM_BLOCK_SAMPLES);
+        put_id(out, "fact");
+        put32(out, 4);
+        put32(out, data_bytes / block_align * IMA_ADPCM_BLOCK_SAMPLES);
+    }
+    put_id(out, "data");
+    put32(out, data_bytes);
+    return out;
+}
+
+const vector<unsigned char>& WavEncoder::encode(const float* left, const float* right, size_t count) {
+    out_.clear();
+    for (size_t i = 0; i < count; i++) {
+        if (format_ == WAV_PCM16) {
+            put16(out_, (uint16_t)to_pcm16(left[i]));
+            if (channels_ == 2) {
+                put16(out_, (uint16_t)to_pcm16(right[i]));
+            }
+            continue;
+        }
+        block_.push_back(to_pcm16(left[i]));
+        if (channels_ == 2) {
+            block_.push_back(to_pcm16(right[i]));
+        }
+        if (block_.size() == (size_t)(IMA_ADPCM_BLOCK_SAMPLES * channels_)) {
+            encode_block();
+        }
+    }
+    return out_;
+}
+
+const vector<unsigned char>& WavEncoder::flush(void) {
+    out_.clear();
+    if (!block_.empty()) {
+        block_.resize(IMA_ADPCM_BLOCK_SAMPLES * channels_, 0);
+        encode_block();
+    }
+    return out_;
+}
+
+/*
+ * Every block starts with the first sample of each channel in full and the
+ * step index, the other samples follow as 4 bit codes, in groups of eight
+ * per channel.
+ */
+void WavEncoder::encode_block(void) {
+    int predictor[2];
+    for (int c = 0; c < channels_; c++) {
+        predictor[c] = block_[c];
+        put16(out_, (uint16_t)block_[c]);
+        out_.push_back((unsigned char)step_index_[c]);
+        out_.push_back(0);
+    }
+    for (int group = 0; group < (IMA_ADPCM_BLOCK_SAMPLES - 1) / 8; group++) {
+        for (int c = 0; c < channels_; c++) {
+            unsigned char byte = 0;
+            for (int k = 0; k < 8; k++) {
+                const int sample = block_[(1 + group * 8 + k) * channels_ + c];
+                const int step = ima_step_table[step_index_[c]];
+                int diff = sample - predictor[c];
+                int code = 0;
+                if (diff < 0) {
+                    code = 8;
+                    diff = -diff;
+                }
+                int delta = step >> 3;
+                if (diff >= step) {
+                    code |= 4;
+                    diff -= step;
+                    delta += step;
+                }
+                if (diff >= step >> 1) {
+                    code |= 2;
+                    diff -= step >> 1;
+                    delta += step >> 1;
+                }
+                if (diff >= step >> 2) {
+                    code |= 1;
+                    delta += step >> 2;
+                }
+                predictor[c] += (code & 8) ? -delta : delta;
+                if (predictor[c] > 32767) {
+                    predictor[c] = 32767;
+                } else if (predictor[c] < -32768) {
+                    predictor[c] = -32768;
+                }
+                step_index_[c] += ima_index_table[code];
+                if (step_index_[c] < 0) {
+                    step_index_[c] = 0;
+                } else if (step_index_[c] > 88) {
+                    step_index_[c] = 88;
+                }
+                if (k % 2 == 0) {
+                    byte = code;
+                } else {
+                    out_.push_back(byte | (code << 4));
+                }
+            }
+        }
+    }
+    block_.clear();
+}
@@ -0,0 +1,64 @@
+/*
+ * wav.h
+ * WAV encoding (16 bit PCM and IMA ADPCM) for file outputs
+ *
+ * Copyright (C) 2024 charlie-foxtrot
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _WAV_H
+#define _WAV_H
+
+#include <cstddef>  // size_t
+#include <cstdint>
+#include <vector>
+
+enum wav_format { WAV_PCM16, WAV_IMA_ADPCM };
+
+#define IMA_ADPCM_BLOCK_ALIGN 256  // bytes per block and channel
+#define IMA_ADPCM_BLOCK_SAMPLES ((IMA_ADPCM_BLOCK_ALIGN - 4) * 2 + 1)
+
+/*
+ * Turns float samples (-1.0 to 1.0) into the data chunk of a WAV file.
+ * IMA ADPCM takes 4 bits per sample and is written in whole blocks of
+ * IMA_ADPCM_BLOCK_SAMPLES samples, flush() pads the last one with silence.
+ */
+class WavEncoder {
+   public:
+    WavEncoder(wav_format format, int channels, int sample_rate);
+
+    size_t header_size(void) const;
+
+    // The header of a file with data_bytes of samples after it
+    std::vector<unsigned char> header(uint32_t data_bytes) const;
+
+    // count samples of each channel, right is ignored for mono. Returns the encoded bytes, valid until the next call
+    const std::vector<unsigned char>& encode(const float* left, const float* right, size_t count);
+
+    // Completes a partly filled ADPCM block, nothing for PCM
+    const std::vector<unsigned char>& flush(void);
+
+   private:
+    wav_format format_;
+    int channels_;
+    int sample_rate_;
+    std::vector<int16_t> block_;  // interleaved samples of the current ADPCM block
+    int step_index_[2];
+    std::vector<unsigned char> out_;
+
+    void encode_block(void);
+};
+
+#endif /* _WAV_H */